@@ -1,5 +1,14 @@
 #include "client_commandline.h"
 #include <iostream>
+#include <sstream>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <atomic>
 #include <openvr.h>
 #include <vrinputemulator.h>
 #include <openvr_math.h>
@@ -452,6 +461,52 @@ void setDeviceRotation(int argc, const char* argv[]) {
 	inputEmulator.setVirtualDevicePose(deviceId, pose);
 }
 
+
+void setDevicePrediction(int argc, const char* argv[]) {
+	if (argc > 2 && std::strcmp(argv[2], "help") == 0) {
+		std::stringstream ss;
+		ss << "Usage: client_commandline.exe setdeviceprediction <virtualId> off|<maxPredictionMs> [<accelerationDampingMs>]" << std::endl << std::endl
+			<< "Extrapolates the pose of a virtual device between client updates, for at most maxPredictionMs." << std::endl
+			<< "accelerationDampingMs is the time constant the estimated acceleration fades out with (0 .. velocity only).";
+		throw std::runtime_error(ss.str());
+	} else if (argc < 4) {
+		throw std::runtime_error("Error: Too few arguments.");
+	}
+	uint32_t deviceId = std::atoi(argv[2]);
+	vrinputemulator::PosePredictionSettings settings;
+	if (std::strcmp(argv[3], "off") != 0) {
+		settings.enabled = true;
+		settings.maxPredictionTime = std::atof(argv[3]) / 1000.0;
+		if (argc > 4) {
+			settings.accelerationDamping = std::atof(argv[4]) / 1000.0;
+		}
+	}
+	vrinputemulator::VRInputEmulator inputEmulator;
+	inputEmulator.connect();
+	inputEmulator.setVirtualDevicePosePrediction(deviceId, settings);
+}
+
+
+void posePump(int argc, const char* argv[]) {
+	if (argc > 2 && std::strcmp(argv[2], "help") == 0) {
+		std::stringstream ss;
+		ss << "Usage: client_commandline.exe posepump <rate> [<virtualId>]" << std::endl << std::endl
+			<< "Without virtualId sets the rate (Hz) of the driver's pose pump, 0 stops it." << std::endl
+			<< "With virtualId sets the rate of a single virtual device, 0 uses the pump's rate.";
+		throw std::runtime_error(ss.str());
+	} else if (argc < 3) {
+		throw std::runtime_error("Error: Too few arguments.");
+	}
+	uint32_t rate = std::atoi(argv[2]);
+	vrinputemulator::VRInputEmulator inputEmulator;
+	inputEmulator.connect();
+	if (argc > 3) {
+		inputEmulator.setVirtualDevicePoseRate(std::atoi(argv[3]), rate);
+	} else {
+		inputEmulator.setPosePumpRate(rate);
+	}
+}
+
 void deviceOffsets(int argc, const char * argv[]) {
 	if (argc > 2 && std::strcmp(argv[2], "help") == 0) {
 		std::stringstream ss;
@@ -555,10 +610,14 @@ void deviceOffsets(int argc, const char * argv[]) {
 void benchmarkIPC(int argc, const char* argv[]) {
 	if (argc > 2 && std::strcmp(argv[2], "help") == 0) {
 		std::stringstream ss;
-		ss << "Usage: client_commandline.exe benchmarkipc [all|roundtrip|throughput1|throughput2|throughput]";
+		ss << "Usage: client_commandline.exe benchmarkipc [all|roundtrip|throughput1|throughput2|throughput] [count]" << std::endl
+			<< "       client_commandline.exe benchmarkipc latency [options]";
 		throw std::runtime_error(ss.str());
 	} else if (argc < 3) {
 		throw std::runtime_error("Error: Too few arguments.");
+	} else if (std::strcmp(argv[2], "latency") == 0) {
+		benchmarkIPCLatency(argc, argv);
+		return;
 	}
 	uint32_t benchmarkMask = 0;
 	if (std::strcmp(argv[2], "all") == 0) {
@@ -617,3 +676,701 @@ void benchmarkIPC(int argc, const char* argv[]) {
 	std::cout << "IPC request size: " << sizeof(vrinputemulator::ipc::Request) << " bytes" << std::endl;
 	std::cout << "IPC reply size: " << sizeof(vrinputemulator::ipc::Reply) << " bytes" << std::endl;
 }
+
+
+namespace {
+
+enum class BenchmarkOp : unsigned {
+	Ping = 0,
+	Button,
+	Axis,
+	Pose,
+	Property,
+	Count
+};
+
+static const char* const benchmarkOpNames[] = { "ping", "button", "axis", "pose", "property" };
+
+// Round-trip ops wait for the driver's reply, the others only measure how long it takes to hand the message to the queue
+static const bool benchmarkOpIsRoundtrip[] = { true, false, false, false, true };
+
+
+struct BenchmarkOptions {
+	unsigned clients = 1;
+	unsigned threads = 1;
+	unsigned count = 10000; // per thread
+	uint32_t deviceId = vr::k_unMaxTrackedDeviceCount - 1; // Unused by default, so the driver does not forward anything
+	unsigned mix[(unsigned)BenchmarkOp::Count] = { 1, 0, 0, 0, 0 };
+	bool sweep = false;
+	std::string format = "text";
+};
+
+
+struct BenchmarkResult {
+	std::string scenario;
+	std::string op;
+	bool roundtrip;
+	uint64_t count;
+	double totalSeconds;
+	double min;
+	double mean;
+	double p50;
+	double p99;
+	double p999;
+	double max;
+};
+
+
+// samples are in microseconds, they get sorted
+BenchmarkResult computeBenchmarkResult(const std::string& scenario, const std::string& op, bool roundtrip, std::vector<double>& samples, double totalSeconds) {
+	BenchmarkResult r;
+	r.scenario = scenario;
+	r.op = op;
+	r.roundtrip = roundtrip;
+	r.count = samples.size();
+	r.totalSeconds = totalSeconds;
+	r.min = r.mean = r.p50 = r.p99 = r.p999 = r.max = 0.0;
+	if (!samples.empty()) {
+		std::sort(samples.begin(), samples.end());
+		auto percentile = [&samples](double p) {
+			auto index = (size_t)(p * (double)(samples.size() - 1) + 0.5);
+			return samples[std::min(index, samples.size() - 1)];
+		};
+		double sum = 0.0;
+		for (auto s : samples) {
+			sum += s;
+		}
+		r.min = samples.front();
+		r.max = samples.back();
+		r.mean = sum / (double)samples.size();
+		r.p50 = percentile(0.5);
+		r.p99 = percentile(0.99);
+		r.p999 = percentile(0.999);
+	}
+	return r;
+}
+
+
+void printBenchmarkResults(const BenchmarkOptions& options, const std::vector<BenchmarkResult>& results) {
+	if (options.format == "csv") {
+		std::cout << "scenario,op,kind,clients,threads,count,total_s,msg_per_s,min_us,mean_us,p50_us,p99_us,p999_us,max_us" << std::endl;
+		for (auto& r : results) {
+			std::cout << r.scenario << "," << r.op << "," << (r.roundtrip ? "roundtrip" : "send") << "," << options.clients << "," << options.threads << ","
+				<< r.count << "," << r.totalSeconds << "," << (r.totalSeconds > 0.0 ? (double)r.count / r.totalSeconds : 0.0) << ","
+				<< r.min << "," << r.mean << "," << r.p50 << "," << r.p99 << "," << r.p999 << "," << r.max << std::endl;
+		}
+	} else if (options.format == "json") {
+		std::cout << "{" << std::endl
+			<< "  \"requestSize\": " << sizeof(vrinputemulator::ipc::Request) << "," << std::endl
+			<< "  \"replySize\": " << sizeof(vrinputemulator::ipc::Reply) << "," << std::endl
+			<< "  \"clients\": " << options.clients << "," << std::endl
+			<< "  \"threads\": " << options.threads << "," << std::endl
+			<< "  \"results\": [" << std::endl;
+		for (size_t i = 0; i < results.size(); ++i) {
+			auto& r = results[i];
+			std::cout << "    { \"scenario\": \"" << r.scenario << "\", \"op\": \"" << r.op << "\", \"kind\": \"" << (r.roundtrip ? "roundtrip" : "send")
+				<< "\", \"count\": " << r.count << ", \"totalSeconds\": " << r.totalSeconds
+				<< ", \"messagesPerSecond\": " << (r.totalSeconds > 0.0 ? (double)r.count / r.totalSeconds : 0.0)
+				<< ", \"minUs\": " << r.min << ", \"meanUs\": " << r.mean << ", \"p50Us\": " << r.p50
+				<< ", \"p99Us\": " << r.p99 << ", \"p999Us\": " << r.p999 << ", \"maxUs\": " << r.max << " }"
+				<< (i + 1 < results.size() ? "," : "") << std::endl;
+		}
+		std::cout << "  ]" << std::endl << "}" << std::endl;
+	} else {
+		std::cout << "IPC request size: " << sizeof(vrinputemulator::ipc::Request) << " bytes, reply size: " << sizeof(vrinputemulator::ipc::Reply) << " bytes" << std::endl;
+		std::cout << "Clients: " << options.clients << ", threads per client: " << options.threads << std::endl;
+		for (auto& r : results) {
+			std::cout << r.scenario << " / " << r.op << " (" << (r.roundtrip ? "round-trip" : "send") << "): " << r.count << " msgs, "
+				<< (r.totalSeconds > 0.0 ? (double)r.count / r.totalSeconds : 0.0) << " msg/s" << std::endl
+				<< "    min " << r.min << " us, mean " << r.mean << " us, p50 " << r.p50 << " us, p99 " << r.p99
+				<< " us, p99.9 " << r.p999 << " us, max " << r.max << " us" << std::endl;
+		}
+	}
+}
+
+
+void executeBenchmarkOp(vrinputemulator::VRInputEmulator& inputEmulator, BenchmarkOp op, const BenchmarkOptions& options, unsigned iteration) {
+	switch (op) {
+		case BenchmarkOp::Ping:
+			inputEmulator.ping();
+			break;
+		case BenchmarkOp::Button:
+			inputEmulator.openvrButtonEvent((iteration & 1) ? vrinputemulator::ButtonEventType::ButtonUnpressed : vrinputemulator::ButtonEventType::ButtonPressed,
+				options.deviceId, vr::k_EButton_SteamVR_Trigger);
+			break;
+		case BenchmarkOp::Axis: {
+			vr::VRControllerAxis_t axisState;
+			axisState.x = std::sin((float)iteration * 0.01f);
+			axisState.y = std::cos((float)iteration * 0.01f);
+			inputEmulator.openvrAxisEvent(options.deviceId, 0, axisState);
+		} break;
+		case BenchmarkOp::Pose: {
+			vr::DriverPose_t pose;
+			memset(&pose, 0, sizeof(vr::DriverPose_t));
+			pose.qWorldFromDriverRotation = { 1.0, 0.0, 0.0, 0.0 };
+			pose.qDriverFromHeadRotation = { 1.0, 0.0, 0.0, 0.0 };
+			pose.qRotation = { 1.0, 0.0, 0.0, 0.0 };
+			pose.vecPosition[0] = std::sin((double)iteration * 0.01);
+			pose.vecPosition[1] = 1.0;
+			pose.poseIsValid = true;
+			pose.deviceIsConnected = true;
+			pose.result = vr::TrackingResult_Running_OK;
+			inputEmulator.openvrUpdatePose(options.deviceId, pose);
+		} break;
+		case BenchmarkOp::Property: {
+			vrinputemulator::DeviceInfo info;
+			try {
+				inputEmulator.getDeviceInfo(options.deviceId, info);
+			} catch (vrinputemulator::vrinputemulator_notfound&) {
+				// Still a full round trip
+			}
+		} break;
+		default:
+			break;
+	}
+}
+
+
+// Runs the message mix on all clients/threads and measures every single message
+void runMixBenchmark(const BenchmarkOptions& options, std::vector<BenchmarkResult>& results) {
+	std::vector<BenchmarkOp> schedule;
+	for (unsigned op = 0; op < (unsigned)BenchmarkOp::Count; ++op) {
+		for (unsigned i = 0; i < options.mix[op]; ++i) {
+			schedule.push_back((BenchmarkOp)op);
+		}
+	}
+	if (schedule.empty()) {
+		throw std::runtime_error("Error: Empty message mix.");
+	}
+	std::vector<std::unique_ptr<vrinputemulator::VRInputEmulator>> clients;
+	for (unsigned c = 0; c < options.clients; ++c) {
+		clients.emplace_back(new vrinputemulator::VRInputEmulator());
+		clients.back()->connect();
+	}
+	unsigned threadCount = options.clients * options.threads;
+	std::vector<std::vector<double>> samples(threadCount * (unsigned)BenchmarkOp::Count);
+	std::vector<std::thread> threads;
+	auto startTime = std::chrono::steady_clock::now();
+	for (unsigned t = 0; t < threadCount; ++t) {
+		threads.emplace_back([&, t]() {
+			auto& inputEmulator = *clients[t / options.threads];
+			for (unsigned i = 0; i < options.count; ++i) {
+				auto op = schedule[(i + t) % schedule.size()];
+				auto t0 = std::chrono::steady_clock::now();
+				executeBenchmarkOp(inputEmulator, op, options, i);
+				auto t1 = std::chrono::steady_clock::now();
+				samples[t * (unsigned)BenchmarkOp::Count + (unsigned)op].push_back(std::chrono::duration<double, std::micro>(t1 - t0).count());
+			}
+		});
+	}
+	for (auto& t : threads) {
+		t.join();
+	}
+	// wait till the driver queue is empty
+	clients[0]->ping();
+	double totalSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	for (unsigned op = 0; op < (unsigned)BenchmarkOp::Count; ++op) {
+		std::vector<double> opSamples;
+		for (unsigned t = 0; t < threadCount; ++t) {
+			auto& s = samples[t * (unsigned)BenchmarkOp::Count + op];
+			opSamples.insert(opSamples.end(), s.begin(), s.end());
+		}
+		if (!opSamples.empty()) {
+			results.push_back(computeBenchmarkResult("mix", benchmarkOpNames[op], benchmarkOpIsRoundtrip[op], opSamples, totalSeconds));
+		}
+	}
+}
+
+
+// All requests have the same size (sizeof(ipc::Request)), so instead of the message size we sweep the burst size:
+// n one-way messages are sent back to back followed by a ping, and the time until the ping returns is measured.
+void runBurstSweepBenchmark(const BenchmarkOptions& options, std::vector<BenchmarkResult>& results) {
+	static const unsigned burstSizes[] = { 1, 4, 16, 50, 100, 200 };
+	vrinputemulator::VRInputEmulator inputEmulator;
+	inputEmulator.connect();
+	for (auto burstSize : burstSizes) {
+		std::vector<double> samples;
+		unsigned iterations = std::max(1u, options.count / burstSize);
+		auto startTime = std::chrono::steady_clock::now();
+		for (unsigned i = 0; i < iterations; ++i) {
+			auto t0 = std::chrono::steady_clock::now();
+			for (unsigned j = 0; j < burstSize; ++j) {
+				executeBenchmarkOp(inputEmulator, BenchmarkOp::Pose, options, i * burstSize + j);
+			}
+			inputEmulator.ping();
+			auto t1 = std::chrono::steady_clock::now();
+			samples.push_back(std::chrono::duration<double, std::micro>(t1 - t0).count());
+		}
+		double totalSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+		auto r = computeBenchmarkResult("burst" + std::to_string(burstSize), "pose+ping", true, samples, totalSeconds);
+		r.count = (uint64_t)iterations * (burstSize + 1); // messages, the latencies are per burst
+		results.push_back(r);
+	}
+}
+
+
+void parseBenchmarkMix(const std::string& spec, BenchmarkOptions& options) {
+	for (auto& m : options.mix) {
+		m = 0;
+	}
+	std::stringstream ss(spec);
+	std::string item;
+	while (std::getline(ss, item, ',')) {
+		auto pos = item.find(':');
+		auto name = item.substr(0, pos);
+		unsigned weight = pos != std::string::npos ? std::atoi(item.substr(pos + 1).c_str()) : 1;
+		bool found = false;
+		for (unsigned op = 0; op < (unsigned)BenchmarkOp::Count; ++op) {
+			if (name == benchmarkOpNames[op]) {
+				options.mix[op] = weight;
+				found = true;
+			}
+		}
+		if (!found) {
+			throw std::runtime_error("Error: Unknown message type in mix: " + name);
+		}
+	}
+}
+
+} // end anonymous namespace
+
+
+void benchmarkIPCLatency(int argc, const char* argv[]) {
+	if (argc > 3 && std::strcmp(argv[3], "help") == 0) {
+		std::stringstream ss;
+		ss << "Usage: client_commandline.exe benchmarkipc latency [options]" << std::endl
+			<< "  --clients <n>\t\tNumber of concurrent client connections (default 1)" << std::endl
+			<< "  --threads <n>\t\tNumber of sending threads per client (default 1)" << std::endl
+			<< "  --count <n>\t\tMessages per thread (default 10000)" << std::endl
+			<< "  --mix <spec>\t\tMessage mix, e.g. ping:1,button:2,axis:4,pose:8,property:1 (default ping:1)" << std::endl
+			<< "  --device <openvrId>\tTarget device of button/axis/pose/property messages (default " << vr::k_unMaxTrackedDeviceCount - 1 << ")" << std::endl
+			<< "  --sweep\t\tAdditionally sweep the burst size (messages per round trip)" << std::endl
+			<< "  --format <fmt>\tOutput format: text, csv or json (default text)";
+		throw std::runtime_error(ss.str());
+	}
+	BenchmarkOptions options;
+	for (int i = 3; i < argc; ++i) {
+		bool hasValue = i + 1 < argc;
+		if (std::strcmp(argv[i], "--clients") == 0 && hasValue) {
+			options.clients = std::max(1, std::atoi(argv[++i]));
+		} else if (std::strcmp(argv[i], "--threads") == 0 && hasValue) {
+			options.threads = std::max(1, std::atoi(argv[++i]));
+		} else if (std::strcmp(argv[i], "--count") == 0 && hasValue) {
+			options.count = std::max(1, std::atoi(argv[++i]));
+		} else if (std::strcmp(argv[i], "--mix") == 0 && hasValue) {
+			parseBenchmarkMix(argv[++i], options);
+		} else if (std::strcmp(argv[i], "--device") == 0 && hasValue) {
+			options.deviceId = std::atoi(argv[++i]);
+		} else if (std::strcmp(argv[i], "--sweep") == 0) {
+			options.sweep = true;
+		} else if (std::strcmp(argv[i], "--format") == 0 && hasValue) {
+			options.format = argv[++i];
+			if (options.format != "text" && options.format != "csv" && options.format != "json") {
+				throw std::runtime_error("Error: Unknown output format.");
+			}
+		} else {
+			throw std::runtime_error(std::string("Error: Unknown option ") + argv[i]);
+		}
+	}
+	std::vector<BenchmarkResult> results;
+	runMixBenchmark(options, results);
+	if (options.sweep) {
+		runBurstSweepBenchmark(options, results);
+	}
+	printBenchmarkResults(options, results);
+}
+
+
+namespace {
+
+struct LoadgenDevice {
+	uint32_t virtualId = 0;
+	uint32_t openvrId = vr::k_unTrackedDeviceIndexInvalid;
+	double phase = 0.0;
+	std::chrono::steady_clock::time_point nextSendTime;
+	uint64_t sentPoses = 0;
+	uint64_t sentStates = 0;
+	// send times of the last poses, indexed by sequence number
+	static const unsigned sendTimeCount = 1024;
+	std::atomic<int64_t> sendTimes[sendTimeCount];
+	std::atomic<uint32_t> lastSequence { 0 };
+	uint32_t lastObservedSequence = 0;
+	std::vector<double> latencies; // microseconds, only touched by the monitor thread
+};
+
+
+int64_t loadgenNow() {
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+// Circles with slightly different radius/speed per device, the sequence number is hidden in vecAngularAcceleration[0]
+// (the driver forwards it untouched in default mode) so the monitor thread can match what it reads back to the send time.
+void loadgenMakePose(vr::DriverPose_t& pose, const LoadgenDevice& device, double t, uint32_t sequence) {
+	memset(&pose, 0, sizeof(vr::DriverPose_t));
+	double radius = 0.3 + 0.05 * (double)(device.virtualId % 8);
+	double speed = 1.0 + 0.1 * (double)(device.virtualId % 5);
+	double angle = t * speed + device.phase;
+	pose.qWorldFromDriverRotation = { 1.0, 0.0, 0.0, 0.0 };
+	pose.qDriverFromHeadRotation = { 1.0, 0.0, 0.0, 0.0 };
+	pose.vecPosition[0] = radius * std::cos(angle);
+	pose.vecPosition[1] = 1.0 + 0.1 * std::sin(angle * 2.0);
+	pose.vecPosition[2] = radius * std::sin(angle);
+	pose.vecVelocity[0] = -radius * speed * std::sin(angle);
+	pose.vecVelocity[1] = 0.2 * speed * std::cos(angle * 2.0);
+	pose.vecVelocity[2] = radius * speed * std::cos(angle);
+	pose.qRotation = vrmath::quaternionFromYawPitchRoll(-angle, 0.0, 0.0);
+	pose.vecAngularVelocity[1] = -speed;
+	pose.vecAngularAcceleration[0] = (double)sequence;
+	pose.poseIsValid = true;
+	pose.deviceIsConnected = true;
+	pose.result = vr::TrackingResult_Running_OK;
+}
+
+
+void loadgenMakeControllerState(vr::VRControllerState_t& state, double t, uint32_t packetNum) {
+	memset(&state, 0, sizeof(vr::VRControllerState_t));
+	state.unPacketNum = packetNum;
+	// trigger pressed every other second, joystick circling
+	bool triggerPressed = ((int64_t)t) & 1;
+	state.rAxis[0].x = (float)std::cos(t * 3.0);
+	state.rAxis[0].y = (float)std::sin(t * 3.0);
+	state.rAxis[1].x = triggerPressed ? 1.0f : 0.0f;
+	state.ulButtonTouched = vr::ButtonMaskFromId(vr::k_EButton_Axis0);
+	if (triggerPressed) {
+		state.ulButtonTouched |= vr::ButtonMaskFromId(vr::k_EButton_Axis1);
+		state.ulButtonPressed |= vr::ButtonMaskFromId(vr::k_EButton_Axis1);
+	}
+}
+
+} // end anonymous namespace
+
+
+void loadGenerator(int argc, const char* argv[]) {
+	if (argc > 2 && std::strcmp(argv[2], "help") == 0) {
+		std::stringstream ss;
+		ss << "Usage: client_commandline.exe loadgen [options]" << std::endl
+			<< "  --devices <n>\t\tNumber of virtual controllers (default 20)" << std::endl
+			<< "  --rate <hz>\t\tPose updates per second and device (default 90)" << std::endl
+			<< "  --staterate <n>\tSend a controller state every n-th pose, 0 disables (default 4)" << std::endl
+			<< "  --duration <s>\tDuration in seconds (default 10)" << std::endl
+			<< "  --policy <p>\t\tSend policy for pose updates: block, timed, dropnewest or dropoldest (default block)" << std::endl
+			<< "  --serial <prefix>\tSerial number prefix of the virtual controllers (default loadgen)";
+		throw std::runtime_error(ss.str());
+	}
+	unsigned deviceCount = 20;
+	double rate = 90.0;
+	unsigned stateRate = 4;
+	double duration = 10.0;
+	vrinputemulator::IpcSendPolicy policy = vrinputemulator::IpcSendPolicy::Block;
+	std::string serialPrefix = "loadgen";
+	for (int i = 2; i < argc; ++i) {
+		bool hasValue = i + 1 < argc;
+		if (std::strcmp(argv[i], "--devices") == 0 && hasValue) {
+			deviceCount = std::max(1, std::atoi(argv[++i]));
+		} else if (std::strcmp(argv[i], "--rate") == 0 && hasValue) {
+			rate = std::max(1.0, std::atof(argv[++i]));
+		} else if (std::strcmp(argv[i], "--staterate") == 0 && hasValue) {
+			stateRate = std::max(0, std::atoi(argv[++i]));
+		} else if (std::strcmp(argv[i], "--duration") == 0 && hasValue) {
+			duration = std::max(0.1, std::atof(argv[++i]));
+		} else if (std::strcmp(argv[i], "--policy") == 0 && hasValue) {
+			++i;
+			if (std::strcmp(argv[i], "block") == 0) {
+				policy = vrinputemulator::IpcSendPolicy::Block;
+			} else if (std::strcmp(argv[i], "timed") == 0) {
+				policy = vrinputemulator::IpcSendPolicy::TimedBlock;
+			} else if (std::strcmp(argv[i], "dropnewest") == 0) {
+				policy = vrinputemulator::IpcSendPolicy::DropNewest;
+			} else if (std::strcmp(argv[i], "dropoldest") == 0) {
+				policy = vrinputemulator::IpcSendPolicy::DropOldest;
+			} else {
+				throw std::runtime_error("Error: Unknown send policy.");
+			}
+		} else if (std::strcmp(argv[i], "--serial") == 0 && hasValue) {
+			serialPrefix = argv[++i];
+		} else {
+			throw std::runtime_error(std::string("Error: Unknown option ") + argv[i]);
+		}
+	}
+	if (deviceCount > vr::k_unMaxTrackedDeviceCount) {
+		throw std::runtime_error("Error: Too many devices.");
+	}
+
+	vrinputemulator::VRInputEmulator inputEmulator;
+	inputEmulator.connect();
+
+	// Create and publish the devices
+	std::vector<std::unique_ptr<LoadgenDevice>> devices;
+	for (unsigned i = 0; i < deviceCount; ++i) {
+		std::unique_ptr<LoadgenDevice> device(new LoadgenDevice());
+		auto virtualId = inputEmulator.addVirtualDevice(vrinputemulator::VirtualDeviceType::TrackedController, serialPrefix + std::to_string(i), true);
+		device->virtualId = virtualId;
+		device->phase = (double)i * 0.7;
+		for (auto& t : device->sendTimes) {
+			t = 0;
+		}
+		auto info = inputEmulator.getVirtualDeviceInfo(virtualId);
+		if (info.openvrDeviceId == vr::k_unTrackedDeviceIndexInvalid) {
+			inputEmulator.setVirtualDeviceProperty(virtualId, vr::Prop_DeviceClass_Int32, (int32_t)vr::TrackedDeviceClass_Controller);
+			inputEmulator.setVirtualDeviceProperty(virtualId, vr::Prop_SupportedButtons_Uint64, (uint64_t)
+				vr::ButtonMaskFromId(vr::k_EButton_System) |
+				vr::ButtonMaskFromId(vr::k_EButton_ApplicationMenu) |
+				vr::ButtonMaskFromId(vr::k_EButton_Grip) |
+				vr::ButtonMaskFromId(vr::k_EButton_Axis0) |
+				vr::ButtonMaskFromId(vr::k_EButton_Axis1)
+				);
+			inputEmulator.setVirtualDeviceProperty(virtualId, vr::Prop_Axis0Type_Int32, (int32_t)vr::k_eControllerAxis_Joystick);
+			inputEmulator.setVirtualDeviceProperty(virtualId, vr::Prop_Axis1Type_Int32, (int32_t)vr::k_eControllerAxis_Trigger);
+			inputEmulator.setVirtualDeviceProperty(virtualId, vr::Prop_RenderModelName_String, std::string("vr_controller_vive_1_5"));
+			inputEmulator.setVirtualDeviceProperty(virtualId, vr::Prop_ManufacturerName_String, std::string("VRInputEmulator"));
+			inputEmulator.setVirtualDeviceProperty(virtualId, vr::Prop_ModelNumber_String, std::string("Load Generator"));
+			inputEmulator.publishVirtualDevice(virtualId);
+		}
+		devices.push_back(std::move(device));
+	}
+	// Wait till OpenVR knows all devices
+	auto waitStart = std::chrono::steady_clock::now();
+	for (auto& device : devices) {
+		while (device->openvrId == vr::k_unTrackedDeviceIndexInvalid) {
+			device->openvrId = inputEmulator.getVirtualDeviceInfo(device->virtualId).openvrDeviceId;
+			if (device->openvrId == vr::k_unTrackedDeviceIndexInvalid) {
+				if (std::chrono::steady_clock::now() - waitStart > std::chrono::seconds(5)) {
+					throw std::runtime_error("Error: Timeout while waiting for the virtual devices to get published.");
+				}
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			}
+		}
+	}
+	std::cout << "Driving " << deviceCount << " virtual controllers at " << rate << " Hz for " << duration << " s" << std::endl;
+
+	inputEmulator.setIpcSendPolicy(vrinputemulator::ipc::RequestType::VirtualDevices_SetDevicePose, policy);
+	inputEmulator.setIpcSendPolicy(vrinputemulator::ipc::RequestType::VirtualDevices_SetControllerState, policy);
+	inputEmulator.resetIpcSendStatistics();
+
+	// The monitor thread reads back what the driver forwarded to OpenVR from the shared device state table
+	std::atomic<bool> running { true };
+	std::thread monitorThread([&]() {
+		while (running) {
+			for (auto& device : devices) {
+				vr::DriverPose_t pose;
+				if (inputEmulator.readDevicePose(device->openvrId, pose)) {
+					auto sequence = (uint32_t)pose.vecAngularAcceleration[0];
+					if (sequence != device->lastObservedSequence && sequence != 0
+							&& device->lastSequence - sequence < LoadgenDevice::sendTimeCount) {
+						auto sendTime = device->sendTimes[sequence % LoadgenDevice::sendTimeCount].load();
+						device->latencies.push_back((double)(loadgenNow() - sendTime));
+						device->lastObservedSequence = sequence;
+					}
+				}
+			}
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+		}
+	});
+
+	auto interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / rate));
+	auto startTime = std::chrono::steady_clock::now();
+	auto endTime = startTime + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(duration));
+	for (size_t i = 0; i < devices.size(); ++i) {
+		// spread the devices over the interval
+		devices[i]->nextSendTime = startTime + interval * i / devices.size();
+	}
+	auto now = startTime;
+	while (now < endTime) {
+		auto nextWakeup = endTime;
+		for (auto& device : devices) {
+			if (device->nextSendTime <= now) {
+				double t = std::chrono::duration<double>(now - startTime).count();
+				uint32_t sequence = device->lastSequence + 1;
+				vr::DriverPose_t pose;
+				loadgenMakePose(pose, *device, t, sequence);
+				device->sendTimes[sequence % LoadgenDevice::sendTimeCount] = loadgenNow();
+				device->lastSequence = sequence;
+				inputEmulator.setVirtualDevicePose(device->virtualId, pose, false);
+				device->sentPoses++;
+				if (stateRate > 0 && sequence % stateRate == 0) {
+					vr::VRControllerState_t state;
+					loadgenMakeControllerState(state, t, sequence);
+					inputEmulator.setVirtualControllerState(device->virtualId, state, false);
+					device->sentStates++;
+				}
+				device->nextSendTime += interval;
+				if (device->nextSendTime < now) {
+					// we are too slow, don't try to catch up
+					device->nextSendTime = now + interval;
+				}
+			}
+			nextWakeup = std::min(nextWakeup, device->nextSendTime);
+		}
+		std::this_thread::sleep_until(nextWakeup);
+		now = std::chrono::steady_clock::now();
+	}
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	inputEmulator.ping();
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	running = false;
+	monitorThread.join();
+	auto stats = inputEmulator.getIpcSendStatistics();
+
+	// Report
+	uint64_t totalPoses = 0;
+	uint64_t totalStates = 0;
+	std::vector<double> allLatencies;
+	for (auto& device : devices) {
+		totalPoses += device->sentPoses;
+		totalStates += device->sentStates;
+		auto result = computeBenchmarkResult("loadgen", std::to_string(device->openvrId), false, device->latencies, elapsed);
+		std::cout << "Device " << device->virtualId << " (openvr id " << device->openvrId << "): " << (double)device->sentPoses / elapsed
+			<< " poses/s, observed " << result.count << " updates, latency p50 " << result.p50 << " us, p99 " << result.p99 << " us" << std::endl;
+		allLatencies.insert(allLatencies.end(), device->latencies.begin(), device->latencies.end());
+	}
+	auto total = computeBenchmarkResult("loadgen", "all", false, allLatencies, elapsed);
+	std::cout << "Total: " << (double)(totalPoses + totalStates) / elapsed << " msg/s (" << totalPoses << " poses, " << totalStates << " controller states in " << elapsed << " s), "
+		<< "target " << rate * deviceCount << " poses/s" << std::endl;
+	std::cout << "Send statistics: " << stats.sentMessages << " sent, " << stats.droppedMessages << " dropped, " << stats.blockedMessages << " blocked for "
+		<< (double)stats.blockedTimeMicroseconds / 1000.0 << " ms in total" << std::endl;
+	std::cout << "Driver-observed latency (send -> forwarded to OpenVR, includes up to 100 us polling): min " << total.min << " us, mean " << total.mean
+		<< " us, p50 " << total.p50 << " us, p99 " << total.p99 << " us, p99.9 " << total.p999 << " us, max " << total.max << " us" << std::endl;
+
+	// Leave the devices in a disconnected state, they cannot be removed from OpenVR
+	for (auto& device : devices) {
+		vr::DriverPose_t pose = inputEmulator.getVirtualDevicePose(device->virtualId);
+		pose.deviceIsConnected = false;
+		pose.poseIsValid = false;
+		inputEmulator.setIpcSendPolicy(vrinputemulator::ipc::RequestType::VirtualDevices_SetDevicePose, vrinputemulator::IpcSendPolicy::Block);
+		inputEmulator.setVirtualDevicePose(device->virtualId, pose);
+	}
+}
+
+
+void hookCapture(int argc, const char* argv[]) {
+	if (argc > 2 && std::strcmp(argv[2], "help") == 0) {
+		std::stringstream ss;
+		ss << "Usage: client_commandline.exe hookcapture start <fileName> [<maxSizeMB>]" << std::endl
+			<< "       client_commandline.exe hookcapture stop" << std::endl << std::endl
+			<< "The capture file is written by the driver into the \"captures\" folder of its install directory," << std::endl
+			<< "so <fileName> must be a plain file name without a path." << std::endl
+			<< "Captures can be replayed with \"driver_testhost.exe replay <file>\".";
+		throw std::runtime_error(ss.str());
+	} else if (argc < 3) {
+		throw std::runtime_error("Error: Too few arguments.");
+	}
+	vrinputemulator::VRInputEmulator inputEmulator;
+	inputEmulator.connect();
+	if (std::strcmp(argv[2], "start") == 0) {
+		if (argc < 4) {
+			throw std::runtime_error("Error: Too few arguments.");
+		}
+		uint32_t maxSizeMB = argc > 4 ? std::max(1, std::atoi(argv[4])) : 256;
+		inputEmulator.startHookCapture(argv[3], maxSizeMB);
+		std::cout << "Hook capture started: " << argv[3] << std::endl;
+	} else if (std::strcmp(argv[2], "stop") == 0) {
+		inputEmulator.stopHookCapture();
+		std::cout << "Hook capture stopped." << std::endl;
+	} else {
+		throw std::runtime_error("Error: Unknown argument.");
+	}
+}
+
+
+void inputMirror(int argc, const char* argv[]) {
+	if (argc > 2 && std::strcmp(argv[2], "help") == 0) {
+		std::stringstream ss;
+		ss << "Usage: client_commandline.exe inputmirror add <sourceId> <targetId>" << std::endl
+			<< "       client_commandline.exe inputmirror remove <sourceId> <targetId>" << std::endl << std::endl
+			<< "All input of the source device is additionally sent to the target device.";
+		throw std::runtime_error(ss.str());
+	} else if (argc < 5) {
+		throw std::runtime_error("Error: Too few arguments.");
+	}
+	vrinputemulator::VRInputEmulator inputEmulator;
+	inputEmulator.connect();
+	uint32_t sourceId = std::atoi(argv[3]);
+	uint32_t targetId = std::atoi(argv[4]);
+	if (std::strcmp(argv[2], "add") == 0) {
+		inputEmulator.addInputMirror(sourceId, targetId);
+	} else if (std::strcmp(argv[2], "remove") == 0) {
+		inputEmulator.removeInputMirror(sourceId, targetId);
+	} else {
+		throw std::runtime_error("Error: Unknown argument.");
+	}
+}
+
+
+void hapticWaveform(int argc, const char* argv[]) {
+	if (argc > 2 && std::strcmp(argv[2], "help") == 0) {
+		std::stringstream ss;
+		ss << "Usage: client_commandline.exe hapticwaveform <deviceId> <segment> [<segment> ...]" << std::endl << std::endl
+			<< "Each segment has the form <delayMs>:<durationMs>:<frequency>:<amplitude>, the delay is relative" << std::endl
+			<< "to the start of the previous segment (at most " << vrinputemulator::maxHapticWaveformSegments << " segments).";
+		throw std::runtime_error(ss.str());
+	} else if (argc < 4) {
+		throw std::runtime_error("Error: Too few arguments.");
+	}
+	uint32_t deviceId = std::atoi(argv[2]);
+	std::vector<vrinputemulator::HapticWaveformSegment> segments;
+	for (int i = 3; i < argc; ++i) {
+		float delay, duration, frequency, amplitude;
+		if (std::sscanf(argv[i], "%f:%f:%f:%f", &delay, &duration, &frequency, &amplitude) != 4) {
+			throw std::runtime_error(std::string("Error: Invalid segment ") + argv[i]);
+		}
+		vrinputemulator::HapticWaveformSegment segment;
+		segment.delayMicroseconds = (uint32_t)(delay * 1000.0f);
+		segment.durationSeconds = duration / 1000.0f;
+		segment.frequency = frequency;
+		segment.amplitude = amplitude;
+		segments.push_back(segment);
+	}
+	vrinputemulator::VRInputEmulator inputEmulator;
+	inputEmulator.connect();
+	inputEmulator.triggerHapticWaveform(deviceId, segments.data(), (uint32_t)segments.size(), false);
+}
+
+
+void poseSmoothing(int argc, const char* argv[]) {
+	if (argc > 2 && std::strcmp(argv[2], "help") == 0) {
+		std::stringstream ss;
+		ss << "Usage: client_commandline.exe posesmoothing <deviceId> off|<minCutoff> <beta> [<derivativeCutoff>]" << std::endl << std::endl
+			<< "minCutoff is the cutoff frequency (Hz) at rest, beta how fast it rises with the speed of the device.";
+		throw std::runtime_error(ss.str());
+	} else if (argc < 4) {
+		throw std::runtime_error("Error: Too few arguments.");
+	}
+	uint32_t deviceId = std::atoi(argv[2]);
+	vrinputemulator::PoseSmoothingSettings settings;
+	if (std::strcmp(argv[3], "off") != 0) {
+		if (argc < 5) {
+			throw std::runtime_error("Error: Too few arguments.");
+		}
+		settings.enabled = true;
+		settings.minCutoff = std::atof(argv[3]);
+		settings.beta = std::atof(argv[4]);
+		if (argc > 5) {
+			settings.derivativeCutoff = std::atof(argv[5]);
+		}
+	}
+	vrinputemulator::VRInputEmulator inputEmulator;
+	inputEmulator.connect();
+	inputEmulator.setPoseSmoothing(deviceId, settings);
+}
+
+
+void motionCompensationGroup(int argc, const char* argv[]) {
+	if (argc > 2 && std::strcmp(argv[2], "help") == 0) {
+		std::stringstream ss;
+		ss << "Usage: client_commandline.exe motioncompensationgroup <deviceId> <group>|none" << std::endl << std::endl
+			<< "Devices are compensated by the reference device of their group (0 .. " << vrinputemulator::maxMotionCompensationGroups - 1
+			<< ", default 0). A device in motion compensation mode is the reference of its group.";
+		throw std::runtime_error(ss.str());
+	} else if (argc < 4) {
+		throw std::runtime_error("Error: Too few arguments.");
+	}
+	uint32_t deviceId = std::atoi(argv[2]);
+	uint32_t group = vrinputemulator::motionCompensationGroupNone;
+	if (std::strcmp(argv[3], "none") != 0) {
+		group = std::atoi(argv[3]);
+	}
+	vrinputemulator::VRInputEmulator inputEmulator;
+	inputEmulator.connect();
+	inputEmulator.setDeviceMotionCompensationGroup(deviceId, group);
+}
@@ -27,6 +27,24 @@ void setDevicePosition(int argc, const char* argv[]);
 
 void setDeviceRotation(int argc, const char* argv[]);
 
+void setDevicePrediction(int argc, const char* argv[]);
+
+void posePump(int argc, const char* argv[]);
+
 void deviceOffsets(int argc, const char* argv[]);
 
 void benchmarkIPC(int argc, const char* argv[]);
+
+void benchmarkIPCLatency(int argc, const char* argv[]);
+
+void loadGenerator(int argc, const char* argv[]);
+
+void hookCapture(int argc, const char* argv[]);
+
+void inputMirror(int argc, const char* argv[]);
+
+void hapticWaveform(int argc, const char* argv[]);
+
+void poseSmoothing(int argc, const char* argv[]);
+
+void motionCompensationGroup(int argc, const char* argv[]);
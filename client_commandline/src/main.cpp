@@ -21,8 +21,16 @@ void printHelp(int argc, const char* argv[]) {
 		<< "  setdeviceconnection\t\tSets the connection state of a virtual device" << std::endl
 		<< "  setdeviceposition\t\tSets the position of a virtual device" << std::endl
 		<< "  setdevicerotation\t\tSets the rotation of a virtual device" << std::endl
+		<< "  setdeviceprediction\t\tConfigures the pose prediction of a virtual device" << std::endl
+		<< "  posepump\t\t\tSets the rate with which virtual device poses are sent" << std::endl
 		<< "  deviceoffsets\t\t\tConfigure the device translation/rotation offsets" << std::endl
-		<< "  benchmarkipc\t\t\tipc benchmarks" << std::endl;
+		<< "  benchmarkipc\t\t\tipc benchmarks" << std::endl
+		<< "  loadgen\t\t\tDrives a swarm of virtual controllers with synthetic input" << std::endl
+		<< "  hookcapture\t\t\tRecords the driver's hook traffic into a file" << std::endl
+		<< "  inputmirror\t\t\tMirrors the input of a device to another device" << std::endl
+		<< "  hapticwaveform\t\tPlays a haptic waveform on a device" << std::endl
+		<< "  posesmoothing\t\t\tConfigures the adaptive pose smoothing of a device" << std::endl
+		<< "  motioncompensationgroup\tAssigns a device to a motion compensation group" << std::endl;
 }
 
 
@@ -63,10 +71,26 @@ int main(int argc, const char* argv[]) {
 			setDevicePosition(argc, argv);
 		} else if (std::strcmp(argv[1], "setdevicerotation") == 0) {
 			setDeviceRotation(argc, argv);
+		} else if (std::strcmp(argv[1], "setdeviceprediction") == 0) {
+			setDevicePrediction(argc, argv);
+		} else if (std::strcmp(argv[1], "posepump") == 0) {
+			posePump(argc, argv);
 		} else if (std::strcmp(argv[1], "deviceoffsets") == 0) {
 			deviceOffsets(argc, argv);
 		} else if (std::strcmp(argv[1], "benchmarkipc") == 0) {
 			benchmarkIPC(argc, argv);
+		} else if (std::strcmp(argv[1], "loadgen") == 0) {
+			loadGenerator(argc, argv);
+		} else if (std::strcmp(argv[1], "hookcapture") == 0) {
+			hookCapture(argc, argv);
+		} else if (std::strcmp(argv[1], "inputmirror") == 0) {
+			inputMirror(argc, argv);
+		} else if (std::strcmp(argv[1], "hapticwaveform") == 0) {
+			hapticWaveform(argc, argv);
+		} else if (std::strcmp(argv[1], "posesmoothing") == 0) {
+			poseSmoothing(argc, argv);
+		} else if (std::strcmp(argv[1], "motioncompensationgroup") == 0) {
+			motionCompensationGroup(argc, argv);
 		} else {
 			throw std::runtime_error("Error: Unknown command.");
 		}
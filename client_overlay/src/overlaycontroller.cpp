@@ -663,6 +663,9 @@ QString OverlayController::digitalBindingToString(const vrinputemulator::Digital
 			status.append(" [A]");
 		}
 		break;
+	case vrinputemulator::DigitalBindingType::KeyboardMacro:
+		status = QString("Keyboard Macro (%1 steps)").arg(binding.data.keyboardMacro.stepCount);
+		break;
 	case vrinputemulator::DigitalBindingType::SuspendRedirectMode:
 		status = "Suspend Redirect Mode";
 		break;
@@ -6,6 +6,7 @@
 #include <vrinputemulator_types.h>
 #include <ipc_protocol.h>
 #include <chrono>
+#include <algorithm>
 
 // application namespace
 namespace inputemulator {
@@ -66,16 +67,51 @@ void DeviceManipulationTabController::initStage2(OverlayController * parent, QQu
 	} catch (const std::exception& e) {
 		LOG(ERROR) << "Could not get device infos: " << e.what();
 	}
+	try {
+		parent->vrInputEmulator().subscribeDeviceStateChanges([this](const vrinputemulator::DeviceState& state) {
+			onDeviceStateChanged(state);
+		});
+		deviceStatesSubscribed = true;
+	} catch (const std::exception& e) {
+		LOG(ERROR) << "Could not subscribe to device state changes, falling back to polling: " << e.what();
+	}
+}
+
+
+void DeviceManipulationTabController::onDeviceStateChanged(const vrinputemulator::DeviceState& state) {
+	if (state.info.deviceId < vr::k_unMaxTrackedDeviceCount) {
+		std::lock_guard<std::mutex> lock(deviceStatesMutex);
+		deviceStates[state.info.deviceId] = state;
+		deviceStatesValid[state.info.deviceId] = true;
+		deviceStatesChanged[state.info.deviceId] = true;
+	}
 }
 
 
 void DeviceManipulationTabController::eventLoopTick(vr::TrackedDevicePose_t* devicePoses) {
+	// Apply device state changes pushed by the driver (signals are emitted without holding the lock since slots may call into the ipc library)
+	std::vector<std::pair<unsigned, vrinputemulator::DeviceInfo>> changedDeviceInfos;
+	{
+		std::lock_guard<std::mutex> lock(deviceStatesMutex);
+		for (unsigned i = 0; i < deviceInfos.size(); ++i) {
+			auto id = deviceInfos[i]->openvrId;
+			if (deviceStatesChanged[id]) {
+				deviceStatesChanged[id] = false;
+				changedDeviceInfos.push_back({ i, deviceStates[id].info });
+			}
+		}
+	}
+	for (auto& c : changedDeviceInfos) {
+		if (applyDeviceInfo(c.first, c.second)) {
+			emit deviceInfoChanged(c.first);
+		}
+	}
 	if (settingsUpdateCounter >= 50) {
 		settingsUpdateCounter = 0;
 		if (parent->isDashboardVisible() || parent->isDesktopMode()) {
 			unsigned i = 0;
 			for (auto info : deviceInfos) {
-				bool hasDeviceInfoChanged = updateDeviceInfo(i);
+				bool hasDeviceInfoChanged = deviceStatesSubscribed ? false : updateDeviceInfo(i);
 				unsigned status = devicePoses[info->openvrId].bDeviceIsConnected ? 0 : 1;
 				if (info->deviceMode == 0 && info->deviceStatus != status) {
 					info->deviceStatus = status;
@@ -104,19 +140,17 @@ void DeviceManipulationTabController::eventLoopTick(vr::TrackedDevicePose_t* dev
 							LOG(ERROR) << "Could not get serial of device " << id;
 						}
 
-						try {
-							vrinputemulator::DeviceInfo info2;
-							parent->vrInputEmulator().getDeviceInfo(info->openvrId, info2);
-							info->deviceMode = info2.deviceMode;
-							info->deviceOffsetsEnabled = info2.offsetsEnabled;
-							if (info->deviceMode == 2 || info->deviceMode == 3) {
-								info->deviceStatus = info2.redirectSuspended ? 1 : 0;
+						deviceInfos.push_back(info);
+						if (deviceStatesSubscribed) {
+							// The driver pushes the state of new devices, we may have received it already
+							std::lock_guard<std::mutex> lock(deviceStatesMutex);
+							if (deviceStatesValid[id]) {
+								deviceStatesChanged[id] = false;
+								applyDeviceInfo((unsigned)deviceInfos.size() - 1, deviceStates[id].info);
 							}
-						} catch (std::exception& e) {
-							LOG(ERROR) << "Exception caught while getting device info: " << e.what();
+						} else {
+							updateDeviceInfo((unsigned)deviceInfos.size() - 1);
 						}
-
-						deviceInfos.push_back(info);
 						LOG(INFO) << "Found device: id " << info->openvrId << ", class " << info->deviceClass << ", serial " << info->serial;
 						newDeviceAdded = true;
 					}
@@ -336,6 +370,16 @@ void DeviceManipulationTabController::reloadDeviceManipulationProfiles() {
 					} else {
 						binding.data.keyboard.sendScanCode = data["sendScanCode"].toBool();
 					}
+				} else if (binding.type == vrinputemulator::DigitalBindingType::KeyboardMacro) {
+					auto steps = data["macroSteps"].toList();
+					binding.data.keyboardMacro.stepCount = std::min((uint32_t)steps.size(), vrinputemulator::maxKeyboardMacroSteps);
+					binding.data.keyboardMacro.sendScanCode = data.contains("sendScanCode") ? data["sendScanCode"].toBool() : true;
+					for (uint32_t i = 0; i < binding.data.keyboardMacro.stepCount; ++i) {
+						auto step = steps[i].toMap();
+						binding.data.keyboardMacro.steps[i].keyCode = (uint16_t)step["keyCode"].toUInt();
+						binding.data.keyboardMacro.steps[i].keyUp = step["keyUp"].toBool();
+						binding.data.keyboardMacro.steps[i].delayMicroseconds = step["delayMicroseconds"].toUInt();
+					}
 				}
 				binding.toggleEnabled = data["toggleEnabled"].toBool();
 				binding.toggleDelay = data["toggleDelay"].toUInt();
@@ -382,6 +426,29 @@ void DeviceManipulationTabController::reloadDeviceManipulationProfiles() {
 				p.remapping.binding.upperDeadzone = r["upperDeadzone"].toFloat();
 				p.remapping.binding.buttonPressDeadzoneFix = r["buttonPressDeadzoneFix"].toBool();
 				p.remapping.binding.touchpadEmulationMode = r["touchpadEmulationMode"].toUInt();
+				p.remapping.binding.deadzoneMode = (vrinputemulator::AnalogDeadzoneMode)r["deadzoneMode"].toUInt();
+				if (r.contains("responseCurve")) {
+					auto c = r["responseCurve"].toMap();
+					auto& curve = p.remapping.binding.responseCurve;
+					curve.type = (vrinputemulator::AnalogResponseCurveType)c["type"].toUInt();
+					curve.exponent = c.contains("exponent") ? c["exponent"].toFloat() : 2.0f;
+					auto points = c["points"].toList();
+					curve.pointCount = std::min((uint32_t)points.size(), vrinputemulator::maxAnalogResponseCurvePoints);
+					for (uint32_t i = 0; i < curve.pointCount; ++i) {
+						auto point = points[i].toMap();
+						curve.points[i][0] = point["x"].toFloat();
+						curve.points[i][1] = point["y"].toFloat();
+					}
+				}
+				auto stages = r["filterStages"].toList();
+				p.remapping.binding.filterStageCount = std::min((uint32_t)stages.size(), vrinputemulator::maxAnalogFilterStages);
+				for (uint32_t i = 0; i < p.remapping.binding.filterStageCount; ++i) {
+					p.remapping.binding.filterStages[i] = (vrinputemulator::AnalogFilterStageType)stages[i].toUInt();
+				}
+				if (r.contains("smoothingFactor")) {
+					p.remapping.binding.smoothingFactor = r["smoothingFactor"].toFloat();
+				}
+				p.remapping.binding.pairScalarComponents = r["pairScalarComponents"].toBool();
 				entry.analogRemappingProfiles[key.toInt()] = p;
 			}
 		}
@@ -438,6 +505,17 @@ void DeviceManipulationTabController::saveDeviceManipulationProfiles() {
 			data["ctrlPressed"] = binding.data.keyboard.ctrlPressed;
 			data["keyCode"] = binding.data.keyboard.keyCode;
 			data["sendScanCode"] = binding.data.keyboard.sendScanCode;
+		} else if (binding.type == vrinputemulator::DigitalBindingType::KeyboardMacro) {
+			QVariantList steps;
+			for (uint32_t i = 0; i < binding.data.keyboardMacro.stepCount; ++i) {
+				QVariantMap step;
+				step["keyCode"] = binding.data.keyboardMacro.steps[i].keyCode;
+				step["keyUp"] = binding.data.keyboardMacro.steps[i].keyUp;
+				step["delayMicroseconds"] = binding.data.keyboardMacro.steps[i].delayMicroseconds;
+				steps.push_back(step);
+			}
+			data["macroSteps"] = steps;
+			data["sendScanCode"] = binding.data.keyboardMacro.sendScanCode;
 		}
 		data["toggleEnabled"] = binding.toggleEnabled;
 		data["autoTriggerEnabled"] = binding.autoTriggerEnabled;
@@ -499,6 +577,31 @@ void DeviceManipulationTabController::saveDeviceManipulationProfiles() {
 					profile["swapAxes"] = ap.remapping.binding.swapAxes;
 					profile["buttonPressDeadzoneFix"] = ap.remapping.binding.buttonPressDeadzoneFix;
 					profile["touchpadEmulationMode"] = ap.remapping.binding.touchpadEmulationMode;
+					profile["deadzoneMode"] = (unsigned)ap.remapping.binding.deadzoneMode;
+					auto& curve = ap.remapping.binding.responseCurve;
+					if (curve.type != vrinputemulator::AnalogResponseCurveType::Linear) {
+						QVariantMap c;
+						c["type"] = (unsigned)curve.type;
+						c["exponent"] = curve.exponent;
+						QVariantList points;
+						for (uint32_t i = 0; i < curve.pointCount && i < vrinputemulator::maxAnalogResponseCurvePoints; ++i) {
+							QVariantMap point;
+							point["x"] = curve.points[i][0];
+							point["y"] = curve.points[i][1];
+							points.push_back(point);
+						}
+						c["points"] = points;
+						profile["responseCurve"] = c;
+					}
+					if (ap.remapping.binding.filterStageCount > 0) {
+						QVariantList stages;
+						for (uint32_t i = 0; i < ap.remapping.binding.filterStageCount && i < vrinputemulator::maxAnalogFilterStages; ++i) {
+							stages.push_back((unsigned)ap.remapping.binding.filterStages[i]);
+						}
+						profile["filterStages"] = stages;
+					}
+					profile["smoothingFactor"] = ap.remapping.binding.smoothingFactor;
+					profile["pairScalarComponents"] = ap.remapping.binding.pairScalarComponents;
 					analogProfiles[QString::number(i2)] = profile;
 				}
 			}
@@ -605,6 +708,12 @@ void DeviceManipulationTabController::addDeviceManipulationProfile(QString name,
 					p.remapping.binding.swapAxes = r.binding.swapAxes;
 					p.remapping.binding.buttonPressDeadzoneFix = r.binding.buttonPressDeadzoneFix;
 					p.remapping.binding.touchpadEmulationMode = r.binding.touchpadEmulationMode;
+					p.remapping.binding.deadzoneMode = r.binding.deadzoneMode;
+					p.remapping.binding.responseCurve = r.binding.responseCurve;
+					p.remapping.binding.filterStageCount = r.binding.filterStageCount;
+					std::copy(r.binding.filterStages, r.binding.filterStages + vrinputemulator::maxAnalogFilterStages, p.remapping.binding.filterStages);
+					p.remapping.binding.smoothingFactor = r.binding.smoothingFactor;
+					p.remapping.binding.pairScalarComponents = r.binding.pairScalarComponents;
 				}
 			}
 		} catch (const std::exception& e) {
@@ -1167,25 +1276,7 @@ bool DeviceManipulationTabController::updateDeviceInfo(unsigned index) {
 		try {
 			vrinputemulator::DeviceInfo info;
 			parent->vrInputEmulator().getDeviceInfo(deviceInfos[index]->openvrId, info);
-			if (deviceInfos[index]->deviceMode != info.deviceMode) {
-				deviceInfos[index]->deviceMode = info.deviceMode;
-				retval = true;
-			}
-			if (deviceInfos[index]->refDeviceId != info.refDeviceId) {
-				deviceInfos[index]->refDeviceId = info.refDeviceId;
-				retval = true;
-			}
-			if (deviceInfos[index]->deviceOffsetsEnabled != info.offsetsEnabled) {
-				deviceInfos[index]->deviceOffsetsEnabled = info.offsetsEnabled;
-				retval = true;
-			}
-			if (deviceInfos[index]->deviceMode == 2 || deviceInfos[index]->deviceMode == 3) {
-				auto status = info.redirectSuspended ? 1 : 0;
-				if (deviceInfos[index]->deviceStatus != status) {
-					deviceInfos[index]->deviceStatus = status;
-					retval = true;
-				}
-			}
+			retval = applyDeviceInfo(index, info);
 		} catch (std::exception& e) {
 			LOG(ERROR) << "Exception caught while getting device info: " << e.what();
 		}
@@ -1193,6 +1284,30 @@ bool DeviceManipulationTabController::updateDeviceInfo(unsigned index) {
 	return retval;
 }
 
+bool DeviceManipulationTabController::applyDeviceInfo(unsigned index, const vrinputemulator::DeviceInfo& info) {
+	bool retval = false;
+	if (deviceInfos[index]->deviceMode != info.deviceMode) {
+		deviceInfos[index]->deviceMode = info.deviceMode;
+		retval = true;
+	}
+	if (deviceInfos[index]->refDeviceId != info.refDeviceId) {
+		deviceInfos[index]->refDeviceId = info.refDeviceId;
+		retval = true;
+	}
+	if (deviceInfos[index]->deviceOffsetsEnabled != info.offsetsEnabled) {
+		deviceInfos[index]->deviceOffsetsEnabled = info.offsetsEnabled;
+		retval = true;
+	}
+	if (deviceInfos[index]->deviceMode == 2 || deviceInfos[index]->deviceMode == 3) {
+		auto status = info.redirectSuspended ? 1 : 0;
+		if (deviceInfos[index]->deviceStatus != status) {
+			deviceInfos[index]->deviceStatus = status;
+			retval = true;
+		}
+	}
+	return retval;
+}
+
 void DeviceManipulationTabController::triggerHapticPulse(unsigned index) {
 	try {
 		// When I use a thread everything works in debug modus, but as soon as I switch to release mode I get a segmentation fault
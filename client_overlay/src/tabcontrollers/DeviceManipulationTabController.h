@@ -3,6 +3,7 @@
 
 #include <QObject>
 #include <memory>
+#include <mutex>
 #include <openvr.h>
 #include <vrinputemulator.h>
 
@@ -88,6 +89,15 @@ private:
 
 	unsigned settingsUpdateCounter = 0;
 
+	// Device states pushed by the driver (written by the ipc thread, consumed in eventLoopTick)
+	bool deviceStatesSubscribed = false; // Otherwise the device infos are polled
+	std::mutex deviceStatesMutex;
+	bool deviceStatesValid[vr::k_unMaxTrackedDeviceCount] = { false };
+	bool deviceStatesChanged[vr::k_unMaxTrackedDeviceCount] = { false };
+	vrinputemulator::DeviceState deviceStates[vr::k_unMaxTrackedDeviceCount];
+	void onDeviceStateChanged(const vrinputemulator::DeviceState& state);
+	bool applyDeviceInfo(unsigned index, const vrinputemulator::DeviceInfo& info);
+
 	std::thread identifyThread;
 
 public:
@@ -0,0 +1,546 @@
+#include "HeadlessRuntime.h"
+
+#include <cstring>
+#include <logging.h>
+
+
+// test host namespace
+namespace vrinputemulator {
+namespace testhost {
+
+
+/**
+* ServerDriver::Init() hooks GetGenericInterface() on the context it gets passed, but the vr:: accessors
+* call it directly. So a call from outside is dispatched through the hooks once, and the nested call that
+* arrives via the detour's origFunc returns the runtime interface.
+*/
+class HeadlessRuntime::RuntimeDriverContext : public vr::IVRDriverContext {
+public:
+	RuntimeDriverContext(HeadlessRuntime* runtime) : _runtime(runtime) {}
+
+	virtual void *GetGenericInterface(const char *pchInterfaceVersion, vr::EVRInitError *peError = nullptr) override {
+		static thread_local bool dispatching = false;
+		if (dispatching) {
+			return _runtime->_getInterface(pchInterfaceVersion, peError);
+		}
+		dispatching = true;
+		auto iface = callThroughHooks<void*, const char*, vr::EVRInitError*>(this, 0, pchInterfaceVersion, peError);
+		dispatching = false;
+		return _runtime->_getProxy(iface);
+	}
+
+	virtual vr::DriverHandle_t GetDriverHandle() override {
+		return driverPropertyContainer;
+	}
+
+private:
+	HeadlessRuntime* _runtime;
+};
+
+
+class HeadlessRuntime::RuntimeServerDriverHost : public vr::IVRServerDriverHost {
+public:
+	RuntimeServerDriverHost(HeadlessRuntime* runtime) : _runtime(runtime) {}
+
+	virtual bool TrackedDeviceAdded(const char *pchDeviceSerialNumber, vr::ETrackedDeviceClass eDeviceClass, vr::ITrackedDeviceServerDriver *pDriver) override {
+		uint32_t openvrId;
+		{
+			std::lock_guard<std::recursive_mutex> lock(_runtime->_mutex);
+			if (_runtime->_devices.size() >= vr::k_unMaxTrackedDeviceCount) {
+				return false;
+			}
+			openvrId = (uint32_t)_runtime->_devices.size();
+			DeviceEntry entry;
+			entry.serial = pchDeviceSerialNumber;
+			entry.deviceClass = eDeviceClass;
+			entry.driver = pDriver;
+			_runtime->_devices.push_back(entry);
+			_runtime->_counters.devicesAdded++;
+		}
+		LOG(INFO) << "Runtime: Device " << pchDeviceSerialNumber << " added with id " << openvrId;
+		// SteamVR activates devices asynchronously, doing it right away keeps the test host deterministic
+		auto error = callThroughHooks<vr::EVRInitError, uint32_t>(pDriver, 0, openvrId);
+		if (error != vr::VRInitError_None) {
+			LOG(ERROR) << "Runtime: Could not activate device " << pchDeviceSerialNumber << ": " << (int)error;
+		}
+		return true;
+	}
+
+	virtual void TrackedDevicePoseUpdated(uint32_t unWhichDevice, const vr::DriverPose_t & newPose, uint32_t unPoseStructSize) override {
+		std::lock_guard<std::recursive_mutex> lock(_runtime->_mutex);
+		if (unWhichDevice < _runtime->_devices.size()) {
+			auto& device = _runtime->_devices[unWhichDevice];
+			device.hasPose = true;
+			device.lastPose = newPose;
+		}
+		_runtime->_counters.poseUpdates++;
+	}
+
+	virtual void VsyncEvent(double vsyncTimeOffsetSeconds) override {}
+
+	virtual void TrackedDeviceButtonPressed(uint32_t unWhichDevice, vr::EVRButtonId eButtonId, double eventTimeOffset) override {
+		_countButtonEvent();
+	}
+
+	virtual void TrackedDeviceButtonUnpressed(uint32_t unWhichDevice, vr::EVRButtonId eButtonId, double eventTimeOffset) override {
+		_countButtonEvent();
+	}
+
+	virtual void TrackedDeviceButtonTouched(uint32_t unWhichDevice, vr::EVRButtonId eButtonId, double eventTimeOffset) override {
+		_countButtonEvent();
+	}
+
+	virtual void TrackedDeviceButtonUntouched(uint32_t unWhichDevice, vr::EVRButtonId eButtonId, double eventTimeOffset) override {
+		_countButtonEvent();
+	}
+
+	virtual void TrackedDeviceAxisUpdated(uint32_t unWhichDevice, uint32_t unWhichAxis, const vr::VRControllerAxis_t & axisState) override {
+		std::lock_guard<std::recursive_mutex> lock(_runtime->_mutex);
+		_runtime->_counters.axisUpdates++;
+	}
+
+	virtual void ProximitySensorState(uint32_t unWhichDevice, bool bProximitySensorTriggered) override {
+		_countOtherEvent();
+	}
+
+	virtual void VendorSpecificEvent(uint32_t unWhichDevice, vr::EVREventType eventType, const vr::VREvent_Data_t & eventData, double eventTimeOffset) override {
+		_countOtherEvent();
+	}
+
+	virtual bool IsExiting() override {
+		return false;
+	}
+
+	virtual bool PollNextEvent(vr::VREvent_t *pEvent, uint32_t uncbVREvent) override {
+		std::lock_guard<std::recursive_mutex> lock(_runtime->_mutex);
+		if (_runtime->_eventQueue.empty() || uncbVREvent < sizeof(vr::VREvent_t)) {
+			return false;
+		}
+		*pEvent = _runtime->_eventQueue.front();
+		_runtime->_eventQueue.erase(_runtime->_eventQueue.begin());
+		return true;
+	}
+
+	virtual void GetRawTrackedDevicePoses(float fPredictedSecondsFromNow, vr::TrackedDevicePose_t *pTrackedDevicePoseArray, uint32_t unTrackedDevicePoseArrayCount) override {
+		std::lock_guard<std::recursive_mutex> lock(_runtime->_mutex);
+		std::memset(pTrackedDevicePoseArray, 0, sizeof(vr::TrackedDevicePose_t) * unTrackedDevicePoseArrayCount);
+		for (uint32_t i = 0; i < unTrackedDevicePoseArrayCount && i < _runtime->_devices.size(); ++i) {
+			auto& device = _runtime->_devices[i];
+			if (device.hasPose) {
+				auto& pose = pTrackedDevicePoseArray[i];
+				pose.bDeviceIsConnected = device.lastPose.deviceIsConnected;
+				pose.bPoseIsValid = device.lastPose.poseIsValid;
+				pose.eTrackingResult = device.lastPose.result;
+				for (int j = 0; j < 3; ++j) {
+					pose.mDeviceToAbsoluteTracking.m[j][3] = (float)device.lastPose.vecPosition[j];
+					pose.vVelocity.v[j] = (float)device.lastPose.vecVelocity[j];
+					pose.vAngularVelocity.v[j] = (float)device.lastPose.vecAngularVelocity[j];
+				}
+				pose.mDeviceToAbsoluteTracking.m[0][0] = 1.0f;
+				pose.mDeviceToAbsoluteTracking.m[1][1] = 1.0f;
+				pose.mDeviceToAbsoluteTracking.m[2][2] = 1.0f;
+			}
+		}
+	}
+
+private:
+	void _countButtonEvent() {
+		std::lock_guard<std::recursive_mutex> lock(_runtime->_mutex);
+		_runtime->_counters.buttonEvents++;
+	}
+
+	void _countOtherEvent() {
+		std::lock_guard<std::recursive_mutex> lock(_runtime->_mutex);
+		_runtime->_counters.otherEvents++;
+	}
+
+	HeadlessRuntime* _runtime;
+};
+
+
+class HeadlessRuntime::RuntimeProperties : public vr::IVRProperties {
+public:
+	RuntimeProperties(HeadlessRuntime* runtime) : _runtime(runtime) {}
+
+	virtual vr::ETrackedPropertyError ReadPropertyBatch(vr::PropertyContainerHandle_t ulContainerHandle, vr::PropertyRead_t *pBatch, uint32_t unBatchEntryCount) override {
+		std::lock_guard<std::recursive_mutex> lock(_runtime->_mutex);
+		auto& properties = _runtime->_propertyStore[ulContainerHandle];
+		for (uint32_t i = 0; i < unBatchEntryCount; ++i) {
+			auto& entry = pBatch[i];
+			auto it = properties.find(entry.prop);
+			if (it == properties.end()) {
+				entry.unTag = vr::k_unInvalidPropertyTag;
+				entry.unRequiredBufferSize = 0;
+				entry.eError = vr::TrackedProp_UnknownProperty;
+			} else if (it->second.error != vr::TrackedProp_Success) {
+				entry.unTag = vr::k_unInvalidPropertyTag;
+				entry.unRequiredBufferSize = 0;
+				entry.eError = it->second.error;
+			} else {
+				entry.unTag = it->second.tag;
+				entry.unRequiredBufferSize = (uint32_t)it->second.data.size();
+				if (entry.unBufferSize < entry.unRequiredBufferSize) {
+					entry.eError = vr::TrackedProp_BufferTooSmall;
+				} else {
+					if (entry.unRequiredBufferSize > 0) {
+						std::memcpy(entry.pvBuffer, it->second.data.data(), entry.unRequiredBufferSize);
+					}
+					entry.eError = vr::TrackedProp_Success;
+				}
+			}
+		}
+		return vr::TrackedProp_Success;
+	}
+
+	virtual vr::ETrackedPropertyError WritePropertyBatch(vr::PropertyContainerHandle_t ulContainerHandle, vr::PropertyWrite_t *pBatch, uint32_t unBatchEntryCount) override {
+		std::lock_guard<std::recursive_mutex> lock(_runtime->_mutex);
+		auto& properties = _runtime->_propertyStore[ulContainerHandle];
+		for (uint32_t i = 0; i < unBatchEntryCount; ++i) {
+			auto& entry = pBatch[i];
+			switch (entry.writeType) {
+				case vr::PropertyWrite_Set: {
+					auto& value = properties[entry.prop];
+					value.tag = entry.unTag;
+					value.data.assign((char*)entry.pvBuffer, (char*)entry.pvBuffer + entry.unBufferSize);
+					value.error = vr::TrackedProp_Success;
+				} break;
+				case vr::PropertyWrite_Erase:
+					properties.erase(entry.prop);
+					break;
+				case vr::PropertyWrite_SetError: {
+					auto& value = properties[entry.prop];
+					value.tag = vr::k_unInvalidPropertyTag;
+					value.data.clear();
+					value.error = entry.eSetError;
+				} break;
+				default:
+					break;
+			}
+			entry.eError = vr::TrackedProp_Success;
+		}
+		return vr::TrackedProp_Success;
+	}
+
+	virtual const char *GetPropErrorNameFromEnum(vr::ETrackedPropertyError error) override {
+		switch (error) {
+			case vr::TrackedProp_Success:
+				return "TrackedProp_Success";
+			case vr::TrackedProp_WrongDataType:
+				return "TrackedProp_WrongDataType";
+			case vr::TrackedProp_UnknownProperty:
+				return "TrackedProp_UnknownProperty";
+			case vr::TrackedProp_BufferTooSmall:
+				return "TrackedProp_BufferTooSmall";
+			default:
+				return "TrackedProp_Unknown";
+		}
+	}
+
+	virtual vr::PropertyContainerHandle_t TrackedDeviceToPropertyContainer(vr::TrackedDeviceIndex_t nDevice) override {
+		// 0 is k_ulInvalidPropertyContainer
+		return (vr::PropertyContainerHandle_t)nDevice + 1;
+	}
+
+private:
+	HeadlessRuntime* _runtime;
+};
+
+
+class HeadlessRuntime::RuntimeDriverInput : public IVRDriverInput001 {
+public:
+	RuntimeDriverInput(HeadlessRuntime* runtime) : _runtime(runtime) {}
+
+	virtual vr::EVRInputError CreateBooleanComponent(vr::PropertyContainerHandle_t ulContainer, const char *pchName, vr::VRInputComponentHandle_t *pHandle) override {
+		return _createComponent(ulContainer, pchName, pHandle);
+	}
+
+	virtual vr::EVRInputError UpdateBooleanComponent(vr::VRInputComponentHandle_t ulComponent, bool bNewValue, double fTimeOffset) override {
+		std::lock_guard<std::recursive_mutex> lock(_runtime->_mutex);
+		auto it = _runtime->_inputComponents.find(ulComponent);
+		if (it == _runtime->_inputComponents.end()) {
+			return (vr::EVRInputError)1; // VRInputError_BadHandle
+		}
+		it->second.value = bNewValue ? 1.0f : 0.0f;
+		_runtime->_counters.booleanUpdates++;
+		return (vr::EVRInputError)0;
+	}
+
+	virtual vr::EVRInputError CreateScalarComponent(vr::PropertyContainerHandle_t ulContainer, const char *pchName, vr::VRInputComponentHandle_t *pHandle, vr::EVRScalarType eType, vr::EVRScalarUnits eUnits) override {
+		return _createComponent(ulContainer, pchName, pHandle);
+	}
+
+	virtual vr::EVRInputError UpdateScalarComponent(vr::VRInputComponentHandle_t ulComponent, float fNewValue, double fTimeOffset) override {
+		std::lock_guard<std::recursive_mutex> lock(_runtime->_mutex);
+		auto it = _runtime->_inputComponents.find(ulComponent);
+		if (it == _runtime->_inputComponents.end()) {
+			return (vr::EVRInputError)1; // VRInputError_BadHandle
+		}
+		it->second.value = fNewValue;
+		_runtime->_counters.scalarUpdates++;
+		return (vr::EVRInputError)0;
+	}
+
+	virtual vr::EVRInputError CreateHapticComponent(vr::PropertyContainerHandle_t ulContainer, const char *pchName, vr::VRInputComponentHandle_t *pHandle) override {
+		return _createComponent(ulContainer, pchName, pHandle);
+	}
+
+private:
+	vr::EVRInputError _createComponent(vr::PropertyContainerHandle_t ulContainer, const char *pchName, vr::VRInputComponentHandle_t *pHandle) {
+		std::lock_guard<std::recursive_mutex> lock(_runtime->_mutex);
+		auto handle = _runtime->_nextInputComponentHandle++;
+		_runtime->_inputComponents[handle] = { ulContainer, pchName, 0.0f };
+		*pHandle = handle;
+		return (vr::EVRInputError)0;
+	}
+
+	HeadlessRuntime* _runtime;
+};
+
+
+// The proxies are what device drivers see. Vtable offsets are the same ones the driver's hooks use.
+
+class HeadlessRuntime::ServerDriverHostProxy : public vr::IVRServerDriverHost {
+public:
+	ServerDriverHostProxy(vr::IVRServerDriverHost* host) : _host(host) {}
+
+	virtual bool TrackedDeviceAdded(const char *pchDeviceSerialNumber, vr::ETrackedDeviceClass eDeviceClass, vr::ITrackedDeviceServerDriver *pDriver) override {
+		return callThroughHooks<bool, const char*, vr::ETrackedDeviceClass, void*>(_host, 0, pchDeviceSerialNumber, eDeviceClass, pDriver);
+	}
+
+	virtual void TrackedDevicePoseUpdated(uint32_t unWhichDevice, const vr::DriverPose_t & newPose, uint32_t unPoseStructSize) override {
+		callThroughHooks<void, uint32_t, const vr::DriverPose_t&, uint32_t>(_host, 1, unWhichDevice, newPose, unPoseStructSize);
+	}
+
+	virtual void VsyncEvent(double vsyncTimeOffsetSeconds) override {
+		_host->VsyncEvent(vsyncTimeOffsetSeconds);
+	}
+
+	virtual void TrackedDeviceButtonPressed(uint32_t unWhichDevice, vr::EVRButtonId eButtonId, double eventTimeOffset) override {
+		callThroughHooks<void, uint32_t, vr::EVRButtonId, double>(_host, 3, unWhichDevice, eButtonId, eventTimeOffset);
+	}
+
+	virtual void TrackedDeviceButtonUnpressed(uint32_t unWhichDevice, vr::EVRButtonId eButtonId, double eventTimeOffset) override {
+		callThroughHooks<void, uint32_t, vr::EVRButtonId, double>(_host, 4, unWhichDevice, eButtonId, eventTimeOffset);
+	}
+
+	virtual void TrackedDeviceButtonTouched(uint32_t unWhichDevice, vr::EVRButtonId eButtonId, double eventTimeOffset) override {
+		callThroughHooks<void, uint32_t, vr::EVRButtonId, double>(_host, 5, unWhichDevice, eButtonId, eventTimeOffset);
+	}
+
+	virtual void TrackedDeviceButtonUntouched(uint32_t unWhichDevice, vr::EVRButtonId eButtonId, double eventTimeOffset) override {
+		callThroughHooks<void, uint32_t, vr::EVRButtonId, double>(_host, 6, unWhichDevice, eButtonId, eventTimeOffset);
+	}
+
+	virtual void TrackedDeviceAxisUpdated(uint32_t unWhichDevice, uint32_t unWhichAxis, const vr::VRControllerAxis_t & axisState) override {
+		callThroughHooks<void, uint32_t, uint32_t, const vr::VRControllerAxis_t&>(_host, 7, unWhichDevice, unWhichAxis, axisState);
+	}
+
+	virtual void ProximitySensorState(uint32_t unWhichDevice, bool bProximitySensorTriggered) override {
+		_host->ProximitySensorState(unWhichDevice, bProximitySensorTriggered);
+	}
+
+	virtual void VendorSpecificEvent(uint32_t unWhichDevice, vr::EVREventType eventType, const vr::VREvent_Data_t & eventData, double eventTimeOffset) override {
+		_host->VendorSpecificEvent(unWhichDevice, eventType, eventData, eventTimeOffset);
+	}
+
+	virtual bool IsExiting() override {
+		return _host->IsExiting();
+	}
+
+	virtual bool PollNextEvent(vr::VREvent_t *pEvent, uint32_t uncbVREvent) override {
+		return _host->PollNextEvent(pEvent, uncbVREvent);
+	}
+
+	virtual void GetRawTrackedDevicePoses(float fPredictedSecondsFromNow, vr::TrackedDevicePose_t *pTrackedDevicePoseArray, uint32_t unTrackedDevicePoseArrayCount) override {
+		_host->GetRawTrackedDevicePoses(fPredictedSecondsFromNow, pTrackedDevicePoseArray, unTrackedDevicePoseArrayCount);
+	}
+
+private:
+	vr::IVRServerDriverHost* _host;
+};
+
+
+class HeadlessRuntime::PropertiesProxy : public vr::IVRProperties {
+public:
+	PropertiesProxy(vr::IVRProperties* properties) : _properties(properties) {}
+
+	virtual vr::ETrackedPropertyError ReadPropertyBatch(vr::PropertyContainerHandle_t ulContainerHandle, vr::PropertyRead_t *pBatch, uint32_t unBatchEntryCount) override {
+		return callThroughHooks<vr::ETrackedPropertyError, vr::PropertyContainerHandle_t, void*, uint32_t>(_properties, 0, ulContainerHandle, pBatch, unBatchEntryCount);
+	}
+
+	virtual vr::ETrackedPropertyError WritePropertyBatch(vr::PropertyContainerHandle_t ulContainerHandle, vr::PropertyWrite_t *pBatch, uint32_t unBatchEntryCount) override {
+		return callThroughHooks<vr::ETrackedPropertyError, vr::PropertyContainerHandle_t, void*, uint32_t>(_properties, 1, ulContainerHandle, pBatch, unBatchEntryCount);
+	}
+
+	virtual const char *GetPropErrorNameFromEnum(vr::ETrackedPropertyError error) override {
+		return _properties->GetPropErrorNameFromEnum(error);
+	}
+
+	virtual vr::PropertyContainerHandle_t TrackedDeviceToPropertyContainer(vr::TrackedDeviceIndex_t nDevice) override {
+		return _properties->TrackedDeviceToPropertyContainer(nDevice);
+	}
+
+private:
+	vr::IVRProperties* _properties;
+};
+
+
+class HeadlessRuntime::DriverInputProxy : public IVRDriverInput001 {
+public:
+	DriverInputProxy(IVRDriverInput001* driverInput) : _driverInput(driverInput) {}
+
+	virtual vr::EVRInputError CreateBooleanComponent(vr::PropertyContainerHandle_t ulContainer, const char *pchName, vr::VRInputComponentHandle_t *pHandle) override {
+		return callThroughHooks<vr::EVRInputError, vr::PropertyContainerHandle_t, const char*, void*>(_driverInput, 0, ulContainer, pchName, pHandle);
+	}
+
+	virtual vr::EVRInputError UpdateBooleanComponent(vr::VRInputComponentHandle_t ulComponent, bool bNewValue, double fTimeOffset) override {
+		return callThroughHooks<vr::EVRInputError, vr::VRInputComponentHandle_t, bool, double>(_driverInput, 1, ulComponent, bNewValue, fTimeOffset);
+	}
+
+	virtual vr::EVRInputError CreateScalarComponent(vr::PropertyContainerHandle_t ulContainer, const char *pchName, vr::VRInputComponentHandle_t *pHandle, vr::EVRScalarType eType, vr::EVRScalarUnits eUnits) override {
+		return callThroughHooks<vr::EVRInputError, vr::PropertyContainerHandle_t, const char*, void*, vr::EVRScalarType, vr::EVRScalarUnits>(_driverInput, 2, ulContainer, pchName, pHandle, eType, eUnits);
+	}
+
+	virtual vr::EVRInputError UpdateScalarComponent(vr::VRInputComponentHandle_t ulComponent, float fNewValue, double fTimeOffset) override {
+		return callThroughHooks<vr::EVRInputError, vr::VRInputComponentHandle_t, float, double>(_driverInput, 3, ulComponent, fNewValue, fTimeOffset);
+	}
+
+	virtual vr::EVRInputError CreateHapticComponent(vr::PropertyContainerHandle_t ulContainer, const char *pchName, vr::VRInputComponentHandle_t *pHandle) override {
+		return callThroughHooks<vr::EVRInputError, vr::PropertyContainerHandle_t, const char*, void*>(_driverInput, 4, ulContainer, pchName, pHandle);
+	}
+
+private:
+	IVRDriverInput001* _driverInput;
+};
+
+
+const vr::PropertyContainerHandle_t HeadlessRuntime::driverPropertyContainer;
+
+
+HeadlessRuntime::HeadlessRuntime(const std::string& installDir) {
+	_driverContext.reset(new RuntimeDriverContext(this));
+	_serverDriverHost.reset(new RuntimeServerDriverHost(this));
+	_properties.reset(new RuntimeProperties(this));
+	_driverInput.reset(new RuntimeDriverInput(this));
+	_serverDriverHostProxy.reset(new ServerDriverHostProxy(_serverDriverHost.get()));
+	_propertiesProxy.reset(new PropertiesProxy(_properties.get()));
+	_driverInputProxy.reset(new DriverInputProxy(_driverInput.get()));
+
+	auto& installPath = _propertyStore[driverPropertyContainer][vr::Prop_InstallPath_String];
+	installPath.tag = vr::k_unStringPropertyTag;
+	installPath.data.assign(installDir.c_str(), installDir.c_str() + installDir.size() + 1);
+	installPath.error = vr::TrackedProp_Success;
+}
+
+
+HeadlessRuntime::~HeadlessRuntime() {}
+
+
+vr::IVRDriverContext* HeadlessRuntime::driverContext() {
+	return _driverContext.get();
+}
+
+
+void HeadlessRuntime::deactivateDevices() {
+	std::vector<vr::ITrackedDeviceServerDriver*> drivers;
+	{
+		std::lock_guard<std::recursive_mutex> lock(_mutex);
+		for (auto& d : _devices) {
+			drivers.push_back(d.driver);
+		}
+	}
+	for (auto d : drivers) {
+		d->Deactivate();
+	}
+}
+
+
+uint32_t HeadlessRuntime::deviceCount() {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	return (uint32_t)_devices.size();
+}
+
+
+vr::ITrackedDeviceServerDriver* HeadlessRuntime::getDevice(uint32_t openvrId) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	if (openvrId < _devices.size()) {
+		return _devices[openvrId].driver;
+	}
+	return nullptr;
+}
+
+
+std::string HeadlessRuntime::getDeviceSerial(uint32_t openvrId) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	if (openvrId < _devices.size()) {
+		return _devices[openvrId].serial;
+	}
+	return "";
+}
+
+
+bool HeadlessRuntime::getLastPose(uint32_t openvrId, vr::DriverPose_t& pose) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	if (openvrId < _devices.size() && _devices[openvrId].hasPose) {
+		pose = _devices[openvrId].lastPose;
+		return true;
+	}
+	return false;
+}
+
+
+bool HeadlessRuntime::triggerHapticPulse(uint32_t openvrId, uint32_t axisId, uint16_t durationMicroseconds) {
+	auto device = getDevice(openvrId);
+	if (!device) {
+		return false;
+	}
+	auto controller = device->GetComponent(vr::IVRControllerComponent_Version);
+	if (!controller) {
+		return false;
+	}
+	return callThroughHooks<bool, uint32_t, uint16_t>(controller, 1, axisId, durationMicroseconds);
+}
+
+
+void HeadlessRuntime::queueEvent(const vr::VREvent_t& event) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	_eventQueue.push_back(event);
+}
+
+
+RuntimeCounters HeadlessRuntime::counters() {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	return _counters;
+}
+
+
+void* HeadlessRuntime::_getInterface(const char* pchInterfaceVersion, vr::EVRInitError* peError) {
+	void* retval = nullptr;
+	if (std::strcmp(pchInterfaceVersion, vr::IVRServerDriverHost_Version) == 0) {
+		retval = _serverDriverHost.get();
+	} else if (std::strcmp(pchInterfaceVersion, vr::IVRProperties_Version) == 0) {
+		retval = _properties.get();
+	} else if (std::strcmp(pchInterfaceVersion, IVRDriverInput001_Version) == 0) {
+		retval = _driverInput.get();
+	}
+	if (peError) {
+		*peError = retval ? vr::VRInitError_None : vr::VRInitError_Init_InterfaceNotFound;
+	}
+	return retval;
+}
+
+
+void* HeadlessRuntime::_getProxy(void* iface) {
+	if (iface == _serverDriverHost.get()) {
+		return _serverDriverHostProxy.get();
+	} else if (iface == _properties.get()) {
+		return _propertiesProxy.get();
+	} else if (iface == _driverInput.get()) {
+		return _driverInputProxy.get();
+	}
+	return iface;
+}
+
+
+} // end namespace testhost
+} // end namespace vrinputemulator
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <openvr_driver.h>
+#include <hooks/common.h>
+
+
+// test host namespace
+namespace vrinputemulator {
+namespace testhost {
+
+
+/**
+* IVRDriverInput_001 is not part of the openvr header we use (see hooks/IVRDriverInput001Hooks.h),
+* so it is declared here with the same vtable layout.
+*/
+class IVRDriverInput001 {
+public:
+	virtual vr::EVRInputError CreateBooleanComponent(vr::PropertyContainerHandle_t ulContainer, const char *pchName, vr::VRInputComponentHandle_t *pHandle) = 0;
+	virtual vr::EVRInputError UpdateBooleanComponent(vr::VRInputComponentHandle_t ulComponent, bool bNewValue, double fTimeOffset) = 0;
+	virtual vr::EVRInputError CreateScalarComponent(vr::PropertyContainerHandle_t ulContainer, const char *pchName, vr::VRInputComponentHandle_t *pHandle, vr::EVRScalarType eType, vr::EVRScalarUnits eUnits) = 0;
+	virtual vr::EVRInputError UpdateScalarComponent(vr::VRInputComponentHandle_t ulComponent, float fNewValue, double fTimeOffset) = 0;
+	virtual vr::EVRInputError CreateHapticComponent(vr::PropertyContainerHandle_t ulContainer, const char *pchName, vr::VRInputComponentHandle_t *pHandle) = 0;
+};
+static const char* const IVRDriverInput001_Version = "IVRDriverInput_001";
+
+
+/**
+* Calls a vtable entry of an interface the way SteamVR or a device driver would call it.
+*
+* In headless mode no code gets patched, so every call that should pass the driver's hooks needs to
+* be dispatched through platform::getHookedFunction(). It returns the detour when the entry is hooked
+* and the original function otherwise.
+*/
+template<typename R, typename... Args>
+R callThroughHooks(void* iface, unsigned vtableOffset, Args... args) {
+	auto targetFunc = (*((void***)iface))[vtableOffset];
+	auto func = (R(*)(void*, Args...))driver::platform::getHookedFunction(targetFunc);
+	return func(iface, args...);
+}
+
+
+/** What arrived at the runtime side, i.e. the output of the driver's device manipulation pipeline */
+struct RuntimeCounters {
+	uint64_t devicesAdded = 0;
+	uint64_t poseUpdates = 0;
+	uint64_t buttonEvents = 0;
+	uint64_t axisUpdates = 0;
+	uint64_t booleanUpdates = 0;
+	uint64_t scalarUpdates = 0;
+	uint64_t otherEvents = 0;
+};
+
+
+/**
+* Stand-in for the SteamVR side of the driver API.
+*
+* Owns the runtime interfaces (driver context, server driver host, properties, driver input) and forwards
+* everything the driver hands on to them into a small in-memory state. Device drivers (virtual devices
+* as well as HeadlessTrackedDevice) get proxies from the vr:: accessors, which dispatch every call
+* through the hooks the driver installed on the runtime interfaces.
+**/
+class HeadlessRuntime {
+public:
+	HeadlessRuntime(const std::string& installDir);
+	~HeadlessRuntime();
+
+	/** Context that is passed to ServerDriver::Init() */
+	vr::IVRDriverContext* driverContext();
+
+	/** Deactivates all added devices, like SteamVR does on shutdown */
+	void deactivateDevices();
+
+	uint32_t deviceCount();
+	vr::ITrackedDeviceServerDriver* getDevice(uint32_t openvrId);
+	std::string getDeviceSerial(uint32_t openvrId);
+	bool getLastPose(uint32_t openvrId, vr::DriverPose_t& pose);
+
+	/** Sends a haptic pulse to a device's controller component, like an application would */
+	bool triggerHapticPulse(uint32_t openvrId, uint32_t axisId, uint16_t durationMicroseconds);
+
+	/** Queues an event that is returned by IVRServerDriverHost::PollNextEvent() */
+	void queueEvent(const vr::VREvent_t& event);
+
+	RuntimeCounters counters();
+
+private:
+	class RuntimeDriverContext;
+	class RuntimeServerDriverHost;
+	class RuntimeProperties;
+	class RuntimeDriverInput;
+	class ServerDriverHostProxy;
+	class PropertiesProxy;
+	class DriverInputProxy;
+
+	struct DeviceEntry {
+		std::string serial;
+		vr::ETrackedDeviceClass deviceClass;
+		vr::ITrackedDeviceServerDriver* driver;
+		bool hasPose = false;
+		vr::DriverPose_t lastPose;
+	};
+
+	struct PropertyValue {
+		vr::PropertyTypeTag_t tag;
+		std::vector<char> data;
+		vr::ETrackedPropertyError error;
+	};
+
+	struct InputComponent {
+		vr::PropertyContainerHandle_t container;
+		std::string name;
+		float value;
+	};
+
+	void* _getInterface(const char* pchInterfaceVersion, vr::EVRInitError* peError);
+	void* _getProxy(void* iface);
+
+	std::unique_ptr<RuntimeDriverContext> _driverContext;
+	std::unique_ptr<RuntimeServerDriverHost> _serverDriverHost;
+	std::unique_ptr<RuntimeProperties> _properties;
+	std::unique_ptr<RuntimeDriverInput> _driverInput;
+	std::unique_ptr<ServerDriverHostProxy> _serverDriverHostProxy;
+	std::unique_ptr<PropertiesProxy> _propertiesProxy;
+	std::unique_ptr<DriverInputProxy> _driverInputProxy;
+
+	std::recursive_mutex _mutex;
+	std::vector<DeviceEntry> _devices;
+	std::map<vr::PropertyContainerHandle_t, std::map<vr::ETrackedDeviceProperty, PropertyValue>> _propertyStore;
+	std::map<vr::VRInputComponentHandle_t, InputComponent> _inputComponents;
+	vr::VRInputComponentHandle_t _nextInputComponentHandle = 1;
+	std::vector<vr::VREvent_t> _eventQueue;
+	RuntimeCounters _counters;
+
+	static const vr::PropertyContainerHandle_t driverPropertyContainer = 0x100000000ull;
+};
+
+
+} // end namespace testhost
+} // end namespace vrinputemulator
@@ -0,0 +1,214 @@
+#include "HeadlessTrackedDevice.h"
+
+#include <cmath>
+#include <cstring>
+#include <logging.h>
+
+
+// test host namespace
+namespace vrinputemulator {
+namespace testhost {
+
+
+HeadlessTrackedDevice::HeadlessTrackedDevice(const std::string& serial, vr::ETrackedDeviceClass deviceClass, bool defaultInputComponents)
+		: m_serialNumber(serial), m_deviceClass(deviceClass), m_defaultInputComponents(defaultInputComponents), m_hapticPulseCount(0) {
+	m_pose = makePose(0.0);
+	memset(&m_ControllerState, 0, sizeof(vr::VRControllerState_t));
+	for (auto& h : m_inputComponents) {
+		h = 0;
+	}
+}
+
+
+vr::EVRInitError HeadlessTrackedDevice::Activate(uint32_t unObjectId) {
+	LOG(TRACE) << "HeadlessTrackedDevice[" << m_serialNumber << "]::Activate( " << unObjectId << " )";
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	m_propertyContainer = vr::VRProperties()->TrackedDeviceToPropertyContainer(unObjectId);
+	m_openvrId = unObjectId;
+	vr::VRProperties()->SetStringProperty(m_propertyContainer, vr::Prop_SerialNumber_String, m_serialNumber.c_str());
+	vr::VRProperties()->SetStringProperty(m_propertyContainer, vr::Prop_TrackingSystemName_String, "headless");
+	vr::VRProperties()->SetStringProperty(m_propertyContainer, vr::Prop_ModelNumber_String, "Headless Controller");
+	vr::VRProperties()->SetInt32Property(m_propertyContainer, vr::Prop_DeviceClass_Int32, m_deviceClass);
+	vr::VRProperties()->SetInt32Property(m_propertyContainer, vr::Prop_ControllerRoleHint_Int32, vr::TrackedControllerRole_Invalid);
+	vr::VRProperties()->SetUint64Property(m_propertyContainer, vr::Prop_SupportedButtons_Uint64,
+		vr::ButtonMaskFromId(vr::k_EButton_System) | vr::ButtonMaskFromId(vr::k_EButton_ApplicationMenu) | vr::ButtonMaskFromId(vr::k_EButton_Grip)
+		| vr::ButtonMaskFromId(vr::k_EButton_SteamVR_Touchpad) | vr::ButtonMaskFromId(vr::k_EButton_SteamVR_Trigger));
+	vr::VRProperties()->SetInt32Property(m_propertyContainer, vr::Prop_Axis0Type_Int32, vr::k_eControllerAxis_TrackPad);
+	vr::VRProperties()->SetInt32Property(m_propertyContainer, vr::Prop_Axis1Type_Int32, vr::k_eControllerAxis_Trigger);
+
+	// Input components, like a driver that already uses the new input system
+	m_driverInput = (IVRDriverInput001*)vr::VRDriverContext()->GetGenericInterface(IVRDriverInput001_Version);
+	if (m_driverInput && m_defaultInputComponents) {
+		m_driverInput->CreateBooleanComponent(m_propertyContainer, "/input/trigger/click", &m_inputComponents[InputTriggerClick]);
+		m_driverInput->CreateScalarComponent(m_propertyContainer, "/input/trigger/value", &m_inputComponents[InputTriggerValue], (vr::EVRScalarType)0, (vr::EVRScalarUnits)1); // absolute, one-sided
+		m_driverInput->CreateScalarComponent(m_propertyContainer, "/input/trackpad/x", &m_inputComponents[InputTrackpadX], (vr::EVRScalarType)0, (vr::EVRScalarUnits)0); // absolute, two-sided
+		m_driverInput->CreateScalarComponent(m_propertyContainer, "/input/trackpad/y", &m_inputComponents[InputTrackpadY], (vr::EVRScalarType)0, (vr::EVRScalarUnits)0);
+	}
+	if (m_driverInput) {
+		for (auto& c : m_customInputComponents) {
+			switch (c.kind) {
+				case driver::HookCaptureComponentKind::Boolean:
+					m_driverInput->CreateBooleanComponent(m_propertyContainer, c.name.c_str(), &c.handle);
+					break;
+				case driver::HookCaptureComponentKind::Scalar:
+					m_driverInput->CreateScalarComponent(m_propertyContainer, c.name.c_str(), &c.handle, c.scalarType, c.scalarUnits);
+					break;
+				case driver::HookCaptureComponentKind::Haptic:
+					m_driverInput->CreateHapticComponent(m_propertyContainer, c.name.c_str(), &c.handle);
+					break;
+			}
+		}
+	}
+	return vr::VRInitError_None;
+}
+
+
+void HeadlessTrackedDevice::Deactivate() {
+	LOG(TRACE) << "HeadlessTrackedDevice[" << m_serialNumber << "]::Deactivate()";
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	m_openvrId = vr::k_unTrackedDeviceIndexInvalid;
+	m_driverInput = nullptr;
+}
+
+
+void * HeadlessTrackedDevice::GetComponent(const char * pchComponentNameAndVersion) {
+	if (std::strcmp(pchComponentNameAndVersion, vr::ITrackedDeviceServerDriver_Version) == 0) {
+		return static_cast<vr::ITrackedDeviceServerDriver*>(this);
+	} else if (std::strcmp(pchComponentNameAndVersion, vr::IVRControllerComponent_Version) == 0) {
+		return static_cast<vr::IVRControllerComponent*>(this);
+	}
+	return nullptr;
+}
+
+
+vr::DriverPose_t HeadlessTrackedDevice::GetPose() {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	return m_pose;
+}
+
+
+vr::VRControllerState_t HeadlessTrackedDevice::GetControllerState() {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	return m_ControllerState;
+}
+
+
+bool HeadlessTrackedDevice::TriggerHapticPulse(uint32_t unAxisId, uint16_t usPulseDurationMicroseconds) {
+	m_hapticPulseCount++;
+	return true;
+}
+
+
+unsigned HeadlessTrackedDevice::addInputComponent(driver::HookCaptureComponentKind kind, const std::string& name, vr::EVRScalarType scalarType, vr::EVRScalarUnits scalarUnits) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	m_customInputComponents.push_back({ kind, name, scalarType, scalarUnits, 0 });
+	return (unsigned)(m_customInputComponents.size() - 1);
+}
+
+
+bool HeadlessTrackedDevice::publish() {
+	return vr::VRServerDriverHost()->TrackedDeviceAdded(m_serialNumber.c_str(), m_deviceClass, this);
+}
+
+
+void HeadlessTrackedDevice::sendPose(const vr::DriverPose_t& pose) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	m_pose = pose;
+	if (m_openvrId != vr::k_unTrackedDeviceIndexInvalid) {
+		vr::VRServerDriverHost()->TrackedDevicePoseUpdated(m_openvrId, m_pose, sizeof(vr::DriverPose_t));
+	}
+}
+
+
+void HeadlessTrackedDevice::sendButtonEvent(ButtonEventType eventType, vr::EVRButtonId buttonId, double eventTimeOffset) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	if (m_openvrId == vr::k_unTrackedDeviceIndexInvalid) {
+		return;
+	}
+	switch (eventType) {
+		case ButtonEventType::ButtonPressed:
+			m_ControllerState.ulButtonPressed |= vr::ButtonMaskFromId(buttonId);
+			vr::VRServerDriverHost()->TrackedDeviceButtonPressed(m_openvrId, buttonId, eventTimeOffset);
+			break;
+		case ButtonEventType::ButtonUnpressed:
+			m_ControllerState.ulButtonPressed &= ~vr::ButtonMaskFromId(buttonId);
+			vr::VRServerDriverHost()->TrackedDeviceButtonUnpressed(m_openvrId, buttonId, eventTimeOffset);
+			break;
+		case ButtonEventType::ButtonTouched:
+			m_ControllerState.ulButtonTouched |= vr::ButtonMaskFromId(buttonId);
+			vr::VRServerDriverHost()->TrackedDeviceButtonTouched(m_openvrId, buttonId, eventTimeOffset);
+			break;
+		case ButtonEventType::ButtonUntouched:
+			m_ControllerState.ulButtonTouched &= ~vr::ButtonMaskFromId(buttonId);
+			vr::VRServerDriverHost()->TrackedDeviceButtonUntouched(m_openvrId, buttonId, eventTimeOffset);
+			break;
+		default:
+			break;
+	}
+}
+
+
+void HeadlessTrackedDevice::sendAxisEvent(uint32_t axisId, const vr::VRControllerAxis_t& axisState) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	if (m_openvrId != vr::k_unTrackedDeviceIndexInvalid && axisId < vr::k_unControllerStateAxisCount) {
+		m_ControllerState.rAxis[axisId] = axisState;
+		vr::VRServerDriverHost()->TrackedDeviceAxisUpdated(m_openvrId, axisId, axisState);
+	}
+}
+
+
+void HeadlessTrackedDevice::sendBooleanComponent(InputComponent component, bool value, double timeOffset) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	if (m_driverInput && m_inputComponents[component]) {
+		m_driverInput->UpdateBooleanComponent(m_inputComponents[component], value, timeOffset);
+	}
+}
+
+
+void HeadlessTrackedDevice::sendScalarComponent(InputComponent component, float value, double timeOffset) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	if (m_driverInput && m_inputComponents[component]) {
+		m_driverInput->UpdateScalarComponent(m_inputComponents[component], value, timeOffset);
+	}
+}
+
+
+void HeadlessTrackedDevice::sendCustomBooleanComponent(unsigned index, bool value, double timeOffset) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	if (m_driverInput && index < m_customInputComponents.size() && m_customInputComponents[index].handle) {
+		m_driverInput->UpdateBooleanComponent(m_customInputComponents[index].handle, value, timeOffset);
+	}
+}
+
+
+void HeadlessTrackedDevice::sendCustomScalarComponent(unsigned index, float value, double timeOffset) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	if (m_driverInput && index < m_customInputComponents.size() && m_customInputComponents[index].handle) {
+		m_driverInput->UpdateScalarComponent(m_customInputComponents[index].handle, value, timeOffset);
+	}
+}
+
+
+vr::DriverPose_t HeadlessTrackedDevice::makePose(double t, uint32_t index) {
+	vr::DriverPose_t pose;
+	memset(&pose, 0, sizeof(vr::DriverPose_t));
+	pose.qDriverFromHeadRotation.w = 1;
+	pose.qWorldFromDriverRotation.w = 1;
+	auto angle = t * 2.0 + index * 0.5;
+	pose.vecPosition[0] = 0.3 * std::cos(angle) + index * 0.1;
+	pose.vecPosition[1] = 1.0;
+	pose.vecPosition[2] = 0.3 * std::sin(angle);
+	pose.vecVelocity[0] = -0.6 * std::sin(angle);
+	pose.vecVelocity[2] = 0.6 * std::cos(angle);
+	pose.qRotation.w = std::cos(angle / 2.0);
+	pose.qRotation.y = std::sin(angle / 2.0);
+	pose.vecAngularVelocity[1] = 2.0;
+	pose.result = vr::TrackingResult_Running_OK;
+	pose.poseIsValid = true;
+	pose.deviceIsConnected = true;
+	return pose;
+}
+
+
+} // end namespace testhost
+} // end namespace vrinputemulator
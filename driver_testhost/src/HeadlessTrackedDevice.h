@@ -0,0 +1,101 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <openvr_driver.h>
+#include <vrinputemulator_types.h>
+#include <capture/HookCaptureFormat.h>
+#include "HeadlessRuntime.h"
+
+
+// test host namespace
+namespace vrinputemulator {
+namespace testhost {
+
+
+/**
+* Simulated controller that plays the role of a third-party device driver.
+*
+* It talks to the runtime through the vr:: accessors like any other driver, so everything it sends passes
+* the hooks and the device manipulation pipeline of the driver under test.
+**/
+class HeadlessTrackedDevice : public vr::ITrackedDeviceServerDriver, public vr::IVRControllerComponent {
+public:
+	enum InputComponent {
+		InputTriggerClick,
+		InputTriggerValue,
+		InputTrackpadX,
+		InputTrackpadY,
+		InputComponentCount
+	};
+
+	HeadlessTrackedDevice(const std::string& serial, vr::ETrackedDeviceClass deviceClass = vr::TrackedDeviceClass_Controller, bool defaultInputComponents = true);
+
+	// from ITrackedDeviceServerDriver
+
+	virtual vr::EVRInitError Activate(uint32_t unObjectId) override;
+	virtual void Deactivate() override;
+	virtual void EnterStandby() override {}
+	virtual void *GetComponent(const char *pchComponentNameAndVersion) override;
+	virtual void DebugRequest(const char *pchRequest, char *pchResponseBuffer, uint32_t unResponseBufferSize) override {}
+	virtual vr::DriverPose_t GetPose() override;
+
+	// from IVRControllerComponent
+
+	virtual vr::VRControllerState_t GetControllerState() override;
+	virtual bool TriggerHapticPulse(uint32_t unAxisId, uint16_t usPulseDurationMicroseconds) override;
+
+	// from self
+
+	const std::string& serialNumber() { return m_serialNumber; }
+	vr::ETrackedDeviceClass deviceClass() { return m_deviceClass; }
+	uint32_t openvrDeviceId() { return m_openvrId; }
+	vr::PropertyContainerHandle_t propertyContainer() { return m_propertyContainer; }
+	bool activated() { return m_openvrId != vr::k_unTrackedDeviceIndexInvalid; }
+	uint64_t hapticPulseCount() { return m_hapticPulseCount; }
+
+	/** Declares an additional input component that gets created on activation, returns its index for sendCustom* */
+	unsigned addInputComponent(driver::HookCaptureComponentKind kind, const std::string& name, vr::EVRScalarType scalarType = (vr::EVRScalarType)0, vr::EVRScalarUnits scalarUnits = (vr::EVRScalarUnits)0);
+
+	/** Announces the device to the runtime (the runtime activates it right away) */
+	bool publish();
+
+	void sendPose(const vr::DriverPose_t& pose);
+	void sendButtonEvent(ButtonEventType eventType, vr::EVRButtonId buttonId, double eventTimeOffset = 0.0);
+	void sendAxisEvent(uint32_t axisId, const vr::VRControllerAxis_t& axisState);
+	void sendBooleanComponent(InputComponent component, bool value, double timeOffset = 0.0);
+	void sendScalarComponent(InputComponent component, float value, double timeOffset = 0.0);
+	void sendCustomBooleanComponent(unsigned index, bool value, double timeOffset = 0.0);
+	void sendCustomScalarComponent(unsigned index, float value, double timeOffset = 0.0);
+
+	/** Deterministic pose that moves the device on a small circle, t is in seconds */
+	static vr::DriverPose_t makePose(double t, uint32_t index = 0);
+
+private:
+	struct CustomInputComponent {
+		driver::HookCaptureComponentKind kind;
+		std::string name;
+		vr::EVRScalarType scalarType;
+		vr::EVRScalarUnits scalarUnits;
+		vr::VRInputComponentHandle_t handle;
+	};
+
+	std::recursive_mutex _mutex;
+	std::string m_serialNumber;
+	vr::ETrackedDeviceClass m_deviceClass;
+	bool m_defaultInputComponents;
+	uint32_t m_openvrId = vr::k_unTrackedDeviceIndexInvalid;
+	vr::PropertyContainerHandle_t m_propertyContainer = vr::k_ulInvalidPropertyContainer;
+	vr::DriverPose_t m_pose;
+	vr::VRControllerState_t m_ControllerState;
+	IVRDriverInput001* m_driverInput = nullptr;
+	vr::VRInputComponentHandle_t m_inputComponents[InputComponentCount];
+	std::vector<CustomInputComponent> m_customInputComponents;
+	std::atomic<uint64_t> m_hapticPulseCount;
+};
+
+
+} // end namespace testhost
+} // end namespace vrinputemulator
@@ -0,0 +1,192 @@
+#include "HookCaptureReplayer.h"
+
+#include <chrono>
+#include <thread>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <logging.h>
+
+
+// test host namespace
+namespace vrinputemulator {
+namespace testhost {
+
+
+template<typename F> void HookCaptureReplayer::_forEachRecord(F op) {
+	auto base = (const char*)m_header;
+	uint64_t offset = (sizeof(driver::HookCaptureFileHeader) + 7) & ~(uint64_t)7;
+	while (offset + sizeof(driver::HookCaptureRecordHeader) <= m_dataEnd) {
+		auto record = (const driver::HookCaptureRecordHeader*)(base + offset);
+		auto type = record->type.load(std::memory_order_acquire);
+		if (type == (uint16_t)driver::HookCaptureRecordType::None) {
+			break;
+		} else if (record->size < sizeof(driver::HookCaptureRecordHeader) || offset + record->size > m_dataEnd) {
+			LOG(WARNING) << "Hook capture " << m_path << " is truncated at offset " << offset;
+			break;
+		}
+		op(record, record + 1);
+		offset += record->size;
+	}
+}
+
+
+HookCaptureReplayer::HookCaptureReplayer(const std::string& path) : m_path(path) {
+	try {
+		m_mapping.reset(new boost::interprocess::file_mapping(path.c_str(), boost::interprocess::read_only));
+		m_region.reset(new boost::interprocess::mapped_region(*m_mapping, boost::interprocess::read_only));
+	} catch (std::exception& e) {
+		throw std::runtime_error("Error: Could not open capture " + path + ": " + e.what());
+	}
+	auto fileSize = (uint64_t)m_region->get_size();
+	m_header = (const driver::HookCaptureFileHeader*)m_region->get_address();
+	if (fileSize < sizeof(driver::HookCaptureFileHeader) || std::memcmp(m_header->magic, HOOKCAPTURE_MAGIC, sizeof(m_header->magic)) != 0) {
+		throw std::runtime_error("Error: " + path + " is not a hook capture.");
+	} else if (m_header->formatVersion != HOOKCAPTURE_FORMAT_VERSION || m_header->headerSize != sizeof(driver::HookCaptureFileHeader)) {
+		throw std::runtime_error("Error: Unsupported hook capture format version " + std::to_string(m_header->formatVersion) + ".");
+	}
+	// A capture that was not closed properly still has its full size, the first unwritten record marks the end then
+	m_dataEnd = std::min(fileSize, std::min(m_header->capacity, m_header->writeOffset.load()));
+
+	int64_t lastTimestamp = 0;
+	_forEachRecord([&](const driver::HookCaptureRecordHeader* record, const void* payload) {
+		m_recordCount++;
+		lastTimestamp = std::max(lastTimestamp, record->timestamp);
+	});
+	m_captureDuration = lastTimestamp / 1e9;
+	LOG(INFO) << "Opened hook capture " << path << ": " << m_recordCount << " records, " << m_header->droppedRecords << " dropped, " << m_captureDuration << " s";
+}
+
+
+void HookCaptureReplayer::publishDevices() {
+	// Devices and their input components come first in a capture, but devices can also be added later on,
+	// so all of them are created up front
+	_forEachRecord([&](const driver::HookCaptureRecordHeader* record, const void* payload) {
+		switch ((driver::HookCaptureRecordType)record->type.load(std::memory_order_relaxed)) {
+			case driver::HookCaptureRecordType::DeviceInfo: {
+				if (m_capturedIdToDeviceMap.find(record->deviceId) == m_capturedIdToDeviceMap.end()) {
+					auto info = (const driver::HookCaptureDeviceInfo*)payload;
+					std::string serial(info->serialNumber, strnlen(info->serialNumber, sizeof(info->serialNumber)));
+					std::shared_ptr<HeadlessTrackedDevice> device(new HeadlessTrackedDevice(serial, (vr::ETrackedDeviceClass)info->deviceClass, false));
+					m_devices.push_back(device);
+					m_capturedIdToDeviceMap[record->deviceId] = device.get();
+				}
+			} break;
+			case driver::HookCaptureRecordType::InputComponent: {
+				auto info = (const driver::HookCaptureInputComponent*)payload;
+				auto it = m_capturedIdToDeviceMap.find(record->deviceId);
+				if (it != m_capturedIdToDeviceMap.end() && m_capturedHandleToComponentMap.find(info->handle) == m_capturedHandleToComponentMap.end()) {
+					std::string name(info->name, strnlen(info->name, sizeof(info->name)));
+					auto index = it->second->addInputComponent(info->kind, name, (vr::EVRScalarType)info->scalarType, (vr::EVRScalarUnits)info->scalarUnits);
+					m_capturedHandleToComponentMap[info->handle] = { it->second, index };
+				}
+			} break;
+			default:
+				break;
+		}
+	});
+	for (auto& d : m_devices) {
+		if (!d->publish() || !d->activated()) {
+			throw std::runtime_error("Error: Could not add device " + d->serialNumber() + ".");
+		}
+	}
+}
+
+
+void HookCaptureReplayer::replay(HeadlessRuntime& runtime, double speed, HookCaptureReplayStatistics& stats) {
+	auto start = std::chrono::steady_clock::now();
+	_forEachRecord([&](const driver::HookCaptureRecordHeader* record, const void* payload) {
+		auto type = (driver::HookCaptureRecordType)record->type.load(std::memory_order_relaxed);
+		if (type == driver::HookCaptureRecordType::DeviceInfo || type == driver::HookCaptureRecordType::InputComponent) {
+			return;
+		}
+		if (speed > 0.0) {
+			auto due = start + std::chrono::nanoseconds((long long)(record->timestamp / speed));
+			auto now = std::chrono::steady_clock::now();
+			if (due > now) {
+				std::this_thread::sleep_until(due);
+			} else {
+				stats.maxLag = std::max(stats.maxLag, std::chrono::duration<double>(now - due).count());
+			}
+		}
+
+		// Component updates carry their own handle, everything else the OpenVR id of the device
+		HeadlessTrackedDevice* device = nullptr;
+		ComponentTarget component = { nullptr, 0 };
+		if (type == driver::HookCaptureRecordType::BooleanComponentUpdate || type == driver::HookCaptureRecordType::ScalarComponentUpdate) {
+			auto handle = type == driver::HookCaptureRecordType::BooleanComponentUpdate
+				? ((const driver::HookCaptureBooleanComponentUpdate*)payload)->handle
+				: ((const driver::HookCaptureScalarComponentUpdate*)payload)->handle;
+			auto it = m_capturedHandleToComponentMap.find(handle);
+			if (it != m_capturedHandleToComponentMap.end()) {
+				component = it->second;
+			}
+		} else {
+			auto it = m_capturedIdToDeviceMap.find(record->deviceId);
+			if (it != m_capturedIdToDeviceMap.end()) {
+				device = it->second;
+			}
+		}
+		if (!device && !component.device) {
+			stats.skippedRecords++;
+			return;
+		}
+
+		switch (type) {
+			case driver::HookCaptureRecordType::PoseUpdate:
+				device->sendPose(((const driver::HookCapturePoseUpdate*)payload)->pose);
+				break;
+			case driver::HookCaptureRecordType::ButtonEvent: {
+				auto r = (const driver::HookCaptureButtonEvent*)payload;
+				device->sendButtonEvent((ButtonEventType)r->eventType, (vr::EVRButtonId)r->buttonId, r->timeOffset);
+			} break;
+			case driver::HookCaptureRecordType::AxisUpdate: {
+				auto r = (const driver::HookCaptureAxisUpdate*)payload;
+				device->sendAxisEvent(r->axisId, r->axisState);
+			} break;
+			case driver::HookCaptureRecordType::BooleanComponentUpdate: {
+				auto r = (const driver::HookCaptureBooleanComponentUpdate*)payload;
+				component.device->sendCustomBooleanComponent(component.index, r->value, r->timeOffset);
+			} break;
+			case driver::HookCaptureRecordType::ScalarComponentUpdate: {
+				auto r = (const driver::HookCaptureScalarComponentUpdate*)payload;
+				component.device->sendCustomScalarComponent(component.index, r->value, r->timeOffset);
+			} break;
+			case driver::HookCaptureRecordType::HapticPulse: {
+				auto r = (const driver::HookCaptureHapticPulse*)payload;
+				runtime.triggerHapticPulse(device->openvrDeviceId(), r->axisId, r->durationMicroseconds);
+			} break;
+			case driver::HookCaptureRecordType::HapticVibration: {
+				// Delivered the way SteamVR does it, as an event the device driver polls
+				auto r = (const driver::HookCaptureHapticVibration*)payload;
+				struct VREvent_HapticVibration_t {
+					uint64_t containerHandle;
+					uint64_t componentHandle;
+					float fDurationSeconds;
+					float fFrequency;
+					float fAmplitude;
+				};
+				vr::VREvent_t event;
+				std::memset(&event, 0, sizeof(vr::VREvent_t));
+				event.eventType = 1700; // VREvent_Input_HapticVibration
+				event.trackedDeviceIndex = device->openvrDeviceId();
+				auto eventData = reinterpret_cast<VREvent_HapticVibration_t*>(&event.data);
+				eventData->containerHandle = device->propertyContainer();
+				eventData->componentHandle = r->componentHandle;
+				eventData->fDurationSeconds = r->durationSeconds;
+				eventData->fFrequency = r->frequency;
+				eventData->fAmplitude = r->amplitude;
+				runtime.queueEvent(event);
+			} break;
+			default:
+				stats.skippedRecords++;
+				return;
+		}
+		stats.records[(int)type]++;
+	});
+	stats.duration += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+} // end namespace testhost
+} // end namespace vrinputemulator
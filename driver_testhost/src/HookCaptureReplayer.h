@@ -0,0 +1,73 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <capture/HookCaptureFormat.h>
+#include "HeadlessRuntime.h"
+#include "HeadlessTrackedDevice.h"
+
+
+// test host namespace
+namespace vrinputemulator {
+namespace testhost {
+
+
+struct HookCaptureReplayStatistics {
+	uint64_t records[(int)driver::HookCaptureRecordType::HapticVibration + 1] = {};
+	uint64_t skippedRecords = 0; // Records of unknown devices or input components
+	double duration = 0.0; // Seconds
+	double maxLag = 0.0; // Seconds the replay fell behind the capture timeline
+};
+
+
+/**
+* Replays a capture written by driver::HookRecorder.
+*
+* Every captured device is recreated as a HeadlessTrackedDevice with the same serial number, device class and
+* input components, then the records are fed through these devices so they pass the hooks again.
+**/
+class HookCaptureReplayer {
+public:
+	/** Maps and validates the capture file, throws std::runtime_error on error */
+	HookCaptureReplayer(const std::string& path);
+
+	/** Creates and publishes the captured devices, needs an initialized driver */
+	void publishDevices();
+
+	/** Replays all records once, speed is relative to the capture timeline (0 = as fast as possible) */
+	void replay(HeadlessRuntime& runtime, double speed, HookCaptureReplayStatistics& stats);
+
+	uint64_t recordCount() { return m_recordCount; }
+	uint64_t droppedRecords() { return m_header->droppedRecords; }
+	double captureDuration() { return m_captureDuration; }
+	const std::vector<std::shared_ptr<HeadlessTrackedDevice>>& devices() { return m_devices; }
+
+private:
+	struct ComponentTarget {
+		HeadlessTrackedDevice* device;
+		unsigned index;
+	};
+
+	/** Calls op for every record in the file */
+	template<typename F> void _forEachRecord(F op);
+
+	std::string m_path;
+	std::unique_ptr<boost::interprocess::file_mapping> m_mapping;
+	std::unique_ptr<boost::interprocess::mapped_region> m_region;
+	const driver::HookCaptureFileHeader* m_header = nullptr;
+	uint64_t m_dataEnd = 0;
+	uint64_t m_recordCount = 0;
+	double m_captureDuration = 0.0;
+
+	std::vector<std::shared_ptr<HeadlessTrackedDevice>> m_devices;
+	std::map<uint32_t, HeadlessTrackedDevice*> m_capturedIdToDeviceMap;
+	std::map<uint64_t, ComponentTarget> m_capturedHandleToComponentMap;
+};
+
+
+} // end namespace testhost
+} // end namespace vrinputemulator
@@ -0,0 +1,75 @@
+#include <iostream>
+#include <cstring>
+#include <logging.h>
+#include "testhost_commands.h"
+
+
+const char* logConfigFileName = "logging.conf";
+
+const char* logConfigDefault =
+"* GLOBAL:\n"
+"	FORMAT = \"[%level] %datetime{%Y-%M-%d %H:%m:%s}: %msg\"\n"
+"	FILENAME = \"driver_testhost.log\"\n"
+"	ENABLED = true\n"
+"	TO_FILE = true\n"
+"	TO_STANDARD_OUTPUT = false\n"
+"	MAX_LOG_FILE_SIZE = 2097152 ## 2MB\n"
+"* TRACE:\n"
+"	ENABLED = false\n"
+"* DEBUG:\n"
+"	ENABLED = false\n";
+
+INITIALIZE_EASYLOGGINGPP
+
+void init_logging() {
+	el::Loggers::addFlag(el::LoggingFlag::DisableApplicationAbortOnFatalLog);
+	el::Configurations conf(logConfigFileName);
+	conf.parseFromText(logConfigDefault);
+	conf.parseFromFile(logConfigFileName);
+	conf.setRemainingToDefault();
+	el::Loggers::reconfigureAllLoggers(conf);
+}
+
+
+void printHelp(int argc, const char* argv[]) {
+	std::cout << "Usage: driver_testhost <command> ..." << std::endl << std::endl
+		<< "Loads the driver into a headless stand-in of the SteamVR runtime." << std::endl << std::endl
+		<< "Available commands (enter \"<command> help\" for help):" << std::endl << std::endl
+		<< "  run\t\t\tRuns the driver with simulated controllers, so clients can connect to it" << std::endl
+		<< "  bench\t\t\tMeasures the cost of the pose/input hooks" << std::endl
+		<< "  microbench\t\tMeasures the cost of the driver's per-event functions" << std::endl
+		<< "  replay\t\tFeeds a hook capture through the driver" << std::endl;
+}
+
+
+int main(int argc, const char* argv[]) {
+	int retval = 0;
+	if (argc <= 1) {
+		std::cout << "Error: No Arguments given." << std::endl;
+		printHelp(argc, argv);
+		exit(1);
+	}
+
+	init_logging();
+
+	try {
+		if (std::strcmp(argv[1], "help") == 0) {
+			printHelp(argc, argv);
+		} else if (std::strcmp(argv[1], "run") == 0) {
+			runHost(argc, argv);
+		} else if (std::strcmp(argv[1], "bench") == 0) {
+			benchmarkHooks(argc, argv);
+		} else if (std::strcmp(argv[1], "microbench") == 0) {
+			microBenchmarks(argc, argv);
+		} else if (std::strcmp(argv[1], "replay") == 0) {
+			replayCapture(argc, argv);
+		} else {
+			throw std::runtime_error("Error: Unknown command.");
+		}
+	} catch (const std::exception& e) {
+		std::cout << e.what() << std::endl;
+		retval = 3;
+	}
+
+	return retval;
+}
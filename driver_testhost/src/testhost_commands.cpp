@@ -0,0 +1,477 @@
+#include "testhost_commands.h"
+
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <functional>
+#include <cstring>
+#include <cstdlib>
+#include <driver/ServerDriver.h>
+#include <devicemanipulation/DeviceManipulationHandle.h>
+#include <devicemanipulation/utils/KalmanFilter.h>
+#include <devicemanipulation/utils/MovingAverageRingBuffer.h>
+#include <driver/utils/PosePredictor.h>
+#include "HeadlessRuntime.h"
+#include "HeadlessTrackedDevice.h"
+#include "HookCaptureReplayer.h"
+
+
+namespace {
+
+using namespace vrinputemulator;
+
+
+/** Driver under test plus the runtime it is loaded into */
+class TestHostEnvironment {
+public:
+	TestHostEnvironment(unsigned deviceCount, const std::string& serialPrefix = "headless") : runtime(".") {
+		if (serverDriver.Init(runtime.driverContext()) != vr::VRInitError_None) {
+			throw std::runtime_error("Error: Could not initialize driver.");
+		}
+		for (unsigned i = 0; i < deviceCount; ++i) {
+			std::shared_ptr<testhost::HeadlessTrackedDevice> device(new testhost::HeadlessTrackedDevice(serialPrefix + std::to_string(i)));
+			if (!device->publish() || !device->activated()) {
+				throw std::runtime_error("Error: Could not add device " + device->serialNumber() + ".");
+			}
+			devices.push_back(device);
+		}
+	}
+
+	~TestHostEnvironment() {
+		runtime.deactivateDevices();
+		serverDriver.Cleanup();
+	}
+
+	testhost::HeadlessRuntime runtime;
+	driver::ServerDriver serverDriver;
+	std::vector<std::shared_ptr<testhost::HeadlessTrackedDevice>> devices;
+};
+
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+void printRuntimeCounters(testhost::HeadlessRuntime& runtime, driver::ServerDriver& serverDriver) {
+	auto c = runtime.counters();
+	auto s = driver::platform::getSideEffectCounters();
+	auto e = serverDriver.driverEventInjectionStats();
+	auto o = serverDriver.outputInjection().stats();
+	std::cout << "  runtime: poses " << c.poseUpdates << ", buttons " << c.buttonEvents << ", axes " << c.axisUpdates
+		<< ", booleans " << c.booleanUpdates << ", scalars " << c.scalarUpdates << ", other " << c.otherEvents
+		<< " | sounds " << s.playedSounds << ", keyboard inputs " << s.keyboardInputs
+		<< " | output actions " << o.executedActions << ", dropped " << o.droppedActions << ", max lateness " << o.maxLatenessMicroseconds << " us"
+		<< " | injected events " << e.injectedEvents << ", dropped " << (e.overflows + e.oversizedEvents + e.unknownHosts) << std::endl;
+}
+
+
+/** Per-call budget of a hooked function, see IVRServerDriverHost005Hooks::_trackedDevicePoseUpdated */
+const double hookBudgetNanoseconds = 166000.0;
+
+volatile double microBenchSink = 0.0;
+
+/**
+* Runs op count times per pass and prints the median and the minimum over all passes.
+*
+* Inputs are deterministic and derived from the iteration index only, so results of different commits
+* can be compared as long as count and passes stay the same.
+*/
+template<typename F>
+void runMicroBench(const char* name, unsigned count, unsigned passes, bool csv, F op) {
+	for (unsigned n = 0; n < count / 10; ++n) { // warm-up
+		op(n);
+	}
+	std::vector<double> results;
+	for (unsigned p = 0; p < passes; ++p) {
+		auto start = std::chrono::steady_clock::now();
+		for (unsigned n = 0; n < count; ++n) {
+			op(n);
+		}
+		results.push_back(secondsSince(start) * 1e9 / count);
+	}
+	std::sort(results.begin(), results.end());
+	auto median = results[results.size() / 2];
+	if (csv) {
+		std::cout << name << "," << std::fixed << std::setprecision(2) << median << "," << results.front() << std::endl;
+	} else {
+		std::cout << "  " << std::left << std::setw(36) << name << std::right << std::fixed << std::setprecision(1)
+			<< std::setw(10) << median << " ns" << std::setw(10) << results.front() << " ns" << std::setprecision(3)
+			<< std::setw(10) << (median * 100.0 / hookBudgetNanoseconds) << " %" << std::endl;
+	}
+}
+
+} // end anonymous namespace
+
+
+void runHost(int argc, const char* argv[]) {
+	if (argc > 2 && std::strcmp(argv[2], "help") == 0) {
+		std::stringstream ss;
+		ss << "Usage: driver_testhost run [options]" << std::endl
+			<< "  --devices <n>\t\tNumber of simulated controllers (default 2)" << std::endl
+			<< "  --rate <hz>\t\tPose updates per second and device (default 90)" << std::endl
+			<< "  --duration <s>\tDuration in seconds, 0 runs until the process is killed (default 0)" << std::endl
+			<< "  --capture <name>\tRecords the hook traffic into the capture file captures/<name> (see replay)";
+		throw std::runtime_error(ss.str());
+	}
+	unsigned deviceCount = 2;
+	double rate = 90.0;
+	double duration = 0.0;
+	std::string capturePath;
+	for (int i = 2; i < argc; ++i) {
+		bool hasValue = i + 1 < argc;
+		if (std::strcmp(argv[i], "--devices") == 0 && hasValue) {
+			deviceCount = std::max(0, std::atoi(argv[++i]));
+		} else if (std::strcmp(argv[i], "--rate") == 0 && hasValue) {
+			rate = std::max(1.0, std::atof(argv[++i]));
+		} else if (std::strcmp(argv[i], "--duration") == 0 && hasValue) {
+			duration = std::max(0.0, std::atof(argv[++i]));
+		} else if (std::strcmp(argv[i], "--capture") == 0 && hasValue) {
+			capturePath = argv[++i];
+		} else {
+			throw std::runtime_error(std::string("Error: Unknown option ") + argv[i]);
+		}
+	}
+
+	TestHostEnvironment env(deviceCount);
+	if (!capturePath.empty() && !env.serverDriver.hookRecorder().start(capturePath, 256 * 1024 * 1024)) {
+		throw std::runtime_error("Error: Could not start hook capture " + capturePath + ".");
+	}
+	std::cout << "Driver is running with " << deviceCount << " simulated controllers, clients can connect now." << std::endl;
+
+	// RunFrame is called at ~90Hz like in vrserver, device poses at the requested rate
+	auto frameInterval = std::chrono::microseconds(11111);
+	auto poseInterval = std::chrono::microseconds((long long)(1000000.0 / rate));
+	auto start = std::chrono::steady_clock::now();
+	auto nextFrame = start;
+	auto nextPose = start;
+	auto nextReport = start + std::chrono::seconds(5);
+	while (duration <= 0.0 || secondsSince(start) < duration) {
+		auto now = std::chrono::steady_clock::now();
+		if (now >= nextPose) {
+			auto t = secondsSince(start);
+			for (unsigned i = 0; i < env.devices.size(); ++i) {
+				env.devices[i]->sendPose(testhost::HeadlessTrackedDevice::makePose(t, i));
+			}
+			nextPose += poseInterval;
+			if (nextPose < now) {
+				nextPose = now + poseInterval;
+			}
+		}
+		if (now >= nextFrame) {
+			env.serverDriver.RunFrame();
+			nextFrame += frameInterval;
+			if (nextFrame < now) {
+				nextFrame = now + frameInterval;
+			}
+		}
+		if (now >= nextReport) {
+			std::cout << "[" << (int)secondsSince(start) << "s]" << std::endl;
+			printRuntimeCounters(env.runtime, env.serverDriver);
+			nextReport += std::chrono::seconds(5);
+		}
+		std::this_thread::sleep_until(std::min(nextPose, nextFrame));
+	}
+	printRuntimeCounters(env.runtime, env.serverDriver);
+}
+
+
+void benchmarkHooks(int argc, const char* argv[]) {
+	if (argc > 2 && std::strcmp(argv[2], "help") == 0) {
+		std::stringstream ss;
+		ss << "Usage: driver_testhost bench [options]" << std::endl
+			<< "  --devices <n>\t\tNumber of simulated controllers (default 4)" << std::endl
+			<< "  --count <n>\t\tCalls per operation and device (default 100000)";
+		throw std::runtime_error(ss.str());
+	}
+	unsigned deviceCount = 4;
+	unsigned count = 100000;
+	for (int i = 2; i < argc; ++i) {
+		bool hasValue = i + 1 < argc;
+		if (std::strcmp(argv[i], "--devices") == 0 && hasValue) {
+			deviceCount = std::max(1, std::atoi(argv[++i]));
+		} else if (std::strcmp(argv[i], "--count") == 0 && hasValue) {
+			count = std::max(1, std::atoi(argv[++i]));
+		} else {
+			throw std::runtime_error(std::string("Error: Unknown option ") + argv[i]);
+		}
+	}
+
+	TestHostEnvironment env(deviceCount);
+
+	std::vector<vr::DriverPose_t> poses;
+	for (unsigned i = 0; i < 256; ++i) {
+		poses.push_back(testhost::HeadlessTrackedDevice::makePose(i / 90.0));
+	}
+	auto measure = [&](const char* name, std::function<void(testhost::HeadlessTrackedDevice&, unsigned)> op) {
+		auto start = std::chrono::steady_clock::now();
+		for (unsigned n = 0; n < count; ++n) {
+			for (auto& d : env.devices) {
+				op(*d, n);
+			}
+		}
+		auto seconds = secondsSince(start);
+		auto calls = (double)count * env.devices.size();
+		std::cout << "  " << std::left << std::setw(12) << name << std::right << std::fixed << std::setprecision(1)
+			<< std::setw(10) << (seconds * 1e9 / calls) << " ns/call" << std::setw(14) << (calls / seconds) << " calls/s" << std::endl;
+	};
+
+	std::cout << "Hook dispatch through the device manipulation pipeline (" << deviceCount << " devices, " << count << " calls each):" << std::endl;
+	measure("pose", [&](testhost::HeadlessTrackedDevice& d, unsigned n) {
+		d.sendPose(poses[n & 255]);
+	});
+	measure("button", [&](testhost::HeadlessTrackedDevice& d, unsigned n) {
+		d.sendButtonEvent((n & 1) ? ButtonEventType::ButtonUnpressed : ButtonEventType::ButtonPressed, vr::k_EButton_Grip);
+	});
+	measure("axis", [&](testhost::HeadlessTrackedDevice& d, unsigned n) {
+		vr::VRControllerAxis_t axis = { (float)((n & 255) / 255.0), 0.5f };
+		d.sendAxisEvent(0, axis);
+	});
+	measure("boolean", [&](testhost::HeadlessTrackedDevice& d, unsigned n) {
+		d.sendBooleanComponent(testhost::HeadlessTrackedDevice::InputTriggerClick, (n & 1) != 0);
+	});
+	measure("scalar", [&](testhost::HeadlessTrackedDevice& d, unsigned n) {
+		d.sendScalarComponent(testhost::HeadlessTrackedDevice::InputTrackpadX, (float)((n & 255) / 127.5 - 1.0));
+	});
+	printRuntimeCounters(env.runtime, env.serverDriver);
+}
+
+
+void replayCapture(int argc, const char* argv[]) {
+	if (argc < 3 || std::strcmp(argv[2], "help") == 0) {
+		std::stringstream ss;
+		ss << "Usage: driver_testhost replay <file> [options]" << std::endl
+			<< "  --speed <factor>\tPlayback speed relative to the capture, 0 replays as fast as possible (default 1)" << std::endl
+			<< "  --loop <n>\t\tNumber of passes (default 1)";
+		throw std::runtime_error(ss.str());
+	}
+	double speed = 1.0;
+	unsigned loops = 1;
+	for (int i = 3; i < argc; ++i) {
+		bool hasValue = i + 1 < argc;
+		if (std::strcmp(argv[i], "--speed") == 0 && hasValue) {
+			speed = std::max(0.0, std::atof(argv[++i]));
+		} else if (std::strcmp(argv[i], "--loop") == 0 && hasValue) {
+			loops = std::max(1, std::atoi(argv[++i]));
+		} else {
+			throw std::runtime_error(std::string("Error: Unknown option ") + argv[i]);
+		}
+	}
+
+	testhost::HookCaptureReplayer replayer(argv[2]);
+	TestHostEnvironment env(0);
+	replayer.publishDevices();
+	std::cout << "Replaying " << replayer.recordCount() << " records (" << replayer.droppedRecords() << " dropped while capturing, "
+		<< replayer.captureDuration() << " s) with " << replayer.devices().size() << " devices" << std::endl;
+
+	testhost::HookCaptureReplayStatistics stats;
+	for (unsigned n = 0; n < loops; ++n) {
+		replayer.replay(env.runtime, speed, stats);
+	}
+
+	static const char* typeNames[] = { "none", "device", "component", "pose", "button", "axis", "boolean", "scalar", "haptic", "vibration" };
+	uint64_t total = 0;
+	for (int t = (int)driver::HookCaptureRecordType::PoseUpdate; t <= (int)driver::HookCaptureRecordType::HapticVibration; ++t) {
+		total += stats.records[t];
+		std::cout << "  " << std::left << std::setw(12) << typeNames[t] << std::right << std::setw(12) << stats.records[t] << std::endl;
+	}
+	std::cout << "  " << total << " records in " << std::fixed << std::setprecision(3) << stats.duration << " s (" << std::setprecision(1)
+		<< (total / stats.duration) << " records/s), " << stats.skippedRecords << " skipped";
+	if (speed > 0.0) {
+		std::cout << ", max. lag " << std::setprecision(3) << stats.maxLag * 1000.0 << " ms";
+	}
+	std::cout << std::endl;
+	printRuntimeCounters(env.runtime, env.serverDriver);
+}
+
+
+void microBenchmarks(int argc, const char* argv[]) {
+	if (argc > 2 && std::strcmp(argv[2], "help") == 0) {
+		std::stringstream ss;
+		ss << "Usage: driver_testhost microbench [options]" << std::endl
+			<< "  --count <n>\t\tCalls per pass (default 200000)" << std::endl
+			<< "  --passes <n>\t\tNumber of passes, the median is reported (default 7)" << std::endl
+			<< "  --csv\t\t\tPrints name,median_ns,min_ns lines for comparing runs";
+		throw std::runtime_error(ss.str());
+	}
+	unsigned count = 200000;
+	unsigned passes = 7;
+	bool csv = false;
+	for (int i = 2; i < argc; ++i) {
+		bool hasValue = i + 1 < argc;
+		if (std::strcmp(argv[i], "--count") == 0 && hasValue) {
+			count = std::max(10, std::atoi(argv[++i]));
+		} else if (std::strcmp(argv[i], "--passes") == 0 && hasValue) {
+			passes = std::max(1, std::atoi(argv[++i]));
+		} else if (std::strcmp(argv[i], "--csv") == 0) {
+			csv = true;
+		} else {
+			throw std::runtime_error(std::string("Error: Unknown option ") + argv[i]);
+		}
+	}
+
+	TestHostEnvironment env(1);
+	auto handle = env.serverDriver.getDeviceManipulationHandleById(env.devices[0]->openvrDeviceId());
+	if (!handle) {
+		throw std::runtime_error("Error: Device has no manipulation handle.");
+	}
+	auto& motionCompensation = env.serverDriver.motionCompensation();
+	std::vector<vr::DriverPose_t> poses;
+	for (unsigned i = 0; i < 256; ++i) {
+		poses.push_back(testhost::HeadlessTrackedDevice::makePose(i / 90.0));
+	}
+
+	if (csv) {
+		std::cout << "name,median_ns,min_ns" << std::endl;
+	} else {
+		std::cout << "Per-call cost of the driver's hot functions (" << passes << " passes of " << count << " calls):" << std::endl
+			<< "  " << std::left << std::setw(36) << "function" << std::right << std::setw(13) << "median" << std::setw(13) << "min"
+			<< std::setw(12) << "budget" << std::endl;
+	}
+
+	// Pose updates; every call works on a copy since the handle modifies the pose in place
+	uint32_t openvrId = handle->openvrId();
+	uint32_t poseSize = sizeof(vr::DriverPose_t);
+	runMicroBench("handlePoseUpdate", count, passes, csv, [&](unsigned n) {
+		auto pose = poses[n & 255];
+		auto id = openvrId;
+		handle->handlePoseUpdate(id, pose, poseSize);
+		microBenchSink = pose.vecPosition[0];
+	});
+	handle->worldFromDriverRotationOffset() = vrmath::quaternionFromYawPitchRoll(0.1, 0.0, 0.0);
+	handle->worldFromDriverTranslationOffset() = { 0.1, 0.0, 0.2 };
+	handle->driverFromHeadRotationOffset() = vrmath::quaternionFromYawPitchRoll(0.0, 0.1, 0.0);
+	handle->driverFromHeadTranslationOffset() = { 0.0, 0.05, 0.0 };
+	handle->deviceRotationOffset() = vrmath::quaternionFromYawPitchRoll(0.0, 0.0, 0.1);
+	handle->deviceTranslationOffset() = { 0.0, 0.0, 0.05 };
+	handle->enableOffsets(true);
+	runMicroBench("handlePoseUpdate (offsets)", count, passes, csv, [&](unsigned n) {
+		auto pose = poses[n & 255];
+		auto id = openvrId;
+		handle->handlePoseUpdate(id, pose, poseSize);
+		microBenchSink = pose.vecPosition[0];
+	});
+	handle->enableOffsets(false);
+
+	// Motion compensation; the last pose time is moved back by one 90Hz frame before every call so the
+	// velocity estimators see realistic time steps instead of falling back to the last values
+	struct {
+		const char* name;
+		MotionCompensationVelAccMode mode;
+	} velAccModes[] = {
+		{ "applyMotionCompensation (disabled)", MotionCompensationVelAccMode::Disabled },
+		{ "applyMotionCompensation (setzero)", MotionCompensationVelAccMode::SetZero },
+		{ "applyMotionCompensation (substract)", MotionCompensationVelAccMode::SubstractMotionRef },
+		{ "applyMotionCompensation (linear)", MotionCompensationVelAccMode::LinearApproximation },
+		{ "applyMotionCompensation (kalman)", MotionCompensationVelAccMode::KalmanFilter }
+	};
+	auto refPose = testhost::HeadlessTrackedDevice::makePose(0.5, 7);
+	for (auto& m : velAccModes) {
+		motionCompensation.setMotionCompensationVelAccMode(0, m.mode);
+		motionCompensation.enableMotionCompensation(0, true);
+		motionCompensation._setMotionCompensationZeroPose(0, refPose);
+		motionCompensation._updateMotionCompensationRefPose(0, refPose);
+		runMicroBench(m.name, count, passes, csv, [&](unsigned n) {
+			auto pose = poses[n & 255];
+			if (handle->getLastPoseTime() >= 0) {
+				handle->setLastPoseTime(handle->getLastPoseTime() - 11111);
+			}
+			motionCompensation._applyMotionCompensation(pose, handle);
+			microBenchSink = pose.vecVelocity[0];
+		});
+	}
+	motionCompensation.enableMotionCompensation(0, false);
+	motionCompensation.setMotionCompensationVelAccMode(0, MotionCompensationVelAccMode::Disabled);
+
+	// Filters
+	driver::PosKalmanFilter kalmanFilter;
+	kalmanFilter.init();
+	kalmanFilter.setProcessNoise(0.1);
+	kalmanFilter.setObservationNoise(0.1);
+	runMicroBench("PosKalmanFilter::update", count, passes, csv, [&](unsigned n) {
+		auto& p = poses[n & 255].vecPosition;
+		kalmanFilter.update({ p[0], p[1], p[2] }, 1.0 / 90.0);
+		microBenchSink = kalmanFilter.getUpdatedVelocityEstimate().v[0];
+	});
+	for (unsigned window : { 3u, 10u }) {
+		driver::MovingAverageRingBuffer movingAverage(window);
+		for (unsigned i = 0; i < window; ++i) {
+			auto& p = poses[i].vecVelocity;
+			movingAverage.push({ p[0], p[1], p[2] });
+		}
+		auto name = "MovingAverageRingBuffer::average (" + std::to_string(window) + ")";
+		runMicroBench(name.c_str(), count, passes, csv, [&](unsigned n) {
+			microBenchSink = movingAverage.average().v[0];
+		});
+	}
+
+	// Pose prediction; a stale source has to end up at its last real pose, not frozen ahead of it
+	driver::PosePredictor posePredictor;
+	PosePredictionSettings predictionSettings;
+	predictionSettings.enabled = true;
+	posePredictor.configure(predictionSettings);
+	for (unsigned i = 0; i < 3; ++i) {
+		posePredictor.addSample(poses[i], i / 90.0);
+	}
+	auto stalePose = poses[2];
+	posePredictor.predict(stalePose, 2 / 90.0 + 2.0 * predictionSettings.maxPredictionTime);
+	if (std::memcmp(stalePose.vecPosition, poses[2].vecPosition, sizeof(stalePose.vecPosition)) != 0) {
+		throw std::runtime_error("Error: PosePredictor keeps extrapolating a stale source.");
+	}
+	runMicroBench("PosePredictor::predict", count, passes, csv, [&](unsigned n) {
+		auto pose = poses[2];
+		posePredictor.predict(pose, 2 / 90.0 + (n & 31) / 1000.0);
+		microBenchSink = pose.vecPosition[0];
+	});
+
+	// Digital remapping state machine, one op is a full press/release cycle
+	auto buttonCycle = [&](unsigned events, ButtonEventType* types) {
+		return [&, events, types](unsigned n) {
+			for (unsigned i = 0; i < events; ++i) {
+				auto id = openvrId;
+				auto buttonId = vr::k_EButton_Grip;
+				double offset = 0.0;
+				handle->handleButtonEvent(id, types[i], buttonId, offset);
+				if (i == 0) {
+					handle->RunFrame(); // Long press times out here
+				}
+			}
+		};
+	};
+	ButtonEventType pressRelease[] = { ButtonEventType::ButtonPressed, ButtonEventType::ButtonUnpressed };
+	ButtonEventType doublePress[] = { ButtonEventType::ButtonPressed, ButtonEventType::ButtonUnpressed, ButtonEventType::ButtonPressed, ButtonEventType::ButtonUnpressed };
+	runMicroBench("handleButtonEvent (no remapping)", count, passes, csv, buttonCycle(2, pressRelease));
+	DigitalInputRemapping digitalRemapping(true);
+	digitalRemapping.longPressEnabled = true;
+	digitalRemapping.longPressThreshold = 0;
+	handle->setDigitalInputRemapping(vr::k_EButton_Grip, digitalRemapping);
+	runMicroBench("handleButtonEvent (long press)", count, passes, csv, buttonCycle(2, pressRelease));
+	digitalRemapping.longPressEnabled = false;
+	digitalRemapping.doublePressEnabled = true;
+	digitalRemapping.doublePressThreshold = 60000; // Must not time out during the run
+	handle->setDigitalInputRemapping(vr::k_EButton_Grip, digitalRemapping);
+	runMicroBench("handleButtonEvent (double press)", count, passes, csv, buttonCycle(4, doublePress));
+	handle->setDigitalInputRemapping(vr::k_EButton_Grip, DigitalInputRemapping(false));
+
+	// Axis events, the input sweeps through the neutral position so the deferred zero updates kick in
+	auto axisEvent = [&](unsigned n) {
+		vr::VRControllerAxis_t axis;
+		axis.x = (n & 15) < 2 ? 0.0f : (float)(((n * 7) & 255) / 127.5 - 1.0);
+		axis.y = (n & 15) < 2 ? 0.0f : (float)(((n * 13) & 255) / 127.5 - 1.0);
+		handle->sendAxisEvent(openvrId, 0, axis);
+	};
+	runMicroBench("sendAxisEvent (no remapping)", count, passes, csv, axisEvent);
+	const char* touchpadModeNames[] = { "sendAxisEvent (touchpad emu 0)", "sendAxisEvent (touchpad emu 1)", "sendAxisEvent (touchpad emu 2)" };
+	for (unsigned mode = 0; mode < 3; ++mode) {
+		AnalogInputRemapping analogRemapping(true);
+		analogRemapping.binding.touchpadEmulationMode = mode;
+		handle->setAnalogInputRemapping(0, analogRemapping);
+		runMicroBench(touchpadModeNames[mode], count, passes, csv, axisEvent);
+	}
+	handle->setAnalogInputRemapping(0, AnalogInputRemapping(false));
+}
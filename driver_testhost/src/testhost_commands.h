@@ -0,0 +1,10 @@
+#pragma once
+
+
+void runHost(int argc, const char* argv[]);
+
+void benchmarkHooks(int argc, const char* argv[]);
+
+void replayCapture(int argc, const char* argv[]);
+
+void microBenchmarks(int argc, const char* argv[]);
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+#include <openvr_driver.h>
+
+
+#define HOOKCAPTURE_MAGIC "VRIEHCAP"
+#define HOOKCAPTURE_FORMAT_VERSION 2
+
+
+// driver namespace
+namespace vrinputemulator {
+namespace driver {
+
+
+/**
+* Binary format of hook captures (see HookRecorder and the replay command of driver_testhost).
+*
+* The file starts with a HookCaptureFileHeader, followed directly by the records. Every record starts with a
+* HookCaptureRecordHeader and is padded to a multiple of 8 bytes. Writers reserve space with an atomic add on
+* writeOffset and store the record type last, so readers stop at the first record whose type is still None.
+* All values are stored in native byte order.
+*/
+
+enum class HookCaptureRecordType : uint16_t {
+	None = 0, // Not (yet) written, marks the end of the capture
+	DeviceInfo,
+	InputComponent,
+	PoseUpdate,
+	ButtonEvent,
+	AxisUpdate,
+	BooleanComponentUpdate,
+	ScalarComponentUpdate,
+	HapticPulse,
+	HapticVibration
+};
+
+enum class HookCaptureComponentKind : uint32_t {
+	Boolean,
+	Scalar,
+	Haptic
+};
+
+
+struct HookCaptureFileHeader {
+	char magic[8];
+	uint32_t formatVersion;
+	uint32_t headerSize;
+	uint64_t capacity; // File size while the capture is running
+	int64_t startTime; // Microseconds since epoch
+	std::atomic<uint64_t> writeOffset; // Reserved bytes, exceeds capacity when records had to be dropped
+	std::atomic<uint64_t> recordCount;
+	std::atomic<uint64_t> droppedRecords;
+};
+
+struct HookCaptureRecordHeader {
+	std::atomic<uint16_t> type; // HookCaptureRecordType, written last
+	uint16_t size; // Including this header and padding
+	uint32_t deviceId; // OpenVR device id
+	int64_t timestamp; // Nanoseconds since the capture started
+};
+
+
+struct HookCaptureDeviceInfo {
+	int32_t deviceClass;
+	char serialNumber[64];
+};
+
+struct HookCaptureInputComponent {
+	uint64_t handle;
+	HookCaptureComponentKind kind;
+	int32_t scalarType;
+	int32_t scalarUnits;
+	char name[64];
+};
+
+struct HookCapturePoseUpdate {
+	vr::DriverPose_t pose; // As it was passed to the hook, i.e. before manipulation
+};
+
+struct HookCaptureButtonEvent {
+	uint32_t eventType; // ButtonEventType
+	uint32_t buttonId;
+	double timeOffset;
+};
+
+struct HookCaptureAxisUpdate {
+	uint32_t axisId;
+	vr::VRControllerAxis_t axisState;
+};
+
+struct HookCaptureBooleanComponentUpdate {
+	uint64_t handle;
+	double timeOffset;
+	bool value;
+};
+
+struct HookCaptureScalarComponentUpdate {
+	uint64_t handle;
+	double timeOffset;
+	float value;
+};
+
+struct HookCaptureHapticPulse {
+	uint32_t axisId;
+	uint16_t durationMicroseconds;
+};
+
+struct HookCaptureHapticVibration { // Haptic event of an IVRDriverInput device, as the device driver polled it
+	uint64_t componentHandle;
+	float durationSeconds;
+	float frequency;
+	float amplitude;
+};
+
+
+inline uint32_t hookCaptureRecordSize(uint32_t payloadSize) {
+	return (uint32_t)((sizeof(HookCaptureRecordHeader) + payloadSize + 7) & ~(size_t)7);
+}
+
+
+} // end namespace driver
+} // end namespace vrinputemulator
@@ -0,0 +1,266 @@
+#include "HookRecorder.h"
+
+#include <cstring>
+#include <algorithm>
+#include <fstream>
+#include <thread>
+#include "../logging.h"
+#include "../platform/platform.h"
+
+
+namespace vrinputemulator {
+namespace driver {
+
+
+HookRecorder::CaptureFile::~CaptureFile() {
+	// Only runs after the last hook let go of the file, so shrinking it to the written size is safe
+	uint64_t size = 0;
+	if (header) {
+		size = std::min(header->writeOffset.load(), header->capacity);
+		LOG(INFO) << "Hook capture " << path << " finished: " << header->recordCount << " records, " << header->droppedRecords << " dropped, " << size << " bytes";
+	}
+	header = nullptr;
+	if (region) {
+		region->flush();
+		region.reset();
+	}
+	mapping.reset();
+	if (size > 0 && !platform::resizeFile(path, size)) {
+		LOG(WARNING) << "Could not shrink hook capture " << path;
+	}
+}
+
+
+HookRecorder::~HookRecorder() {
+	stop();
+}
+
+
+void HookRecorder::setCaptureDirectory(const std::string& directory) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	_captureDirectory = directory;
+}
+
+
+bool HookRecorder::_isValidFileName(const std::string& fileName) {
+	// The name comes from a client, so it must not be able to leave the capture directory
+	if (fileName.empty() || fileName == "." || fileName == "..") {
+		return false;
+	}
+	for (auto c : fileName) {
+		if (c == '/' || c == '\\' || c == ':' || (unsigned char)c < 32) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+bool HookRecorder::start(const std::string& fileName, uint64_t maxSize) {
+	stop();
+	if (!_isValidFileName(fileName)) {
+		LOG(ERROR) << "Invalid hook capture file name: " << fileName;
+		return false;
+	}
+	std::string directory;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		directory = _captureDirectory;
+	}
+	if (directory.empty() || !platform::createDirectory(directory)) {
+		LOG(ERROR) << "Could not create hook capture directory " << directory;
+		return false;
+	}
+	auto path = directory + platform::pathSeparator + fileName;
+	maxSize = std::max<uint64_t>(maxSize, 1024 * 1024);
+	auto file = std::make_shared<CaptureFile>();
+	file->path = path;
+	try {
+		{
+			std::ofstream out(path, std::ios::binary | std::ios::trunc);
+			if (!out) {
+				LOG(ERROR) << "Could not create hook capture " << path;
+				return false;
+			}
+			out.seekp(maxSize - 1);
+			out.put(0);
+		}
+		file->mapping.reset(new boost::interprocess::file_mapping(path.c_str(), boost::interprocess::read_write));
+		file->region.reset(new boost::interprocess::mapped_region(*file->mapping, boost::interprocess::read_write, 0, (size_t)maxSize));
+	} catch (std::exception& e) {
+		LOG(ERROR) << "Could not map hook capture " << path << ": " << e.what();
+		return false;
+	}
+	auto header = new (file->region->get_address()) HookCaptureFileHeader();
+	std::memcpy(header->magic, HOOKCAPTURE_MAGIC, sizeof(header->magic));
+	header->formatVersion = HOOKCAPTURE_FORMAT_VERSION;
+	header->headerSize = sizeof(HookCaptureFileHeader);
+	header->capacity = maxSize;
+	header->startTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	header->writeOffset = (sizeof(HookCaptureFileHeader) + 7) & ~(uint64_t)7;
+	header->recordCount = 0;
+	header->droppedRecords = 0;
+	file->header = header;
+	file->startTime = std::chrono::steady_clock::now();
+
+	// Known devices and input components first, so the replayer can recreate them
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		for (auto& d : _devices) {
+			_write(*file, HookCaptureRecordType::DeviceInfo, d.first, &d.second.info, sizeof(HookCaptureDeviceInfo));
+		}
+		for (auto& c : _components) {
+			_write(*file, HookCaptureRecordType::InputComponent, c.deviceId, &c.info, sizeof(HookCaptureInputComponent));
+		}
+		std::atomic_store(&_file, file);
+		_active = true;
+		_setHookFeatures(true);
+	}
+	LOG(INFO) << "Hook capture started: " << path << " (max. " << maxSize << " bytes)";
+	return true;
+}
+
+
+void HookRecorder::stop() {
+	std::shared_ptr<CaptureFile> file;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_active = false;
+		file = std::atomic_exchange(&_file, std::shared_ptr<CaptureFile>());
+		_setHookFeatures(false);
+	}
+	if (file) {
+		// Hooks only hold the file while they write a single record. Waiting for them keeps the flush and
+		// resize in ~CaptureFile on this thread instead of a hook thread.
+		while (file.use_count() > 1) {
+			std::this_thread::yield();
+		}
+		file.reset();
+	}
+}
+
+
+void HookRecorder::_setHookFeatures(bool acquire) {
+	if (acquire != _hookFeaturesAcquired) {
+		for (auto f : { HookFeature::DigitalInput, HookFeature::AnalogInput, HookFeature::Haptics, HookFeature::EventInjection }) {
+			if (acquire) {
+				HookFeatures::acquire(f);
+			} else {
+				HookFeatures::release(f);
+			}
+		}
+		_hookFeaturesAcquired = acquire;
+	}
+}
+
+
+void HookRecorder::registerDevice(uint32_t deviceId, const std::string& serialNumber, vr::ETrackedDeviceClass deviceClass) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	auto& entry = _devices[deviceId];
+	std::memset(&entry.info, 0, sizeof(HookCaptureDeviceInfo));
+	entry.info.deviceClass = (int32_t)deviceClass;
+	std::strncpy(entry.info.serialNumber, serialNumber.c_str(), sizeof(entry.info.serialNumber) - 1);
+	if (isActive()) {
+		_write(HookCaptureRecordType::DeviceInfo, deviceId, entry.info);
+	}
+}
+
+
+void HookRecorder::registerInputComponent(uint32_t deviceId, HookCaptureComponentKind kind, const char* name, uint64_t handle, int32_t scalarType, int32_t scalarUnits) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	ComponentEntry entry;
+	std::memset(&entry.info, 0, sizeof(HookCaptureInputComponent));
+	entry.deviceId = deviceId;
+	entry.info.handle = handle;
+	entry.info.kind = kind;
+	entry.info.scalarType = scalarType;
+	entry.info.scalarUnits = scalarUnits;
+	std::strncpy(entry.info.name, name, sizeof(entry.info.name) - 1);
+	_components.push_back(entry);
+	if (isActive()) {
+		_write(HookCaptureRecordType::InputComponent, deviceId, entry.info);
+	}
+}
+
+
+void HookRecorder::recordPoseUpdate(uint32_t deviceId, const vr::DriverPose_t& pose) {
+	HookCapturePoseUpdate record;
+	record.pose = pose;
+	_write(HookCaptureRecordType::PoseUpdate, deviceId, record);
+}
+
+
+void HookRecorder::recordButtonEvent(uint32_t deviceId, ButtonEventType eventType, vr::EVRButtonId buttonId, double timeOffset) {
+	HookCaptureButtonEvent record;
+	record.eventType = (uint32_t)eventType;
+	record.buttonId = (uint32_t)buttonId;
+	record.timeOffset = timeOffset;
+	_write(HookCaptureRecordType::ButtonEvent, deviceId, record);
+}
+
+
+void HookRecorder::recordAxisUpdate(uint32_t deviceId, uint32_t axisId, const vr::VRControllerAxis_t& axisState) {
+	HookCaptureAxisUpdate record;
+	record.axisId = axisId;
+	record.axisState = axisState;
+	_write(HookCaptureRecordType::AxisUpdate, deviceId, record);
+}
+
+
+void HookRecorder::recordBooleanComponentUpdate(uint32_t deviceId, uint64_t handle, bool value, double timeOffset) {
+	HookCaptureBooleanComponentUpdate record;
+	record.handle = handle;
+	record.timeOffset = timeOffset;
+	record.value = value;
+	_write(HookCaptureRecordType::BooleanComponentUpdate, deviceId, record);
+}
+
+
+void HookRecorder::recordScalarComponentUpdate(uint32_t deviceId, uint64_t handle, float value, double timeOffset) {
+	HookCaptureScalarComponentUpdate record;
+	record.handle = handle;
+	record.timeOffset = timeOffset;
+	record.value = value;
+	_write(HookCaptureRecordType::ScalarComponentUpdate, deviceId, record);
+}
+
+
+void HookRecorder::recordHapticPulse(uint32_t deviceId, uint32_t axisId, uint16_t durationMicroseconds) {
+	HookCaptureHapticPulse record;
+	record.axisId = axisId;
+	record.durationMicroseconds = durationMicroseconds;
+	_write(HookCaptureRecordType::HapticPulse, deviceId, record);
+}
+
+
+void HookRecorder::recordHapticVibration(uint32_t deviceId, uint64_t componentHandle, float durationSeconds, float frequency, float amplitude) {
+	HookCaptureHapticVibration record;
+	record.componentHandle = componentHandle;
+	record.durationSeconds = durationSeconds;
+	record.frequency = frequency;
+	record.amplitude = amplitude;
+	_write(HookCaptureRecordType::HapticVibration, deviceId, record);
+}
+
+
+void HookRecorder::_write(CaptureFile& file, HookCaptureRecordType type, uint32_t deviceId, const void* payload, uint32_t payloadSize) {
+	auto header = file.header;
+	auto timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - file.startTime).count();
+	auto size = hookCaptureRecordSize(payloadSize);
+	auto offset = header->writeOffset.fetch_add(size, std::memory_order_relaxed);
+	if (offset + size > header->capacity) {
+		header->droppedRecords.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	auto record = (HookCaptureRecordHeader*)((char*)header + offset);
+	record->size = (uint16_t)size;
+	record->deviceId = deviceId;
+	record->timestamp = timestamp;
+	std::memcpy(record + 1, payload, payloadSize);
+	record->type.store((uint16_t)type, std::memory_order_release);
+	header->recordCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+} // end namespace driver
+} // end namespace vrinputemulator
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <chrono>
+#include <vector>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <openvr_driver.h>
+#include <vrinputemulator_types.h>
+#include "../hooks/common.h"
+#include "HookCaptureFormat.h"
+
+
+// driver namespace
+namespace vrinputemulator {
+namespace driver {
+
+
+/**
+* Captures everything that passes the ServerDriver::hooks* entry points into a memory-mapped file.
+*
+* The hooks check isActive() first, so the only cost while nothing gets recorded is one atomic load. Recording
+* itself never blocks: space is reserved with an atomic add and when the file is full the record is dropped
+* and counted. Devices and input components are tracked all the time, so a capture that is started in the
+* middle of a session still knows them (they are written at the beginning of every capture).
+*/
+class HookRecorder {
+public:
+	~HookRecorder();
+
+	/** Captures are only written into this directory, has to be set before the first start() */
+	void setCaptureDirectory(const std::string& directory);
+
+	/** Creates/overwrites the capture file with the given maximum size in the capture directory, returns false on error.
+	* fileName has to be a plain file name, paths are rejected. */
+	bool start(const std::string& fileName, uint64_t maxSize);
+	/** Waits until no hook writes into the capture anymore, then finishes the file on the calling thread */
+	void stop();
+	bool isActive() const { return _active.load(std::memory_order_relaxed); }
+
+	void registerDevice(uint32_t deviceId, const std::string& serialNumber, vr::ETrackedDeviceClass deviceClass);
+	void registerInputComponent(uint32_t deviceId, HookCaptureComponentKind kind, const char* name, uint64_t handle, int32_t scalarType = 0, int32_t scalarUnits = 0);
+
+	void recordPoseUpdate(uint32_t deviceId, const vr::DriverPose_t& pose);
+	void recordButtonEvent(uint32_t deviceId, ButtonEventType eventType, vr::EVRButtonId buttonId, double timeOffset);
+	void recordAxisUpdate(uint32_t deviceId, uint32_t axisId, const vr::VRControllerAxis_t& axisState);
+	void recordBooleanComponentUpdate(uint32_t deviceId, uint64_t handle, bool value, double timeOffset);
+	void recordScalarComponentUpdate(uint32_t deviceId, uint64_t handle, float value, double timeOffset);
+	void recordHapticPulse(uint32_t deviceId, uint32_t axisId, uint16_t durationMicroseconds);
+	void recordHapticVibration(uint32_t deviceId, uint64_t componentHandle, float durationSeconds, float frequency, float amplitude);
+
+private:
+	struct CaptureFile {
+		~CaptureFile();
+		std::string path;
+		std::unique_ptr<boost::interprocess::file_mapping> mapping;
+		std::unique_ptr<boost::interprocess::mapped_region> region;
+		HookCaptureFileHeader* header = nullptr;
+		std::chrono::steady_clock::time_point startTime;
+	};
+
+	struct DeviceEntry {
+		HookCaptureDeviceInfo info;
+	};
+	struct ComponentEntry {
+		uint32_t deviceId;
+		HookCaptureInputComponent info;
+	};
+
+	template<typename T>
+	void _write(HookCaptureRecordType type, uint32_t deviceId, const T& payload) {
+		auto file = std::atomic_load(&_file);
+		if (file) {
+			_write(*file, type, deviceId, &payload, sizeof(T));
+		}
+	}
+	static void _write(CaptureFile& file, HookCaptureRecordType type, uint32_t deviceId, const void* payload, uint32_t payloadSize);
+
+	void _setHookFeatures(bool acquire);
+	static bool _isValidFileName(const std::string& fileName);
+
+	std::atomic<bool> _active { false };
+	bool _hookFeaturesAcquired = false; // Input and haptic hooks stay enabled while recording
+	std::shared_ptr<CaptureFile> _file;
+	std::string _captureDirectory;
+
+	std::mutex _mutex;
+	std::map<uint32_t, DeviceEntry> _devices;
+	std::vector<ComponentEntry> _components;
+};
+
+
+} // end namespace driver
+} // end namespace vrinputemulator
@@ -1,5 +1,8 @@
 #include "driver_ipc_shm.h"
 
+#include <cstring>
+#include <cmath>
+#include <algorithm>
 #include <boost/date_time/posix_time/posix_time_types.hpp>
 #include <openvr_driver.h>
 #include <ipc_protocol.h>
@@ -15,6 +18,21 @@ namespace driver {
 
 void IpcShmCommunicator::init(ServerDriver* driver) {
 	_driver = driver;
+	memset(_publishedDeviceStates, 0, sizeof(_publishedDeviceStates));
+	try {
+		boost::interprocess::shared_memory_object::remove(_deviceStateShmName.c_str());
+		_deviceStateShm.reset(new boost::interprocess::shared_memory_object(boost::interprocess::create_only, _deviceStateShmName.c_str(), boost::interprocess::read_write));
+		_deviceStateShm->truncate(sizeof(ipc::SharedDeviceStateTable));
+		_deviceStateRegion.reset(new boost::interprocess::mapped_region(*_deviceStateShm, boost::interprocess::read_write));
+		memset(_deviceStateRegion->get_address(), 0, sizeof(ipc::SharedDeviceStateTable));
+		_deviceStateTable = new (_deviceStateRegion->get_address()) ipc::SharedDeviceStateTable();
+		_deviceStateTable->layoutVersion = IPC_SHM_LAYOUT_VERSION;
+	} catch (std::exception& e) {
+		LOG(ERROR) << "Could not create device state shared memory: " << e.what();
+		_deviceStateTable = nullptr;
+		_deviceStateRegion.reset();
+		_deviceStateShm.reset();
+	}
 	_ipcThreadStopFlag = false;
 	_ipcThread = std::thread(_ipcThreadFunc, this, driver);
 }
@@ -24,13 +42,30 @@ void IpcShmCommunicator::shutdown() {
 		_ipcThreadStopFlag = true;
 		_ipcThread.join();
 	}
+	_poseTelemetryActive = false;
+	std::atomic_store(&_poseTelemetrySubscribers, std::shared_ptr<PoseTelemetrySubscriberList>());
+	_retiredPoseTelemetrySubscribers.clear();
+	if (_deviceStateShm) {
+		_deviceStateTable = nullptr;
+		_deviceStateRegion.reset();
+		_deviceStateShm.reset();
+		boost::interprocess::shared_memory_object::remove(_deviceStateShmName.c_str());
+	}
 }
 
 void IpcShmCommunicator::sendReplySetMotionCompensationMode(bool success) {
+	_setMotionCompensationResult = success ? 1 : 2;
+}
+
+void IpcShmCommunicator::_sendPendingMotionCompensationReply() {
+	auto result = _setMotionCompensationResult.exchange(0);
+	if (result == 0) {
+		return;
+	}
 	if (_setMotionCompensationMessageId != 0) {
 		ipc::Reply resp(ipc::ReplyType::GenericReply);
 		resp.messageId = _setMotionCompensationMessageId;
-		if (success) {
+		if (result == 1) {
 			resp.status = ipc::ReplyStatus::Ok;
 		} else {
 			resp.status = ipc::ReplyStatus::NotTracking;
@@ -40,6 +75,161 @@ void IpcShmCommunicator::sendReplySetMotionCompensationMode(bool success) {
 	_setMotionCompensationMessageId = 0;
 }
 
+void IpcShmCommunicator::updateSharedDevicePose(uint32_t deviceId, const vr::DriverPose_t& pose) {
+	if (_devicePosesActive.load(std::memory_order_relaxed) && _deviceStateTable && deviceId < vr::k_unMaxTrackedDeviceCount) {
+		ipc::SharedDevicePoseData data;
+		data.valid = true;
+		data.timestamp = std::chrono::duration_cast <std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+		data.pose = pose;
+		auto& entry = _deviceStateTable->devices[deviceId];
+		ipc::seqlockWrite(entry.poseSequence, entry.pose, data);
+	}
+}
+
+void IpcShmCommunicator::updateEventInjectionDrops(uint64_t droppedEvents) {
+	if (_deviceStateTable) {
+		_deviceStateTable->droppedInjectedEvents.store(droppedEvents, std::memory_order_relaxed);
+	}
+}
+
+void IpcShmCommunicator::writePoseTelemetry(uint32_t deviceId, const vr::DriverPose_t& rawPose, const vr::DriverPose_t& outputPose, bool forwarded) {
+	auto subscribers = std::atomic_load(&_poseTelemetrySubscribers);
+	if (!subscribers || deviceId >= vr::k_unMaxTrackedDeviceCount) {
+		return;
+	}
+	auto timestamp = std::chrono::duration_cast <std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	for (auto& s : *subscribers) {
+		if (!(s->deviceMask & ((uint64_t)1 << deviceId))) {
+			continue;
+		}
+		auto ring = s->ring;
+		// Never wait in the pose hook, when another thread is writing or the reader is too slow the record is dropped
+		if (s->writeLock.test_and_set(std::memory_order_acquire)) {
+			ring->droppedRecords.fetch_add(1, std::memory_order_relaxed);
+			continue;
+		}
+		auto writeIndex = ring->writeIndex.load(std::memory_order_relaxed);
+		if (writeIndex - ring->readIndex.load(std::memory_order_acquire) >= ring->capacity) {
+			ring->droppedRecords.fetch_add(1, std::memory_order_relaxed);
+		} else {
+			auto& r = ring->records()[writeIndex & (ring->capacity - 1)];
+			r.timestamp = timestamp;
+			r.deviceId = deviceId;
+			r.forwarded = forwarded;
+			r.rawPose = rawPose;
+			r.outputPose = outputPose;
+			ring->writeIndex.store(writeIndex + 1, std::memory_order_release);
+		}
+		s->writeLock.clear(std::memory_order_release);
+	}
+}
+
+
+IpcShmCommunicator::PoseTelemetrySubscriber::~PoseTelemetrySubscriber() {
+	ring = nullptr;
+	region.reset();
+	if (shm) {
+		shm.reset();
+		boost::interprocess::shared_memory_object::remove(shmName.c_str());
+	}
+}
+
+
+ipc::ReplyStatus IpcShmCommunicator::_subscribePoseTelemetry(uint32_t clientId, uint64_t deviceMask, uint32_t capacity) {
+	uint32_t ringCapacity = 16;
+	while (ringCapacity < capacity && ringCapacity < IPC_SHM_POSETELEMETRY_MAXCAPACITY) {
+		ringCapacity <<= 1;
+	}
+	auto subscriber = std::make_shared<PoseTelemetrySubscriber>();
+	subscriber->clientId = clientId;
+	subscriber->deviceMask = deviceMask;
+	subscriber->shmName = std::string(IPC_SHM_POSETELEMETRY_NAME) + std::to_string(clientId);
+	try {
+		boost::interprocess::shared_memory_object::remove(subscriber->shmName.c_str());
+		subscriber->shm.reset(new boost::interprocess::shared_memory_object(boost::interprocess::create_only, subscriber->shmName.c_str(), boost::interprocess::read_write));
+		subscriber->shm->truncate(ipc::PoseTelemetryRing::sizeFor(ringCapacity));
+		subscriber->region.reset(new boost::interprocess::mapped_region(*subscriber->shm, boost::interprocess::read_write));
+		memset(subscriber->region->get_address(), 0, sizeof(ipc::PoseTelemetryRing));
+		subscriber->ring = new (subscriber->region->get_address()) ipc::PoseTelemetryRing();
+		subscriber->ring->layoutVersion = IPC_SHM_LAYOUT_VERSION;
+		subscriber->ring->capacity = ringCapacity;
+	} catch (std::exception& e) {
+		LOG(ERROR) << "Could not create pose telemetry shared memory: " << e.what();
+		return ipc::ReplyStatus::UnknownError;
+	}
+	auto subscribers = std::make_shared<PoseTelemetrySubscriberList>();
+	auto oldSubscribers = std::atomic_load(&_poseTelemetrySubscribers);
+	if (oldSubscribers) {
+		for (auto& s : *oldSubscribers) {
+			if (s->clientId != clientId) {
+				subscribers->push_back(s);
+			} else {
+				_retiredPoseTelemetrySubscribers.push_back(s);
+			}
+		}
+	}
+	subscribers->push_back(subscriber);
+	std::atomic_store(&_poseTelemetrySubscribers, subscribers);
+	_poseTelemetryActive = true;
+	LOG(INFO) << "Pose telemetry enabled: clientId " << clientId << ", capacity " << ringCapacity;
+	return ipc::ReplyStatus::Ok;
+}
+
+
+void IpcShmCommunicator::_unsubscribePoseTelemetry(uint32_t clientId) {
+	auto oldSubscribers = std::atomic_load(&_poseTelemetrySubscribers);
+	if (oldSubscribers) {
+		auto subscribers = std::make_shared<PoseTelemetrySubscriberList>();
+		for (auto& s : *oldSubscribers) {
+			if (s->clientId != clientId) {
+				subscribers->push_back(s);
+			} else {
+				_retiredPoseTelemetrySubscribers.push_back(s);
+			}
+		}
+		if (subscribers->size() != oldSubscribers->size()) {
+			LOG(INFO) << "Pose telemetry disabled: clientId " << clientId;
+		}
+		_poseTelemetryActive = !subscribers->empty();
+		std::atomic_store(&_poseTelemetrySubscribers, subscribers);
+	}
+}
+
+
+void IpcShmCommunicator::_releaseRetiredPoseTelemetrySubscribers() {
+	// A pose hook may still hold the old list. Once only we hold a retired subscriber, no hook can reach
+	// it anymore, so its shared memory is unmapped and removed here instead of on a pose hook thread.
+	auto i = _retiredPoseTelemetrySubscribers.begin();
+	while (i != _retiredPoseTelemetrySubscribers.end()) {
+		if (i->use_count() == 1) {
+			i = _retiredPoseTelemetrySubscribers.erase(i);
+		} else {
+			++i;
+		}
+	}
+}
+
+
+void IpcShmCommunicator::_subscribeDevicePoses(uint32_t clientId, bool subscribe) {
+	if (subscribe) {
+		if (_devicePoseSubscribers.insert(clientId).second) {
+			LOG(INFO) << "Device pose mirroring enabled: clientId " << clientId;
+		}
+	} else if (_devicePoseSubscribers.erase(clientId)) {
+		LOG(INFO) << "Device pose mirroring disabled: clientId " << clientId;
+	}
+	bool active = !_devicePoseSubscribers.empty();
+	if (_devicePosesActive.exchange(active) && !active && _deviceStateTable) {
+		// Poses are not updated anymore, so the next reader must not see stale ones
+		ipc::SharedDevicePoseData data;
+		memset(&data, 0, sizeof(data));
+		for (auto& entry : _deviceStateTable->devices) {
+			ipc::seqlockWrite(entry.poseSequence, entry.pose, data);
+		}
+	}
+}
+
+
 void IpcShmCommunicator::_ipcThreadFunc(IpcShmCommunicator* _this, ServerDriver * driver) {
 	_this->_ipcThreadRunning = true;
 	LOG(DEBUG) << "CServerDriver::_ipcThreadFunc: thread started";
@@ -57,9 +247,7 @@ void IpcShmCommunicator::_ipcThreadFunc(IpcShmCommunicator* _this, ServerDriver
 			try {
 				ipc::Request message;
 				uint64_t recv_size;
-				unsigned priority;
-				boost::posix_time::ptime timeout = boost::posix_time::microsec_clock::universal_time() + boost::posix_time::milliseconds(50);
-				if (messageQueue.timed_receive(&message, sizeof(ipc::Request), recv_size, priority, timeout)) {
+				if (_this->_receiveRequest(messageQueue, message, recv_size)) {
 					LOG(TRACE) << "CServerDriver::_ipcThreadFunc: IPC request received ( type " << (int)message.type << ")";
 					if (recv_size == sizeof(ipc::Request)) {
 						switch (message.type) {
@@ -74,7 +262,10 @@ void IpcShmCommunicator::_ipcThreadFunc(IpcShmCommunicator* _this, ServerDriver
 									uint32_t clientId = 0;
 									if (message.msg.ipc_ClientConnect.ipcProcotolVersion == IPC_PROTOCOL_VERSION) {
 										clientId = _this->_ipcClientIdNext++;
-										_this->_ipcEndpoints.insert({ clientId, queue });
+										{
+											std::lock_guard<std::mutex> guard(_this->_sendMutex);
+											_this->_ipcEndpoints.insert({ clientId, queue });
+										}
 										reply.msg.ipc_ClientConnect.clientId = clientId;
 										reply.status = ipc::ReplyStatus::Ok;
 										LOG(INFO) << "New client connected: endpoint \"" << message.msg.ipc_ClientConnect.queueName << "\", cliendId " << clientId;
@@ -102,7 +293,13 @@ void IpcShmCommunicator::_ipcThreadFunc(IpcShmCommunicator* _this, ServerDriver
 									if (reply.messageId != 0) {
 										_this->sendReply(message.msg.ipc_ClientDisconnect.clientId, reply);
 									}
-									_this->_ipcEndpoints.erase(i);
+									_this->_unsubscribeDeviceStateChanges(message.msg.ipc_ClientDisconnect.clientId);
+									_this->_unsubscribePoseTelemetry(message.msg.ipc_ClientDisconnect.clientId);
+									_this->_subscribeDevicePoses(message.msg.ipc_ClientDisconnect.clientId, false);
+									{
+										std::lock_guard<std::mutex> guard(_this->_sendMutex);
+										_this->_ipcEndpoints.erase(i);
+									}
 								} else {
 									LOG(ERROR) << "Error during client disconnect: unknown clientID " << message.msg.ipc_ClientDisconnect.clientId;
 								}
@@ -123,7 +320,7 @@ void IpcShmCommunicator::_ipcThreadFunc(IpcShmCommunicator* _this, ServerDriver
 						case ipc::RequestType::OpenVR_ButtonEvent:
 							{
 								if (vr::VRServerDriverHost()) {
-									unsigned iterCount = min(message.msg.ipc_ButtonEvent.eventCount, REQUEST_OPENVR_BUTTONEVENT_MAXCOUNT);
+									unsigned iterCount = std::min(message.msg.ipc_ButtonEvent.eventCount, (unsigned)REQUEST_OPENVR_BUTTONEVENT_MAXCOUNT);
 									for (unsigned i = 0; i < iterCount; ++i) {
 										auto& e = message.msg.ipc_ButtonEvent.events[i];
 										try {
@@ -136,25 +333,6 @@ void IpcShmCommunicator::_ipcThreadFunc(IpcShmCommunicator* _this, ServerDriver
 							}
 							break;
 
-						case ipc::RequestType::OpenVR_AxisEvent:
-							{
-								if (vr::VRServerDriverHost()) {
-									for (unsigned i = 0; i < message.msg.ipc_AxisEvent.eventCount; ++i) {
-										auto& e = message.msg.ipc_AxisEvent.events[i];
-										driver->openvr_axisEvent(e.deviceId, e.axisId, e.axisState);
-									}
-								}
-							}
-							break;
-
-						case ipc::RequestType::OpenVR_PoseUpdate:
-							{
-								if (vr::VRServerDriverHost()) {
-									driver->openvr_poseUpdate(message.msg.ipc_PoseUpdate.deviceId, message.msg.ipc_PoseUpdate.pose, message.timestamp);
-								}
-							}
-							break;
-
 						case ipc::RequestType::OpenVR_ProximitySensorEvent:
 							{
 								driver->openvr_proximityEvent(message.msg.ipc_PoseUpdate.deviceId, message.msg.ovr_ProximitySensorEvent.sensorTriggered);
@@ -192,7 +370,7 @@ void IpcShmCommunicator::_ipcThreadFunc(IpcShmCommunicator* _this, ServerDriver
 										resp.msg.vd_GetDeviceInfo.virtualDeviceId = message.msg.vd_GenericDeviceIdMessage.deviceId;
 										resp.msg.vd_GetDeviceInfo.openvrDeviceId = d->openvrDeviceId();
 										resp.msg.vd_GetDeviceInfo.deviceType = d->deviceType();
-										strncpy_s(resp.msg.vd_GetDeviceInfo.deviceSerial, d->serialNumber().c_str(), 127);
+										std::strncpy(resp.msg.vd_GetDeviceInfo.deviceSerial, d->serialNumber().c_str(), 127);
 										resp.msg.vd_GetDeviceInfo.deviceSerial[127] = '\0';
 										resp.status = ipc::ReplyStatus::Ok;
 									}
@@ -460,6 +638,58 @@ void IpcShmCommunicator::_ipcThreadFunc(IpcShmCommunicator* _this, ServerDriver
 							}
 							break;
 
+						case ipc::RequestType::VirtualDevices_SetPosePrediction:
+							{
+								ipc::Reply resp(ipc::ReplyType::GenericReply);
+								resp.messageId = message.msg.vd_SetPosePrediction.messageId;
+								if (message.msg.vd_SetPosePrediction.virtualDeviceId >= driver->virtualDevices_getDeviceCount()) {
+									resp.status = ipc::ReplyStatus::InvalidId;
+								} else {
+									auto device = driver->virtualDevices_getDevice(message.msg.vd_SetPosePrediction.virtualDeviceId);
+									if (!device) {
+										resp.status = ipc::ReplyStatus::NotFound;
+									} else {
+										device->setPosePrediction(message.msg.vd_SetPosePrediction.settings);
+										resp.status = ipc::ReplyStatus::Ok;
+									}
+								}
+								if (resp.status != ipc::ReplyStatus::Ok) {
+									LOG(ERROR) << "Error while setting pose prediction: Error code " << (int)resp.status;
+								}
+								if (resp.messageId != 0) {
+									_this->sendReply(message.msg.vd_SetPosePrediction.clientId, resp);
+								}
+							}
+							break;
+
+						case ipc::RequestType::VirtualDevices_SetPoseRate:
+							{
+								ipc::Reply resp(ipc::ReplyType::GenericReply);
+								resp.messageId = message.msg.vd_SetPoseRate.messageId;
+								if (message.msg.vd_SetPoseRate.virtualDeviceId == vr::k_unTrackedDeviceIndexInvalid) {
+									driver->setPosePumpRate(message.msg.vd_SetPoseRate.rate);
+									resp.status = ipc::ReplyStatus::Ok;
+								} else if (message.msg.vd_SetPoseRate.virtualDeviceId >= driver->virtualDevices_getDeviceCount()) {
+									resp.status = ipc::ReplyStatus::InvalidId;
+								} else {
+									auto device = driver->virtualDevices_getDevice(message.msg.vd_SetPoseRate.virtualDeviceId);
+									if (!device) {
+										resp.status = ipc::ReplyStatus::NotFound;
+									} else {
+										device->setPoseRate(message.msg.vd_SetPoseRate.rate);
+										driver->posePump().devicesChanged();
+										resp.status = ipc::ReplyStatus::Ok;
+									}
+								}
+								if (resp.status != ipc::ReplyStatus::Ok) {
+									LOG(ERROR) << "Error while setting pose rate: Error code " << (int)resp.status;
+								}
+								if (resp.messageId != 0) {
+									_this->sendReply(message.msg.vd_SetPoseRate.clientId, resp);
+								}
+							}
+							break;
+
 						case ipc::RequestType::DeviceManipulation_GetDeviceInfo:
 							{
 								ipc::Reply resp(ipc::ReplyType::GenericReply);
@@ -675,6 +905,7 @@ void IpcShmCommunicator::_ipcThreadFunc(IpcShmCommunicator* _this, ServerDriver
 											}
 											break;
 										}
+										_this->deviceStateChanged(message.msg.dm_DeviceOffsets.deviceId);
 									}
 								}
 								if (resp.status != ipc::ReplyStatus::Ok) {
@@ -794,8 +1025,11 @@ void IpcShmCommunicator::_ipcThreadFunc(IpcShmCommunicator* _this, ServerDriver
 										resp.status = ipc::ReplyStatus::NotFound;
 									} else {
 										auto serverDriver = ServerDriver::getInstance();
-										if (serverDriver) {
-											serverDriver->motionCompensation().setMotionCompensationVelAccMode(message.msg.dm_MotionCompensationMode.velAccCompensationMode);
+										if (info->motionCompensationGroup() >= maxMotionCompensationGroups) {
+											resp.status = ipc::ReplyStatus::InvalidOperation;
+										} else if (serverDriver) {
+											serverDriver->motionCompensation().setMotionCompensationVelAccMode(info->motionCompensationGroup(), message.msg.dm_MotionCompensationMode.velAccCompensationMode);
+											_this->_setMotionCompensationResult = 0;
 											info->setMotionCompensationMode();
 											_this->_setMotionCompensationMessageId = message.msg.dm_MotionCompensationMode.messageId;
 											_this->_setMotionCompensationClientId = message.msg.dm_MotionCompensationMode.clientId;
@@ -848,6 +1082,29 @@ void IpcShmCommunicator::_ipcThreadFunc(IpcShmCommunicator* _this, ServerDriver
 									DeviceManipulationHandle* info = driver->getDeviceManipulationHandleById(message.msg.dm_triggerHapticPulse.deviceId);
 									if (!info) {
 										resp.status = ipc::ReplyStatus::NotFound;
+									} else if (message.msg.dm_triggerHapticPulse.waveformSegmentCount > 0) {
+										// The whole waveform is played by the output injection worker, one message instead of one per pulse
+										auto& request = message.msg.dm_triggerHapticPulse;
+										auto segmentCount = std::min(request.waveformSegmentCount, maxHapticWaveformSegments);
+										bool valid = true;
+										for (uint32_t i = 0; i < segmentCount; ++i) {
+											auto& segment = request.waveform[i];
+											if (!std::isfinite(segment.durationSeconds) || !std::isfinite(segment.frequency) || !std::isfinite(segment.amplitude)) {
+												valid = false;
+												break;
+											}
+											segment.durationSeconds = std::min(std::max(0.0f, segment.durationSeconds), maxHapticWaveformSegmentSeconds);
+											segment.delayMicroseconds = std::min(segment.delayMicroseconds, (uint32_t)(maxHapticWaveformSegmentSeconds * 1E6f));
+											segment.amplitude = std::min(std::max(0.0f, segment.amplitude), 1.0f);
+										}
+										auto target = info->hapticTarget(request.directMode);
+										if (!valid) {
+											resp.status = ipc::ReplyStatus::InvalidOperation;
+										} else if (!target || driver->outputInjection().playHapticWaveform(target, request.waveform, segmentCount)) {
+											resp.status = ipc::ReplyStatus::Ok;
+										} else {
+											resp.status = ipc::ReplyStatus::UnknownError;
+										}
 									} else {
 										info->triggerHapticPulse(message.msg.dm_triggerHapticPulse.axisId, message.msg.dm_triggerHapticPulse.durationMicroseconds, message.msg.dm_triggerHapticPulse.directMode);
 										resp.status = ipc::ReplyStatus::Ok;
@@ -867,18 +1124,21 @@ void IpcShmCommunicator::_ipcThreadFunc(IpcShmCommunicator* _this, ServerDriver
 								ipc::Reply resp(ipc::ReplyType::GenericReply);
 								resp.messageId = message.msg.dm_SetMotionCompensationProperties.messageId;
 								auto serverDriver = ServerDriver::getInstance();
-								if (serverDriver) {
+								auto group = message.msg.dm_SetMotionCompensationProperties.group;
+								if (group >= maxMotionCompensationGroups) {
+									resp.status = ipc::ReplyStatus::InvalidId;
+								} else if (serverDriver) {
 									if (message.msg.dm_SetMotionCompensationProperties.velAccCompensationModeValid) {
-										serverDriver->motionCompensation().setMotionCompensationVelAccMode(message.msg.dm_SetMotionCompensationProperties.velAccCompensationMode);
+										serverDriver->motionCompensation().setMotionCompensationVelAccMode(group, message.msg.dm_SetMotionCompensationProperties.velAccCompensationMode);
 									}
 									if (message.msg.dm_SetMotionCompensationProperties.kalmanFilterProcessNoiseValid) {
-										serverDriver->motionCompensation().setMotionCompensationKalmanProcessVariance(message.msg.dm_SetMotionCompensationProperties.kalmanFilterProcessNoise);
+										serverDriver->motionCompensation().setMotionCompensationKalmanProcessVariance(group, message.msg.dm_SetMotionCompensationProperties.kalmanFilterProcessNoise);
 									}
 									if (message.msg.dm_SetMotionCompensationProperties.kalmanFilterObservationNoiseValid) {
-										serverDriver->motionCompensation().setMotionCompensationKalmanObservationVariance(message.msg.dm_SetMotionCompensationProperties.kalmanFilterObservationNoise);
+										serverDriver->motionCompensation().setMotionCompensationKalmanObservationVariance(group, message.msg.dm_SetMotionCompensationProperties.kalmanFilterObservationNoise);
 									}
 									if (message.msg.dm_SetMotionCompensationProperties.movingAverageWindowValid) {
-										serverDriver->motionCompensation().setMotionCompensationMovingAverageWindow(message.msg.dm_SetMotionCompensationProperties.movingAverageWindow);
+										serverDriver->motionCompensation().setMotionCompensationMovingAverageWindow(group, message.msg.dm_SetMotionCompensationProperties.movingAverageWindow);
 									}
 									resp.status = ipc::ReplyStatus::Ok;
 								} else {
@@ -893,6 +1153,169 @@ void IpcShmCommunicator::_ipcThreadFunc(IpcShmCommunicator* _this, ServerDriver
 							}
 							break;
 
+						case ipc::RequestType::DeviceManipulation_SubscribeDeviceStateChanges:
+							{
+								ipc::Reply resp(ipc::ReplyType::GenericReply);
+								resp.messageId = message.msg.dm_SubscribeDeviceStateChanges.messageId;
+								auto clientId = message.msg.dm_SubscribeDeviceStateChanges.clientId;
+								if (_this->_ipcEndpoints.find(clientId) == _this->_ipcEndpoints.end()) {
+									resp.status = ipc::ReplyStatus::InvalidId;
+								} else {
+									if (!message.msg.dm_SubscribeDeviceStateChanges.subscribe) {
+										_this->_unsubscribeDeviceStateChanges(clientId);
+									}
+									resp.status = ipc::ReplyStatus::Ok;
+								}
+								if (resp.status != ipc::ReplyStatus::Ok) {
+									LOG(ERROR) << "Error while subscribing to device state changes: Error code " << (int)resp.status;
+								}
+								if (resp.messageId != 0) {
+									_this->sendReply(clientId, resp);
+								}
+								// New subscribers get the current state of all devices (after the reply)
+								if (resp.status == ipc::ReplyStatus::Ok && message.msg.dm_SubscribeDeviceStateChanges.subscribe) {
+									_this->_subscribeDeviceStateChanges(clientId);
+								}
+							}
+							break;
+
+						case ipc::RequestType::DeviceManipulation_SubscribePoseTelemetry:
+							{
+								ipc::Reply resp(ipc::ReplyType::GenericReply);
+								resp.messageId = message.msg.dm_SubscribePoseTelemetry.messageId;
+								auto clientId = message.msg.dm_SubscribePoseTelemetry.clientId;
+								if (_this->_ipcEndpoints.find(clientId) == _this->_ipcEndpoints.end()) {
+									resp.status = ipc::ReplyStatus::InvalidId;
+								} else if (message.msg.dm_SubscribePoseTelemetry.subscribe) {
+									resp.status = _this->_subscribePoseTelemetry(clientId, message.msg.dm_SubscribePoseTelemetry.deviceMask, message.msg.dm_SubscribePoseTelemetry.capacity);
+								} else {
+									_this->_unsubscribePoseTelemetry(clientId);
+									resp.status = ipc::ReplyStatus::Ok;
+								}
+								if (resp.status != ipc::ReplyStatus::Ok) {
+									LOG(ERROR) << "Error while subscribing to pose telemetry: Error code " << (int)resp.status;
+								}
+								if (resp.messageId != 0) {
+									_this->sendReply(clientId, resp);
+								}
+							}
+							break;
+
+						case ipc::RequestType::DeviceManipulation_SubscribeDevicePoses:
+							{
+								ipc::Reply resp(ipc::ReplyType::GenericReply);
+								resp.messageId = message.msg.dm_SubscribeDevicePoses.messageId;
+								auto clientId = message.msg.dm_SubscribeDevicePoses.clientId;
+								if (_this->_ipcEndpoints.find(clientId) == _this->_ipcEndpoints.end()) {
+									resp.status = ipc::ReplyStatus::InvalidId;
+								} else {
+									_this->_subscribeDevicePoses(clientId, message.msg.dm_SubscribeDevicePoses.subscribe);
+									resp.status = ipc::ReplyStatus::Ok;
+								}
+								if (resp.status != ipc::ReplyStatus::Ok) {
+									LOG(ERROR) << "Error while subscribing to device poses: Error code " << (int)resp.status;
+								}
+								if (resp.messageId != 0) {
+									_this->sendReply(clientId, resp);
+								}
+							}
+							break;
+
+						case ipc::RequestType::DeviceManipulation_HookCapture:
+							{
+								ipc::Reply resp(ipc::ReplyType::GenericReply);
+								resp.messageId = message.msg.dm_HookCapture.messageId;
+								if (message.msg.dm_HookCapture.start) {
+									message.msg.dm_HookCapture.fileName[sizeof(message.msg.dm_HookCapture.fileName) - 1] = '\0';
+									uint64_t maxSize = (uint64_t)message.msg.dm_HookCapture.maxSizeMB * 1024 * 1024;
+									if (driver->hookRecorder().start(message.msg.dm_HookCapture.fileName, maxSize)) {
+										resp.status = ipc::ReplyStatus::Ok;
+									} else {
+										resp.status = ipc::ReplyStatus::UnknownError;
+									}
+								} else {
+									driver->hookRecorder().stop();
+									resp.status = ipc::ReplyStatus::Ok;
+								}
+								if (resp.messageId != 0) {
+									_this->sendReply(message.msg.dm_HookCapture.clientId, resp);
+								}
+							}
+							break;
+
+						case ipc::RequestType::DeviceManipulation_InputMirror:
+							{
+								ipc::Reply resp(ipc::ReplyType::GenericReply);
+								resp.messageId = message.msg.dm_InputMirror.messageId;
+								auto sourceId = message.msg.dm_InputMirror.sourceDeviceId;
+								auto targetId = message.msg.dm_InputMirror.targetDeviceId;
+								if (sourceId >= vr::k_unMaxTrackedDeviceCount || targetId >= vr::k_unMaxTrackedDeviceCount || sourceId == targetId) {
+									resp.status = ipc::ReplyStatus::InvalidId;
+								} else if (driver->setInputMirror(sourceId, targetId, message.msg.dm_InputMirror.enable)) {
+									resp.status = ipc::ReplyStatus::Ok;
+								} else {
+									resp.status = ipc::ReplyStatus::InvalidOperation;
+								}
+								if (resp.messageId != 0) {
+									_this->sendReply(message.msg.dm_InputMirror.clientId, resp);
+								}
+							}
+							break;
+
+						case ipc::RequestType::DeviceManipulation_SetPoseSmoothing:
+							{
+								ipc::Reply resp(ipc::ReplyType::GenericReply);
+								resp.messageId = message.msg.dm_SetPoseSmoothing.messageId;
+								if (message.msg.dm_SetPoseSmoothing.deviceId >= vr::k_unMaxTrackedDeviceCount) {
+									resp.status = ipc::ReplyStatus::InvalidId;
+								} else {
+									DeviceManipulationHandle* info = driver->getDeviceManipulationHandleById(message.msg.dm_SetPoseSmoothing.deviceId);
+									if (!info) {
+										resp.status = ipc::ReplyStatus::NotFound;
+									} else {
+										info->setPoseSmoothing(message.msg.dm_SetPoseSmoothing.settings);
+										resp.status = ipc::ReplyStatus::Ok;
+									}
+								}
+								if (resp.status != ipc::ReplyStatus::Ok) {
+									LOG(ERROR) << "Error while setting pose smoothing: Error code " << (int)resp.status;
+								}
+								if (resp.messageId != 0) {
+									_this->sendReply(message.msg.dm_SetPoseSmoothing.clientId, resp);
+								}
+							}
+							break;
+
+						case ipc::RequestType::DeviceManipulation_SetMotionCompensationGroup:
+							{
+								ipc::Reply resp(ipc::ReplyType::GenericReply);
+								resp.messageId = message.msg.dm_SetMotionCompensationGroup.messageId;
+								if (message.msg.dm_SetMotionCompensationGroup.deviceId >= vr::k_unMaxTrackedDeviceCount) {
+									resp.status = ipc::ReplyStatus::InvalidId;
+								} else {
+									DeviceManipulationHandle* info = driver->getDeviceManipulationHandleById(message.msg.dm_SetMotionCompensationGroup.deviceId);
+									if (!info) {
+										resp.status = ipc::ReplyStatus::NotFound;
+									} else {
+										auto res = info->setMotionCompensationGroup(message.msg.dm_SetMotionCompensationGroup.group);
+										if (res == -1) {
+											resp.status = ipc::ReplyStatus::InvalidId;
+										} else if (res != 0) {
+											resp.status = ipc::ReplyStatus::InvalidOperation;
+										} else {
+											resp.status = ipc::ReplyStatus::Ok;
+										}
+									}
+								}
+								if (resp.status != ipc::ReplyStatus::Ok) {
+									LOG(ERROR) << "Error while setting motion compensation group: Error code " << (int)resp.status;
+								}
+								if (resp.messageId != 0) {
+									_this->sendReply(message.msg.dm_SetMotionCompensationGroup.clientId, resp);
+								}
+							}
+							break;
+
 						case ipc::RequestType::InputRemapping_SetTouchpadEmulationFixEnabled: {
 							DeviceManipulationHandle::setTouchpadEmulationFixFlag(message.msg.ir_SetTouchPadEmulationFixEnabled.enable);
 						} break;
@@ -905,6 +1328,11 @@ void IpcShmCommunicator::_ipcThreadFunc(IpcShmCommunicator* _this, ServerDriver
 						LOG(ERROR) << "Error in ipc server receive loop: received size is wrong (" << recv_size << " != " << sizeof(ipc::Request) << ")";
 					}
 				}
+				_this->_sendPendingMotionCompensationReply();
+				_this->_publishDirtyDeviceStates();
+				_this->_resyncDeviceStateSubscribers();
+				driver->releaseIdleEventInjectionHook();
+				_this->_releaseRetiredPoseTelemetrySubscribers();
 			} catch (std::exception& ex) {
 				LOG(ERROR) << "Exception caught in ipc server receive loop: " << ex.what();
 			}
@@ -918,6 +1346,264 @@ void IpcShmCommunicator::_ipcThreadFunc(IpcShmCommunicator* _this, ServerDriver
 }
 
 
+bool IpcShmCommunicator::_receiveRequest(boost::interprocess::message_queue& queue, ipc::Request& message, uint64_t& recv_size) {
+	if (_pendingRequests.empty()) {
+		unsigned priority;
+		boost::posix_time::ptime timeout = boost::posix_time::microsec_clock::universal_time() + boost::posix_time::milliseconds(50);
+		if (!queue.timed_receive(&message, sizeof(ipc::Request), recv_size, priority, timeout)) {
+			return false;
+		}
+		// Drain everything that is already waiting so that pose and axis updates can be coalesced in one sweep
+		do {
+			_pendingRequests.push_back({ message, recv_size });
+		} while (_pendingRequests.size() < queue.get_max_msg() && queue.try_receive(&message, sizeof(ipc::Request), recv_size, priority));
+	}
+	while (!_pendingRequests.empty()) {
+		message = _pendingRequests.front().request;
+		recv_size = _pendingRequests.front().size;
+		_pendingRequests.pop_front();
+		if (recv_size == sizeof(ipc::Request)
+				&& (message.type == ipc::RequestType::OpenVR_PoseUpdate || message.type == ipc::RequestType::OpenVR_AxisEvent)) {
+			_coalesceRequest(message);
+		} else {
+			// Everything else (including button events) needs to see all preceding updates applied
+			_flushCoalescedUpdates();
+			return true;
+		}
+	}
+	_flushCoalescedUpdates();
+	return false;
+}
+
+
+void IpcShmCommunicator::_coalesceRequest(const ipc::Request& message) {
+	if (message.type == ipc::RequestType::OpenVR_PoseUpdate) {
+		auto deviceId = message.msg.ipc_PoseUpdate.deviceId;
+		if (deviceId < vr::k_unMaxTrackedDeviceCount) {
+			auto& p = _coalescedPoses[deviceId];
+			p.pending = true;
+			p.timestamp = message.timestamp;
+			p.pose = message.msg.ipc_PoseUpdate.pose;
+			_coalescedUpdatesPending = true;
+		} else {
+			LOG(ERROR) << "Error in ipc server receive loop: Invalid device id in pose update (" << deviceId << ")";
+		}
+	} else if (message.type == ipc::RequestType::OpenVR_AxisEvent) {
+		unsigned iterCount = std::min(message.msg.ipc_AxisEvent.eventCount, (unsigned)REQUEST_OPENVR_AXISEVENT_MAXCOUNT);
+		for (unsigned i = 0; i < iterCount; ++i) {
+			auto& e = message.msg.ipc_AxisEvent.events[i];
+			if (e.deviceId < vr::k_unMaxTrackedDeviceCount && e.axisId < vr::k_unControllerStateAxisCount) {
+				auto& a = _coalescedAxes[e.deviceId][e.axisId];
+				a.pending = true;
+				a.axisState = e.axisState;
+				_coalescedUpdatesPending = true;
+			} else {
+				LOG(ERROR) << "Error in ipc server receive loop: Invalid device/axis id in axis event (" << e.deviceId << ", " << e.axisId << ")";
+			}
+		}
+	}
+}
+
+
+void IpcShmCommunicator::_flushCoalescedUpdates() {
+	if (!_coalescedUpdatesPending) {
+		return;
+	}
+	_coalescedUpdatesPending = false;
+	bool hasHost = vr::VRServerDriverHost() != nullptr;
+	for (uint32_t deviceId = 0; deviceId < vr::k_unMaxTrackedDeviceCount; ++deviceId) {
+		for (uint32_t axisId = 0; axisId < vr::k_unControllerStateAxisCount; ++axisId) {
+			auto& a = _coalescedAxes[deviceId][axisId];
+			if (a.pending) {
+				a.pending = false;
+				if (hasHost) {
+					_driver->openvr_axisEvent(deviceId, axisId, a.axisState);
+				}
+			}
+		}
+		auto& p = _coalescedPoses[deviceId];
+		if (p.pending) {
+			p.pending = false;
+			if (hasHost) {
+				_driver->openvr_poseUpdate(deviceId, p.pose, p.timestamp);
+			}
+		}
+	}
+}
+
+
+bool IpcShmCommunicator::_getDeviceState(uint32_t deviceId, DeviceState& state) {
+	auto info = _driver->getDeviceManipulationHandleById(deviceId);
+	if (!info) {
+		return false;
+	}
+	// zero everything (including padding) so that states can be compared with memcmp
+	memset(&state, 0, sizeof(DeviceState));
+	state.info.deviceId = deviceId;
+	state.info.deviceClass = info->deviceClass();
+	state.info.deviceMode = info->deviceMode();
+	auto ref = info->redirectRef();
+	if (ref) {
+		state.info.refDeviceId = ref->openvrId();
+	} else {
+		state.info.refDeviceId = (uint32_t)vr::k_unTrackedDeviceIndexInvalid;
+	}
+	state.info.offsetsEnabled = info->areOffsetsEnabled();
+	state.info.redirectSuspended = info->redirectSuspended();
+	state.offsets.deviceId = deviceId;
+	state.offsets.offsetsEnabled = info->areOffsetsEnabled();
+	state.offsets.worldFromDriverRotationOffset = info->worldFromDriverRotationOffset();
+	state.offsets.worldFromDriverTranslationOffset = info->worldFromDriverTranslationOffset();
+	state.offsets.driverFromHeadRotationOffset = info->driverFromHeadRotationOffset();
+	state.offsets.driverFromHeadTranslationOffset = info->driverFromHeadTranslationOffset();
+	state.offsets.deviceRotationOffset = info->deviceRotationOffset();
+	state.offsets.deviceTranslationOffset = info->deviceTranslationOffset();
+	state.motionCompensationGroup = info->motionCompensationGroup();
+	if (state.info.deviceMode == 5 && state.motionCompensationGroup < maxMotionCompensationGroups) {
+		state.motionCompensationStatus = (uint32_t)_driver->motionCompensation().motionCompensationStatus(state.motionCompensationGroup);
+	}
+	return true;
+}
+
+
+void IpcShmCommunicator::_getSharedDeviceState(uint32_t deviceId, ipc::SharedDeviceStateData& data) {
+	memset(&data, 0, sizeof(ipc::SharedDeviceStateData));
+	data.valid = _getDeviceState(deviceId, data.state);
+	if (data.valid) {
+		auto info = _driver->getDeviceManipulationHandleById(deviceId);
+		data.digitalRemappingMask = info->digitalInputRemappingMask();
+		data.analogRemappingMask = info->analogInputRemappingMask();
+	}
+}
+
+
+void IpcShmCommunicator::deviceStateChanged(uint32_t deviceId) {
+	if (deviceId >= vr::k_unMaxTrackedDeviceCount) {
+		return;
+	}
+	if (std::this_thread::get_id() == _ipcThread.get_id()) {
+		_publishDeviceState(deviceId);
+	} else {
+		_dirtyDeviceStates.fetch_or((uint64_t)1 << deviceId, std::memory_order_relaxed);
+	}
+}
+
+
+void IpcShmCommunicator::_publishDirtyDeviceStates() {
+	auto dirty = _dirtyDeviceStates.exchange(0, std::memory_order_relaxed);
+	for (uint32_t deviceId = 0; dirty != 0; ++deviceId, dirty >>= 1) {
+		if (dirty & 1) {
+			_publishDeviceState(deviceId);
+		}
+	}
+}
+
+
+void IpcShmCommunicator::_publishDeviceState(uint32_t deviceId) {
+	std::lock_guard<std::mutex> lock(_deviceStateMutex);
+	if (_deviceStateSubscribers.empty() && !_deviceStateTable) {
+		return;
+	}
+	ipc::SharedDeviceStateData data;
+	_getSharedDeviceState(deviceId, data);
+	auto& published = _publishedDeviceStates[deviceId];
+	if (memcmp(&data, &published, sizeof(ipc::SharedDeviceStateData)) == 0) {
+		return;
+	}
+	bool stateChanged = data.valid && (!published.valid || memcmp(&data.state, &published.state, sizeof(DeviceState)) != 0);
+	published = data;
+	if (_deviceStateTable) {
+		auto& entry = _deviceStateTable->devices[deviceId];
+		ipc::seqlockWrite(entry.stateSequence, entry.state, data);
+		_deviceStateTable->updateCounter.fetch_add(1, std::memory_order_release);
+	}
+	if (stateChanged) {
+		ipc::Reply reply(ipc::ReplyType::DeviceManipulation_DeviceStateChanged);
+		reply.messageId = 0;
+		reply.status = ipc::ReplyStatus::Ok;
+		reply.msg.dm_deviceStateChanged.state = data.state;
+		for (auto& s : _deviceStateSubscribers) {
+			// A subscriber that is already out of sync gets everything with the next resync anyway
+			if (!s.second.resync && !_trySendNotification(s.first, reply)) {
+				_deviceStateNotificationDropped(s.first, s.second);
+			}
+		}
+	}
+}
+
+
+void IpcShmCommunicator::_subscribeDeviceStateChanges(uint32_t clientId) {
+	std::lock_guard<std::mutex> lock(_deviceStateMutex);
+	auto& subscriber = _deviceStateSubscribers[clientId];
+	if (!_sendDeviceStates(clientId)) {
+		_deviceStateNotificationDropped(clientId, subscriber);
+	}
+}
+
+
+void IpcShmCommunicator::_unsubscribeDeviceStateChanges(uint32_t clientId) {
+	std::lock_guard<std::mutex> lock(_deviceStateMutex);
+	auto i = _deviceStateSubscribers.find(clientId);
+	if (i != _deviceStateSubscribers.end()) {
+		if (i->second.droppedNotifications > 0) {
+			LOG(INFO) << "Device state subscriber " << clientId << " dropped " << i->second.droppedNotifications << " notifications";
+		}
+		_deviceStateSubscribers.erase(i);
+	}
+}
+
+
+void IpcShmCommunicator::_deviceStateNotificationDropped(uint32_t clientId, DeviceStateSubscriber& subscriber) {
+	if (!subscriber.resync) {
+		LOG(WARNING) << "Reply queue of device state subscriber " << clientId << " is full, resending all device states later";
+	}
+	subscriber.droppedNotifications++;
+	subscriber.resync = true;
+	_deviceStateResyncPending = true;
+}
+
+
+void IpcShmCommunicator::_resyncDeviceStateSubscribers() {
+	if (!_deviceStateResyncPending.exchange(false)) {
+		return;
+	}
+	std::lock_guard<std::mutex> lock(_deviceStateMutex);
+	for (auto& s : _deviceStateSubscribers) {
+		if (s.second.resync) {
+			if (_sendDeviceStates(s.first)) {
+				s.second.resync = false;
+			} else {
+				s.second.droppedNotifications++;
+				_deviceStateResyncPending = true;
+			}
+		}
+	}
+}
+
+
+bool IpcShmCommunicator::_sendDeviceStates(uint32_t clientId) {
+	for (uint32_t deviceId = 0; deviceId < vr::k_unMaxTrackedDeviceCount; ++deviceId) {
+		ipc::Reply reply(ipc::ReplyType::DeviceManipulation_DeviceStateChanged);
+		reply.messageId = 0;
+		reply.status = ipc::ReplyStatus::Ok;
+		if (_getDeviceState(deviceId, reply.msg.dm_deviceStateChanged.state) && !_trySendNotification(clientId, reply)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+bool IpcShmCommunicator::_trySendNotification(uint32_t clientId, const ipc::Reply& reply) {
+	std::lock_guard<std::mutex> guard(_sendMutex);
+	auto i = _ipcEndpoints.find(clientId);
+	if (i != _ipcEndpoints.end()) {
+		return i->second->try_send(&reply, sizeof(ipc::Reply), 0);
+	}
+	return true;
+}
+
+
 void IpcShmCommunicator::sendReply(uint32_t clientId, const ipc::Reply& reply) {
 	std::lock_guard<std::mutex> guard(_sendMutex);
 	auto i = _ipcEndpoints.find(clientId);
@@ -3,17 +3,24 @@
 #include <thread>
 #include <string>
 #include <map>
+#include <set>
+#include <chrono>
 #include <mutex>
 #include <memory>
+#include <deque>
+#include <vector>
+#include <atomic>
 #include <boost/interprocess/ipc/message_queue.hpp>
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <openvr_driver.h>
+#include <ipc_protocol.h>
+#include <ipc_shm_layout.h>
 
 
 // driver namespace
 namespace vrinputemulator {
 
-// forward declarations
-namespace ipc { struct Reply; }
-
 namespace driver {
 
 // forward declarations
@@ -25,14 +32,57 @@ public:
 	void init(ServerDriver* driver);
 	void shutdown();
 
+	/** Can be called from any thread, the reply is sent by the ipc thread */
 	void sendReplySetMotionCompensationMode(bool success);
 
+	/** Called from the pose hooks with the pose that is forwarded to OpenVR. Does nothing while no client reads poses */
+	void updateSharedDevicePose(uint32_t deviceId, const vr::DriverPose_t& pose);
+	bool isDevicePoseMirrorActive() const { return _devicePosesActive.load(std::memory_order_relaxed); }
+	void updateEventInjectionDrops(uint64_t droppedEvents);
+
+	/** Has to be called whenever something in the DeviceState of a device changes, can be called from any thread.
+	* On the ipc thread the shared device state table is updated and subscribers are notified right away. Other
+	* threads (SteamVR's hook threads) only mark the device, the ipc thread publishes it within one receive timeout,
+	* so a client that does not read its reply queue can never stall them */
+	void deviceStateChanged(uint32_t deviceId);
+
+	/** Pose telemetry is opt-in, the pose hook only needs to make a copy of the raw pose when this returns true */
+	bool isPoseTelemetryActive() const { return _poseTelemetryActive; }
+	void writePoseTelemetry(uint32_t deviceId, const vr::DriverPose_t& rawPose, const vr::DriverPose_t& outputPose, bool forwarded);
+
 private:
 	static void _ipcThreadFunc(IpcShmCommunicator* _this, ServerDriver* driver);
 
+	/** Returns the next request that needs to be dispatched. Pose and axis updates are coalesced and applied internally. */
+	bool _receiveRequest(boost::interprocess::message_queue& queue, ipc::Request& message, uint64_t& recv_size);
+	void _coalesceRequest(const ipc::Request& message);
+	void _flushCoalescedUpdates();
+
+	void _publishDeviceState(uint32_t deviceId);
+	void _publishDirtyDeviceStates();
+	void _sendPendingMotionCompensationReply();
+	bool _getDeviceState(uint32_t deviceId, DeviceState& state);
+	void _getSharedDeviceState(uint32_t deviceId, ipc::SharedDeviceStateData& data);
+	struct DeviceStateSubscriber {
+		uint64_t droppedNotifications = 0;
+		bool resync = false; // Notifications were dropped, all states are sent again once the reply queue has room
+	};
+	void _subscribeDeviceStateChanges(uint32_t clientId);
+	void _unsubscribeDeviceStateChanges(uint32_t clientId);
+	void _deviceStateNotificationDropped(uint32_t clientId, DeviceStateSubscriber& subscriber);
+	void _resyncDeviceStateSubscribers();
+	bool _sendDeviceStates(uint32_t clientId);
+	/** Notifications must never block the sender on a client that does not read its reply queue */
+	bool _trySendNotification(uint32_t clientId, const ipc::Reply& reply);
+
+	ipc::ReplyStatus _subscribePoseTelemetry(uint32_t clientId, uint64_t deviceMask, uint32_t capacity);
+	void _unsubscribePoseTelemetry(uint32_t clientId);
+	void _releaseRetiredPoseTelemetrySubscribers();
+	void _subscribeDevicePoses(uint32_t clientId, bool subscribe);
+
 	void sendReply(uint32_t clientId, const ipc::Reply& reply);
 
-	std::mutex _sendMutex;
+	std::mutex _sendMutex; // Guards _ipcEndpoints. Replies and notifications are only sent by the ipc thread, so no other thread waits behind a blocking send
 	ServerDriver* _driver = nullptr;
 	std::thread _ipcThread;
 	volatile bool _ipcThreadRunning = false;
@@ -41,9 +91,61 @@ private:
 	uint32_t _ipcClientIdNext = 1;
 	std::map<uint32_t, std::shared_ptr<boost::interprocess::message_queue>> _ipcEndpoints;
 
+	// Pose and axis updates are "fire and forget", so when the queue is backed up only the newest value per device/axis matters
+	struct CoalescedPoseUpdate {
+		bool pending = false;
+		int64_t timestamp = 0;
+		vr::DriverPose_t pose;
+	};
+	struct CoalescedAxisUpdate {
+		bool pending = false;
+		vr::VRControllerAxis_t axisState;
+	};
+	struct PendingRequest {
+		ipc::Request request;
+		uint64_t size;
+	};
+	std::deque<PendingRequest> _pendingRequests;
+	bool _coalescedUpdatesPending = false;
+	CoalescedPoseUpdate _coalescedPoses[vr::k_unMaxTrackedDeviceCount];
+	CoalescedAxisUpdate _coalescedAxes[vr::k_unMaxTrackedDeviceCount][vr::k_unControllerStateAxisCount];
+
+	// Clients that want device state changes pushed to them
+	std::mutex _deviceStateMutex; // Subscribers, published states and the shared state table
+	std::map<uint32_t, DeviceStateSubscriber> _deviceStateSubscribers;
+	std::atomic<bool> _deviceStateResyncPending { false };
+	static_assert(vr::k_unMaxTrackedDeviceCount <= 64, "Dirty mask is too small");
+	std::atomic<uint64_t> _dirtyDeviceStates { 0 }; // Devices whose state changed on another thread than the ipc thread
+	ipc::SharedDeviceStateData _publishedDeviceStates[vr::k_unMaxTrackedDeviceCount];
+
+	// Read-only device state table in shared memory
+	std::string _deviceStateShmName = IPC_SHM_DEVICESTATE_NAME;
+	std::unique_ptr<boost::interprocess::shared_memory_object> _deviceStateShm;
+	std::unique_ptr<boost::interprocess::mapped_region> _deviceStateRegion;
+	ipc::SharedDeviceStateTable* _deviceStateTable = nullptr;
+	std::set<uint32_t> _devicePoseSubscribers; // Only touched by the ipc thread
+	std::atomic<bool> _devicePosesActive { false }; // Pose hooks skip the shared pose while nobody reads it
+
+	// Pose telemetry rings, the list is replaced as a whole by the ipc thread and read lock-free by the pose hooks
+	struct PoseTelemetrySubscriber {
+		~PoseTelemetrySubscriber();
+		uint32_t clientId = 0;
+		uint64_t deviceMask = 0;
+		std::string shmName;
+		std::unique_ptr<boost::interprocess::shared_memory_object> shm;
+		std::unique_ptr<boost::interprocess::mapped_region> region;
+		ipc::PoseTelemetryRing* ring = nullptr;
+		std::atomic_flag writeLock = ATOMIC_FLAG_INIT; // Pose hooks of different drivers may run concurrently, but the ring has only one producer
+	};
+	typedef std::vector<std::shared_ptr<PoseTelemetrySubscriber>> PoseTelemetrySubscriberList;
+	std::shared_ptr<PoseTelemetrySubscriberList> _poseTelemetrySubscribers;
+	std::atomic<bool> _poseTelemetryActive { false };
+	PoseTelemetrySubscriberList _retiredPoseTelemetrySubscribers; // Removed subscribers, destroyed by the ipc thread once no pose hook uses them
+
 	// This is not exactly multi-user safe, maybe I fix it in the future
 	uint32_t _setMotionCompensationClientId = 0;
 	uint32_t _setMotionCompensationMessageId = 0;
+	std::atomic<int> _setMotionCompensationResult { 0 }; // Set by the pose hooks, 0 .. none, 1 .. success, 2 .. not tracking
 };
 
 
@@ -7,13 +7,7 @@
 #include "../hooks/IVRServerDriverHost005Hooks.h"
 #include "../hooks/IVRControllerComponent001Hooks.h"
 #include "../hooks/IVRDriverInput001Hooks.h"
-
-#undef WIN32_LEAN_AND_MEAN
-#undef NOSOUND
-#include <Windows.h>
-// According to windows documentation mmsystem.h should be automatically included with Windows.h when WIN32_LEAN_AND_MEAN and NOSOUND are not defined
-// But it doesn't work so I have to include it manually
-#include <mmsystem.h>
+#include "../platform/platform.h"
 
 
 namespace vrinputemulator {
@@ -33,6 +27,16 @@ DeviceManipulationHandle::DeviceManipulationHandle(const char* serial, vr::ETrac
 		: m_isValid(true), m_parent(ServerDriver::getInstance()), m_motionCompensationManager(m_parent->motionCompensation()), m_deviceDriverPtr(driverPtr), m_deviceDriverHostPtr(driverHostPtr),
 		m_deviceDriverInterfaceVersion(driverInterfaceVersion), m_eDeviceClass(eDeviceClass), m_serialNumber(serial) {
 	memset(_AxisIdToComponentHandleMap, 0, sizeof(_AxisIdToComponentHandleMap));
+	_updatePipeline();
+}
+
+
+DeviceManipulationHandle::~DeviceManipulationHandle() {
+	for (int f = 0; f < (int)HookFeature::Count; ++f) {
+		if (m_hookFeatures & (1 << f)) {
+			HookFeatures::release((HookFeature)f);
+		}
+	}
 }
 
 
@@ -45,6 +49,7 @@ void DeviceManipulationHandle::setDigitalInputRemapping(uint32_t buttonId, const
 			m_digitalInputRemapping.erase(it);
 		}
 	}
+	_updateInputRemappingActive();
 }
 
 
@@ -60,8 +65,78 @@ DigitalInputRemapping DeviceManipulationHandle::getDigitalInputRemapping(uint32_
 
 void DeviceManipulationHandle::setAnalogInputRemapping(uint32_t axisId, const AnalogInputRemapping& remapping) {
 	if (axisId < 5) {
-		m_analogInputRemapping[axisId].remapping = remapping;
+		std::lock_guard<std::recursive_mutex> lock(_mutex);
+		auto& axisInfo = m_analogInputRemapping[axisId];
+		axisInfo.remapping = remapping;
+		axisInfo.filter.configure(remapping);
+	}
+	_updateInputRemappingActive();
+}
+
+
+void DeviceManipulationHandle::_updateInputRemappingActive() {
+	bool active = !m_digitalInputRemapping.empty();
+	for (auto& a : m_analogInputRemapping) {
+		active = active || a.remapping.valid;
+	}
+	m_inputRemappingActive = active;
+	_manipulationChanged();
+}
+
+
+void DeviceManipulationHandle::_updateHookFeatures() {
+	bool redirected = m_deviceMode == 2 || m_deviceMode == 3 || m_deviceMode == 4;
+	bool analogRemapping = false;
+	for (auto& a : m_analogInputRemapping) {
+		analogRemapping = analogRemapping || a.remapping.valid;
+	}
+	unsigned required = 0;
+	if (m_deviceMode == 1 || redirected || !m_digitalInputRemapping.empty()) {
+		required |= 1 << (int)HookFeature::DigitalInput;
+	}
+	if (m_deviceMode == 1 || redirected || analogRemapping) {
+		required |= 1 << (int)HookFeature::AnalogInput;
+	}
+	if (redirected) {
+		required |= 1 << (int)HookFeature::Haptics;
+		required |= 1 << (int)HookFeature::EventInjection;
+	}
+	for (int f = 0; f < (int)HookFeature::Count; ++f) {
+		unsigned bit = 1 << f;
+		if ((required & bit) && !(m_hookFeatures & bit)) {
+			HookFeatures::acquire((HookFeature)f);
+		} else if (!(required & bit) && (m_hookFeatures & bit)) {
+			HookFeatures::release((HookFeature)f);
+		}
+	}
+	m_hookFeatures = required;
+}
+
+
+void DeviceManipulationHandle::_manipulationChanged() {
+	_updatePipeline();
+	_updateHookFeatures();
+	m_parent->updateInputRoutingTable();
+	m_parent->updateDeviceProcessingMask();
+	m_parent->deviceStateChanged(m_openvrId);
+}
+
+
+void DeviceManipulationHandle::enableOffsets(bool enable) {
+	m_offsetsEnabled = enable;
+	_updatePipeline();
+	m_parent->updateDeviceProcessingMask();
+	m_parent->deviceStateChanged(m_openvrId);
+}
+
+
+void DeviceManipulationHandle::setPoseSmoothing(const PoseSmoothingSettings& settings) {
+	{
+		std::lock_guard<std::recursive_mutex> lock(_mutex);
+		m_poseSmoothing.configure(settings);
+		_updatePipeline();
 	}
+	m_parent->updateDeviceProcessingMask();
 }
 
 
@@ -73,10 +148,76 @@ AnalogInputRemapping DeviceManipulationHandle::getAnalogInputRemapping(uint32_t
 	}
 }
 
-bool DeviceManipulationHandle::handlePoseUpdate(uint32_t& unWhichDevice, vr::DriverPose_t& newPose, uint32_t unPoseStructSize) {
+uint64_t DeviceManipulationHandle::digitalInputRemappingMask() const {
+	uint64_t mask = 0;
+	for (auto& r : m_digitalInputRemapping) {
+		if (r.first < 64) {
+			mask |= (uint64_t)1 << r.first;
+		}
+	}
+	return mask;
+}
+
+
+uint32_t DeviceManipulationHandle::analogInputRemappingMask() const {
+	uint32_t mask = 0;
+	for (uint32_t i = 0; i < 5; ++i) {
+		if (m_analogInputRemapping[i].remapping.valid) {
+			mask |= 1 << i;
+		}
+	}
+	return mask;
+}
+
+void DeviceManipulationHandle::_updatePipeline() {
 	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	m_inputBlocked = m_deviceMode == 1 || (m_deviceMode == 3 && !m_redirectSuspended);
+	if (m_deviceMode == 1) {
+		m_posePipeline = &DeviceManipulationHandle::_posePipeline<false, false, false, PoseRoute::FakeDisconnected>;
+	} else if (m_deviceMode == 3 && !m_redirectSuspended) {
+		m_posePipeline = &DeviceManipulationHandle::_posePipeline<false, false, false, PoseRoute::Drop>;
+	} else if (m_deviceMode == 5) {
+		m_posePipeline = &DeviceManipulationHandle::_posePipeline<false, false, false, PoseRoute::MotionCompensationRef>;
+	} else {
+		auto route = PoseRoute::Forward;
+		if (m_deviceMode == 2 && !m_redirectSuspended) {
+			route = PoseRoute::RedirectSource;
+		} else if (m_deviceMode == 4) {
+			route = PoseRoute::Swap;
+		}
+		// Whether the group is enabled is checked by the stage itself, enabling a group must not reselect the
+		// pipelines of its devices under their locks
+		bool compensation = m_motionCompensationGroup < maxMotionCompensationGroups;
+		switch ((m_poseSmoothing.enabled() ? 4 : 0) | (m_offsetsEnabled ? 2 : 0) | (compensation ? 1 : 0)) {
+		case 0: m_posePipeline = _selectPosePipeline<false, false, false>(route); break;
+		case 1: m_posePipeline = _selectPosePipeline<false, false, true>(route); break;
+		case 2: m_posePipeline = _selectPosePipeline<false, true, false>(route); break;
+		case 3: m_posePipeline = _selectPosePipeline<false, true, true>(route); break;
+		case 4: m_posePipeline = _selectPosePipeline<true, false, false>(route); break;
+		case 5: m_posePipeline = _selectPosePipeline<true, false, true>(route); break;
+		case 6: m_posePipeline = _selectPosePipeline<true, true, false>(route); break;
+		default: m_posePipeline = _selectPosePipeline<true, true, true>(route); break;
+		}
+	}
+}
 
-	if (m_deviceMode == 1) { // fake disconnect mode
+
+template<bool Smoothing, bool Offsets, bool Compensation>
+DeviceManipulationHandle::PosePipeline DeviceManipulationHandle::_selectPosePipeline(PoseRoute route) {
+	switch (route) {
+	case PoseRoute::RedirectSource:
+		return &DeviceManipulationHandle::_posePipeline<Smoothing, Offsets, Compensation, PoseRoute::RedirectSource>;
+	case PoseRoute::Swap:
+		return &DeviceManipulationHandle::_posePipeline<Smoothing, Offsets, Compensation, PoseRoute::Swap>;
+	default:
+		return &DeviceManipulationHandle::_posePipeline<Smoothing, Offsets, Compensation, PoseRoute::Forward>;
+	}
+}
+
+
+template<bool Smoothing, bool Offsets, bool Compensation, DeviceManipulationHandle::PoseRoute Route>
+bool DeviceManipulationHandle::_posePipeline(uint32_t& unWhichDevice, vr::DriverPose_t& newPose) {
+	if (Route == PoseRoute::FakeDisconnected) {
 		if (!_disconnectedMsgSend) {
 			newPose.poseIsValid = false;
 			newPose.deviceIsConnected = false;
@@ -87,33 +228,37 @@ bool DeviceManipulationHandle::handlePoseUpdate(uint32_t& unWhichDevice, vr::Dri
 			return false;
 		}
 
-	} else if (m_deviceMode == 3 && !m_redirectSuspended) { // redirect target
+	} else if (Route == PoseRoute::Drop) { // redirect target
 		return false;
 
-	} else if (m_deviceMode == 5) { // motion compensation mode
+	} else if (Route == PoseRoute::MotionCompensationRef) {
 		auto serverDriver = ServerDriver::getInstance();
 		if (serverDriver) {
 			if (newPose.poseIsValid && newPose.result == vr::TrackingResult_Running_OK) {
-				m_motionCompensationManager._setMotionCompensationStatus(MotionCompensationStatus::Running);
-				if (!m_motionCompensationManager._isMotionCompensationZeroPoseValid()) {
-					m_motionCompensationManager._setMotionCompensationZeroPose(newPose);
+				m_motionCompensationManager._setMotionCompensationStatus(m_motionCompensationGroup, MotionCompensationStatus::Running);
+				if (!m_motionCompensationManager._isMotionCompensationZeroPoseValid(m_motionCompensationGroup)) {
+					m_motionCompensationManager._setMotionCompensationZeroPose(m_motionCompensationGroup, newPose);
 					serverDriver->sendReplySetMotionCompensationMode(true);
 				} else {
-					m_motionCompensationManager._updateMotionCompensationRefPose(newPose);
+					m_motionCompensationManager._updateMotionCompensationRefPose(m_motionCompensationGroup, newPose);
 				}
 			} else {
-				if (!m_motionCompensationManager._isMotionCompensationZeroPoseValid()) {
+				if (!m_motionCompensationManager._isMotionCompensationZeroPoseValid(m_motionCompensationGroup)) {
 					setDefaultMode();
 					serverDriver->sendReplySetMotionCompensationMode(false);
 				} else {
-					m_motionCompensationManager._setMotionCompensationStatus(MotionCompensationStatus::MotionRefNotTracking);
+					m_motionCompensationManager._setMotionCompensationStatus(m_motionCompensationGroup, MotionCompensationStatus::MotionRefNotTracking);
 				}
 			}
 		}
 		return true;
 
 	} else {
-		if (m_offsetsEnabled) {
+		if (Smoothing) {
+			auto now = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+			m_poseSmoothing.filter(newPose, (double)now / 1.0E6 + newPose.poseTimeOffset);
+		}
+		if (Offsets) {
 			if (m_worldFromDriverRotationOffset.w != 1.0 || m_worldFromDriverRotationOffset.x != 0.0
 				|| m_worldFromDriverRotationOffset.y != 0.0 || m_worldFromDriverRotationOffset.z != 0.0) {
 				newPose.qWorldFromDriverRotation = m_worldFromDriverRotationOffset * newPose.qWorldFromDriverRotation;
@@ -136,10 +281,12 @@ bool DeviceManipulationHandle::handlePoseUpdate(uint32_t& unWhichDevice, vr::Dri
 				VECTOR_ADD(newPose.vecPosition, m_deviceTranslationOffset);
 			}
 		}
-		
-		m_motionCompensationManager._applyMotionCompensation(newPose, this);
-		
-		if (m_deviceMode == 2 && !m_redirectSuspended) { // redirect source
+
+		if (Compensation && m_motionCompensationManager.isMotionCompensationEnabled(motionCompensationGroup())) {
+			m_motionCompensationManager._applyMotionCompensation(newPose, this);
+		}
+
+		if (Route == PoseRoute::RedirectSource) {
 			m_redirectRef->ll_sendPoseUpdate(newPose);
 			if (!_disconnectedMsgSend) {
 				newPose.poseIsValid = false;
@@ -149,7 +296,7 @@ bool DeviceManipulationHandle::handlePoseUpdate(uint32_t& unWhichDevice, vr::Dri
 			} else {
 				return false;
 			}
-		} else if (m_deviceMode == 4) { // swap mode
+		} else if (Route == PoseRoute::Swap) {
 			unWhichDevice = m_redirectRef->openvrId();
 		}
 		return true;
@@ -157,6 +304,12 @@ bool DeviceManipulationHandle::handlePoseUpdate(uint32_t& unWhichDevice, vr::Dri
 }
 
 
+bool DeviceManipulationHandle::handlePoseUpdate(uint32_t& unWhichDevice, vr::DriverPose_t& newPose, uint32_t unPoseStructSize) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	return (this->*m_posePipeline)(unWhichDevice, newPose);
+}
+
+
 void DeviceManipulationHandle::ll_sendPoseUpdate(const vr::DriverPose_t& newPose) {
 	if (m_deviceDriverInterfaceVersion == 4) {
 		IVRServerDriverHost004Hooks::trackedDevicePoseUpdatedOrig(m_deviceDriverHostPtr, m_openvrId, newPose, sizeof(vr::DriverPose_t));
@@ -228,11 +381,11 @@ void DeviceManipulationHandle::ll_sendAxisEvent(uint32_t unWhichAxis, const vr::
 				LOG(WARNING) << "Device " << m_openvrId << ": No mapping from axis id " << unWhichAxis << " to input component.";
 			} else {
 				if (_AxisIdToComponentHandleMap[unWhichAxis].first != 0) {
-					sendScalarComponentUpdate(m_openvrId, unWhichAxis, 0, axisState.x, 0.0);
+					ll_sendScalarComponentUpdate(_AxisIdToComponentHandleMap[unWhichAxis].first, axisState.x, 0.0);
 				}
 				if (_AxisIdToComponentHandleMap[unWhichAxis].second != 0) {
-					sendScalarComponentUpdate(m_openvrId, unWhichAxis, 1, axisState.y, 0.0);
-				} 
+					ll_sendScalarComponentUpdate(_AxisIdToComponentHandleMap[unWhichAxis].second, axisState.y, 0.0);
+				}
 			}
 		}
 	}
@@ -243,26 +396,8 @@ bool DeviceManipulationHandle::ll_triggerHapticPulse(uint32_t unAxisId, uint16_t
 	if (m_deviceDriverInterfaceVersion == 4 && m_controllerComponentHooks) {
 		return std::static_pointer_cast<IVRControllerComponent001Hooks>(m_controllerComponentHooks)->triggerHapticPulseOrig(unAxisId, usPulseDurationMicroseconds);
 	} else if (m_deviceDriverInterfaceVersion == 5) {
-		
-		struct VREvent_HapticVibration_t {
-			uint64_t containerHandle; // property container handle of the device with the haptic component
-			uint64_t componentHandle; // Which haptic component needs to vibrate
-			float fDurationSeconds;
-			float fFrequency;
-			float fAmplitude;
-		};
-
-		vr::VREvent_t* hapticEvent = (vr::VREvent_t*)malloc(48);
-		hapticEvent->eventType = 1700; // VREvent_Input_HapticVibration = 1700
-		hapticEvent->eventAgeSeconds = 0.0f;
-		hapticEvent->trackedDeviceIndex = m_openvrId;
-		auto eventData = reinterpret_cast<VREvent_HapticVibration_t*>(&hapticEvent->data);
-		eventData->containerHandle = m_propertyContainerHandle;
-		eventData->componentHandle = m_inputHapticComponentHandle;
-		eventData->fDurationSeconds = ((float)usPulseDurationMicroseconds)/1E6f;
-		eventData->fFrequency = 1.0f/ eventData->fDurationSeconds;
-		eventData->fAmplitude = 1.0f;
-		m_parent->addDriverEventForInjection(m_deviceDriverHostPtr, std::shared_ptr<void>(hapticEvent), 48);
+		float durationSeconds = ((float)usPulseDurationMicroseconds)/1E6f;
+		return ll_sendHapticPulseEvent(durationSeconds, 1.0f/durationSeconds, 1.0f);
 	}
 	return true;
 }
@@ -281,7 +416,8 @@ bool DeviceManipulationHandle::ll_sendHapticPulseEvent(float fDurationSeconds, f
 			float fAmplitude;
 		};
 
-		vr::VREvent_t* hapticEvent = (vr::VREvent_t*)malloc(48);
+		alignas(8) char eventBuffer[48] = {};
+		vr::VREvent_t* hapticEvent = (vr::VREvent_t*)eventBuffer;
 		hapticEvent->eventType = 1700; // VREvent_Input_HapticVibration = 1700
 		hapticEvent->eventAgeSeconds = 0.0f;
 		hapticEvent->trackedDeviceIndex = m_openvrId;
@@ -291,7 +427,7 @@ bool DeviceManipulationHandle::ll_sendHapticPulseEvent(float fDurationSeconds, f
 		eventData->fDurationSeconds = fDurationSeconds;
 		eventData->fFrequency = fFrequency;
 		eventData->fAmplitude = fAmplitude;
-		m_parent->addDriverEventForInjection(m_deviceDriverHostPtr, std::shared_ptr<void>(hapticEvent), 48);
+		m_parent->addDriverEventForInjection(m_deviceDriverHostPtr, eventBuffer, sizeof(eventBuffer));
 	}
 	return true;
 }
@@ -307,15 +443,9 @@ void DeviceManipulationHandle::ll_sendScalarComponentUpdate(vr::VRInputComponent
 			unsigned unWhichAxis = it->second.first;
 			unsigned unWhichAxisDim = it->second.second;
 			if (unWhichAxis < 5) {
-				auto& axisInfo = m_analogInputRemapping[unWhichAxis];
-				if (unWhichAxisDim == 0) {
-					axisInfo.binding.lastSeenAxisState.x = fNewValue;
-					axisInfo.binding.lastSendAxisState.x = fNewValue;
-				} else {
-					axisInfo.binding.lastSeenAxisState.x = fNewValue;
-					axisInfo.binding.lastSendAxisState.x = fNewValue;
-				}
-				IVRServerDriverHost004Hooks::trackedDeviceAxisUpdatedOrig(m_deviceDriverHostPtr, m_openvrId, unWhichAxis, axisInfo.binding.lastSendAxisState);
+				auto& filter = m_analogInputRemapping[unWhichAxis].filter;
+				filter.setSent(1 << unWhichAxisDim, { fNewValue, fNewValue });
+				IVRServerDriverHost004Hooks::trackedDeviceAxisUpdatedOrig(m_deviceDriverHostPtr, m_openvrId, unWhichAxis, filter.state().lastSent);
 			}
 		}
 	}
@@ -410,14 +540,14 @@ bool DeviceManipulationHandle::handleButtonEvent(uint32_t& unWhichDevice, Button
 				}
 			}
 		} else {
-			if (m_deviceMode == 1 || (m_deviceMode == 3 && !m_redirectSuspended) /*|| m_deviceMode == 5*/) {
+			if (m_inputBlocked) {
 				//nop
 			} else {
 				sendButtonEvent(unWhichDevice, eventType, eButtonId, eventTimeOffset);
 			}
 		}
 	} else {
-		if (m_deviceMode == 1 || (m_deviceMode == 3 && !m_redirectSuspended) /*|| m_deviceMode == 5*/) {
+		if (m_inputBlocked) {
 			//nop
 		} else {
 			sendButtonEvent(unWhichDevice, eventType, eButtonId, eventTimeOffset);
@@ -433,6 +563,11 @@ void DeviceManipulationHandle::suspendRedirectMode() {
 		_disconnectedMsgSend = false;
 		m_redirectRef->m_redirectSuspended = m_redirectSuspended;
 		m_redirectRef->_disconnectedMsgSend = false;
+		_updatePipeline();
+		m_redirectRef->_updatePipeline();
+		m_parent->updateInputRoutingTable();
+		m_parent->deviceStateChanged(m_openvrId);
+		m_parent->deviceStateChanged(m_redirectRef->m_openvrId);
 	}
 }
 
@@ -497,6 +632,13 @@ void DeviceManipulationHandle::RunFrame() {
 		RunFrameDigitalBinding(r.second.remapping.longPressBinding, (vr::EVRButtonId)r.first, r.second.bindings[1]);
 		RunFrameDigitalBinding(r.second.remapping.doublePressBinding, (vr::EVRButtonId)r.first, r.second.bindings[2]);
 	}
+	// A paired scalar update whose second half did not arrive must not wait longer than one frame
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	for (uint32_t i = 0; i < 5; ++i) {
+		if (m_analogInputRemapping[i].pendingScalarSample.dimensions) {
+			_flushPendingScalarSample(i);
+		}
+	}
 }
 
 
@@ -535,11 +677,11 @@ bool DeviceManipulationHandle::handleAxisUpdate(uint32_t& unWhichDevice, uint32_
 	if (unWhichAxis < 5) {
 		axisInfo = m_analogInputRemapping + unWhichAxis;
 	}
-	if (m_deviceMode == 1 || (m_deviceMode == 3 && !m_redirectSuspended) /*|| m_deviceMode == 5*/) {
+	if (m_inputBlocked) {
 		return false;
 	}
 	if (axisInfo && axisInfo->remapping.valid) {
-		sendAnalogBinding(axisInfo->remapping.binding, unWhichDevice, unWhichAxis, axisState, &axisInfo->binding);
+		sendAnalogBinding(*axisInfo, unWhichDevice, unWhichAxis, axisState);
 	} else {
 		sendAxisEvent(unWhichDevice, unWhichAxis, axisState);
 	}
@@ -576,11 +718,16 @@ bool DeviceManipulationHandle::handleScalarComponentUpdate(vr::VRInputComponentH
 		if (unWhichAxis < 5) {
 			axisInfo = m_analogInputRemapping + unWhichAxis;
 		}
-		if (m_deviceMode == 1 || (m_deviceMode == 3 && !m_redirectSuspended) /*|| m_deviceMode == 5*/) {
+		if (m_inputBlocked) {
 			return false;
 		}
 		if (axisInfo && axisInfo->remapping.valid) {
-			sendAnalogBinding(axisInfo->remapping.binding, m_openvrId, unWhichAxis, unWhichAxisDim, ulComponent, fNewValue, fTimeOffset);
+			auto& handles = _AxisIdToComponentHandleMap[unWhichAxis];
+			if (axisInfo->remapping.binding.pairScalarComponents && unWhichAxisDim < 2 && handles.first != 0 && handles.second != 0) {
+				_pairScalarComponentUpdate(unWhichAxis, unWhichAxisDim, fNewValue, fTimeOffset);
+			} else {
+				sendAnalogBinding(*axisInfo, m_openvrId, unWhichAxis, unWhichAxisDim, ulComponent, fNewValue, fTimeOffset);
+			}
 		} else {
 			sendScalarComponentUpdate(m_openvrId, unWhichAxis, unWhichAxisDim, ulComponent, fNewValue, fTimeOffset);
 		}
@@ -603,14 +750,23 @@ bool DeviceManipulationHandle::handleHapticPulseEvent(float& fDurationSeconds, f
 }
 
 
-bool DeviceManipulationHandle::triggerHapticPulse(uint32_t unAxisId, uint16_t usPulseDurationMicroseconds, bool directMode) {
+DeviceManipulationHandle* DeviceManipulationHandle::hapticTarget(bool directMode) {
 	std::lock_guard<std::recursive_mutex> lock(_mutex);
 	if (directMode) {
-		return ll_triggerHapticPulse(unAxisId, usPulseDurationMicroseconds);
+		return this;
 	} else if ((m_deviceMode == 3 && !m_redirectSuspended) || m_deviceMode == 4) {
-		return m_redirectRef->ll_triggerHapticPulse(unAxisId, usPulseDurationMicroseconds);
+		return m_redirectRef;
 	} else  if (m_deviceMode == 0 || ((m_deviceMode == 3 || m_deviceMode == 2) && m_redirectSuspended)) {
-		return ll_triggerHapticPulse(unAxisId, usPulseDurationMicroseconds);
+		return this;
+	}
+	return nullptr;
+}
+
+
+bool DeviceManipulationHandle::triggerHapticPulse(uint32_t unAxisId, uint16_t usPulseDurationMicroseconds, bool directMode) {
+	auto target = hapticTarget(directMode);
+	if (target) {
+		return target->ll_triggerHapticPulse(unAxisId, usPulseDurationMicroseconds);
 	}
 	return true;
 }
@@ -816,7 +972,7 @@ void DeviceManipulationHandle::sendDigitalBinding(vrinputemulator::DigitalBindin
 		if (sendEvent) {
 			switch (binding.type) {
 				case DigitalBindingType::OpenVR: {
-					if (m_deviceMode == 1 || (m_deviceMode == 3 && !m_redirectSuspended) /*|| m_deviceMode == 5*/) {
+					if (m_inputBlocked) {
 						//nop
 					} else {
 						vr::EVRButtonId button = (vr::EVRButtonId)binding.data.openvr.buttonId;
@@ -828,11 +984,21 @@ void DeviceManipulationHandle::sendDigitalBinding(vrinputemulator::DigitalBindin
 					}
 				} break;
 				case DigitalBindingType::Keyboard: {
-					if (m_deviceMode == 1 || (m_deviceMode == 3 && !m_redirectSuspended) /*|| m_deviceMode == 5*/) {
+					if (m_inputBlocked) {
 						//nop
 					} else {
 						sendKeyboardEvent(eventType, binding.data.keyboard.shiftPressed, binding.data.keyboard.ctrlPressed, 
-							binding.data.keyboard.altPressed, (WORD)binding.data.keyboard.keyCode, binding.data.keyboard.sendScanCode, bindingInfo);
+							binding.data.keyboard.altPressed, (uint16_t)binding.data.keyboard.keyCode, binding.data.keyboard.sendScanCode, bindingInfo);
+					}
+				} break;
+				case DigitalBindingType::KeyboardMacro: {
+					if (m_inputBlocked) {
+						//nop
+					} else if (eventType == ButtonEventType::ButtonPressed && !bindingInfo->pressedState) {
+						m_parent->outputInjection().sendKeyboardMacro(binding.data.keyboardMacro);
+						bindingInfo->pressedState = true;
+					} else if (eventType == ButtonEventType::ButtonUnpressed) {
+						bindingInfo->pressedState = false;
 					}
 				} break;
 				case DigitalBindingType::SuspendRedirectMode: {
@@ -864,43 +1030,31 @@ void DeviceManipulationHandle::sendDigitalBinding(vrinputemulator::DigitalBindin
 
 
 void DeviceManipulationHandle::_audioCue() {
-	auto audiofile = ServerDriver::getInstallDirectory().append("\\resources\\sounds\\audiocue.wav");
-	PlaySoundA(audiofile.c_str(), NULL, SND_FILENAME | SND_ASYNC | SND_NODEFAULT);
+	m_parent->outputInjection().playSound(OutputSound::AudioCue);
 }
 
 
 void DeviceManipulationHandle::_vibrationCue() {
-	if (_vibrationCueTheadHandle != NULL) {
-		DWORD threadExitCode = 0;
-		if (GetExitCodeThread(_vibrationCueTheadHandle, &threadExitCode) != 0 && threadExitCode == STILL_ACTIVE) {
-			return;
-		}
-		CloseHandle(_vibrationCueTheadHandle);
-		_vibrationCueTheadHandle = NULL;
-	}
-	static struct _vibrationCueThreadArgs {
-		DeviceManipulationHandle* deviceInfo;
-	} threadArgs;
-	threadArgs.deviceInfo = this;
-	_vibrationCueTheadHandle = CreateThread(
-		NULL,                   // default security attributes
-		0,                      // use default stack size  
-		[](LPVOID lpParam)->DWORD {
-			_vibrationCueThreadArgs* args = (_vibrationCueThreadArgs*)lpParam;
-			for (unsigned i = 0; i < 10; ++i) {
-				args->deviceInfo->ll_triggerHapticPulse(0, 1000);
-				std::this_thread::sleep_for(std::chrono::milliseconds(10));
-			}
-			return 0;
-		},
-		&threadArgs,			// argument to thread function 
-		0,                      // use default creation flags 
-		NULL
-	);
+	m_parent->outputInjection().vibrationCue(this);
 }
 
 
-void DeviceManipulationHandle::sendAnalogBinding(vrinputemulator::AnalogBinding& binding, uint32_t unWhichDevice, uint32_t axisId, const vr::VRControllerAxis_t& axisState, DeviceManipulationHandle::AnalogInputRemappingInfo::BindingInfo* bindingInfo) {
+void DeviceManipulationHandle::_invertAndSwapAxes(const AnalogBinding& binding, vr::VRControllerAxis_t& value) {
+	if (binding.invertXAxis) {
+		value.x *= -1;
+	}
+	if (binding.invertYAxis) {
+		value.y *= -1;
+	}
+	if (binding.swapAxes) {
+		std::swap(value.x, value.y);
+	}
+}
+
+
+void DeviceManipulationHandle::sendAnalogBinding(DeviceManipulationHandle::AnalogInputRemappingInfo& axisInfo, uint32_t unWhichDevice, uint32_t axisId, const vr::VRControllerAxis_t& axisState) {
+	auto& binding = axisInfo.remapping.binding;
+	auto bindingInfo = &axisInfo.binding;
 	if (binding.type == AnalogBindingType::NoRemapping) {
 		sendAxisEvent(unWhichDevice, axisId, axisState, false, bindingInfo);
 	} else if (binding.type == AnalogBindingType::Disabled) {
@@ -908,7 +1062,7 @@ void DeviceManipulationHandle::sendAnalogBinding(vrinputemulator::AnalogBinding&
 	} else {
 		switch (binding.type) {
 			case AnalogBindingType::OpenVR: {
-				if (m_deviceMode == 1 || (m_deviceMode == 3 && !m_redirectSuspended) /*|| m_deviceMode == 5*/) {
+				if (m_inputBlocked) {
 					//nop
 				} else {
 					vr::EVRButtonId axisId = (vr::EVRButtonId)binding.data.openvr.axisId;
@@ -917,50 +1071,8 @@ void DeviceManipulationHandle::sendAnalogBinding(vrinputemulator::AnalogBinding&
 					if (deviceId >= 999) {
 						deviceId = m_openvrId;
 					}
-					if (binding.invertXAxis) {
-						newAxisState.x *= -1;
-					}
-					if (binding.invertYAxis) {
-						newAxisState.y *= -1;
-					}
-					if (binding.swapAxes) {
-						auto tmp = newAxisState.x;
-						newAxisState.x = newAxisState.y;
-						newAxisState.y = tmp;
-					}
-					if ( binding.lowerDeadzone < binding.upperDeadzone && (binding.lowerDeadzone > 0.0f || binding.upperDeadzone < 1.0f)) {
-						auto zone = binding.upperDeadzone - binding.lowerDeadzone;
-						if (axisState.x >= 0.0f) {
-							newAxisState.x = (axisState.x - binding.lowerDeadzone) * (1.0f / zone) + binding.lowerDeadzone;
-							if (newAxisState.x < 0.0f) {
-								newAxisState.x = 0.0f;
-							} else if (newAxisState.x > 1.0f) {
-								newAxisState.x = 1.0f;
-							}
-						} else {
-							newAxisState.x = (axisState.x + binding.lowerDeadzone) * (1.0f / zone) - binding.lowerDeadzone;
-							if (newAxisState.x > 0.0f) {
-								newAxisState.x = 0.0f;
-							} else if (newAxisState.x < -1.0f) {
-								newAxisState.x = -1.0f;
-							}
-						}
-						if (axisState.y >= 0.0f) {
-							newAxisState.y = (axisState.y - binding.lowerDeadzone) * (1.0f / zone) + binding.lowerDeadzone;
-							if (newAxisState.y < 0.0f) {
-								newAxisState.y = 0.0f;
-							} else if (newAxisState.y > 1.0f) {
-								newAxisState.y = 1.0f;
-							}
-						} else {
-							newAxisState.y = (axisState.y + binding.lowerDeadzone) * (1.0f / zone) - binding.lowerDeadzone;
-							if (newAxisState.y > 0.0f) {
-								newAxisState.y = 0.0f;
-							} else if (newAxisState.y < -1.0f) {
-								newAxisState.y = -1.0f;
-							}
-						}
-					}
+					_invertAndSwapAxes(binding, newAxisState);
+					axisInfo.filter.filterInput(3, newAxisState, newAxisState);
 					sendAxisEvent(deviceId, axisId, newAxisState, false, bindingInfo);
 				}
 			} break;
@@ -970,7 +1082,8 @@ void DeviceManipulationHandle::sendAnalogBinding(vrinputemulator::AnalogBinding&
 	}
 }
 
-void DeviceManipulationHandle::sendAnalogBinding(vrinputemulator::AnalogBinding & binding, uint32_t unWhichDevice, uint32_t unWhichAxis, uint32_t unAxisDim, vr::VRInputComponentHandle_t ulComponent, float fNewValue, double fTimeOffset) {
+void DeviceManipulationHandle::sendAnalogBinding(DeviceManipulationHandle::AnalogInputRemappingInfo& axisInfo, uint32_t unWhichDevice, uint32_t unWhichAxis, uint32_t unAxisDim, vr::VRInputComponentHandle_t ulComponent, float fNewValue, double fTimeOffset) {
+	auto& binding = axisInfo.remapping.binding;
 	if (binding.type == AnalogBindingType::NoRemapping) {
 		sendScalarComponentUpdate(unWhichDevice, unWhichAxis, unAxisDim, ulComponent, fNewValue, fTimeOffset);
 	} else if (binding.type == AnalogBindingType::Disabled) {
@@ -978,7 +1091,7 @@ void DeviceManipulationHandle::sendAnalogBinding(vrinputemulator::AnalogBinding
 	} else {
 		switch (binding.type) {
 			case AnalogBindingType::OpenVR: {
-				if (m_deviceMode == 1 || (m_deviceMode == 3 && !m_redirectSuspended) /*|| m_deviceMode == 5*/) {
+				if (m_inputBlocked) {
 					//nop
 				} else {
 					uint32_t axisId = binding.data.openvr.axisId;
@@ -988,36 +1101,18 @@ void DeviceManipulationHandle::sendAnalogBinding(vrinputemulator::AnalogBinding
 					if (deviceId >= 999) {
 						deviceId = m_openvrId;
 					}
-					if ((unAxisDim == 0 && binding.invertXAxis) || (unAxisDim == 1 && binding.invertYAxis)) {
-						myNewState *= -1;
-					}
-					if (binding.swapAxes) {
-						if (axisDim == 0) {
-							axisDim = 1;
-						} else {
-							axisDim = 0;
-						}
-					}
-					if (binding.lowerDeadzone < binding.upperDeadzone && (binding.lowerDeadzone > 0.0f || binding.upperDeadzone < 1.0f)) {
-						auto zone = binding.upperDeadzone - binding.lowerDeadzone;
-						if (myNewState >= 0.0f) {
-							myNewState = (myNewState - binding.lowerDeadzone) * (1.0f / zone) + binding.lowerDeadzone;
-							if (myNewState < 0.0f) {
-								myNewState = 0.0f;
-							} else if (myNewState > 1.0f) {
-								myNewState = 1.0f;
-							}
-						} else {
-							myNewState = (myNewState + binding.lowerDeadzone) * (1.0f / zone) - binding.lowerDeadzone;
-							if (myNewState > 0.0f) {
-								myNewState = 0.0f;
-							} else if (myNewState < -1.0f) {
-								myNewState = -1.0f;
-							}
+					if (unAxisDim < 2) {
+						vr::VRControllerAxis_t value = { 0.0f, 0.0f };
+						(unAxisDim == 0 ? value.x : value.y) = fNewValue;
+						_invertAndSwapAxes(binding, value);
+						if (binding.swapAxes) {
+							axisDim = 1 - unAxisDim;
 						}
+						axisInfo.filter.filterInput(1 << axisDim, value, value);
+						myNewState = axisDim == 0 ? value.x : value.y;
 					}
 					if (deviceId != unWhichDevice || axisId != unWhichAxis || axisDim != unAxisDim) {
-						sendScalarComponentUpdate(deviceId, axisId, unAxisDim, myNewState, fTimeOffset);
+						sendScalarComponentUpdate(deviceId, axisId, axisDim, myNewState, fTimeOffset);
 					} else {
 						sendScalarComponentUpdate(deviceId, axisId, unAxisDim, ulComponent, myNewState, fTimeOffset);
 					}
@@ -1030,25 +1125,120 @@ void DeviceManipulationHandle::sendAnalogBinding(vrinputemulator::AnalogBinding
 }
 
 
+void DeviceManipulationHandle::sendAnalogBindingPair(DeviceManipulationHandle::AnalogInputRemappingInfo& axisInfo, uint32_t unWhichDevice, uint32_t unWhichAxis, const vr::VRControllerAxis_t& value, double fTimeOffset) {
+	auto& binding = axisInfo.remapping.binding;
+	if (binding.type == AnalogBindingType::NoRemapping) {
+		sendScalarComponentPair(unWhichDevice, unWhichAxis, value, fTimeOffset);
+	} else if (binding.type == AnalogBindingType::Disabled) {
+		// nop
+	} else {
+		switch (binding.type) {
+			case AnalogBindingType::OpenVR: {
+				if (m_inputBlocked) {
+					//nop
+				} else {
+					uint32_t axisId = binding.data.openvr.axisId;
+					uint32_t deviceId = binding.data.openvr.controllerId;
+					auto newState = value;
+					if (deviceId >= 999) {
+						deviceId = m_openvrId;
+					}
+					_invertAndSwapAxes(binding, newState);
+					axisInfo.filter.filterInput(3, newState, newState);
+					sendScalarComponentPair(deviceId, axisId, newState, fTimeOffset);
+				}
+			} break;
+			default: {
+			} break;
+		}
+	}
+}
+
+
+/**
+* Collects x and y of one scalar component sample (same time offset) and remaps them together. A dimension that
+* arrives twice or with another time offset flushes the pending one, which is then remapped on its own. A dimension
+* whose partner never arrives (only one of them changed) is flushed by the next RunFrame, i.e. up to one frame late.
+*/
+void DeviceManipulationHandle::_pairScalarComponentUpdate(uint32_t unWhichAxis, uint32_t unAxisDim, float fNewValue, double fTimeOffset) {
+	auto& axisInfo = m_analogInputRemapping[unWhichAxis];
+	auto& pending = axisInfo.pendingScalarSample;
+	uint32_t dimension = 1 << unAxisDim;
+	if (pending.dimensions && ((pending.dimensions & dimension) || pending.timeOffset != fTimeOffset)) {
+		_flushPendingScalarSample(unWhichAxis);
+	}
+	if (unAxisDim == 0) {
+		pending.value.x = fNewValue;
+	} else {
+		pending.value.y = fNewValue;
+	}
+	pending.dimensions |= dimension;
+	pending.timeOffset = fTimeOffset;
+	if (pending.dimensions == 3) {
+		pending.dimensions = 0;
+		sendAnalogBindingPair(axisInfo, m_openvrId, unWhichAxis, pending.value, fTimeOffset);
+	}
+}
+
+
+void DeviceManipulationHandle::_flushPendingScalarSample(uint32_t unWhichAxis) {
+	auto& axisInfo = m_analogInputRemapping[unWhichAxis];
+	auto& pending = axisInfo.pendingScalarSample;
+	auto dimensions = pending.dimensions;
+	pending.dimensions = 0;
+	if (dimensions & 1) {
+		sendAnalogBinding(axisInfo, m_openvrId, unWhichAxis, 0, _AxisIdToComponentHandleMap[unWhichAxis].first, pending.value.x, pending.timeOffset);
+	}
+	if (dimensions & 2) {
+		sendAnalogBinding(axisInfo, m_openvrId, unWhichAxis, 1, _AxisIdToComponentHandleMap[unWhichAxis].second, pending.value.y, pending.timeOffset);
+	}
+}
+
+
 void DeviceManipulationHandle::_buttonPressDeadzoneFix(vr::EVRButtonId eButtonId) {
 	auto& axisInfo = m_analogInputRemapping[eButtonId - vr::k_EButton_Axis0];
 	if (axisInfo.remapping.valid && axisInfo.remapping.binding.buttonPressDeadzoneFix) {
-		if (axisInfo.binding.lastSendAxisState.x == 0.0f && axisInfo.binding.lastSendAxisState.y == 0.0f) {
+		if (axisInfo.filter.state().lastSent.x == 0.0f && axisInfo.filter.state().lastSent.y == 0.0f) {
 			ll_sendAxisEvent(eButtonId - vr::k_EButton_Axis0, { 0.01f, 0.01f });
 		}
 	}
 }
 
+/**
+* Sends input for unWhichDevice to all targets of its route (see InputRoutingTable). Returns false when the input
+* is for this device only and has to be processed by the caller. Input for other devices (bindings) goes directly
+* to that device, their routes only apply to their own input.
+*/
+template<typename F> bool DeviceManipulationHandle::_routeInput(uint32_t unWhichDevice, F send) {
+	InputRoutingTable::Route route;
+	if (!m_parent->lookupInputRoute(unWhichDevice, route)) {
+		return false;
+	}
+	if (unWhichDevice != m_openvrId) {
+		send(route.device, true);
+		return true;
+	}
+	if (route.targetCount == 1 && route.targets[0] == this) {
+		return false;
+	}
+	for (uint32_t i = 0; i < route.targetCount; ++i) {
+		send(route.targets[i], i == 0);
+	}
+	return true;
+}
+
 void DeviceManipulationHandle::sendButtonEvent(uint32_t unWhichDevice, ButtonEventType eventType, vr::EVRButtonId eButtonId, double eventTimeOffset, bool directMode, DigitalInputRemappingInfo::BindingInfo* binding) {
 	if (!directMode) {
-		if (unWhichDevice == m_openvrId && ((m_deviceMode == 2 && !m_redirectSuspended) || m_deviceMode == 4)) {
-			unWhichDevice = m_redirectRef->openvrId();
+		// Mirrors must not change the binding state of the primary target, so they get a copy of the original state
+		DigitalInputRemappingInfo::BindingInfo bindingState;
+		if (binding) {
+			bindingState = *binding;
 		}
-		if (unWhichDevice != m_openvrId) {
-			auto deviceInfo = m_parent->getDeviceManipulationHandleById(unWhichDevice);
-			if (deviceInfo) {
-				return deviceInfo->sendButtonEvent(unWhichDevice, eventType, eButtonId, eventTimeOffset, true, binding);
-			}
+		if (_routeInput(unWhichDevice, [&](DeviceManipulationHandle* target, bool primary) {
+			auto bindingCopy = bindingState;
+			target->sendButtonEvent(target->openvrId(), eventType, eButtonId, eventTimeOffset, true, (primary || !binding) ? binding : &bindingCopy);
+		})) {
+			return;
 		}
 	}
 	switch (eventType) {
@@ -1124,72 +1314,10 @@ void DeviceManipulationHandle::sendButtonEvent(uint32_t unWhichDevice, ButtonEve
 }
 
 
-void DeviceManipulationHandle::sendKeyboardEvent(ButtonEventType eventType, bool shiftPressed, bool ctrlPressed, bool altPressed, WORD keyCode, bool sendScanCode, DigitalInputRemappingInfo::BindingInfo* binding) {
+void DeviceManipulationHandle::sendKeyboardEvent(ButtonEventType eventType, bool shiftPressed, bool ctrlPressed, bool altPressed, uint16_t keyCode, bool sendScanCode, DigitalInputRemappingInfo::BindingInfo* binding) {
 	if ( (eventType == ButtonEventType::ButtonPressed && (!binding || !binding->pressedState)) 
 			|| (eventType == ButtonEventType::ButtonUnpressed && (!binding || binding->pressedState)) ) {
-		INPUT ips[4];
-		memset(ips, 0, sizeof(ips));
-		WORD flags = 0;
-		/* DirectInput games ignore virtual key codes, for those scan codes should be used */
-		if (sendScanCode) {
-			flags |= KEYEVENTF_SCANCODE;
-			keyCode = MapVirtualKey(keyCode, MAPVK_VK_TO_VSC);
-		}
-		if (eventType == ButtonEventType::ButtonUnpressed) {
-			flags |= KEYEVENTF_KEYUP;
-		}
-		unsigned ipCount = 0;
-		if (eventType == ButtonEventType::ButtonUnpressed && keyCode) {
-			ips[ipCount].type = INPUT_KEYBOARD;
-			if (sendScanCode) {
-				ips[ipCount].ki.wScan = keyCode;
-			} else {
-				ips[ipCount].ki.wVk = keyCode;
-			}
-			ips[ipCount].ki.dwFlags = flags;
-			ipCount++;
-		}
-		if (shiftPressed) {
-			ips[ipCount].type = INPUT_KEYBOARD;
-			if (sendScanCode) {
-				ips[ipCount].ki.wScan = MapVirtualKey(VK_SHIFT, MAPVK_VK_TO_VSC);
-			} else {
-				ips[ipCount].ki.wVk = VK_SHIFT;
-			}
-			ips[ipCount].ki.dwFlags = flags;
-			ipCount++;
-		}
-		if (ctrlPressed) {
-			ips[ipCount].type = INPUT_KEYBOARD;
-			if (sendScanCode) {
-				ips[ipCount].ki.wScan = MapVirtualKey(VK_CONTROL, MAPVK_VK_TO_VSC);
-			} else {
-				ips[ipCount].ki.wVk = VK_CONTROL;
-			}
-			ips[ipCount].ki.dwFlags = flags;
-			ipCount++;
-		}
-		if (altPressed) {
-			ips[ipCount].type = INPUT_KEYBOARD;
-			if (sendScanCode) {
-				ips[ipCount].ki.wScan = MapVirtualKey(VK_MENU, MAPVK_VK_TO_VSC);
-			} else {
-				ips[ipCount].ki.wVk = VK_MENU;
-			}
-			ips[ipCount].ki.dwFlags = flags;
-			ipCount++;
-		}
-		if (eventType == ButtonEventType::ButtonPressed && keyCode) {
-			ips[ipCount].type = INPUT_KEYBOARD;
-			if (sendScanCode) {
-				ips[ipCount].ki.wScan = keyCode;
-			} else {
-				ips[ipCount].ki.wVk = keyCode;
-			}
-			ips[ipCount].ki.dwFlags = flags;
-			ipCount++;
-		}
-		SendInput(4, ips, sizeof(INPUT));
+		m_parent->outputInjection().sendKeyboardInput(eventType == ButtonEventType::ButtonUnpressed, shiftPressed, ctrlPressed, altPressed, keyCode, sendScanCode);
 		if (binding) {
 			if (eventType == ButtonEventType::ButtonPressed) {
 				binding->pressedState = true;
@@ -1203,57 +1331,23 @@ void DeviceManipulationHandle::sendKeyboardEvent(ButtonEventType eventType, bool
 
 void DeviceManipulationHandle::sendAxisEvent(uint32_t unWhichDevice, uint32_t unWhichAxis, const vr::VRControllerAxis_t& axisState, bool directMode, AnalogInputRemappingInfo::BindingInfo* binding) {
 	if (!directMode) {
-		if (unWhichDevice == m_openvrId && ((m_deviceMode == 2 && !m_redirectSuspended) || m_deviceMode == 4)) {
-			unWhichDevice = m_redirectRef->openvrId();
+		AnalogInputRemappingInfo::BindingInfo bindingState;
+		if (binding) {
+			bindingState = *binding;
 		}
-		if (unWhichDevice != m_openvrId) {
-			auto deviceInfo = m_parent->getDeviceManipulationHandleById(unWhichDevice);
-			if (deviceInfo) {
-				return deviceInfo->sendAxisEvent(unWhichDevice, unWhichAxis, axisState, true, binding);
-			}
+		if (_routeInput(unWhichDevice, [&](DeviceManipulationHandle* target, bool primary) {
+			auto bindingCopy = bindingState;
+			target->sendAxisEvent(target->openvrId(), unWhichAxis, axisState, true, (primary || !binding) ? binding : &bindingCopy);
+		})) {
+			return;
 		}
 	}
 	if (unWhichAxis < 5) {
-		if (m_analogInputRemapping[unWhichAxis].remapping.valid && touchpadEmulationEnabledFlag) {
-			auto newState = axisState;
-			auto& lastSeenState = m_analogInputRemapping[unWhichAxis].binding.lastSeenAxisState;
-			auto& lastSendState = m_analogInputRemapping[unWhichAxis].binding.lastSendAxisState;
-			bool suppress = false;
-
-			if (m_analogInputRemapping[unWhichAxis].remapping.binding.touchpadEmulationMode == 1) {
-				if (axisState.x != 0.0f && vrmath::signum(axisState.x) == vrmath::signum(lastSendState.x) && abs(axisState.x) < abs(lastSendState.x)) {
-					newState.x = lastSendState.x;
-				}
-				if (axisState.y != 0.0f && vrmath::signum(axisState.y) == vrmath::signum(lastSendState.y) && abs(axisState.y) < abs(lastSendState.y)) {
-					newState.y = lastSendState.y;
-				}
-
-			} else if (m_analogInputRemapping[unWhichAxis].remapping.binding.touchpadEmulationMode == 2) {
-				// Joystick was already in neutral position but we haven't send it yet, and now it moved away from neutral position
-				// => send neutral position before we do anything else since some menus use this information to reset input handling.
-				if (lastSeenState.x == 0.0f && lastSeenState.y == 0.0f && (lastSendState.x != 0.0f || lastSendState.y != 0.0f) && (axisState.x != 0.0f || axisState.y != 0.0f)) {
-					ll_sendAxisEvent(unWhichAxis, { 0.0f, 0.0f });
-					lastSendState = {0.0f, 0.0f};
-				}
-				if (axisState.x == 0.0f || (vrmath::signum(axisState.x) == vrmath::signum(lastSendState.x) && abs(axisState.x) < abs(lastSendState.x))) {
-					newState.x = lastSendState.x;
-				}
-				if (axisState.y == 0.0f || (vrmath::signum(axisState.y) == vrmath::signum(lastSendState.y) && abs(axisState.y) < abs(lastSendState.y))) {
-					newState.y = lastSendState.y;
-				}
-			}
-
-			lastSeenState = axisState;
-			if (!suppress) {
-				ll_sendAxisEvent(unWhichAxis, newState);
-				lastSendState = newState;
-			}
-		} else {
-			ll_sendAxisEvent(unWhichAxis, axisState);
-			m_analogInputRemapping[unWhichAxis].binding.lastSeenAxisState = axisState;
-			m_analogInputRemapping[unWhichAxis].binding.lastSendAxisState = axisState;
+		vr::VRControllerAxis_t newState;
+		if (m_analogInputRemapping[unWhichAxis].filter.filterOutput(3, axisState, newState, touchpadEmulationEnabledFlag)) {
+			ll_sendAxisEvent(unWhichAxis, { 0.0f, 0.0f });
 		}
-
+		ll_sendAxisEvent(unWhichAxis, newState);
 	} else {
 		ll_sendAxisEvent(unWhichAxis, axisState);
 	}
@@ -1261,73 +1355,24 @@ void DeviceManipulationHandle::sendAxisEvent(uint32_t unWhichDevice, uint32_t un
 
 void DeviceManipulationHandle::sendScalarComponentUpdate(uint32_t unWhichDevice, uint32_t unWhichAxis, uint32_t unAxisDim, vr::VRInputComponentHandle_t ulComponent, float fNewValue, double fTimeOffset, bool directMode) {
 	if (!directMode) {
-		if (unWhichDevice == m_openvrId && ((m_deviceMode == 2 && !m_redirectSuspended) || m_deviceMode == 4)) {
-			unWhichDevice = m_redirectRef->openvrId();
-		}
-		if (unWhichDevice != m_openvrId) {
-			auto deviceInfo = m_parent->getDeviceManipulationHandleById(unWhichDevice);
-			if (deviceInfo) {
-				return deviceInfo->sendScalarComponentUpdate(unWhichDevice, unWhichAxis, unAxisDim, fNewValue, fTimeOffset, true);
-			}
+		// Component handles belong to the device, so other targets look up their own component
+		if (_routeInput(unWhichDevice, [&](DeviceManipulationHandle* target, bool primary) {
+			target->sendScalarComponentUpdate(target->openvrId(), unWhichAxis, unAxisDim, fNewValue, fTimeOffset, true);
+		})) {
+			return;
 		}
 	}
-	if (unWhichAxis < 5) {
-		auto& axisInfo = m_analogInputRemapping[unWhichAxis];
-		if (axisInfo.remapping.valid && touchpadEmulationEnabledFlag) {
-			auto myNewState = fNewValue;
-			auto& lastSeenState = m_analogInputRemapping[unWhichAxis].binding.lastSeenAxisState;
-			auto& lastSendState = m_analogInputRemapping[unWhichAxis].binding.lastSendAxisState;
-			bool suppress = false;
-
-			if (m_analogInputRemapping[unWhichAxis].remapping.binding.touchpadEmulationMode == 1) {
-				if (unAxisDim == 0 && (fNewValue != 0.0f && vrmath::signum(fNewValue) == vrmath::signum(lastSendState.x) && abs(fNewValue) < abs(lastSendState.x))) {
-					myNewState = lastSendState.x;
-				} else if (unAxisDim == 1 && (fNewValue != 0.0f && vrmath::signum(fNewValue) == vrmath::signum(lastSendState.y) && abs(fNewValue) < abs(lastSendState.y))) {
-					myNewState = lastSendState.y;
-				}
-
-			} else if (m_analogInputRemapping[unWhichAxis].remapping.binding.touchpadEmulationMode == 2) {
-				// Joystick was already in neutral position but we haven't send it yet, and now it moved away from neutral position
-				// => send neutral position before we do anything else since some menus use this information to reset input handling.
-				if (lastSeenState.x == 0.0f && lastSeenState.y == 0.0f && (lastSendState.x != 0.0f || lastSendState.y != 0.0f) && fNewValue != 0.0f) {
-					ll_sendScalarComponentUpdate(ulComponent, 0.0f, fTimeOffset);
-					if (unAxisDim == 0) {
-						ll_sendScalarComponentUpdate(_AxisIdToComponentHandleMap[unWhichAxis].second, 0.0f, fTimeOffset);
-					} else {
-						ll_sendScalarComponentUpdate(_AxisIdToComponentHandleMap[unWhichAxis].first, 0.0f, fTimeOffset);
-					}
-					lastSendState = {0.0f, 0.0f};
-				}
-				if (unAxisDim == 0 && (fNewValue == 0.0f || (vrmath::signum(fNewValue) == vrmath::signum(lastSendState.x) && abs(fNewValue) < abs(lastSendState.x)))) {
-					myNewState = lastSendState.x;
-				} else if (unAxisDim == 1 && (fNewValue == 0.0f || (vrmath::signum(fNewValue) == vrmath::signum(lastSendState.y) && abs(fNewValue) < abs(lastSendState.y)))) {
-					myNewState = lastSendState.y;
-				}
-			}
-
-			if (unAxisDim == 0) {
-				lastSeenState.x = fNewValue;
-			} else {
-				lastSeenState.y = fNewValue;
-			}
-			if (!suppress) {
-				ll_sendScalarComponentUpdate(ulComponent, myNewState, fTimeOffset);
-				if (unAxisDim == 0) {
-					lastSendState.x = myNewState;
-				} else {
-					lastSendState.y = myNewState;
-				}
-			}
-		} else {
-			ll_sendScalarComponentUpdate(ulComponent, fNewValue, fTimeOffset);
-			if (unAxisDim == 0) {
-				axisInfo.binding.lastSeenAxisState.x = fNewValue;
-				axisInfo.binding.lastSendAxisState.x = fNewValue;
-			} else {
-				axisInfo.binding.lastSeenAxisState.y = fNewValue;
-				axisInfo.binding.lastSendAxisState.y = fNewValue;
+	if (unWhichAxis < 5 && unAxisDim < 2) {
+		vr::VRControllerAxis_t newState;
+		if (m_analogInputRemapping[unWhichAxis].filter.filterOutput(1 << unAxisDim, { fNewValue, fNewValue }, newState, touchpadEmulationEnabledFlag)) {
+			auto& handles = _AxisIdToComponentHandleMap[unWhichAxis];
+			ll_sendScalarComponentUpdate(ulComponent, 0.0f, fTimeOffset);
+			auto otherComponent = unAxisDim == 0 ? handles.second : handles.first;
+			if (otherComponent != 0) {
+				ll_sendScalarComponentUpdate(otherComponent, 0.0f, fTimeOffset);
 			}
 		}
+		ll_sendScalarComponentUpdate(ulComponent, unAxisDim == 0 ? newState.x : newState.y, fTimeOffset);
 	} else {
 		ll_sendScalarComponentUpdate(ulComponent, fNewValue, fTimeOffset);
 	}
@@ -1335,14 +1380,11 @@ void DeviceManipulationHandle::sendScalarComponentUpdate(uint32_t unWhichDevice,
 
 void DeviceManipulationHandle::sendScalarComponentUpdate(uint32_t unWhichDevice, uint32_t unWhichAxis, uint32_t unAxisDim, float fNewValue, double fTimeOffset, bool directMode) {
 	if (!directMode) {
-		if (unWhichDevice == m_openvrId && ((m_deviceMode == 2 && !m_redirectSuspended) || m_deviceMode == 4)) {
-			unWhichDevice = m_redirectRef->openvrId();
-		}
-		if (unWhichDevice != m_openvrId) {
-			auto deviceInfo = m_parent->getDeviceManipulationHandleById(unWhichDevice);
-			if (deviceInfo) {
-				return deviceInfo->sendScalarComponentUpdate(unWhichDevice, unWhichAxis, unAxisDim, fNewValue, fTimeOffset, true);
-			}
+		// Component handles belong to the device, so other targets look up their own component
+		if (_routeInput(unWhichDevice, [&](DeviceManipulationHandle* target, bool primary) {
+			target->sendScalarComponentUpdate(target->openvrId(), unWhichAxis, unAxisDim, fNewValue, fTimeOffset, true);
+		})) {
+			return;
 		}
 	}
 	if (unWhichAxis < 5) {
@@ -1358,6 +1400,32 @@ void DeviceManipulationHandle::sendScalarComponentUpdate(uint32_t unWhichDevice,
 	}
 }
 
+void DeviceManipulationHandle::sendScalarComponentPair(uint32_t unWhichDevice, uint32_t unWhichAxis, const vr::VRControllerAxis_t& value, double fTimeOffset, bool directMode) {
+	if (!directMode) {
+		if (_routeInput(unWhichDevice, [&](DeviceManipulationHandle* target, bool primary) {
+			target->sendScalarComponentPair(target->openvrId(), unWhichAxis, value, fTimeOffset, true);
+		})) {
+			return;
+		}
+	}
+	if (unWhichAxis < 5) {
+		auto& handles = _AxisIdToComponentHandleMap[unWhichAxis];
+		if (handles.first == 0 || handles.second == 0) {
+			// Target has no two-dimensional component for this axis
+			sendScalarComponentUpdate(unWhichDevice, unWhichAxis, 0, value.x, fTimeOffset, true);
+			sendScalarComponentUpdate(unWhichDevice, unWhichAxis, 1, value.y, fTimeOffset, true);
+			return;
+		}
+		vr::VRControllerAxis_t newState;
+		if (m_analogInputRemapping[unWhichAxis].filter.filterOutput(3, value, newState, touchpadEmulationEnabledFlag)) {
+			ll_sendScalarComponentUpdate(handles.first, 0.0f, fTimeOffset);
+			ll_sendScalarComponentUpdate(handles.second, 0.0f, fTimeOffset);
+		}
+		ll_sendScalarComponentUpdate(handles.first, newState.x, fTimeOffset);
+		ll_sendScalarComponentUpdate(handles.second, newState.y, fTimeOffset);
+	}
+}
+
 
 
 int DeviceManipulationHandle::setDefaultMode() {
@@ -1366,6 +1434,7 @@ int DeviceManipulationHandle::setDefaultMode() {
 	if (res == 0) {
 		m_deviceMode = 0;
 	}
+	_manipulationChanged();
 	return 0; 
 }
 
@@ -1381,6 +1450,7 @@ int DeviceManipulationHandle::setRedirectMode(bool target, DeviceManipulationHan
 			m_deviceMode = 2;
 		}
 	}
+	_manipulationChanged();
 	return 0; 
 }
 
@@ -1391,19 +1461,40 @@ int DeviceManipulationHandle::setSwapMode(DeviceManipulationHandle* ref) {
 		m_redirectRef = ref;
 		m_deviceMode = 4;
 	}
+	_manipulationChanged();
 	return 0;
 }
 
 int DeviceManipulationHandle::setMotionCompensationMode() {
 	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	if (m_motionCompensationGroup >= maxMotionCompensationGroups) {
+		return -1;
+	}
 	auto res = _disableOldMode(5);
 	auto serverDriver = ServerDriver::getInstance();
 	if (res == 0 && serverDriver) {
-		m_motionCompensationManager.enableMotionCompensation(true);
-		m_motionCompensationManager.setMotionCompensationRefDevice(this);
-		m_motionCompensationManager._setMotionCompensationStatus(MotionCompensationStatus::WaitingForZeroRef);
+		m_motionCompensationManager.enableMotionCompensation(m_motionCompensationGroup, true);
+		m_motionCompensationManager.setMotionCompensationRefDevice(m_motionCompensationGroup, this);
+		m_motionCompensationManager._setMotionCompensationStatus(m_motionCompensationGroup, MotionCompensationStatus::WaitingForZeroRef);
 		m_deviceMode = 5;
 	}
+	_manipulationChanged();
+	return 0;
+}
+
+int DeviceManipulationHandle::setMotionCompensationGroup(uint32_t group) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	if (group >= maxMotionCompensationGroups && group != motionCompensationGroupNone) {
+		return -1;
+	} else if (m_deviceMode == 5) {
+		// The reference device of a running group cannot leave it
+		return -2;
+	}
+	if (m_motionCompensationGroup != group) {
+		m_motionCompensationGroup = group;
+		setLastPoseTime(-1); // The next compensated pose also sets up the filters for the new group
+		_manipulationChanged();
+	}
 	return 0;
 }
 
@@ -1414,6 +1505,7 @@ int DeviceManipulationHandle::setFakeDisconnectedMode() {
 		_disconnectedMsgSend = false;
 		m_deviceMode = 1;
 	}
+	_manipulationChanged();
 	return 0;
 }
 
@@ -1422,18 +1514,21 @@ int DeviceManipulationHandle::_disableOldMode(int newMode) {
 		if (m_deviceMode == 5) {
 			auto serverDriver = ServerDriver::getInstance();
 			if (serverDriver) {
-				m_motionCompensationManager.enableMotionCompensation(false);
-				m_motionCompensationManager.setMotionCompensationRefDevice(nullptr);
+				m_motionCompensationManager.enableMotionCompensation(m_motionCompensationGroup, false);
+				m_motionCompensationManager.setMotionCompensationRefDevice(m_motionCompensationGroup, nullptr);
 			}
 		} else if (m_deviceMode == 3 || m_deviceMode == 2 || m_deviceMode == 4) {
 			m_redirectRef->m_deviceMode = 0;
+			m_redirectRef->_updatePipeline();
+			m_redirectRef->_updateHookFeatures();
+			m_parent->deviceStateChanged(m_redirectRef->m_openvrId);
 		}
 		if (newMode == 5) {
 			auto serverDriver = ServerDriver::getInstance();
 			if (serverDriver) {
-				m_motionCompensationManager._disableMotionCompensationOnAllDevices();
-				m_motionCompensationManager.enableMotionCompensation(false);
-				m_motionCompensationManager.setMotionCompensationRefDevice(nullptr);
+				m_motionCompensationManager._disableMotionCompensationOnAllDevices(m_motionCompensationGroup);
+				m_motionCompensationManager.enableMotionCompensation(m_motionCompensationGroup, false);
+				m_motionCompensationManager.setMotionCompensationRefDevice(m_motionCompensationGroup, nullptr);
 			}
 		} 
 	}
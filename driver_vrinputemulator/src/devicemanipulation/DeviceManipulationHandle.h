@@ -1,11 +1,15 @@
 #pragma once
 #pragma once
 
+#include <thread>
+#include <atomic>
 #include <openvr_driver.h>
 #include <vrinputemulator_types.h>
 #include <openvr_math.h>
 #include "utils/KalmanFilter.h"
 #include "utils/MovingAverageRingBuffer.h"
+#include "utils/AnalogFilterPipeline.h"
+#include "utils/PoseSmoothingFilter.h"
 #include "../logging.h"
 #include "../hooks/common.h"
 
@@ -42,14 +46,18 @@ private:
 
 	int m_deviceMode = 0; // 0 .. default, 1 .. disabled, 2 .. redirect source, 3 .. redirect target, 4 .. swap mode, 5 .. motion compensation
 	bool _disconnectedMsgSend = false;
+	std::atomic<uint32_t> m_motionCompensationGroup { 0 }; // Group that compensates this device, or that it is the reference of in mode 5. Read without _mutex by the motion compensation manager
 
 	bool m_offsetsEnabled = false;
+	bool m_inputRemappingActive = false;
+	unsigned m_hookFeatures = 0; // Bitmask of the HookFeatures this device holds a reference to
 	vr::HmdQuaternion_t m_worldFromDriverRotationOffset = { 1.0, 0.0, 0.0, 0.0 };
 	vr::HmdVector3d_t m_worldFromDriverTranslationOffset = { 0.0, 0.0, 0.0 };
 	vr::HmdQuaternion_t m_driverFromHeadRotationOffset = { 1.0, 0.0, 0.0, 0.0 };
 	vr::HmdVector3d_t m_driverFromHeadTranslationOffset = { 0.0, 0.0, 0.0 };
 	vr::HmdQuaternion_t m_deviceRotationOffset = { 1.0, 0.0, 0.0, 0.0 };
 	vr::HmdVector3d_t m_deviceTranslationOffset = { 0.0, 0.0, 0.0 };
+	PoseSmoothingFilter m_poseSmoothing;
 
 	struct DigitalInputRemappingInfo {
 		int state = 0;
@@ -74,10 +82,14 @@ private:
 		struct BindingInfo {
 			bool pressedState = false;
 			bool touchedState = false;
-			vr::VRControllerAxis_t lastSeenAxisState = { 0, 0 };
-			vr::VRControllerAxis_t lastSendAxisState = { 0, 0 };
 		} binding;
 		AnalogInputRemapping remapping;
+		AnalogFilterPipeline filter; // Compiled from remapping.binding
+		struct PendingScalarSample {
+			uint32_t dimensions = 0; // Bit mask, 1 .. x, 2 .. y
+			vr::VRControllerAxis_t value = { 0, 0 };
+			double timeOffset = 0.0;
+		} pendingScalarSample; // First half of a paired scalar component update (see AnalogBinding::pairScalarComponents)
 	};
 	AnalogInputRemappingInfo m_analogInputRemapping[5];
 
@@ -86,12 +98,21 @@ private:
 	bool m_redirectSuspended = false;
 	DeviceManipulationHandle* m_redirectRef = nullptr;
 
+	// The pose pipeline is specialized for the current configuration (mode, redirect suspension, smoothing, offsets,
+	// motion compensation group) and reselected by _updatePipeline() whenever it changes, so poses pass only the
+	// stages that apply without checking the configuration on every update
+	enum class PoseRoute { Forward, FakeDisconnected, Drop, MotionCompensationRef, RedirectSource, Swap };
+	typedef bool (DeviceManipulationHandle::*PosePipeline)(uint32_t& unWhichDevice, vr::DriverPose_t& newPose);
+	PosePipeline m_posePipeline = nullptr;
+	bool m_inputBlocked = false; // Fake disconnected or active redirect target, input events are swallowed
+
 	long long m_lastPoseTime = -1;
 	bool m_lastPoseValid = false;
 	vr::DriverPose_t m_lastPose;
 	MovingAverageRingBuffer m_velMovingAverageBuffer;
 	double m_lastPoseTimeOffset = 0.0;
 	PosKalmanFilter m_kalmanFilter;
+	uint64_t m_motionCompensationFilterKey = (uint64_t)-1; // Group and filter settings generation the filters above were set up for, only touched by the pose hook
 
 	vr::PropertyContainerHandle_t m_propertyContainerHandle = vr::k_ulInvalidPropertyContainer;
 	uint64_t m_inputHapticComponentHandle = 0; // Let's assume for now that there is only one haptic component
@@ -100,22 +121,34 @@ private:
 	std::map<uint64_t, std::pair<unsigned, unsigned>> _componentHandleToAxisIdMap;
 	std::pair<uint64_t, uint64_t> _AxisIdToComponentHandleMap[5];
 
-	HANDLE _vibrationCueTheadHandle = NULL;
-
 	void sendDigitalBinding(vrinputemulator::DigitalBinding& binding, uint32_t unWhichDevice, ButtonEventType eventType, vr::EVRButtonId eButtonId, double eventTimeOffset, DigitalInputRemappingInfo::BindingInfo* bindingInfo = nullptr);
-	void sendAnalogBinding(vrinputemulator::AnalogBinding& binding, uint32_t unWhichDevice, uint32_t axisId, const vr::VRControllerAxis_t& axisState, AnalogInputRemappingInfo::BindingInfo* bindingInfo = nullptr);
-	void sendAnalogBinding(vrinputemulator::AnalogBinding& binding, uint32_t unWhichDevice, uint32_t unWhichAxis, uint32_t unAxisDim, vr::VRInputComponentHandle_t ulComponent, float fNewValue, double fTimeOffset);
+	static void _invertAndSwapAxes(const AnalogBinding& binding, vr::VRControllerAxis_t& value);
+	void sendAnalogBinding(AnalogInputRemappingInfo& axisInfo, uint32_t unWhichDevice, uint32_t axisId, const vr::VRControllerAxis_t& axisState);
+	void sendAnalogBinding(AnalogInputRemappingInfo& axisInfo, uint32_t unWhichDevice, uint32_t unWhichAxis, uint32_t unAxisDim, vr::VRInputComponentHandle_t ulComponent, float fNewValue, double fTimeOffset);
+	void sendAnalogBindingPair(AnalogInputRemappingInfo& axisInfo, uint32_t unWhichDevice, uint32_t unWhichAxis, const vr::VRControllerAxis_t& value, double fTimeOffset);
+	void _pairScalarComponentUpdate(uint32_t unWhichAxis, uint32_t unAxisDim, float fNewValue, double fTimeOffset);
+	void _flushPendingScalarSample(uint32_t unWhichAxis);
 
 	void _buttonPressDeadzoneFix(vr::EVRButtonId eButtonId);
 	void _vibrationCue();
 	void _audioCue();
+	void _updateInputRemappingActive();
+	void _updateHookFeatures();
+	void _manipulationChanged();
+	void _updatePipeline();
+	template<bool Smoothing, bool Offsets, bool Compensation, PoseRoute Route> bool _posePipeline(uint32_t& unWhichDevice, vr::DriverPose_t& newPose);
+	template<bool Smoothing, bool Offsets, bool Compensation> static PosePipeline _selectPosePipeline(PoseRoute route);
+	template<typename F> bool _routeInput(uint32_t unWhichDevice, F send);
 
 	int _disableOldMode(int newMode);
 
 public:
 	DeviceManipulationHandle(const char* serial, vr::ETrackedDeviceClass eDeviceClass, void* driverPtr, void* driverHostPtr, int driverInterfaceVersion);
+	~DeviceManipulationHandle();
 
 	bool isValid() const { return m_isValid; }
+	/** false when hooks can pass everything of this device through unchanged */
+	bool needsProcessing() const { return m_deviceMode != 0 || m_offsetsEnabled || m_inputRemappingActive || m_poseSmoothing.enabled(); }
 	vr::ETrackedDeviceClass deviceClass() const { return m_eDeviceClass; }
 	uint32_t openvrId() const { return m_openvrId; }
 	void setOpenvrId(uint32_t id) { m_openvrId = id; }
@@ -133,10 +166,12 @@ public:
 	int setRedirectMode(bool target, DeviceManipulationHandle* ref);
 	int setSwapMode(DeviceManipulationHandle* ref);
 	int setMotionCompensationMode();
+	uint32_t motionCompensationGroup() const { return m_motionCompensationGroup.load(std::memory_order_relaxed); }
+	int setMotionCompensationGroup(uint32_t group);
 	int setFakeDisconnectedMode();
 
 	bool areOffsetsEnabled() const { return m_offsetsEnabled; }
-	void enableOffsets(bool enable) { m_offsetsEnabled = enable; }
+	void enableOffsets(bool enable);
 	const vr::HmdQuaternion_t& worldFromDriverRotationOffset() const { return m_worldFromDriverRotationOffset; }
 	vr::HmdQuaternion_t& worldFromDriverRotationOffset() { return m_worldFromDriverRotationOffset; }
 	const vr::HmdVector3d_t& worldFromDriverTranslationOffset() const { return m_worldFromDriverTranslationOffset; }
@@ -150,12 +185,18 @@ public:
 	const vr::HmdVector3d_t& deviceTranslationOffset() const { return m_deviceTranslationOffset; }
 	vr::HmdVector3d_t& deviceTranslationOffset() { return m_deviceTranslationOffset; }
 
+	void setPoseSmoothing(const PoseSmoothingSettings& settings);
+	const PoseSmoothingSettings& poseSmoothing() const { return m_poseSmoothing.settings(); }
+
 	void setDigitalInputRemapping(uint32_t buttonId, const DigitalInputRemapping& remapping);
 	DigitalInputRemapping getDigitalInputRemapping(uint32_t buttonId);
 
 	void setAnalogInputRemapping(uint32_t axisId, const AnalogInputRemapping& remapping);
 	AnalogInputRemapping getAnalogInputRemapping(uint32_t axisId);
 
+	uint64_t digitalInputRemappingMask() const;
+	uint32_t analogInputRemappingMask() const;
+
 	bool redirectSuspended() const { return m_redirectSuspended; }
 	DeviceManipulationHandle* redirectRef() const { return m_redirectRef; }
 
@@ -174,13 +215,17 @@ public:
 	bool handleHapticPulseEvent(float& fDurationSeconds, float& fFrequency, float& fAmplitude);
 
 	void sendButtonEvent(uint32_t unWhichDevice, ButtonEventType eventType, vr::EVRButtonId eButtonId, double eventTimeOffset, bool directMode = false, DigitalInputRemappingInfo::BindingInfo* binding = nullptr);
-	void sendKeyboardEvent(ButtonEventType eventType, bool shiftPressed, bool ctrlPressed, bool altPressed, WORD keyCode, bool sendScanCode, DigitalInputRemappingInfo::BindingInfo* binding = nullptr);
+	void sendKeyboardEvent(ButtonEventType eventType, bool shiftPressed, bool ctrlPressed, bool altPressed, uint16_t keyCode, bool sendScanCode, DigitalInputRemappingInfo::BindingInfo* binding = nullptr);
 	void sendAxisEvent(uint32_t unWhichDevice, uint32_t unWhichAxis, const vr::VRControllerAxis_t& axisState, bool directMode = false, AnalogInputRemappingInfo::BindingInfo* binding = nullptr);
 	void sendScalarComponentUpdate(uint32_t unWhichDevice, uint32_t unWhichAxis, uint32_t unAxisDim, vr::VRInputComponentHandle_t ulComponent, float fNewValue, double fTimeOffset, bool directMode = false);
 	void sendScalarComponentUpdate(uint32_t unWhichDevice, uint32_t unWhichAxis, uint32_t unAxisDim, float, double fTimeOffset, bool directMode = false);
+	/** Both dimensions of a scalar component axis as one sample, x first */
+	void sendScalarComponentPair(uint32_t unWhichDevice, uint32_t unWhichAxis, const vr::VRControllerAxis_t& value, double fTimeOffset, bool directMode = false);
 	
 
 	bool triggerHapticPulse(uint32_t unAxisId, uint16_t usPulseDurationMicroseconds, bool directMode = false);
+	/** The device that has to vibrate when a haptic pulse for this device arrives (depends on redirect/swap modes), nullptr when it is swallowed */
+	DeviceManipulationHandle* hapticTarget(bool directMode = false);
 
 	void inputAddBooleanComponent(const char *pchName, uint64_t pHandle);
 	void inputAddScalarComponent(const char *pchName, uint64_t pHandle, vr::EVRScalarType eType, vr::EVRScalarUnits eUnits);
@@ -188,6 +233,8 @@ public:
 
 	PosKalmanFilter& kalmanFilter() { return m_kalmanFilter; }
 	MovingAverageRingBuffer& velMovingAverage() { return m_velMovingAverageBuffer; }
+	uint64_t motionCompensationFilterKey() const { return m_motionCompensationFilterKey; }
+	void setMotionCompensationFilterKey(uint64_t key) { m_motionCompensationFilterKey = key; }
 	long long getLastPoseTime() { return m_lastPoseTime; }
 	void setLastPoseTime(long long time) { m_lastPoseTime = time; }
 	double getLastPoseTimeOffset() { return m_lastPoseTimeOffset; }
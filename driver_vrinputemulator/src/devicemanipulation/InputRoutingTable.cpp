@@ -0,0 +1,124 @@
+#include "InputRoutingTable.h"
+
+#include <thread>
+#include <algorithm>
+#include <ipc_shm_layout.h>
+#include "DeviceManipulationHandle.h"
+#include "../hooks/common.h"
+
+
+// driver namespace
+namespace vrinputemulator {
+namespace driver {
+
+
+InputRoutingTable::~InputRoutingTable() {
+	if (_hookFeaturesAcquired) {
+		HookFeatures::release(HookFeature::DigitalInput);
+		HookFeatures::release(HookFeature::AnalogInput);
+	}
+}
+
+
+void InputRoutingTable::rebuild(DeviceManipulationHandle* const* handles) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	for (uint32_t i = 0; i < vr::k_unMaxTrackedDeviceCount; ++i) {
+		Route route = { nullptr, 0, {} };
+		auto handle = handles[i];
+		if (handle && handle->isValid()) {
+			route.device = handle;
+			auto mode = handle->deviceMode();
+			if (((mode == 2 && !handle->redirectSuspended()) || mode == 4) && handle->redirectRef()) {
+				route.targets[route.targetCount++] = handle->redirectRef();
+			} else {
+				route.targets[route.targetCount++] = handle;
+			}
+			for (auto& m : _mirrors) {
+				if (m.first == i && m.second < vr::k_unMaxTrackedDeviceCount && route.targetCount < maxTargets) {
+					auto target = handles[m.second];
+					if (target && target->isValid() && std::find(route.targets, route.targets + route.targetCount, target) == route.targets + route.targetCount) {
+						route.targets[route.targetCount++] = target;
+					}
+				}
+			}
+		}
+		ipc::seqlockWrite(_entries[i].sequence, _entries[i].route, route);
+	}
+}
+
+
+bool InputRoutingTable::lookup(uint32_t openvrId, Route& route) const {
+	if (openvrId >= vr::k_unMaxTrackedDeviceCount) {
+		return false;
+	}
+	auto& entry = _entries[openvrId];
+	while (!ipc::seqlockTryRead(entry.sequence, entry.route, route)) {
+		std::this_thread::yield();
+	}
+	return route.device != nullptr;
+}
+
+
+bool InputRoutingTable::setMirror(uint32_t sourceId, uint32_t targetId, bool enable) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	auto it = std::find(_mirrors.begin(), _mirrors.end(), std::make_pair(sourceId, targetId));
+	if (enable && it == _mirrors.end()) {
+		auto count = std::count_if(_mirrors.begin(), _mirrors.end(), [sourceId](const std::pair<uint32_t, uint32_t>& m) { return m.first == sourceId; });
+		if (count >= maxTargets - 1) {
+			return false;
+		}
+		_mirrors.push_back({ sourceId, targetId });
+		LOG(INFO) << "Input of device " << sourceId << " is mirrored to device " << targetId;
+	} else if (!enable && it != _mirrors.end()) {
+		_mirrors.erase(it);
+		LOG(INFO) << "Input of device " << sourceId << " is no longer mirrored to device " << targetId;
+	}
+	_mirrorsChanged();
+	return true;
+}
+
+
+void InputRoutingTable::clearMirrors(uint32_t sourceId) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	_mirrors.erase(std::remove_if(_mirrors.begin(), _mirrors.end(), [sourceId](const std::pair<uint32_t, uint32_t>& m) { return m.first == sourceId; }), _mirrors.end());
+	_mirrorsChanged();
+}
+
+
+std::vector<uint32_t> InputRoutingTable::mirrors(uint32_t sourceId) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	std::vector<uint32_t> retval;
+	for (auto& m : _mirrors) {
+		if (m.first == sourceId) {
+			retval.push_back(m.second);
+		}
+	}
+	return retval;
+}
+
+
+void InputRoutingTable::_mirrorsChanged() {
+	uint64_t mask = 0;
+	for (auto& m : _mirrors) {
+		if (m.first < 64) {
+			mask |= (uint64_t)1 << m.first;
+		}
+	}
+	_mirroredDevices.store(mask, std::memory_order_relaxed);
+	// Mirrored input has to pass the input hooks even when the source device is not manipulated otherwise
+	bool needHooks = !_mirrors.empty();
+	if (needHooks != _hookFeaturesAcquired) {
+		if (needHooks) {
+			HookFeatures::acquire(HookFeature::DigitalInput);
+			HookFeatures::acquire(HookFeature::AnalogInput);
+		} else {
+			HookFeatures::release(HookFeature::DigitalInput);
+			HookFeatures::release(HookFeature::AnalogInput);
+		}
+		_hookFeaturesAcquired = needHooks;
+	}
+}
+
+
+} // end namespace driver
+} // end namespace vrinputemulator
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <openvr_driver.h>
+#include "../logging.h"
+
+
+
+// driver namespace
+namespace vrinputemulator {
+namespace driver {
+
+
+// forward declarations
+class DeviceManipulationHandle;
+
+
+/**
+* Driver-wide table that tells where the input of a device has to go.
+*
+* Redirect and swap modes as well as input mirrors are compiled into one route per OpenVR id whenever
+* something changes, so sending an event only needs one indexed lookup instead of resolving modes and
+* device ids per event. A route can have several targets: besides the primary target (the device itself
+* or its redirect/swap partner) the input can be mirrored to other devices, e.g. one physical controller
+* driving two virtual devices. Inputs keep their ids on all targets.
+*
+* Every entry is protected by a seqlock, so the hooks read routes without locking.
+*/
+class InputRoutingTable {
+public:
+	static const uint32_t maxTargets = 4;
+
+	struct Route {
+		DeviceManipulationHandle* device; // The device the route belongs to
+		uint32_t targetCount;
+		DeviceManipulationHandle* targets[maxTargets]; // targets[0] is the primary target
+	};
+
+	~InputRoutingTable();
+
+	/** Recompiles all routes from the given handles (one per OpenVR id), needs to be called after every mode change */
+	void rebuild(DeviceManipulationHandle* const* handles);
+
+	/** Returns false when there is no valid device with this id */
+	bool lookup(uint32_t openvrId, Route& route) const;
+
+	/** Mirrors are configured by OpenVR id, so they can be set up before the devices exist. Returns false when there are too many. */
+	bool setMirror(uint32_t sourceId, uint32_t targetId, bool enable);
+	void clearMirrors(uint32_t sourceId);
+	std::vector<uint32_t> mirrors(uint32_t sourceId);
+
+	/** One bit per OpenVR id that has at least one mirror */
+	uint64_t mirroredDevices() const { return _mirroredDevices.load(std::memory_order_relaxed); }
+
+private:
+	struct Entry {
+		std::atomic<uint32_t> sequence { 0 };
+		Route route = { nullptr, 0, {} };
+	};
+
+	void _mirrorsChanged();
+
+	std::mutex _mutex;
+	Entry _entries[vr::k_unMaxTrackedDeviceCount];
+	std::vector<std::pair<uint32_t, uint32_t>> _mirrors; // (source, target)
+	std::atomic<uint64_t> _mirroredDevices { 0 };
+	bool _hookFeaturesAcquired = false;
+};
+
+
+} // end namespace driver
+} // end namespace vrinputemulator
@@ -9,121 +9,168 @@ namespace vrinputemulator {
 namespace driver {
 
 
-void MotionCompensationManager::enableMotionCompensation(bool enable) {
-	_motionCompensationZeroRefTimeout = 0;
-	_motionCompensationZeroPoseValid = false;
-	_motionCompensationRefPoseValid = false;
-	_motionCompensationEnabled = enable;
-	if (_motionCompensationVelAccMode == MotionCompensationVelAccMode::KalmanFilter) {
-		m_parent->executeCodeForEachDeviceManipulationHandle([](DeviceManipulationHandle* handle) {
-			handle->setLastPoseTime(-1);
-		});
-	}
+double MotionCompensationManager::_poseSampleTime(const vr::DriverPose_t& pose) {
+	auto now = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	return (double)now / 1.0E6 + pose.poseTimeOffset;
 }
 
-void MotionCompensationManager::setMotionCompensationRefDevice(DeviceManipulationHandle* device) {
-	_motionCompensationRefDevice = device;
+template<typename F> void MotionCompensationManager::_forEachDeviceInGroup(uint32_t group, F code) {
+	m_parent->executeCodeForEachDeviceManipulationHandle([group, &code](DeviceManipulationHandle* handle) {
+		if (handle->motionCompensationGroup() == group) {
+			code(handle);
+		}
+	});
 }
 
-DeviceManipulationHandle* MotionCompensationManager::getMotionCompensationRefDevice() {
-	return _motionCompensationRefDevice;
+void MotionCompensationManager::enableMotionCompensation(uint32_t group, bool enable) {
+	auto& g = _groups[group];
+	g.zeroRefTimeout = 0;
+	g.zeroPoseValid = false;
+	{
+		std::lock_guard<std::mutex> lock(g.refMutex);
+		g.refPoseValid = false;
+		g.refHistory.clear();
+	}
+	g.enabled = enable;
+	if (enable) {
+		_enabledGroups.fetch_or(1u << group, std::memory_order_relaxed);
+	} else {
+		_enabledGroups.fetch_and(~(1u << group), std::memory_order_relaxed);
+	}
+	// Restarts the velocity estimation of all devices in the group
+	g.filterSettingsGeneration.fetch_add(1, std::memory_order_release);
 }
 
-void MotionCompensationManager::setMotionCompensationVelAccMode(MotionCompensationVelAccMode velAccMode) {
-	if (_motionCompensationVelAccMode != velAccMode) {
-		_motionCompensationRefVelAccValid = false;
-		m_parent->executeCodeForEachDeviceManipulationHandle([this](DeviceManipulationHandle* handle) {
-			handle->setLastPoseTime(-1);
-			handle->kalmanFilter().setProcessNoise(m_motionCompensationKalmanProcessVariance);
-			handle->kalmanFilter().setObservationNoise(m_motionCompensationKalmanObservationVariance);
-			handle->velMovingAverage().resize(m_motionCompensationMovingAverageWindow);
-		});
-		_motionCompensationVelAccMode = velAccMode;
+void MotionCompensationManager::_setMotionCompensationStatus(uint32_t group, MotionCompensationStatus status) {
+	auto& g = _groups[group];
+	if (g.status != status) {
+		g.status = status;
+		if (g.refDevice) {
+			m_parent->deviceStateChanged(g.refDevice->openvrId());
+		}
 	}
 }
 
-void MotionCompensationManager::setMotionCompensationKalmanProcessVariance(double variance) {
-	m_motionCompensationKalmanProcessVariance = variance;
-	if (_motionCompensationVelAccMode == MotionCompensationVelAccMode::KalmanFilter) {
-		m_parent->executeCodeForEachDeviceManipulationHandle([variance](DeviceManipulationHandle* handle) {
-			handle->kalmanFilter().setProcessNoise(variance);
-		});
-	}
+void MotionCompensationManager::setMotionCompensationRefDevice(uint32_t group, DeviceManipulationHandle* device) {
+	_groups[group].refDevice = device;
 }
 
-void MotionCompensationManager::setMotionCompensationKalmanObservationVariance(double variance) {
-	m_motionCompensationKalmanObservationVariance = variance;
-	if (_motionCompensationVelAccMode == MotionCompensationVelAccMode::KalmanFilter) {
-		m_parent->executeCodeForEachDeviceManipulationHandle([variance](DeviceManipulationHandle* handle) {
-			handle->kalmanFilter().setObservationNoise(variance);
-		});
-	}
+DeviceManipulationHandle* MotionCompensationManager::getMotionCompensationRefDevice(uint32_t group) {
+	return _groups[group].refDevice;
 }
 
-void MotionCompensationManager::setMotionCompensationMovingAverageWindow(unsigned window) {
-	m_motionCompensationMovingAverageWindow = window;
-	if (_motionCompensationVelAccMode == MotionCompensationVelAccMode::LinearApproximation) {
-		m_parent->executeCodeForEachDeviceManipulationHandle([window](DeviceManipulationHandle* handle) {
-			handle->velMovingAverage().resize(window);
-		});
+void MotionCompensationManager::setMotionCompensationVelAccMode(uint32_t group, MotionCompensationVelAccMode velAccMode) {
+	auto& g = _groups[group];
+	if (g.velAccMode != velAccMode) {
+		g.refVelAccValid = false;
+		g.velAccMode = velAccMode;
+		g.filterSettingsGeneration.fetch_add(1, std::memory_order_release);
 	}
 }
 
-void MotionCompensationManager::_disableMotionCompensationOnAllDevices() {
-	m_parent->executeCodeForEachDeviceManipulationHandle([](DeviceManipulationHandle* handle) {
+void MotionCompensationManager::setMotionCompensationKalmanProcessVariance(uint32_t group, double variance) {
+	auto& g = _groups[group];
+	g.kalmanProcessVariance = variance;
+	g.filterSettingsGeneration.fetch_add(1, std::memory_order_release);
+}
+
+void MotionCompensationManager::setMotionCompensationKalmanObservationVariance(uint32_t group, double variance) {
+	auto& g = _groups[group];
+	g.kalmanObservationVariance = variance;
+	g.filterSettingsGeneration.fetch_add(1, std::memory_order_release);
+}
+
+void MotionCompensationManager::setMotionCompensationMovingAverageWindow(uint32_t group, unsigned window) {
+	auto& g = _groups[group];
+	g.movingAverageWindow = window;
+	g.filterSettingsGeneration.fetch_add(1, std::memory_order_release);
+}
+
+void MotionCompensationManager::_disableMotionCompensationOnAllDevices(uint32_t group) {
+	_forEachDeviceInGroup(group, [](DeviceManipulationHandle* handle) {
 		if (handle->deviceMode() == 5) {
 			handle->setDefaultMode();
 		}
 	});
 }
 
-bool MotionCompensationManager::_isMotionCompensationZeroPoseValid() {
-	return _motionCompensationZeroPoseValid;
+bool MotionCompensationManager::_isMotionCompensationZeroPoseValid(uint32_t group) {
+	return _groups[group].zeroPoseValid;
 }
 
-void MotionCompensationManager::_setMotionCompensationZeroPose(const vr::DriverPose_t& pose) {
+void MotionCompensationManager::_setMotionCompensationZeroPose(uint32_t group, const vr::DriverPose_t& pose) {
+	auto& g = _groups[group];
 	// convert pose from driver space to app space
 	auto tmpConj = vrmath::quaternionConjugate(pose.qWorldFromDriverRotation);
-	_motionCompensationZeroPos = vrmath::quaternionRotateVector(pose.qWorldFromDriverRotation, tmpConj, pose.vecPosition, true) - pose.vecWorldFromDriverTranslation;
-	_motionCompensationZeroRot = tmpConj * pose.qRotation;
+	g.zeroPos = vrmath::quaternionRotateVector(pose.qWorldFromDriverRotation, tmpConj, pose.vecPosition, true) - pose.vecWorldFromDriverTranslation;
+	g.zeroRot = tmpConj * pose.qRotation;
 
-	_motionCompensationZeroPoseValid = true;
+	g.zeroPoseValid = true;
 }
 
-void MotionCompensationManager::_updateMotionCompensationRefPose(const vr::DriverPose_t& pose) {
+void MotionCompensationManager::_updateMotionCompensationRefPose(uint32_t group, const vr::DriverPose_t& pose) {
+	auto& g = _groups[group];
 	// convert pose from driver space to app space
 	auto tmpConj = vrmath::quaternionConjugate(pose.qWorldFromDriverRotation);
-	_motionCompensationRefPos = vrmath::quaternionRotateVector(pose.qWorldFromDriverRotation, tmpConj, pose.vecPosition, true) - pose.vecWorldFromDriverTranslation;
+	auto poseWorldPos = vrmath::quaternionRotateVector(pose.qWorldFromDriverRotation, tmpConj, pose.vecPosition, true) - pose.vecWorldFromDriverTranslation;
 	auto poseWorldRot = tmpConj * pose.qRotation;
 
-	// calculate orientation difference and its inverse
-	_motionCompensationRotDiff = poseWorldRot * vrmath::quaternionConjugate(_motionCompensationZeroRot);
-	_motionCompensationRotDiffInv = vrmath::quaternionConjugate(_motionCompensationRotDiff);
+	// calculate orientation difference (devices are compensated with the inverse of the interpolated difference)
+	auto rotDiff = poseWorldRot * vrmath::quaternionConjugate(g.zeroRot);
+	{
+		std::lock_guard<std::mutex> lock(g.refMutex);
+		g.refHistory.push(_poseSampleTime(pose), poseWorldPos, rotDiff);
+		g.refPoseValid = true;
+	}
 
 	// Convert velocity and acceleration values into app space and undo device rotation
-	if (_motionCompensationVelAccMode == MotionCompensationVelAccMode::SubstractMotionRef) {
+	if (g.velAccMode == MotionCompensationVelAccMode::SubstractMotionRef) {
 		auto tmpRot = tmpConj * vrmath::quaternionConjugate(pose.qRotation);
 		auto tmpRotInv = vrmath::quaternionConjugate(tmpRot);
-		_motionCompensationRefPosVel = vrmath::quaternionRotateVector(tmpRot, tmpRotInv, { pose.vecVelocity[0], pose.vecVelocity[1], pose.vecVelocity[2] });
-		_motionCompensationRefPosAcc = vrmath::quaternionRotateVector(tmpRot, tmpRotInv, { pose.vecAcceleration[0], pose.vecAcceleration[1], pose.vecAcceleration[2] });
-		_motionCompensationRefRotVel = vrmath::quaternionRotateVector(tmpRot, tmpRotInv, { pose.vecAngularVelocity[0], pose.vecAngularVelocity[1], pose.vecAngularVelocity[2] });
-		_motionCompensationRefRotAcc = vrmath::quaternionRotateVector(tmpRot, tmpRotInv, { pose.vecAngularAcceleration[0], pose.vecAngularAcceleration[1], pose.vecAngularAcceleration[2] });
-		_motionCompensationRefVelAccValid = true;
+		g.refPosVel = vrmath::quaternionRotateVector(tmpRot, tmpRotInv, { pose.vecVelocity[0], pose.vecVelocity[1], pose.vecVelocity[2] });
+		g.refPosAcc = vrmath::quaternionRotateVector(tmpRot, tmpRotInv, { pose.vecAcceleration[0], pose.vecAcceleration[1], pose.vecAcceleration[2] });
+		g.refRotVel = vrmath::quaternionRotateVector(tmpRot, tmpRotInv, { pose.vecAngularVelocity[0], pose.vecAngularVelocity[1], pose.vecAngularVelocity[2] });
+		g.refRotAcc = vrmath::quaternionRotateVector(tmpRot, tmpRotInv, { pose.vecAngularAcceleration[0], pose.vecAngularAcceleration[1], pose.vecAngularAcceleration[2] });
+		g.refVelAccValid = true;
 	}
-
-	_motionCompensationRefPoseValid = true;
 }
 
 bool MotionCompensationManager::_applyMotionCompensation(vr::DriverPose_t& pose, DeviceManipulationHandle* deviceInfo) {
-	if (_motionCompensationEnabled && _motionCompensationZeroPoseValid && _motionCompensationRefPoseValid) {
+	auto group = deviceInfo->motionCompensationGroup();
+	if (group >= maxMotionCompensationGroups) {
+		return true;
+	}
+	auto& g = _groups[group];
+	auto filterKey = ((uint64_t)group << 32) | g.filterSettingsGeneration.load(std::memory_order_acquire);
+	if (deviceInfo->motionCompensationFilterKey() != filterKey) {
+		// New group or new filter settings, set up the filters here instead of from the thread that changed them
+		deviceInfo->setLastPoseTime(-1);
+		deviceInfo->kalmanFilter().setProcessNoise(g.kalmanProcessVariance);
+		deviceInfo->kalmanFilter().setObservationNoise(g.kalmanObservationVariance);
+		deviceInfo->velMovingAverage().resize(g.movingAverageWindow);
+		deviceInfo->setMotionCompensationFilterKey(filterKey);
+	}
+	if (g.enabled && g.zeroPoseValid && g.refPoseValid) {
+		// reference pose at the time this pose was sampled
+		vr::HmdVector3d_t refPos;
+		vr::HmdQuaternion_t rotDiff;
+		{
+			std::lock_guard<std::mutex> lock(g.refMutex);
+			if (g.refHistory.empty()) {
+				return true;
+			}
+			g.refHistory.sample(_poseSampleTime(pose), refPos, rotDiff);
+		}
+		auto rotDiffInv = vrmath::quaternionConjugate(rotDiff);
+
 		// convert pose from driver space to app space
 		vr::HmdQuaternion_t tmpConj = vrmath::quaternionConjugate(pose.qWorldFromDriverRotation);
 		auto poseWorldPos = vrmath::quaternionRotateVector(pose.qWorldFromDriverRotation, tmpConj, pose.vecPosition, true) - pose.vecWorldFromDriverTranslation;
 		auto poseWorldRot = tmpConj * pose.qRotation;
 
 		// do motion compensation
-		auto compensatedPoseWorldPos = _motionCompensationZeroPos + vrmath::quaternionRotateVector(_motionCompensationRotDiff, _motionCompensationRotDiffInv, poseWorldPos - _motionCompensationRefPos, true);
-		auto compensatedPoseWorldRot = _motionCompensationRotDiffInv * poseWorldRot;
+		auto compensatedPoseWorldPos = g.zeroPos + vrmath::quaternionRotateVector(rotDiff, rotDiffInv, poseWorldPos - refPos, true);
+		auto compensatedPoseWorldRot = rotDiffInv * poseWorldRot;
 
 		// Velocity / Acceleration Compensation
 		vr::HmdVector3d_t compensatedPoseWorldVel;
@@ -134,36 +181,36 @@ bool MotionCompensationManager::_applyMotionCompensation(vr::DriverPose_t& pose,
 		bool setAngAccToZero = false;
 
 		auto now = std::chrono::duration_cast <std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
-		if (_motionCompensationVelAccMode == MotionCompensationVelAccMode::SetZero) {
+		if (g.velAccMode == MotionCompensationVelAccMode::SetZero) {
 			setVelToZero = true;
 			setAccToZero = true;
 			setAngVelToZero = true;
 			setAngAccToZero = true;
 
-		} else if (_motionCompensationVelAccMode == MotionCompensationVelAccMode::SubstractMotionRef) {
+		} else if (g.velAccMode == MotionCompensationVelAccMode::SubstractMotionRef) {
 			// We translate the motion ref vel/acc values into driver space and directly substract them
-			if (_motionCompensationRefVelAccValid) {
+			if (g.refVelAccValid) {
 				auto tmpRot = pose.qWorldFromDriverRotation * pose.qRotation;
 				auto tmpRotInv = vrmath::quaternionConjugate(tmpRot);
-				auto tmpPosVel = vrmath::quaternionRotateVector(tmpRot, tmpRotInv, _motionCompensationRefPosVel);
+				auto tmpPosVel = vrmath::quaternionRotateVector(tmpRot, tmpRotInv, g.refPosVel);
 				pose.vecVelocity[0] -= tmpPosVel.v[0];
 				pose.vecVelocity[1] -= tmpPosVel.v[1];
 				pose.vecVelocity[2] -= tmpPosVel.v[2];
-				auto tmpPosAcc = vrmath::quaternionRotateVector(tmpRot, tmpRotInv, _motionCompensationRefPosAcc);
+				auto tmpPosAcc = vrmath::quaternionRotateVector(tmpRot, tmpRotInv, g.refPosAcc);
 				pose.vecAcceleration[0] -= tmpPosAcc.v[0];
 				pose.vecAcceleration[1] -= tmpPosAcc.v[1];
 				pose.vecAcceleration[2] -= tmpPosAcc.v[2];
-				auto tmpRotVel = vrmath::quaternionRotateVector(tmpRot, tmpRotInv, _motionCompensationRefRotVel);
+				auto tmpRotVel = vrmath::quaternionRotateVector(tmpRot, tmpRotInv, g.refRotVel);
 				pose.vecAngularVelocity[0] -= tmpRotVel.v[0];
 				pose.vecAngularVelocity[1] -= tmpRotVel.v[1];
 				pose.vecAngularVelocity[2] -= tmpRotVel.v[2];
-				auto tmpRotAcc = vrmath::quaternionRotateVector(tmpRot, tmpRotInv, _motionCompensationRefRotAcc);
+				auto tmpRotAcc = vrmath::quaternionRotateVector(tmpRot, tmpRotInv, g.refRotAcc);
 				pose.vecAngularAcceleration[0] -= tmpRotAcc.v[0];
 				pose.vecAngularAcceleration[1] -= tmpRotAcc.v[1];
 				pose.vecAngularAcceleration[2] -= tmpRotAcc.v[2];
 			}
 
-		} else if (_motionCompensationVelAccMode == MotionCompensationVelAccMode::KalmanFilter) {
+		} else if (g.velAccMode == MotionCompensationVelAccMode::KalmanFilter) {
 			// The Kalman filter uses app space coordinates
 			auto lastTime = deviceInfo->getLastPoseTime();
 			if (lastTime >= 0.0) {
@@ -199,8 +246,8 @@ bool MotionCompensationManager::_applyMotionCompensation(vr::DriverPose_t& pose,
 					{ 0.0, 0.0, 0.0 },
 					{ { 0.0, 0.0 },{ 0.0, 0.0 } }
 				);
-				deviceInfo->kalmanFilter().setProcessNoise(m_motionCompensationKalmanProcessVariance);
-				deviceInfo->kalmanFilter().setObservationNoise(m_motionCompensationKalmanObservationVariance);
+				deviceInfo->kalmanFilter().setProcessNoise(g.kalmanProcessVariance);
+				deviceInfo->kalmanFilter().setObservationNoise(g.kalmanObservationVariance);
 				// Kalman Filter is not ready yet, so set everything to zero
 				setVelToZero = true;
 				setAccToZero = true;
@@ -208,7 +255,7 @@ bool MotionCompensationManager::_applyMotionCompensation(vr::DriverPose_t& pose,
 				setAngAccToZero = true;
 			}
 
-		} else if (_motionCompensationVelAccMode == MotionCompensationVelAccMode::LinearApproximation) {
+		} else if (g.velAccMode == MotionCompensationVelAccMode::LinearApproximation) {
 			// Linear approximation uses driver space coordinates
 			if (deviceInfo->lastDriverPoseValid()) {
 				auto& lastPose = deviceInfo->lastDriverPose();
@@ -302,11 +349,16 @@ bool MotionCompensationManager::_applyMotionCompensation(vr::DriverPose_t& pose,
 
 
 void MotionCompensationManager::runFrame() {
-	if (_motionCompensationEnabled && _motionCompensationStatus == MotionCompensationStatus::WaitingForZeroRef) {
-		_motionCompensationZeroRefTimeout++;
-		if (_motionCompensationZeroRefTimeout >= _motionCompensationZeroRefTimeoutMax) {
-			_motionCompensationRefDevice->setDefaultMode();
-			m_parent->sendReplySetMotionCompensationMode(false);
+	if (!isMotionCompensationEnabled()) {
+		return;
+	}
+	for (auto& g : _groups) {
+		if (g.enabled && g.status == MotionCompensationStatus::WaitingForZeroRef) {
+			g.zeroRefTimeout++;
+			if (g.zeroRefTimeout >= _motionCompensationZeroRefTimeoutMax && g.refDevice) {
+				g.refDevice->setDefaultMode();
+				m_parent->sendReplySetMotionCompensationMode(false);
+			}
 		}
 	}
 }
@@ -1,9 +1,12 @@
 #pragma once
 
+#include <mutex>
+#include <atomic>
 #include <openvr_driver.h>
 #include <vrinputemulator_types.h>
 #include <openvr_math.h>
 #include "../logging.h"
+#include "utils/MotionCompensationRefHistory.h"
 
 
 
@@ -24,58 +27,84 @@ enum class MotionCompensationStatus : uint32_t {
 };
 
 
+/**
+* Motion compensation in up to maxMotionCompensationGroups independent groups (e.g. several motion seats in one tracked space).
+*
+* Every group has its own reference device (the device in motion compensation mode), zero pose, vel/acc mode and filter
+* parameters. Every other device is compensated by the group it is assigned to (group 0 unless assigned otherwise).
+* All group arguments have to be valid group ids.
+*/
 class MotionCompensationManager {
 public:
 	MotionCompensationManager(ServerDriver* parent) : m_parent(parent) {}
 
-	void enableMotionCompensation(bool enable);
-	MotionCompensationStatus motionCompensationStatus() { return _motionCompensationStatus; }
-	void _setMotionCompensationStatus(MotionCompensationStatus status) { _motionCompensationStatus = status; }
-	void setMotionCompensationRefDevice(DeviceManipulationHandle* device);
-	DeviceManipulationHandle* getMotionCompensationRefDevice();
-	void setMotionCompensationVelAccMode(MotionCompensationVelAccMode velAccMode);
-	double motionCompensationKalmanProcessVariance() { return m_motionCompensationKalmanProcessVariance; }
-	void setMotionCompensationKalmanProcessVariance(double variance);
-	double motionCompensationKalmanObservationVariance() { return m_motionCompensationKalmanObservationVariance; }
-	void setMotionCompensationKalmanObservationVariance(double variance);
-	double motionCompensationMovingAverageWindow() { return m_motionCompensationMovingAverageWindow; }
-	void setMotionCompensationMovingAverageWindow(unsigned window);
-	void _disableMotionCompensationOnAllDevices();
-	bool _isMotionCompensationZeroPoseValid();
-	void _setMotionCompensationZeroPose(const vr::DriverPose_t& pose);
-	void _updateMotionCompensationRefPose(const vr::DriverPose_t& pose);
+	void enableMotionCompensation(uint32_t group, bool enable);
+	bool isMotionCompensationEnabled() const { return _enabledGroups.load(std::memory_order_relaxed) != 0; } // In any group
+	/** Lock-free, the pose pipelines check it on every pose (also accepts motionCompensationGroupNone) */
+	bool isMotionCompensationEnabled(uint32_t group) const { return group < maxMotionCompensationGroups && (_enabledGroups.load(std::memory_order_relaxed) & (1u << group)) != 0; }
+	MotionCompensationStatus motionCompensationStatus(uint32_t group) { return _groups[group].status; }
+	void _setMotionCompensationStatus(uint32_t group, MotionCompensationStatus status);
+	void setMotionCompensationRefDevice(uint32_t group, DeviceManipulationHandle* device);
+	DeviceManipulationHandle* getMotionCompensationRefDevice(uint32_t group);
+	void setMotionCompensationVelAccMode(uint32_t group, MotionCompensationVelAccMode velAccMode);
+	double motionCompensationKalmanProcessVariance(uint32_t group) { return _groups[group].kalmanProcessVariance; }
+	void setMotionCompensationKalmanProcessVariance(uint32_t group, double variance);
+	double motionCompensationKalmanObservationVariance(uint32_t group) { return _groups[group].kalmanObservationVariance; }
+	void setMotionCompensationKalmanObservationVariance(uint32_t group, double variance);
+	double motionCompensationMovingAverageWindow(uint32_t group) { return _groups[group].movingAverageWindow; }
+	void setMotionCompensationMovingAverageWindow(uint32_t group, unsigned window);
+	void _disableMotionCompensationOnAllDevices(uint32_t group);
+	bool _isMotionCompensationZeroPoseValid(uint32_t group);
+	void _setMotionCompensationZeroPose(uint32_t group, const vr::DriverPose_t& pose);
+	void _updateMotionCompensationRefPose(uint32_t group, const vr::DriverPose_t& pose);
+	/** Compensates pose with the group deviceInfo is assigned to. Runs on the pose hook of deviceInfo, which is
+	* also where the device picks up a new group or new filter settings of its group */
 	bool _applyMotionCompensation(vr::DriverPose_t& pose, DeviceManipulationHandle* deviceInfo);
 
 	void runFrame();
 
+	// Sample time of a pose in seconds, the time base of the reference history
+	static double _poseSampleTime(const vr::DriverPose_t& pose);
+
 private:
+	struct Group {
+		bool enabled = false;
+		DeviceManipulationHandle* refDevice = nullptr;
+		MotionCompensationStatus status = MotionCompensationStatus::WaitingForZeroRef;
+		uint32_t zeroRefTimeout = 0;
+		MotionCompensationVelAccMode velAccMode = MotionCompensationVelAccMode::Disabled;
+		std::atomic<double> kalmanProcessVariance { 0.1 };
+		std::atomic<double> kalmanObservationVariance { 0.1 };
+		std::atomic<unsigned> movingAverageWindow { 3 };
+		// Bumped whenever the filter settings of the devices change, every device applies them with its next pose
+		std::atomic<uint32_t> filterSettingsGeneration { 0 };
+
+		bool zeroPoseValid = false;
+		vr::HmdVector3d_t zeroPos;
+		vr::HmdQuaternion_t zeroRot;
+
+		// Reference poses arrive asynchronously to the compensated devices (other driver threads, other rates)
+		std::mutex refMutex;
+		bool refPoseValid = false;
+		MotionCompensationRefHistory refHistory;
+
+		// Calculated once per reference update (SubstractMotionRef mode)
+		bool refVelAccValid = false;
+		vr::HmdVector3d_t refPosVel;
+		vr::HmdVector3d_t refPosAcc;
+		vr::HmdVector3d_t refRotVel;
+		vr::HmdVector3d_t refRotAcc;
+	};
+
+	/** Calls code for every device assigned to group */
+	template<typename F> void _forEachDeviceInGroup(uint32_t group, F code);
+
 	ServerDriver* m_parent;
 
-	bool _motionCompensationEnabled = false;
-	DeviceManipulationHandle* _motionCompensationRefDevice = nullptr;
-	MotionCompensationStatus _motionCompensationStatus = MotionCompensationStatus::WaitingForZeroRef;
 	constexpr static uint32_t _motionCompensationZeroRefTimeoutMax = 20;
-	uint32_t _motionCompensationZeroRefTimeout = 0;
-	MotionCompensationVelAccMode _motionCompensationVelAccMode = MotionCompensationVelAccMode::Disabled;
-	double m_motionCompensationKalmanProcessVariance = 0.1;
-	double m_motionCompensationKalmanObservationVariance = 0.1;
-	unsigned m_motionCompensationMovingAverageWindow = 3;
-
-	bool _motionCompensationZeroPoseValid = false;
-	vr::HmdVector3d_t _motionCompensationZeroPos;
-	vr::HmdQuaternion_t _motionCompensationZeroRot;
-
-	bool _motionCompensationRefPoseValid = false;
-	vr::HmdVector3d_t _motionCompensationRefPos;
-	vr::HmdQuaternion_t _motionCompensationRotDiff;
-	vr::HmdQuaternion_t _motionCompensationRotDiffInv;
-
-	bool _motionCompensationRefVelAccValid = false;
-	vr::HmdVector3d_t _motionCompensationRefPosVel;
-	vr::HmdVector3d_t _motionCompensationRefPosAcc;
-	vr::HmdVector3d_t _motionCompensationRefRotVel;
-	vr::HmdVector3d_t _motionCompensationRefRotAcc;
+	Group _groups[maxMotionCompensationGroups];
+	std::atomic<uint32_t> _enabledGroups { 0 }; // Bit mask
 };
 
 }
-}
\ No newline at end of file
+}
@@ -0,0 +1,160 @@
+#include "AnalogFilterPipeline.h"
+
+#include <cmath>
+#include <algorithm>
+#include <openvr_math.h>
+
+// driver namespace
+namespace vrinputemulator {
+namespace driver {
+
+
+void AnalogFilterPipeline::configure(const AnalogInputRemapping& remapping) {
+	static const AnalogFilterStageType defaultStages[] = {
+		AnalogFilterStageType::Deadzone, AnalogFilterStageType::ResponseCurve, AnalogFilterStageType::TouchpadEmulation
+	};
+	auto& binding = remapping.binding;
+	const AnalogFilterStageType* stages = defaultStages;
+	uint32_t stageCount = 3;
+	if (!remapping.valid) {
+		stageCount = 0;
+	} else if (binding.filterStageCount > 0) {
+		stages = binding.filterStages;
+		stageCount = std::min(binding.filterStageCount, maxAnalogFilterStages);
+	}
+	_stageCount = 0;
+	_touchpadEmulationMode = 0;
+	_smoothingFactor = std::min(std::max(binding.smoothingFactor, 0.0f), 0.99f);
+	uint32_t tableCount = 0;
+	uint32_t seen = 0;
+	for (uint32_t i = 0; i < stageCount; ++i) {
+		auto type = stages[i];
+		if ((uint32_t)type >= maxAnalogFilterStages || (seen & (1 << (uint32_t)type))) {
+			continue; // Every stage only once
+		}
+		seen |= 1 << (uint32_t)type;
+		switch (type) {
+			case AnalogFilterStageType::Deadzone:
+				if (i + 1 < stageCount && stages[i + 1] == AnalogFilterStageType::ResponseCurve) {
+					seen |= 1 << (uint32_t)AnalogFilterStageType::ResponseCurve;
+					_tables[tableCount].compile(binding, true, true);
+					++i;
+				} else {
+					_tables[tableCount].compile(binding, true, false);
+				}
+				if (!_tables[tableCount].isIdentity()) {
+					_stages[_stageCount++] = { StageOp::Table, (uint8_t)tableCount++ };
+				}
+				break;
+			case AnalogFilterStageType::ResponseCurve:
+				_tables[tableCount].compile(binding, false, true);
+				if (!_tables[tableCount].isIdentity()) {
+					_stages[_stageCount++] = { StageOp::Table, (uint8_t)tableCount++ };
+				}
+				break;
+			case AnalogFilterStageType::Smoothing:
+				if (_smoothingFactor > 0.0f) {
+					_stages[_stageCount++] = { StageOp::Smoothing, 0 };
+				}
+				break;
+			case AnalogFilterStageType::TouchpadEmulation:
+				_touchpadEmulationMode = binding.touchpadEmulationMode;
+				break;
+		}
+	}
+}
+
+
+void AnalogFilterPipeline::filterInput(uint32_t dimensions, const vr::VRControllerAxis_t& value, vr::VRControllerAxis_t& result) {
+	// Smoothing only advances on input, so it must not lag behind a value that does not change anymore
+	bool settled[2] = {
+		(dimensions & 1) && (value.x == 0.0f || value.x == _state.input[0]),
+		(dimensions & 2) && (value.y == 0.0f || value.y == _state.input[1])
+	};
+	if (dimensions & 1) {
+		_state.input[0] = value.x;
+	}
+	if (dimensions & 2) {
+		_state.input[1] = value.y;
+	}
+	float v[2] = { _state.input[0], _state.input[1] };
+	for (uint32_t i = 0; i < _stageCount; ++i) {
+		auto& stage = _stages[i];
+		if (stage.op == StageOp::Table) {
+			auto& table = _tables[stage.table];
+			if (dimensions == 3 || table.isRadial()) {
+				table.apply(v[0], v[1]);
+			} else {
+				auto d = dimensions == 1 ? 0 : 1;
+				v[d] = table.apply(v[d]);
+			}
+		} else {
+			for (uint32_t d = 0; d < 2; ++d) {
+				if (settled[d]) {
+					_state.smoothed[d] = v[d];
+				} else if (dimensions & (1 << d)) {
+					_state.smoothed[d] += (v[d] - _state.smoothed[d]) * (1.0f - _smoothingFactor);
+					v[d] = _state.smoothed[d];
+				}
+			}
+		}
+	}
+	result.x = v[0];
+	result.y = v[1];
+}
+
+
+bool AnalogFilterPipeline::filterOutput(uint32_t dimensions, const vr::VRControllerAxis_t& value, vr::VRControllerAxis_t& result, bool touchpadEmulationEnabled) {
+	auto mode = touchpadEmulationEnabled ? _touchpadEmulationMode : 0;
+	auto& lastSeen = _state.lastSeen;
+	auto& lastSent = _state.lastSent;
+	bool sendNeutral = false;
+	result = value;
+	if (mode == 1) {
+		if ((dimensions & 1) && value.x != 0.0f && vrmath::signum(value.x) == vrmath::signum(lastSent.x) && std::abs(value.x) < std::abs(lastSent.x)) {
+			result.x = lastSent.x;
+		}
+		if ((dimensions & 2) && value.y != 0.0f && vrmath::signum(value.y) == vrmath::signum(lastSent.y) && std::abs(value.y) < std::abs(lastSent.y)) {
+			result.y = lastSent.y;
+		}
+	} else if (mode == 2) {
+		// Joystick was already in neutral position but we haven't send it yet, and now it moved away from neutral position
+		// => send neutral position before we do anything else since some menus use this information to reset input handling.
+		bool moved = ((dimensions & 1) && value.x != 0.0f) || ((dimensions & 2) && value.y != 0.0f);
+		if (lastSeen.x == 0.0f && lastSeen.y == 0.0f && (lastSent.x != 0.0f || lastSent.y != 0.0f) && moved) {
+			sendNeutral = true;
+			lastSent = { 0.0f, 0.0f };
+		}
+		if ((dimensions & 1) && (value.x == 0.0f || (vrmath::signum(value.x) == vrmath::signum(lastSent.x) && std::abs(value.x) < std::abs(lastSent.x)))) {
+			result.x = lastSent.x;
+		}
+		if ((dimensions & 2) && (value.y == 0.0f || (vrmath::signum(value.y) == vrmath::signum(lastSent.y) && std::abs(value.y) < std::abs(lastSent.y)))) {
+			result.y = lastSent.y;
+		}
+	}
+	if (dimensions & 1) {
+		lastSeen.x = value.x;
+		lastSent.x = result.x;
+	}
+	if (dimensions & 2) {
+		lastSeen.y = value.y;
+		lastSent.y = result.y;
+	}
+	return sendNeutral;
+}
+
+
+void AnalogFilterPipeline::setSent(uint32_t dimensions, const vr::VRControllerAxis_t& value) {
+	if (dimensions & 1) {
+		_state.lastSeen.x = value.x;
+		_state.lastSent.x = value.x;
+	}
+	if (dimensions & 2) {
+		_state.lastSeen.y = value.y;
+		_state.lastSent.y = value.y;
+	}
+}
+
+
+}
+}
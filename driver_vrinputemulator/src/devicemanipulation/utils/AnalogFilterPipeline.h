@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdint.h>
+#include <openvr_driver.h>
+#include <vrinputemulator_types.h>
+#include "AnalogResponseTable.h"
+
+// driver namespace
+namespace vrinputemulator {
+namespace driver {
+
+// Everything the filter stages of one axis remember between updates
+struct AnalogFilterState {
+	float input[2] = { 0.0f, 0.0f }; // Last input per dimension, scalar components only deliver one dimension per update
+	float smoothed[2] = { 0.0f, 0.0f };
+	vr::VRControllerAxis_t lastSeen = { 0.0f, 0.0f }; // Last value before touchpad emulation
+	vr::VRControllerAxis_t lastSent = { 0.0f, 0.0f };
+};
+
+// Filter stages of one axis (deadzone -> curve -> smoothing -> touchpad emulation, or the order of the binding).
+// The legacy axis path and the scalar component path both feed it, the axis path with both dimensions at once,
+// the scalar path with the one dimension that changed (dimensions is a bit mask, 1 .. x, 2 .. y).
+class AnalogFilterPipeline {
+public:
+	void configure(const AnalogInputRemapping& remapping);
+
+	// Deadzone, curve and smoothing stages, on the axis the input comes from. Smoothing snaps to its target when
+	// the input is released (0) or repeated unchanged.
+	void filterInput(uint32_t dimensions, const vr::VRControllerAxis_t& value, vr::VRControllerAxis_t& result);
+
+	// Touchpad emulation, on the axis the value is sent to. Returns true when a neutral update has to be sent before result.
+	bool filterOutput(uint32_t dimensions, const vr::VRControllerAxis_t& value, vr::VRControllerAxis_t& result, bool touchpadEmulationEnabled);
+
+	// Records a value that has been sent without going through filterOutput
+	void setSent(uint32_t dimensions, const vr::VRControllerAxis_t& value);
+
+	const AnalogFilterState& state() const { return _state; }
+
+private:
+	enum class StageOp : uint8_t {
+		Table,
+		Smoothing
+	};
+
+	struct Stage {
+		StageOp op;
+		uint8_t table;
+	};
+
+	uint32_t _stageCount = 0;
+	Stage _stages[maxAnalogFilterStages];
+	AnalogResponseTable _tables[2]; // Adjacent deadzone and curve stages share one table
+	float _smoothingFactor = 0.0f;
+	unsigned _touchpadEmulationMode = 0;
+	AnalogFilterState _state;
+};
+
+}
+}
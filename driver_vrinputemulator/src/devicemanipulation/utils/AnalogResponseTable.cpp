@@ -0,0 +1,118 @@
+#include "AnalogResponseTable.h"
+
+#include <cmath>
+#include <algorithm>
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VRINPUTEMULATOR_ANALOG_SSE2
+#include <emmintrin.h>
+#endif
+
+// driver namespace
+namespace vrinputemulator {
+namespace driver {
+
+
+void AnalogResponseTable::compile(const AnalogBinding& binding, bool withDeadzone, bool withCurve) {
+	bool deadzone = withDeadzone && binding.lowerDeadzone < binding.upperDeadzone && (binding.lowerDeadzone > 0.0f || binding.upperDeadzone < 1.0f);
+	AnalogResponseCurve linear;
+	const AnalogResponseCurve& curve = withCurve ? binding.responseCurve : linear;
+	_identity = !deadzone && curve.type == AnalogResponseCurveType::Linear;
+	_radial = binding.deadzoneMode == AnalogDeadzoneMode::Radial;
+	auto zone = binding.upperDeadzone - binding.lowerDeadzone;
+	for (uint32_t i = 0; i <= tableSize; ++i) {
+		float value = (float)i / (float)tableSize;
+		if (deadzone) {
+			// Same mapping the deadzones had before they were compiled into a table
+			value = (value - binding.lowerDeadzone) * (1.0f / zone) + binding.lowerDeadzone;
+			value = std::min(std::max(value, 0.0f), 1.0f);
+		}
+		_table[i] = std::min(std::max(_curve(curve, value), 0.0f), 1.0f);
+	}
+	_table[tableSize + 1] = _table[tableSize];
+}
+
+
+float AnalogResponseTable::_curve(const AnalogResponseCurve& curve, float value) {
+	switch (curve.type) {
+		case AnalogResponseCurveType::Exponential:
+			return std::pow(value, std::max(curve.exponent, 0.01f));
+		case AnalogResponseCurveType::SCurve: {
+			auto weight = std::min(std::max(curve.exponent, 0.0f), 1.0f);
+			auto smooth = value * value * (3.0f - 2.0f * value);
+			return value + (smooth - value) * weight;
+		}
+		case AnalogResponseCurveType::PiecewiseLinear: {
+			float lastIn = 0.0f;
+			float lastOut = 0.0f;
+			auto count = std::min(curve.pointCount, maxAnalogResponseCurvePoints);
+			for (uint32_t i = 0; i <= count; ++i) {
+				float in = i < count ? curve.points[i][0] : 1.0f;
+				float out = i < count ? curve.points[i][1] : 1.0f;
+				if (in <= lastIn) {
+					continue; // Points have to be sorted, ignore the rest
+				} else if (value <= in) {
+					return lastOut + (out - lastOut) * (value - lastIn) / (in - lastIn);
+				}
+				lastIn = in;
+				lastOut = out;
+			}
+			return lastOut;
+		}
+		default:
+			return value;
+	}
+}
+
+
+float AnalogResponseTable::_lookup(float magnitude) const {
+	if (!(magnitude < 1.0f)) { // also catches NaN
+		return _table[tableSize];
+	}
+	float pos = magnitude * (float)tableSize;
+	auto index = (uint32_t)pos;
+	float fraction = pos - (float)index;
+	return _table[index] + (_table[index + 1] - _table[index]) * fraction;
+}
+
+
+float AnalogResponseTable::apply(float value) const {
+	auto result = _lookup(std::fabs(value));
+	return value < 0.0f ? -result : result;
+}
+
+
+void AnalogResponseTable::apply(float& x, float& y) const {
+	if (_radial) {
+		auto length = std::sqrt(x * x + y * y);
+		if (length > 0.0f) {
+			auto scale = _lookup(length) / length;
+			x *= scale;
+			y *= scale;
+		}
+		return;
+	}
+#if defined(VRINPUTEMULATOR_ANALOG_SSE2)
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+	__m128 values = _mm_set_ps(0.0f, 0.0f, y, x);
+	__m128 signs = _mm_and_ps(values, signMask);
+	// _mm_min_ps returns the second operand for NaN, so NaN ends up at the end of the table
+	__m128 magnitudes = _mm_min_ps(_mm_andnot_ps(signMask, values), _mm_set1_ps(1.0f));
+	__m128 positions = _mm_mul_ps(magnitudes, _mm_set1_ps((float)tableSize));
+	__m128i indices = _mm_cvttps_epi32(positions);
+	__m128 fractions = _mm_sub_ps(positions, _mm_cvtepi32_ps(indices));
+	int ix = _mm_cvtsi128_si32(indices);
+	int iy = _mm_cvtsi128_si32(_mm_shuffle_epi32(indices, 1));
+	__m128 lower = _mm_set_ps(0.0f, 0.0f, _table[iy], _table[ix]);
+	__m128 upper = _mm_set_ps(0.0f, 0.0f, _table[iy + 1], _table[ix + 1]);
+	__m128 results = _mm_or_ps(_mm_add_ps(lower, _mm_mul_ps(_mm_sub_ps(upper, lower), fractions)), signs);
+	x = _mm_cvtss_f32(results);
+	y = _mm_cvtss_f32(_mm_shuffle_ps(results, results, 1));
+#else
+	x = apply(x);
+	y = apply(y);
+#endif
+}
+
+
+}
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdint.h>
+#include <openvr_driver.h>
+#include <vrinputemulator_types.h>
+
+// driver namespace
+namespace vrinputemulator {
+namespace driver {
+
+// Deadzones and response curve of an analog binding, compiled into a lookup table over the input magnitude.
+// Compiling happens when the remapping is set, applying it is a table lookup plus a linear interpolation.
+class AnalogResponseTable {
+public:
+	static const uint32_t tableSize = 256;
+
+	// withDeadzone/withCurve select which parts of the binding go into the table
+	void compile(const AnalogBinding& binding, bool withDeadzone = true, bool withCurve = true);
+
+	// True when the binding neither has deadzones nor a curve
+	bool isIdentity() const { return _identity; }
+	bool isRadial() const { return _radial; }
+
+	// One axis value in -1.0 .. 1.0 (axial mode), keeps the sign
+	float apply(float value) const;
+
+	// Both axes at once, radial or axial depending on the binding (axial mode uses SSE2 when available)
+	void apply(float& x, float& y) const;
+
+private:
+	float _lookup(float magnitude) const;
+	static float _curve(const AnalogResponseCurve& curve, float value);
+
+	bool _identity = true;
+	bool _radial = false;
+	alignas(16) float _table[tableSize + 2]; // Two extra entries so that the interpolation never needs a bounds check
+};
+
+}
+}
@@ -0,0 +1,62 @@
+#include "MotionCompensationRefHistory.h"
+
+#include <algorithm>
+#include <openvr_math.h>
+
+// driver namespace
+namespace vrinputemulator {
+namespace driver {
+
+
+// Device samples newer than the newest reference sample are compensated against the extrapolated reference,
+// but never further than this (the reference may have stopped tracking)
+static const double maxExtrapolation = 0.05;
+
+
+void MotionCompensationRefHistory::push(double time, const vr::HmdVector3d_t& position, const vr::HmdQuaternion_t& rotDiff) {
+	if (_count > 0 && time <= _entries[_newest].time) {
+		_entries[_newest] = { _entries[_newest].time, position, rotDiff };
+		return;
+	}
+	_newest = (_newest + 1) % capacity;
+	_entries[_newest] = { time, position, rotDiff };
+	_count = std::min(_count + 1, (uint32_t)capacity);
+}
+
+
+void MotionCompensationRefHistory::_interpolate(const Entry& from, const Entry& to, double time, vr::HmdVector3d_t& position, vr::HmdQuaternion_t& rotDiff) {
+	auto t = (time - from.time) / (to.time - from.time);
+	position = from.position + (to.position - from.position) * t;
+	rotDiff = vrmath::quaternionSlerp(from.rotDiff, to.rotDiff, t);
+}
+
+
+void MotionCompensationRefHistory::sample(double time, vr::HmdVector3d_t& position, vr::HmdQuaternion_t& rotDiff) const {
+	auto& newest = _entries[_newest];
+	if (time >= newest.time) {
+		if (_count < 2) {
+			position = newest.position;
+			rotDiff = newest.rotDiff;
+		} else {
+			auto& previous = _entries[(_newest + capacity - 1) % capacity];
+			_interpolate(previous, newest, std::min(time, newest.time + maxExtrapolation), position, rotDiff);
+		}
+		return;
+	}
+	// Device samples are usually close to the newest reference sample, so search backwards
+	auto later = _newest;
+	for (uint32_t i = 1; i < _count; ++i) {
+		auto index = (_newest + capacity - i) % capacity;
+		if (_entries[index].time <= time) {
+			_interpolate(_entries[index], _entries[later], time, position, rotDiff);
+			return;
+		}
+		later = index;
+	}
+	position = _entries[later].position;
+	rotDiff = _entries[later].rotDiff;
+}
+
+
+}
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdint.h>
+#include <openvr_driver.h>
+
+// driver namespace
+namespace vrinputemulator {
+namespace driver {
+
+// Short history of motion compensation reference poses (app space position and rotation difference to the zero pose),
+// so devices can be compensated against the reference at their own sample time instead of the newest reference pose.
+// Rotation differences are stored instead of rotations: slerp(a * c, b * c, t) == slerp(a, b, t) * c, so the
+// difference only has to be calculated once per reference update.
+class MotionCompensationRefHistory {
+public:
+	static const uint32_t capacity = 32;
+
+	void clear() { _count = 0; }
+	bool empty() const { return _count == 0; }
+
+	// time is the sample time in seconds, samples have to be pushed in order (an older sample replaces the newest one)
+	void push(double time, const vr::HmdVector3d_t& position, const vr::HmdQuaternion_t& rotDiff);
+
+	// Reference at the given time: interpolated between the samples around it, extrapolated from the newest two samples
+	// (for at most maxExtrapolation seconds) or the oldest sample when time lies before the history
+	void sample(double time, vr::HmdVector3d_t& position, vr::HmdQuaternion_t& rotDiff) const;
+
+private:
+	struct Entry {
+		double time;
+		vr::HmdVector3d_t position;
+		vr::HmdQuaternion_t rotDiff;
+	};
+
+	static void _interpolate(const Entry& from, const Entry& to, double time, vr::HmdVector3d_t& position, vr::HmdQuaternion_t& rotDiff);
+
+	Entry _entries[capacity];
+	uint32_t _newest = 0;
+	uint32_t _count = 0;
+};
+
+}
+}
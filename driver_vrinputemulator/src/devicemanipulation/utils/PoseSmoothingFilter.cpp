@@ -0,0 +1,84 @@
+#include "PoseSmoothingFilter.h"
+
+#include <cmath>
+#include <openvr_math.h>
+
+// driver namespace
+namespace vrinputemulator {
+namespace driver {
+
+
+// Gaps longer than this (tracking loss, device sleeping) restart the filter instead of smoothing across them
+static const double maxSampleGap = 0.5;
+
+
+void PoseSmoothingFilter::configure(const PoseSmoothingSettings& settings) {
+	_settings = settings;
+	if (_settings.minCutoff <= 0.0) {
+		_settings.minCutoff = 0.01;
+	}
+	if (_settings.derivativeCutoff <= 0.0) {
+		_settings.derivativeCutoff = 0.01;
+	}
+	if (_settings.beta < 0.0) {
+		_settings.beta = 0.0;
+	}
+	_initialized = false;
+}
+
+
+double PoseSmoothingFilter::_alpha(double cutoff, double dt) {
+	// Smoothing factor of a first order low-pass with the given cutoff frequency, 1 / (1 + tau / dt)
+	auto tau = 1.0 / (2.0 * 3.14159265358979323846 * cutoff);
+	return 1.0 / (1.0 + tau / dt);
+}
+
+
+void PoseSmoothingFilter::filter(vr::DriverPose_t& pose, double time) {
+	auto dt = time - _lastTime;
+	if (!_initialized || dt > maxSampleGap || !pose.poseIsValid) {
+		for (unsigned i = 0; i < 3; ++i) {
+			_position[i] = pose.vecPosition[i];
+			_velocity[i] = 0.0;
+		}
+		_rotation = pose.qRotation;
+		_angularSpeed = 0.0;
+		_lastTime = time;
+		_initialized = pose.poseIsValid;
+		return;
+	}
+	if (dt <= 0.0) {
+		// Same sample time as the last pose, repeat the last output
+		for (unsigned i = 0; i < 3; ++i) {
+			pose.vecPosition[i] = _position[i];
+		}
+		pose.qRotation = _rotation;
+		return;
+	}
+	_lastTime = time;
+
+	// Position
+	auto derivativeAlpha = _alpha(_settings.derivativeCutoff, dt);
+	double speed2 = 0.0;
+	for (unsigned i = 0; i < 3; ++i) {
+		auto v = (pose.vecPosition[i] - _position[i]) / dt;
+		_velocity[i] += derivativeAlpha * (v - _velocity[i]);
+		speed2 += _velocity[i] * _velocity[i];
+	}
+	auto alpha = _alpha(_settings.minCutoff + _settings.beta * std::sqrt(speed2), dt);
+	for (unsigned i = 0; i < 3; ++i) {
+		_position[i] += alpha * (pose.vecPosition[i] - _position[i]);
+		pose.vecPosition[i] = _position[i];
+	}
+
+	// Orientation
+	auto angularSpeed = vrmath::quaternionAngle(_rotation, pose.qRotation) / dt;
+	_angularSpeed += derivativeAlpha * (angularSpeed - _angularSpeed);
+	alpha = _alpha(_settings.minCutoff + _settings.beta * _angularSpeed, dt);
+	_rotation = vrmath::quaternionSlerp(_rotation, pose.qRotation, alpha);
+	pose.qRotation = _rotation;
+}
+
+
+}
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <openvr_driver.h>
+#include <vrinputemulator_types.h>
+
+// driver namespace
+namespace vrinputemulator {
+namespace driver {
+
+// Adaptive low-pass filter for device poses (One Euro filter, Casiez et al.). The cutoff frequency rises with the
+// filtered speed, so a device at rest is smoothed strongly while fast movements pass with little lag.
+// Position is filtered per component, orientation with a slerp towards the new rotation.
+class PoseSmoothingFilter {
+public:
+	void configure(const PoseSmoothingSettings& settings);
+	const PoseSmoothingSettings& settings() const { return _settings; }
+	bool enabled() const { return _settings.enabled; }
+
+	// time is the sample time in seconds (any monotonic base)
+	void filter(vr::DriverPose_t& pose, double time);
+
+	void reset() { _initialized = false; }
+
+private:
+	static double _alpha(double cutoff, double dt);
+
+	PoseSmoothingSettings _settings;
+	bool _initialized = false;
+	double _lastTime = 0.0;
+	double _position[3];
+	double _velocity[3]; // filtered derivative of the raw position
+	vr::HmdQuaternion_t _rotation;
+	double _angularSpeed; // filtered, rad/s
+};
+
+}
+}
@@ -0,0 +1,274 @@
+#include "OutputInjectionWorker.h"
+
+#include <algorithm>
+#include "../logging.h"
+#include "../platform/platform.h"
+#include "../devicemanipulation/DeviceManipulationHandle.h"
+#include "ServerDriver.h"
+
+
+// driver namespace
+namespace vrinputemulator {
+namespace driver {
+
+
+bool OutputInjectionWorker::_dueLater(const Action& lhs, const Action& rhs) {
+	return lhs.due > rhs.due || (lhs.due == rhs.due && lhs.sequence > rhs.sequence);
+}
+
+
+OutputInjectionWorker::~OutputInjectionWorker() {
+	stop();
+}
+
+
+void OutputInjectionWorker::start() {
+	if (!_thread.joinable()) {
+		_stopThread = false;
+		_scheduledActions.reserve(queueCapacity);
+		_thread = std::thread(_threadFunc, this);
+	}
+}
+
+
+void OutputInjectionWorker::stop() {
+	if (_thread.joinable()) {
+		_stopThread = true;
+		{
+			std::lock_guard<std::mutex> lock(_wakeMutex);
+			_wakeCondition.notify_one();
+		}
+		_thread.join();
+	}
+}
+
+
+bool OutputInjectionWorker::sendKeyboardInput(bool keyUp, bool shiftPressed, bool ctrlPressed, bool altPressed, uint16_t keyCode, bool sendScanCode) {
+	Action action;
+	action.type = ActionType::KeyboardInput;
+	action.keyboard.keyUp = keyUp;
+	action.keyboard.shiftPressed = shiftPressed;
+	action.keyboard.ctrlPressed = ctrlPressed;
+	action.keyboard.altPressed = altPressed;
+	action.keyboard.sendScanCode = sendScanCode;
+	action.keyboard.keyCode = keyCode;
+	return _push(action);
+}
+
+
+bool OutputInjectionWorker::sendKeyboardMacro(const KeyboardMacro& macro) {
+	Action action;
+	action.type = ActionType::KeyboardMacro;
+	action.macro = macro;
+	action.macro.stepCount = std::min(macro.stepCount, maxKeyboardMacroSteps);
+	return _push(action);
+}
+
+
+bool OutputInjectionWorker::playSound(OutputSound sound) {
+	Action action;
+	action.type = ActionType::Sound;
+	action.sound = sound;
+	return _push(action);
+}
+
+
+bool OutputInjectionWorker::playHapticWaveform(DeviceManipulationHandle* device, const HapticWaveformSegment* segments, uint32_t segmentCount) {
+	return _pushHapticWaveform(device, segments, segmentCount, false);
+}
+
+
+bool OutputInjectionWorker::vibrationCue(DeviceManipulationHandle* device, uint32_t pulseCount, uint32_t intervalMilliseconds, uint16_t pulseDurationMicroseconds) {
+	HapticWaveformSegment segments[maxHapticWaveformSegments];
+	pulseCount = std::min(pulseCount, maxHapticWaveformSegments);
+	for (uint32_t i = 0; i < pulseCount; ++i) {
+		segments[i].delayMicroseconds = i == 0 ? 0 : intervalMilliseconds * 1000;
+		segments[i].durationSeconds = ((float)pulseDurationMicroseconds) / 1E6f;
+		segments[i].frequency = 1.0f / segments[i].durationSeconds;
+		segments[i].amplitude = 1.0f;
+	}
+	return _pushHapticWaveform(device, segments, pulseCount, true);
+}
+
+
+OutputInjectionStats OutputInjectionWorker::stats() const {
+	OutputInjectionStats stats;
+	stats.executedActions = _executedActions.load(std::memory_order_relaxed);
+	stats.droppedActions = _droppedActions.load(std::memory_order_relaxed);
+	stats.maxLatenessMicroseconds = _maxLatenessMicroseconds.load(std::memory_order_relaxed);
+	return stats;
+}
+
+
+bool OutputInjectionWorker::_pushHapticWaveform(DeviceManipulationHandle* device, const HapticWaveformSegment* segments, uint32_t segmentCount, bool cue) {
+	Action action;
+	action.type = ActionType::HapticWaveform;
+	action.waveform.device = device;
+	action.waveform.cue = cue;
+	action.waveform.segmentCount = std::min(segmentCount, maxHapticWaveformSegments);
+	std::copy(segments, segments + action.waveform.segmentCount, action.waveform.segments);
+	_pendingHapticActions.fetch_add(1, std::memory_order_relaxed);
+	if (!_push(action)) {
+		_pendingHapticActions.fetch_sub(1, std::memory_order_relaxed);
+		return false;
+	}
+	return true;
+}
+
+
+bool OutputInjectionWorker::_push(Action& action) {
+	action.due = std::chrono::steady_clock::now();
+	action.sequence = 0;
+	if (!_queue.push(action)) {
+		auto dropped = _droppedActions.fetch_add(1, std::memory_order_relaxed) + 1;
+		if ((dropped & (dropped - 1)) == 0) {
+			LOG(WARNING) << "Output injection queue is full, " << dropped << " actions dropped so far";
+		}
+		return false;
+	}
+	// Pairs with the fence in _threadFunc: either the worker sees the new action or we see that it sleeps
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (_sleeping.load(std::memory_order_relaxed)) {
+		std::lock_guard<std::mutex> lock(_wakeMutex);
+		_wakeCondition.notify_one();
+	}
+	return true;
+}
+
+
+void OutputInjectionWorker::_drainQueue() {
+	Action action;
+	while (_queue.pop(action)) {
+		switch (action.type) {
+			case ActionType::KeyboardMacro: {
+				Action step;
+				step.type = ActionType::KeyboardInput;
+				step.due = action.due;
+				step.keyboard.shiftPressed = false;
+				step.keyboard.ctrlPressed = false;
+				step.keyboard.altPressed = false;
+				step.keyboard.sendScanCode = action.macro.sendScanCode;
+				for (uint32_t i = 0; i < action.macro.stepCount; ++i) {
+					step.due += std::chrono::microseconds(action.macro.steps[i].delayMicroseconds);
+					step.keyboard.keyUp = action.macro.steps[i].keyUp;
+					step.keyboard.keyCode = action.macro.steps[i].keyCode;
+					_schedule(step);
+				}
+			} break;
+			case ActionType::HapticWaveform: {
+				// The scheduled pulses take over from the queued waveform in one step
+				_pendingHapticActions.fetch_add(action.waveform.segmentCount - 1, std::memory_order_relaxed);
+				if (action.waveform.segmentCount == 0) {
+					break;
+				}
+				auto& timeline = _hapticTimelines[action.waveform.device];
+				if (action.waveform.cue && timeline.cueEnd > action.due) {
+					_pendingHapticActions.fetch_sub(action.waveform.segmentCount, std::memory_order_relaxed);
+					break; // Cue already running
+				}
+				Action step;
+				step.type = ActionType::HapticPulse;
+				step.haptic.device = action.waveform.device;
+				step.due = action.due;
+				auto& end = timeline.waveformEnd;
+				if (end > step.due) {
+					step.due = end;
+				}
+				for (uint32_t i = 0; i < action.waveform.segmentCount; ++i) {
+					auto segment = action.waveform.segments[i];
+					// Not every caller goes through the ipc validation, out of range floats must not reach the integer conversion
+					segment.durationSeconds = std::min(std::max(0.0f, segment.durationSeconds), maxHapticWaveformSegmentSeconds); // Also maps NaN to 0
+					segment.delayMicroseconds = std::min(segment.delayMicroseconds, (uint32_t)(maxHapticWaveformSegmentSeconds * 1E6f));
+					step.due += std::chrono::microseconds(segment.delayMicroseconds);
+					step.haptic.segment = segment;
+					_schedule(step);
+					auto segmentEnd = step.due + std::chrono::microseconds((long long)(segment.durationSeconds * 1E6f));
+					if (segmentEnd > end) {
+						end = segmentEnd;
+					}
+				}
+				if (action.waveform.cue) {
+					timeline.cueEnd = end;
+				}
+			} break;
+			default:
+				_schedule(action);
+				break;
+		}
+	}
+}
+
+
+void OutputInjectionWorker::_schedule(const Action& action) {
+	_scheduledActions.push_back(action);
+	_scheduledActions.back().sequence = _nextSequence++;
+	std::push_heap(_scheduledActions.begin(), _scheduledActions.end(), _dueLater);
+}
+
+
+void OutputInjectionWorker::_execute(const Action& action) {
+	switch (action.type) {
+		case ActionType::KeyboardInput:
+			platform::sendKeyboardInput(action.keyboard.keyUp, action.keyboard.shiftPressed, action.keyboard.ctrlPressed,
+				action.keyboard.altPressed, action.keyboard.keyCode, action.keyboard.sendScanCode);
+			break;
+		case ActionType::Sound:
+			if (action.sound == OutputSound::AudioCue) {
+				platform::playSound(ServerDriver::getInstallDirectory() + platform::pathSeparator + "resources" + platform::pathSeparator
+					+ "sounds" + platform::pathSeparator + "audiocue.wav");
+			}
+			break;
+		case ActionType::HapticPulse:
+			action.haptic.device->ll_sendHapticPulseEvent(action.haptic.segment.durationSeconds, action.haptic.segment.frequency, action.haptic.segment.amplitude);
+			_pendingHapticActions.fetch_sub(1, std::memory_order_relaxed);
+			break;
+		default:
+			break;
+	}
+}
+
+
+void OutputInjectionWorker::_threadFunc(OutputInjectionWorker* _this) {
+	LOG(DEBUG) << "OutputInjectionWorker::_threadFunc: thread started";
+	auto spinThreshold = std::chrono::microseconds(_spinThresholdMicroseconds);
+	auto& schedule = _this->_scheduledActions;
+	while (!_this->_stopThread) {
+		_this->_drainQueue();
+		auto now = std::chrono::steady_clock::now();
+		if (!schedule.empty() && schedule.front().due <= now) {
+			std::pop_heap(schedule.begin(), schedule.end(), _dueLater);
+			auto action = schedule.back();
+			schedule.pop_back();
+			_this->_execute(action);
+			_this->_executedActions.fetch_add(1, std::memory_order_relaxed);
+			auto lateness = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - action.due).count();
+			if (lateness > _this->_maxLatenessMicroseconds.load(std::memory_order_relaxed)) {
+				_this->_maxLatenessMicroseconds.store(lateness, std::memory_order_relaxed);
+			}
+		} else if (!schedule.empty() && schedule.front().due - now <= spinThreshold) {
+			std::this_thread::yield();
+		} else {
+			std::unique_lock<std::mutex> lock(_this->_wakeMutex);
+			_this->_sleeping.store(true, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (_this->_queue.empty() && !_this->_stopThread) {
+				if (schedule.empty()) {
+					_this->_wakeCondition.wait(lock);
+				} else {
+					_this->_wakeCondition.wait_until(lock, schedule.front().due - spinThreshold);
+				}
+			}
+			_this->_sleeping.store(false, std::memory_order_relaxed);
+		}
+	}
+	if (!schedule.empty()) {
+		LOG(INFO) << "OutputInjectionWorker: " << schedule.size() << " scheduled actions discarded";
+		schedule.clear();
+	}
+	_this->_pendingHapticActions = 0;
+	LOG(DEBUG) << "OutputInjectionWorker::_threadFunc: thread stopped";
+}
+
+
+} // end namespace driver
+} // end namespace vrinputemulator
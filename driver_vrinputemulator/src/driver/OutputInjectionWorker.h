@@ -0,0 +1,148 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <condition_variable>
+#include <openvr_driver.h>
+#include <vrinputemulator_types.h>
+#include "utils/BoundedQueue.h"
+
+
+
+// driver namespace
+namespace vrinputemulator {
+namespace driver {
+
+
+// forward declarations
+class DeviceManipulationHandle;
+
+
+enum class OutputSound : uint32_t {
+	AudioCue = 0
+};
+
+
+struct OutputInjectionStats {
+	uint64_t executedActions = 0;
+	uint64_t droppedActions = 0; // Queue was full
+	uint64_t maxLatenessMicroseconds = 0; // Largest delay between the due time and the execution of an action
+};
+
+
+/**
+* Executes all OS-side side effects of the driver (keyboard input, sounds, haptic waveforms) on its own thread.
+*
+* SendInput and PlaySound can block for milliseconds, which must not happen on SteamVR's driver thread. The hooks
+* only push a small action into a lock-free queue and return. Actions can be scheduled, keyboard macros and
+* haptic waveforms are expanded into steps with absolute due times when the worker takes them from the queue.
+* Waveforms are queued per device: a waveform starts when the previous waveform of the same device has ended.
+* The worker sleeps until shortly before the next due time and yields for the rest, so steps keep their
+* timing even with a coarse OS timer.
+*
+* The OS side is implemented by the platform layer (Win32 for the driver dll, the counting stub of
+* platform_headless.cpp for driver_testhost).
+*/
+class OutputInjectionWorker {
+public:
+	static const uint32_t queueCapacity = 256;
+
+	~OutputInjectionWorker();
+
+	void start();
+	void stop();
+
+	// All of these are safe to call from any thread, never block and return false when the action was dropped
+
+	/** Presses/releases keyCode (a Windows virtual key code) together with the given modifiers */
+	bool sendKeyboardInput(bool keyUp, bool shiftPressed, bool ctrlPressed, bool altPressed, uint16_t keyCode, bool sendScanCode);
+	/** Plays all steps of the macro, the first one immediately */
+	bool sendKeyboardMacro(const KeyboardMacro& macro);
+	bool playSound(OutputSound sound);
+	/** Plays the waveform on the given device (no redirect/swap handling), the device must outlive the worker */
+	bool playHapticWaveform(DeviceManipulationHandle* device, const HapticWaveformSegment* segments, uint32_t segmentCount);
+	/** A series of short haptic pulses on the given device, ignored while the previous cue of the device is still running */
+	bool vibrationCue(DeviceManipulationHandle* device, uint32_t pulseCount = 10, uint32_t intervalMilliseconds = 10, uint16_t pulseDurationMicroseconds = 1000);
+
+	OutputInjectionStats stats() const;
+	/** Haptic pulses are queued or scheduled, they are injected as driver events when they are due */
+	bool hapticsPending() const { return _pendingHapticActions.load(std::memory_order_relaxed) > 0; }
+
+private:
+	enum class ActionType : uint32_t {
+		KeyboardInput,
+		KeyboardMacro,
+		Sound,
+		HapticWaveform,
+		HapticPulse
+	};
+
+	struct Action {
+		ActionType type;
+		std::chrono::steady_clock::time_point due;
+		uint64_t sequence; // Keeps actions with the same due time in queue order
+		union {
+			struct {
+				bool keyUp;
+				bool shiftPressed;
+				bool ctrlPressed;
+				bool altPressed;
+				bool sendScanCode;
+				uint16_t keyCode;
+			} keyboard;
+			KeyboardMacro macro;
+			OutputSound sound;
+			struct {
+				DeviceManipulationHandle* device;
+				bool cue; // Vibration cue, skipped while another cue is running
+				uint32_t segmentCount;
+				HapticWaveformSegment segments[maxHapticWaveformSegments];
+			} waveform;
+			struct {
+				DeviceManipulationHandle* device;
+				HapticWaveformSegment segment;
+			} haptic;
+		};
+	};
+
+	/** How long before a due time the worker stops sleeping and starts yielding */
+	static const uint32_t _spinThresholdMicroseconds = 2000;
+
+	struct HapticTimeline {
+		std::chrono::steady_clock::time_point waveformEnd; // End of the last scheduled waveform
+		std::chrono::steady_clock::time_point cueEnd; // End of the last scheduled vibration cue
+	};
+
+	static bool _dueLater(const Action& lhs, const Action& rhs);
+	bool _pushHapticWaveform(DeviceManipulationHandle* device, const HapticWaveformSegment* segments, uint32_t segmentCount, bool cue);
+	bool _push(Action& action);
+	/** Moves all queued actions into the schedule, expanding macros and cues into single steps */
+	void _drainQueue();
+	void _schedule(const Action& action);
+	void _execute(const Action& action);
+	static void _threadFunc(OutputInjectionWorker* _this);
+
+	BoundedQueue<Action, queueCapacity> _queue;
+	std::vector<Action> _scheduledActions; // Min-heap on (due, sequence), only touched by the worker thread
+	uint64_t _nextSequence = 0;
+	std::map<DeviceManipulationHandle*, HapticTimeline> _hapticTimelines; // Only touched by the worker thread
+
+	std::thread _thread;
+	std::atomic<bool> _stopThread { false };
+	std::atomic<bool> _sleeping { false };
+	std::mutex _wakeMutex;
+	std::condition_variable _wakeCondition;
+
+	std::atomic<uint32_t> _pendingHapticActions { 0 }; // Queued waveforms plus scheduled haptic pulses
+	std::atomic<uint64_t> _executedActions { 0 };
+	std::atomic<uint64_t> _droppedActions { 0 };
+	std::atomic<uint64_t> _maxLatenessMicroseconds { 0 };
+};
+
+
+} // end namespace driver
+} // end namespace vrinputemulator
@@ -0,0 +1,199 @@
+#include "PosePumpWorker.h"
+
+#include <algorithm>
+#include <openvr_driver.h>
+#include "../logging.h"
+#include "../platform/platform.h"
+#include "ServerDriver.h"
+#include "VirtualDeviceDriver.h"
+
+
+// driver namespace
+namespace vrinputemulator {
+namespace driver {
+
+
+// How often the pump logs its jitter statistics
+static const auto statsLogInterval = std::chrono::seconds(60);
+
+
+PosePumpWorker::~PosePumpWorker() {
+	stop();
+}
+
+
+void PosePumpWorker::setRate(ServerDriver* driver, uint32_t rate) {
+	std::lock_guard<std::mutex> controlLock(_controlMutex);
+	if (rate != 0) {
+		rate = std::min(std::max(rate, (uint32_t)minRate), (uint32_t)maxRate);
+	}
+	if (_thread.joinable()) {
+		_stopThread = true;
+		{
+			std::lock_guard<std::mutex> lock(_wakeMutex);
+			_wakeCondition.notify_one();
+		}
+		_thread.join();
+		_clearEntries();
+	}
+	_rate = rate;
+	if (rate != 0) {
+		LOG(INFO) << "Starting pose pump with " << rate << " Hz";
+		_driver = driver;
+		_stopThread = false;
+		_devicesChanged = true;
+		_thread = std::thread(_threadFunc, this);
+	}
+}
+
+
+void PosePumpWorker::devicesChanged() {
+	_devicesChanged = true;
+	std::lock_guard<std::mutex> lock(_wakeMutex);
+	_wakeCondition.notify_one();
+}
+
+
+void PosePumpWorker::removeDevice(VirtualDeviceDriver* device) {
+	std::lock_guard<std::mutex> lock(_entriesMutex);
+	for (auto it = _entries.begin(); it != _entries.end(); ++it) {
+		if (it->device.get() == device) {
+			_entries.erase(it);
+			device->setPosePumped(false);
+			break;
+		}
+	}
+}
+
+
+PosePumpStats PosePumpWorker::stats() const {
+	PosePumpStats stats;
+	stats.sentPoses = _sentPoses.load(std::memory_order_relaxed);
+	stats.missedPeriods = _missedPeriods.load(std::memory_order_relaxed);
+	stats.maxJitterMicroseconds = _maxJitterMicroseconds.load(std::memory_order_relaxed);
+	if (stats.sentPoses > 0) {
+		stats.meanJitterMicroseconds = _jitterSumMicroseconds.load(std::memory_order_relaxed) / stats.sentPoses;
+	}
+	return stats;
+}
+
+
+void PosePumpWorker::resetStats() {
+	_sentPoses = 0;
+	_missedPeriods = 0;
+	_jitterSumMicroseconds = 0;
+	_maxJitterMicroseconds = 0;
+}
+
+
+void PosePumpWorker::_rebuildEntries() {
+	auto now = std::chrono::steady_clock::now();
+	std::vector<Entry> entries;
+	auto count = _driver->virtualDevices_getDeviceCount();
+	for (uint32_t i = 0; i < count; ++i) {
+		auto device = _driver->virtualDevices_getDeviceShared(i);
+		if (!device || !device->published() || !device->periodicPoseUpdates()) {
+			continue;
+		}
+		auto rate = device->poseRate();
+		if (rate == 0) {
+			rate = _rate;
+		}
+		Entry entry;
+		entry.device = device;
+		entry.period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / rate));
+		entry.due = now;
+		// Keep the phase of devices that were already pumped
+		for (auto& e : _entries) {
+			if (e.device == device && e.period == entry.period) {
+				entry.due = e.due;
+				break;
+			}
+		}
+		entries.push_back(entry);
+	}
+	std::lock_guard<std::mutex> lock(_entriesMutex);
+	for (auto& e : _entries) {
+		e.device->setPosePumped(false);
+	}
+	for (auto& e : entries) {
+		e.device->setPosePumped(true);
+	}
+	_entries.swap(entries);
+}
+
+
+void PosePumpWorker::_clearEntries() {
+	std::lock_guard<std::mutex> lock(_entriesMutex);
+	for (auto& e : _entries) {
+		e.device->setPosePumped(false);
+	}
+	_entries.clear();
+}
+
+
+void PosePumpWorker::_threadFunc(PosePumpWorker* _this) {
+	LOG(DEBUG) << "PosePumpWorker::_threadFunc: thread started";
+	platform::beginHighResolutionTimer();
+	auto spinThreshold = std::chrono::microseconds(_spinThresholdMicroseconds);
+	auto& entries = _this->_entries;
+	auto nextStatsLog = std::chrono::steady_clock::now() + statsLogInterval;
+	while (!_this->_stopThread) {
+		if (_this->_devicesChanged.exchange(false)) {
+			_this->_rebuildEntries();
+		}
+		auto now = std::chrono::steady_clock::now();
+		if (now >= nextStatsLog) {
+			auto stats = _this->stats();
+			LOG(INFO) << "Pose pump: " << stats.sentPoses << " poses sent, jitter mean " << stats.meanJitterMicroseconds << " us, max "
+				<< stats.maxJitterMicroseconds << " us, " << stats.missedPeriods << " missed periods";
+			nextStatsLog = now + statsLogInterval;
+		}
+		auto nextDue = std::chrono::steady_clock::time_point::max();
+		std::unique_lock<std::mutex> entriesLock(_this->_entriesMutex);
+		for (auto& e : entries) {
+			if (e.due <= now) {
+				e.device->sendPoseUpdate();
+				auto jitter = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - e.due).count();
+				_this->_sentPoses.fetch_add(1, std::memory_order_relaxed);
+				_this->_jitterSumMicroseconds.fetch_add(jitter, std::memory_order_relaxed);
+				if (jitter > _this->_maxJitterMicroseconds.load(std::memory_order_relaxed)) {
+					_this->_maxJitterMicroseconds.store(jitter, std::memory_order_relaxed);
+				}
+				e.due += e.period;
+				if (e.due <= now) {
+					// Fell behind by more than a period, do not try to catch up with a burst of sends
+					_this->_missedPeriods.fetch_add(1, std::memory_order_relaxed);
+					e.due = now + e.period;
+				}
+			}
+			nextDue = std::min(nextDue, e.due);
+		}
+		bool noEntries = entries.empty();
+		entriesLock.unlock();
+		now = std::chrono::steady_clock::now();
+		if (nextDue <= now) {
+			continue;
+		} else if (nextDue - now <= spinThreshold) {
+			std::this_thread::yield();
+		} else {
+			std::unique_lock<std::mutex> lock(_this->_wakeMutex);
+			if (!_this->_stopThread && !_this->_devicesChanged) {
+				if (noEntries) {
+					_this->_wakeCondition.wait(lock);
+				} else {
+					_this->_wakeCondition.wait_until(lock, nextDue - spinThreshold);
+				}
+			}
+		}
+	}
+	platform::endHighResolutionTimer();
+	auto stats = _this->stats();
+	LOG(INFO) << "Pose pump stopped: " << stats.sentPoses << " poses sent, jitter mean " << stats.meanJitterMicroseconds << " us, max "
+		<< stats.maxJitterMicroseconds << " us, " << stats.missedPeriods << " missed periods";
+	LOG(DEBUG) << "PosePumpWorker::_threadFunc: thread stopped";
+}
+
+
+} // end namespace driver
+} // end namespace vrinputemulator
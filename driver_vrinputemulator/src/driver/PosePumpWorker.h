@@ -0,0 +1,95 @@
+#pragma once
+
+#include <mutex>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <condition_variable>
+
+
+
+// driver namespace
+namespace vrinputemulator {
+namespace driver {
+
+
+// forward declarations
+class ServerDriver;
+class VirtualDeviceDriver;
+
+
+struct PosePumpStats {
+	uint64_t sentPoses = 0;
+	uint64_t missedPeriods = 0; // A device was more than one period late, its schedule was restarted
+	uint64_t meanJitterMicroseconds = 0; // Mean delay between the scheduled and the actual send time
+	uint64_t maxJitterMicroseconds = 0;
+};
+
+
+/**
+* Sends the poses of published virtual devices from its own thread at a fixed rate.
+*
+* RunFrame is only called at ~90 Hz, while native controllers report at ~369 Hz. The pump resends the newest
+* pose of every virtual device with periodic pose updates (plus the pose prediction of the device, if enabled)
+* at the pump rate or the device's own rate. Like the output injection worker it sleeps until shortly before
+* the next due time and yields for the rest. While the pump runs RunFrame does not send virtual device poses,
+* and the pump is the only sender of the devices it pumps: updatePose() only stores their new pose.
+*/
+class PosePumpWorker {
+public:
+	static const uint32_t minRate = 10;
+	static const uint32_t maxRate = 1000;
+
+	~PosePumpWorker();
+
+	/** rate in Hz, 0 stops the pump. Other values are clamped to minRate .. maxRate */
+	void setRate(ServerDriver* driver, uint32_t rate);
+	uint32_t rate() const { return _rate.load(std::memory_order_relaxed); }
+	bool isRunning() const { return rate() != 0; }
+	void stop() { setRate(nullptr, 0); }
+
+	/** Has to be called when a virtual device gets published or its rate changes */
+	void devicesChanged();
+	/** Stops pumping device, returns after the pump has finished its last send of it */
+	void removeDevice(VirtualDeviceDriver* device);
+
+	PosePumpStats stats() const;
+	void resetStats();
+
+private:
+	struct Entry {
+		std::shared_ptr<VirtualDeviceDriver> device;
+		std::chrono::steady_clock::duration period;
+		std::chrono::steady_clock::time_point due;
+	};
+
+	/** How long before a due time the pump stops sleeping and starts yielding */
+	static const uint32_t _spinThresholdMicroseconds = 1500;
+
+	void _rebuildEntries();
+	void _clearEntries();
+	static void _threadFunc(PosePumpWorker* _this);
+
+	ServerDriver* _driver = nullptr;
+	std::mutex _controlMutex; // Serializes setRate
+	std::atomic<uint32_t> _rate { 0 };
+	std::mutex _entriesMutex; // Held by the pump thread while it sends
+	std::vector<Entry> _entries;
+	std::atomic<bool> _devicesChanged { false };
+
+	std::thread _thread;
+	std::atomic<bool> _stopThread { false };
+	std::mutex _wakeMutex;
+	std::condition_variable _wakeCondition;
+
+	std::atomic<uint64_t> _sentPoses { 0 };
+	std::atomic<uint64_t> _missedPeriods { 0 };
+	std::atomic<uint64_t> _jitterSumMicroseconds { 0 };
+	std::atomic<uint64_t> _maxJitterMicroseconds { 0 };
+};
+
+
+} // end namespace driver
+} // end namespace vrinputemulator
@@ -19,6 +19,9 @@ ServerDriver::ServerDriver() : m_motionCompensation(this) {
 	singleton = this;
 	memset(m_openvrIdToVirtualDeviceMap, 0, sizeof(VirtualDeviceDriver*) * vr::k_unMaxTrackedDeviceCount);
 	memset(_openvrIdToDeviceManipulationHandleMap, 0, sizeof(DeviceManipulationHandle*) * vr::k_unMaxTrackedDeviceCount);
+	for (auto& m : _deviceProcessingMask) {
+		m = 0;
+	}
 }
 
 
@@ -28,8 +31,22 @@ ServerDriver::~ServerDriver() {
 
 
 bool ServerDriver::hooksTrackedDevicePoseUpdated(void* serverDriverHost, int version, uint32_t& unWhichDevice, vr::DriverPose_t& newPose, uint32_t& unPoseStructSize) {
+	if (m_hookRecorder.isActive()) {
+		m_hookRecorder.recordPoseUpdate(unWhichDevice, newPose);
+	}
 	if (_openvrIdToDeviceManipulationHandleMap[unWhichDevice] && _openvrIdToDeviceManipulationHandleMap[unWhichDevice]->isValid()) {
-		return _openvrIdToDeviceManipulationHandleMap[unWhichDevice]->handlePoseUpdate(unWhichDevice, newPose, unPoseStructSize);
+		bool retval;
+		if (shmCommunicator.isPoseTelemetryActive()) {
+			vr::DriverPose_t rawPose = newPose;
+			retval = _openvrIdToDeviceManipulationHandleMap[unWhichDevice]->handlePoseUpdate(unWhichDevice, newPose, unPoseStructSize);
+			shmCommunicator.writePoseTelemetry(unWhichDevice, rawPose, newPose, retval);
+		} else {
+			retval = _openvrIdToDeviceManipulationHandleMap[unWhichDevice]->handlePoseUpdate(unWhichDevice, newPose, unPoseStructSize);
+		}
+		if (retval && shmCommunicator.isDevicePoseMirrorActive()) {
+			shmCommunicator.updateSharedDevicePose(unWhichDevice, newPose);
+		}
+		return retval;
 	}
 	return true;
 }
@@ -37,6 +54,9 @@ bool ServerDriver::hooksTrackedDevicePoseUpdated(void* serverDriverHost, int ver
 
 bool ServerDriver::hooksTrackedDeviceButtonPressed(void* serverDriverHost, int version, uint32_t& unWhichDevice, vr::EVRButtonId& eButtonId, double& eventTimeOffset) {
 	LOG(TRACE) << "ServerDriver::hooksTrackedDeviceButtonPressed(" << serverDriverHost << ", " << version << ", " << unWhichDevice << ", " << (int)eButtonId << ", " << eventTimeOffset << ")";
+	if (m_hookRecorder.isActive()) {
+		m_hookRecorder.recordButtonEvent(unWhichDevice, ButtonEventType::ButtonPressed, eButtonId, eventTimeOffset);
+	}
 	if (_openvrIdToDeviceManipulationHandleMap[unWhichDevice] && _openvrIdToDeviceManipulationHandleMap[unWhichDevice]->isValid()) {
 		return _openvrIdToDeviceManipulationHandleMap[unWhichDevice]->handleButtonEvent(unWhichDevice, ButtonEventType::ButtonPressed, eButtonId, eventTimeOffset);
 	}
@@ -45,6 +65,9 @@ bool ServerDriver::hooksTrackedDeviceButtonPressed(void* serverDriverHost, int v
 
 bool ServerDriver::hooksTrackedDeviceButtonUnpressed(void* serverDriverHost, int version, uint32_t& unWhichDevice, vr::EVRButtonId& eButtonId, double& eventTimeOffset) {
 	LOG(TRACE) << "ServerDriver::hooksTrackedDeviceButtonUnpressed(" << serverDriverHost << ", " << version << ", " << unWhichDevice << ", " << (int)eButtonId << ", " << eventTimeOffset << ")";
+	if (m_hookRecorder.isActive()) {
+		m_hookRecorder.recordButtonEvent(unWhichDevice, ButtonEventType::ButtonUnpressed, eButtonId, eventTimeOffset);
+	}
 	if (_openvrIdToDeviceManipulationHandleMap[unWhichDevice] && _openvrIdToDeviceManipulationHandleMap[unWhichDevice]->isValid()) {
 		return _openvrIdToDeviceManipulationHandleMap[unWhichDevice]->handleButtonEvent(unWhichDevice, ButtonEventType::ButtonUnpressed, eButtonId, eventTimeOffset);
 	}
@@ -53,6 +76,9 @@ bool ServerDriver::hooksTrackedDeviceButtonUnpressed(void* serverDriverHost, int
 
 bool ServerDriver::hooksTrackedDeviceButtonTouched(void* serverDriverHost, int version, uint32_t& unWhichDevice, vr::EVRButtonId& eButtonId, double& eventTimeOffset) {
 	LOG(TRACE) << "ServerDriver::hooksTrackedDeviceButtonTouched(" << serverDriverHost << ", " << version << ", " << unWhichDevice << ", " << (int)eButtonId << ", " << eventTimeOffset << ")";
+	if (m_hookRecorder.isActive()) {
+		m_hookRecorder.recordButtonEvent(unWhichDevice, ButtonEventType::ButtonTouched, eButtonId, eventTimeOffset);
+	}
 	if (_openvrIdToDeviceManipulationHandleMap[unWhichDevice] && _openvrIdToDeviceManipulationHandleMap[unWhichDevice]->isValid()) {
 		return _openvrIdToDeviceManipulationHandleMap[unWhichDevice]->handleButtonEvent(unWhichDevice, ButtonEventType::ButtonTouched, eButtonId, eventTimeOffset);
 	}
@@ -61,6 +87,9 @@ bool ServerDriver::hooksTrackedDeviceButtonTouched(void* serverDriverHost, int v
 
 bool ServerDriver::hooksTrackedDeviceButtonUntouched(void* serverDriverHost, int version, uint32_t& unWhichDevice, vr::EVRButtonId& eButtonId, double& eventTimeOffset) {
 	LOG(TRACE) << "ServerDriver::hooksTrackedDeviceButtonUntouched(" << serverDriverHost << ", " << version << ", " << unWhichDevice << ", " << (int)eButtonId << ", " << eventTimeOffset << ")";
+	if (m_hookRecorder.isActive()) {
+		m_hookRecorder.recordButtonEvent(unWhichDevice, ButtonEventType::ButtonUntouched, eButtonId, eventTimeOffset);
+	}
 	if (_openvrIdToDeviceManipulationHandleMap[unWhichDevice] && _openvrIdToDeviceManipulationHandleMap[unWhichDevice]->isValid()) {
 		return _openvrIdToDeviceManipulationHandleMap[unWhichDevice]->handleButtonEvent(unWhichDevice, ButtonEventType::ButtonUntouched, eButtonId, eventTimeOffset);
 	}
@@ -69,6 +98,9 @@ bool ServerDriver::hooksTrackedDeviceButtonUntouched(void* serverDriverHost, int
 
 bool ServerDriver::hooksTrackedDeviceAxisUpdated(void* serverDriverHost, int version, uint32_t& unWhichDevice, uint32_t& unWhichAxis, vr::VRControllerAxis_t& axisState) {
 	LOG(TRACE) << "ServerDriver::hooksTrackedDeviceAxisUpdated(" << serverDriverHost << ", " << version << ", " << unWhichDevice << ", " << (int)unWhichAxis << ")";
+	if (m_hookRecorder.isActive()) {
+		m_hookRecorder.recordAxisUpdate(unWhichDevice, unWhichAxis, axisState);
+	}
 	if (_openvrIdToDeviceManipulationHandleMap[unWhichDevice] && _openvrIdToDeviceManipulationHandleMap[unWhichDevice]->isValid()) {
 		return _openvrIdToDeviceManipulationHandleMap[unWhichDevice]->handleAxisUpdate(unWhichDevice, unWhichAxis, axisState);
 	}
@@ -94,6 +126,10 @@ bool ServerDriver::hooksPollNextEvent(void* serverDriverHost, int version, void*
 				<< ", duration = " << eventData->fDurationSeconds << ", frequency = " << eventData->fFrequency << ", amplitude = " << eventData->fAmplitude;
 
 			auto it = _propertyContainerToDeviceManipulationHandleMap.find(eventData->containerHandle);
+			if (m_hookRecorder.isActive()) {
+				auto deviceId = it != _propertyContainerToDeviceManipulationHandleMap.end() ? it->second->openvrId() : event->trackedDeviceIndex;
+				m_hookRecorder.recordHapticVibration(deviceId, eventData->componentHandle, eventData->fDurationSeconds, eventData->fFrequency, eventData->fAmplitude);
+			}
 			if (it != _propertyContainerToDeviceManipulationHandleMap.end()) {
 				return it->second->handleHapticPulseEvent(eventData->fDurationSeconds, eventData->fFrequency, eventData->fAmplitude);
 			}
@@ -106,6 +142,9 @@ bool ServerDriver::hooksControllerTriggerHapticPulse(void* controllerComponent,
 	LOG(TRACE) << "ServerDriver::hooksControllerTriggerHapticPulse(" << controllerComponent << ", " << version << ", " << unAxisId << ", " << usPulseDurationMicroseconds << ")";
 	auto it = _ptrToDeviceManipulationHandleMap.find(controllerComponent);
 	if (it != _ptrToDeviceManipulationHandleMap.end()) {
+		if (m_hookRecorder.isActive()) {
+			m_hookRecorder.recordHapticPulse(it->second->openvrId(), unAxisId, usPulseDurationMicroseconds);
+		}
 		it->second->triggerHapticPulse(unAxisId, usPulseDurationMicroseconds);
 		return false;
 	}
@@ -151,6 +190,10 @@ void ServerDriver::hooksTrackedDeviceActivated(void* serverDriver, int version,
 		auto container = vr::VRPropertiesRaw()->TrackedDeviceToPropertyContainer(unObjectId);
 		handle->setPropertyContainer(container);
 		_propertyContainerToDeviceManipulationHandleMap[container] = handle.get();
+		m_hookRecorder.registerDevice(unObjectId, handle->serialNumber(), handle->deviceClass());
+		updateInputRoutingTable();
+		updateDeviceProcessingMask();
+		deviceStateChanged(unObjectId);
 
 		LOG(INFO) << "Successfully added device " << handle->serialNumber() << " (OpenVR Id: " << handle->openvrId() << ")";
 	}
@@ -245,6 +288,7 @@ void ServerDriver::hooksCreateBooleanComponent(void * driverInput, int version,
 		it->second->setDriverInputPtr(driverInput);
 		_inputComponentToDeviceManipulationHandleMap[*((uint64_t*)pHandle)] = it->second;
 		it->second->inputAddBooleanComponent(pchName, *((uint64_t*)pHandle));
+		m_hookRecorder.registerInputComponent(it->second->openvrId(), HookCaptureComponentKind::Boolean, pchName, *((uint64_t*)pHandle));
 	}
 }
 
@@ -256,6 +300,7 @@ void ServerDriver::hooksCreateScalarComponent(void * driverInput, int version, v
 		it->second->setDriverInputPtr(driverInput);
 		_inputComponentToDeviceManipulationHandleMap[*((uint64_t*)pHandle)] = it->second;
 		it->second->inputAddScalarComponent(pchName, *((uint64_t*)pHandle), eType, eUnits);
+		m_hookRecorder.registerInputComponent(it->second->openvrId(), HookCaptureComponentKind::Scalar, pchName, *((uint64_t*)pHandle), (int32_t)eType, (int32_t)eUnits);
 	}
 }
 
@@ -266,12 +311,16 @@ void ServerDriver::hooksCreateHapticComponent(void * driverInput, int version, v
 		it->second->setDriverInputPtr(driverInput);
 		_inputComponentToDeviceManipulationHandleMap[*((uint64_t*)pHandle)] = it->second;
 		it->second->inputAddHapticComponent(pchName, *((uint64_t*)pHandle));
+		m_hookRecorder.registerInputComponent(it->second->openvrId(), HookCaptureComponentKind::Haptic, pchName, *((uint64_t*)pHandle));
 	}
 }
 
 bool ServerDriver::hooksUpdateBooleanComponent(void* driverInput, int version, vr::VRInputComponentHandle_t& ulComponent, bool& bNewValue, double& fTimeOffset) {
 	auto it = _inputComponentToDeviceManipulationHandleMap.find(ulComponent);
-	if (it != _inputComponentToDeviceManipulationHandleMap.end()) {
+	if (it != _inputComponentToDeviceManipulationHandleMap.end() && inputNeedsProcessing(it->second->openvrId())) {
+		if (m_hookRecorder.isActive()) {
+			m_hookRecorder.recordBooleanComponentUpdate(it->second->openvrId(), ulComponent, bNewValue, fTimeOffset);
+		}
 		return it->second->handleBooleanComponentUpdate(ulComponent, bNewValue, fTimeOffset);
 	}
 	return true;
@@ -279,7 +328,10 @@ bool ServerDriver::hooksUpdateBooleanComponent(void* driverInput, int version, v
 
 bool ServerDriver::hooksUpdateScalarComponent(void* driverInput, int version, vr::VRInputComponentHandle_t& ulComponent, float& fNewValue, double& fTimeOffset) {
 	auto it = _inputComponentToDeviceManipulationHandleMap.find(ulComponent);
-	if (it != _inputComponentToDeviceManipulationHandleMap.end()) {
+	if (it != _inputComponentToDeviceManipulationHandleMap.end() && inputNeedsProcessing(it->second->openvrId())) {
+		if (m_hookRecorder.isActive()) {
+			m_hookRecorder.recordScalarComponentUpdate(it->second->openvrId(), ulComponent, fNewValue, fTimeOffset);
+		}
 		return it->second->handleScalarComponentUpdate(ulComponent, fNewValue, fTimeOffset);
 	}
 	return true;
@@ -291,11 +343,11 @@ vr::EVRInitError ServerDriver::Init(vr::IVRDriverContext *pDriverContext) {
 
 	// Initialize Hooking
 	InterfaceHooks::setServerDriver(this);
-	auto mhError = MH_Initialize();
-	if (mhError == MH_OK) {
+	auto hookError = platform::initHooking();
+	if (!hookError) {
 		_driverContextHooks = InterfaceHooks::hookInterface(pDriverContext, "IVRDriverContext");
 	} else {
-		LOG(ERROR) << "Error while initialising minHook: " << MH_StatusToString(mhError);
+		LOG(ERROR) << "Error while initialising function hooking: " << hookError;
 	}
 
 	LOG(DEBUG) << "Initialize driver context.";
@@ -306,35 +358,53 @@ vr::EVRInitError ServerDriver::Init(vr::IVRDriverContext *pDriverContext) {
 	installDir = vr::VRProperties()->GetStringProperty(pDriverContext->GetDriverHandle(), vr::Prop_InstallPath_String, &tpeError);
 	if (tpeError == vr::TrackedProp_Success) {
 		LOG(INFO) << "Install Dir:" << installDir;
+		m_hookRecorder.setCaptureDirectory(installDir + platform::pathSeparator + "captures");
 	} else {
 		LOG(INFO) << "Could not get Install Dir: " << vr::VRPropertiesRaw()->GetPropErrorNameFromEnum(tpeError);
 	}
 
-	// Read vrsettings
+	// Read vrsettings (the headless test host does not provide any)
 	char buffer[vr::k_unMaxPropertyStringSize];
+	uint32_t posePumpRate = 0;
 	vr::EVRSettingsError peError;
-	vr::VRSettings()->GetString(vrsettings_SectionName, vrsettings_overrideHmdManufacturer_string, buffer, vr::k_unMaxPropertyStringSize, &peError);
-	if (peError == vr::VRSettingsError_None) {
-		_propertiesOverrideHmdManufacturer = buffer;
-		LOG(INFO) << vrsettings_SectionName << "::" << vrsettings_overrideHmdManufacturer_string << " = " << _propertiesOverrideHmdManufacturer;
-	}
-	vr::VRSettings()->GetString(vrsettings_SectionName, vrsettings_overrideHmdModel_string, buffer, vr::k_unMaxPropertyStringSize, &peError);
-	if (peError == vr::VRSettingsError_None) {
-		_propertiesOverrideHmdModel = buffer;
-		LOG(INFO) << vrsettings_SectionName << "::" << vrsettings_overrideHmdModel_string << " = " << _propertiesOverrideHmdModel;
-	}
-	vr::VRSettings()->GetString(vrsettings_SectionName, vrsettings_overrideHmdTrackingSystem_string, buffer, vr::k_unMaxPropertyStringSize, &peError);
-	if (peError == vr::VRSettingsError_None) {
-		_propertiesOverrideHmdTrackingSystem = buffer;
-		LOG(INFO) << vrsettings_SectionName << "::" << vrsettings_overrideHmdTrackingSystem_string << " = " << _propertiesOverrideHmdTrackingSystem;
+	if (vr::VRSettings()) {
+		vr::VRSettings()->GetString(vrsettings_SectionName, vrsettings_overrideHmdManufacturer_string, buffer, vr::k_unMaxPropertyStringSize, &peError);
+		if (peError == vr::VRSettingsError_None) {
+			_propertiesOverrideHmdManufacturer = buffer;
+			LOG(INFO) << vrsettings_SectionName << "::" << vrsettings_overrideHmdManufacturer_string << " = " << _propertiesOverrideHmdManufacturer;
+		}
+		vr::VRSettings()->GetString(vrsettings_SectionName, vrsettings_overrideHmdModel_string, buffer, vr::k_unMaxPropertyStringSize, &peError);
+		if (peError == vr::VRSettingsError_None) {
+			_propertiesOverrideHmdModel = buffer;
+			LOG(INFO) << vrsettings_SectionName << "::" << vrsettings_overrideHmdModel_string << " = " << _propertiesOverrideHmdModel;
+		}
+		vr::VRSettings()->GetString(vrsettings_SectionName, vrsettings_overrideHmdTrackingSystem_string, buffer, vr::k_unMaxPropertyStringSize, &peError);
+		if (peError == vr::VRSettingsError_None) {
+			_propertiesOverrideHmdTrackingSystem = buffer;
+			LOG(INFO) << vrsettings_SectionName << "::" << vrsettings_overrideHmdTrackingSystem_string << " = " << _propertiesOverrideHmdTrackingSystem;
+		}
+		auto boolVal = vr::VRSettings()->GetBool(vrsettings_SectionName, vrsettings_genericTrackerFakeController_bool, &peError);
+		if (peError == vr::VRSettingsError_None) {
+			_propertiesOverrideGenericTrackerFakeController = boolVal;
+			LOG(INFO) << vrsettings_SectionName << "::" << vrsettings_genericTrackerFakeController_bool << " = " << boolVal;
+		}
+		auto intVal = vr::VRSettings()->GetInt32(vrsettings_SectionName, vrsettings_posePumpRate_int32, &peError);
+		if (peError == vr::VRSettingsError_None) {
+			posePumpRate = intVal > 0 ? (uint32_t)intVal : 0;
+			LOG(INFO) << vrsettings_SectionName << "::" << vrsettings_posePumpRate_int32 << " = " << intVal;
+		}
 	}
-	auto boolVal = vr::VRSettings()->GetBool(vrsettings_SectionName, vrsettings_genericTrackerFakeController_bool, &peError);
-	if (peError == vr::VRSettingsError_None) {
-		_propertiesOverrideGenericTrackerFakeController = boolVal;
-		LOG(INFO) << vrsettings_SectionName << "::" << vrsettings_genericTrackerFakeController_bool << " = " << boolVal;
+	// Property batches only need to be hooked when there is something to override
+	if (!_propertiesOverrideHmdManufacturer.empty() || !_propertiesOverrideHmdModel.empty() || !_propertiesOverrideHmdTrackingSystem.empty()) {
+		HookFeatures::acquire(HookFeature::PropertyBatches);
+		_propertiesOverrideHooksActive = true;
 	}
 
-	// Start IPC thread
+	// Start output injection, pose pump and IPC thread
+	m_outputInjection.start();
+	if (posePumpRate > 0) {
+		m_posePump.setRate(this, posePumpRate);
+	}
 	shmCommunicator.init(this);
 	return vr::VRInitError_None;
 }
@@ -342,8 +412,22 @@ vr::EVRInitError ServerDriver::Init(vr::IVRDriverContext *pDriverContext) {
 
 void ServerDriver::Cleanup() {
 	LOG(TRACE) << "CServerDriver::Cleanup()";
+	m_hookRecorder.stop();
+	m_posePump.stop();
+	m_outputInjection.stop();
+	{
+		std::lock_guard<std::mutex> lock(_eventInjectionHookMutex);
+		if (_eventInjectionHookActive) {
+			HookFeatures::release(HookFeature::EventInjection);
+			_eventInjectionHookActive = false;
+		}
+	}
+	if (_propertiesOverrideHooksActive) {
+		HookFeatures::release(HookFeature::PropertyBatches);
+		_propertiesOverrideHooksActive = false;
+	}
 	_driverContextHooks.reset();
-	MH_Uninitialize();
+	platform::shutdownHooking();
 	shmCommunicator.shutdown();
 	VR_CLEANUP_SERVER_DRIVER_CONTEXT();
 }
@@ -351,10 +435,12 @@ void ServerDriver::Cleanup() {
 
 // Call frequency: ~93Hz
 void ServerDriver::RunFrame() {
-	for (int i = 0; i < vr::k_unMaxTrackedDeviceCount; ++i) {
-		auto vd = m_virtualDevices[i];
-		if (vd && vd->published() && vd->periodicPoseUpdates()) {
-			vd->sendPoseUpdate();
+	if (!m_posePump.isRunning()) {
+		for (int i = 0; i < vr::k_unMaxTrackedDeviceCount; ++i) {
+			auto vd = m_virtualDevices[i];
+			if (vd && vd->published() && vd->periodicPoseUpdates()) {
+				vd->sendPoseUpdate();
+			}
 		}
 	}
 	for (auto d : _deviceManipulationHandles) {
@@ -410,6 +496,7 @@ int32_t ServerDriver::virtualDevices_publishDevice(uint32_t emulatedDeviceId, bo
 		try {
 			device->publish();
 			LOG(INFO) << "Published tracked controller: virtualDeviceId " << emulatedDeviceId;
+			m_posePump.devicesChanged();
 		} catch (std::exception& e) {
 			LOG(ERROR) << "Error while publishing controller " << emulatedDeviceId << ": " << e.what();
 			return -4;
@@ -486,6 +573,11 @@ VirtualDeviceDriver* ServerDriver::virtualDevices_getDevice(uint32_t unWhichDevi
 	return nullptr;
 }
 
+std::shared_ptr<VirtualDeviceDriver> ServerDriver::virtualDevices_getDeviceShared(uint32_t unWhichDevice) {
+	std::lock_guard<std::recursive_mutex> lock(this->_virtualDevicesMutex);
+	return this->m_virtualDevices[unWhichDevice];
+}
+
 VirtualDeviceDriver* ServerDriver::virtualDevices_findDevice(const std::string& serial) {
 	for (uint32_t i = 0; i < this->m_virtualDeviceCount; ++i) {
 		if (this->m_virtualDevices[i]->serialNumber().compare(serial) == 0) {
@@ -514,27 +606,100 @@ DeviceManipulationHandle* ServerDriver::getDeviceManipulationHandleByPropertyCon
 }
 
 
+void ServerDriver::updateDeviceProcessingMask() {
+	// Handles are never removed, so they can be read without _deviceManipulationHandlesMutex. This is called
+	// while handle locks are held, so taking that mutex here could deadlock with the IPC thread.
+	std::lock_guard<std::mutex> lock(_deviceProcessingMaskMutex);
+	uint64_t mask[(vr::k_unMaxTrackedDeviceCount + 63) / 64] = {};
+	auto mirroredDevices = m_inputRouting.mirroredDevices();
+	for (uint32_t i = 0; i < vr::k_unMaxTrackedDeviceCount; ++i) {
+		auto handle = _openvrIdToDeviceManipulationHandleMap[i];
+		bool mirrored = i < 64 && (mirroredDevices & ((uint64_t)1 << i));
+		if (handle && handle->isValid() && (handle->needsProcessing() || mirrored)) {
+			mask[i / 64] |= (uint64_t)1 << (i % 64);
+		}
+	}
+	for (unsigned i = 0; i < (vr::k_unMaxTrackedDeviceCount + 63) / 64; ++i) {
+		_deviceProcessingMask[i].store(mask[i], std::memory_order_relaxed);
+	}
+}
+
+
+bool ServerDriver::setInputMirror(uint32_t sourceId, uint32_t targetId, bool enable) {
+	if (!m_inputRouting.setMirror(sourceId, targetId, enable)) {
+		return false;
+	}
+	updateInputRoutingTable();
+	updateDeviceProcessingMask();
+	return true;
+}
+
+
 void ServerDriver::sendReplySetMotionCompensationMode(bool success) {
 	shmCommunicator.sendReplySetMotionCompensationMode(success);
 }
 
 
-void ServerDriver::addDriverEventForInjection(void* serverDriverHost, std::shared_ptr<void> event, uint32_t size) {
-	std::lock_guard<std::mutex> lock(_driverEventInjectionMutex);
-	m_eventsToInjectQueues[serverDriverHost].push({event, size});
+bool ServerDriver::addDriverEventForInjection(void* serverDriverHost, const void* event, uint32_t size) {
+	if (!m_eventsToInject.push(serverDriverHost, event, size)) {
+		auto stats = m_eventsToInject.stats();
+		auto dropped = stats.overflows + stats.oversizedEvents + stats.unknownHosts;
+		shmCommunicator.updateEventInjectionDrops(dropped);
+		// Only log every power of two so a stuck host cannot flood the log
+		if ((dropped & (dropped - 1)) == 0) {
+			LOG(WARNING) << "Could not inject driver event (" << stats.overflows << " overflows, " << stats.oversizedEvents << " oversized, " 
+				<< stats.unknownHosts << " unknown hosts so far)";
+		}
+		return false;
+	}
+	_lastEventInjectionTime.store(_steadyMilliseconds(), std::memory_order_relaxed);
+	// Pairs with the fence in releaseIdleEventInjectionHook(): either the releaser sees this event or we see its release
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (!_eventInjectionHookActive.load()) {
+		std::lock_guard<std::mutex> lock(_eventInjectionHookMutex);
+		if (!_eventInjectionHookActive) {
+			HookFeatures::acquire(HookFeature::EventInjection);
+			_eventInjectionHookActive = true;
+		}
+	}
+	return true;
 }
 
-std::pair<std::shared_ptr<void>, uint32_t> ServerDriver::getDriverEventForInjection(void* serverDriverHost) {
-	std::lock_guard<std::mutex> lock(_driverEventInjectionMutex);
-	auto it = m_eventsToInjectQueues.find(serverDriverHost);
-	if (it != m_eventsToInjectQueues.end()) {
-		if (it->second.size() > 0) {
-			auto retval = it->second.front();
-			it->second.pop();
-			return retval;
+bool ServerDriver::getDriverEventForInjection(void* serverDriverHost, void* pEvent, uint32_t uncbVREvent) {
+	uint32_t eventSize;
+	while (m_eventsToInject.pop(serverDriverHost, pEvent, uncbVREvent, eventSize)) {
+		if (eventSize == uncbVREvent) {
+			return true;
 		}
+		LOG(ERROR) << "Could not inject driver event because size does not match, expected " << uncbVREvent << " but got " << eventSize;
 	}
-	return std::pair<std::shared_ptr<void>, uint32_t>({ std::shared_ptr<void>(), 0});
+	return false;
+}
+
+void ServerDriver::releaseIdleEventInjectionHook() {
+	if (!_eventInjectionHookActive.load()) {
+		return;
+	}
+	// Waveforms are injected pulse by pulse, the grace period keeps the hook from flapping between them
+	if (!m_eventsToInject.empty() || m_outputInjection.hapticsPending()
+			|| _steadyMilliseconds() - _lastEventInjectionTime.load(std::memory_order_relaxed) < 1000) {
+		return;
+	}
+	std::lock_guard<std::mutex> lock(_eventInjectionHookMutex);
+	if (!_eventInjectionHookActive) {
+		return;
+	}
+	_eventInjectionHookActive = false;
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (!m_eventsToInject.empty()) {
+		_eventInjectionHookActive = true; // An event slipped in, keep the hook
+		return;
+	}
+	HookFeatures::release(HookFeature::EventInjection);
+}
+
+int64_t ServerDriver::_steadyMilliseconds() {
+	return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
 }
 
 
@@ -1,8 +1,8 @@
 #pragma once
 
 #include <memory>
+#include <atomic>
 #include <mutex>
-#include <queue>
 #include <openvr_driver.h>
 #include <vrinputemulator_types.h>
 #include <openvr_math.h>
@@ -10,6 +10,11 @@
 #include "../logging.h"
 #include "../com/shm/driver_ipc_shm.h"
 #include "../devicemanipulation/MotionCompensationManager.h"
+#include "../devicemanipulation/InputRoutingTable.h"
+#include "../capture/HookRecorder.h"
+#include "utils/DriverEventInjectionQueue.h"
+#include "OutputInjectionWorker.h"
+#include "PosePumpWorker.h"
 
 
 
@@ -70,6 +75,8 @@ public:
 
 	VirtualDeviceDriver* virtualDevices_getDevice(uint32_t unWhichDevice);
 
+	std::shared_ptr<VirtualDeviceDriver> virtualDevices_getDeviceShared(uint32_t unWhichDevice);
+
 	VirtualDeviceDriver* virtualDevices_findDevice(const std::string& serial);
 
 	int32_t virtualDevices_addDevice(VirtualDeviceType type, const std::string& serial);
@@ -109,6 +116,42 @@ public:
 	MotionCompensationManager& motionCompensation() { return m_motionCompensation; }
 	void sendReplySetMotionCompensationMode(bool success);
 
+	/* Hook traffic capture */
+	HookRecorder& hookRecorder() { return m_hookRecorder; }
+
+	/* Keyboard input, sounds and vibration cues are executed by a worker thread, never on the hook thread */
+	OutputInjectionWorker& outputInjection() { return m_outputInjection; }
+
+	/* Periodic virtual device poses are sent by the pose pump when it runs, otherwise by RunFrame */
+	PosePumpWorker& posePump() { return m_posePump; }
+	void setPosePumpRate(uint32_t rate) { m_posePump.setRate(this, rate); }
+
+	/* Passthrough fast path: Hooks forward calls of devices without active manipulation directly to the original function */
+	bool poseNeedsProcessing(uint32_t openvrId) const {
+		return inputNeedsProcessing(openvrId) || m_motionCompensation.isMotionCompensationEnabled() || shmCommunicator.isPoseTelemetryActive();
+	}
+	bool inputNeedsProcessing(uint32_t openvrId) const {
+		return openvrId >= vr::k_unMaxTrackedDeviceCount || m_hookRecorder.isActive()
+			|| (_deviceProcessingMask[openvrId / 64].load(std::memory_order_relaxed) & ((uint64_t)1 << (openvrId % 64))) != 0;
+	}
+	/** Needs to be called whenever the mode, offsets or input remappings of a device change */
+	void updateDeviceProcessingMask();
+	/** Needs to be called whenever something in the DeviceState of a device changes (pushed to subscribed clients) */
+	void deviceStateChanged(uint32_t openvrId) { shmCommunicator.deviceStateChanged(openvrId); }
+	/** Needs to be called whenever redirect/swap modes change */
+	void updateInputRoutingTable() { m_inputRouting.rebuild(_openvrIdToDeviceManipulationHandleMap); }
+	bool lookupInputRoute(uint32_t openvrId, InputRoutingTable::Route& route) const { return m_inputRouting.lookup(openvrId, route); }
+	/** Additionally sends all input of the source device to the target device, returns false when the source has too many mirrors */
+	bool setInputMirror(uint32_t sourceId, uint32_t targetId, bool enable);
+	std::vector<uint32_t> getInputMirrors(uint32_t sourceId) { return m_inputRouting.mirrors(sourceId); }
+
+	/** Keeps the shared device state table up to date for poses that took the fast path (only while a client reads it) */
+	void passthroughPoseUpdated(uint32_t openvrId, const vr::DriverPose_t& newPose) {
+		if (shmCommunicator.isDevicePoseMirrorActive()) {
+			shmCommunicator.updateSharedDevicePose(openvrId, newPose);
+		}
+	}
+
 	//// function hooks related ////
 	void hooksTrackedDeviceAdded(void* serverDriverHost, int version, const char *pchDeviceSerialNumber, vr::ETrackedDeviceClass& eDeviceClass, void* pDriver);
 	void hooksTrackedDeviceActivated(void* serverDriver, int version, uint32_t unObjectId);
@@ -131,9 +174,16 @@ public:
 	bool hooksUpdateBooleanComponent(void* driverInput, int version, vr::VRInputComponentHandle_t& ulComponent, bool& bNewValue, double& fTimeOffset);
 	bool hooksUpdateScalarComponent(void* driverInput, int version, vr::VRInputComponentHandle_t& ulComponent, float& fNewValue, double& fTimeOffset);
 
-	// driver events injection
-	void addDriverEventForInjection(void* serverDriverHost, std::shared_ptr<void> event, uint32_t size);
-	std::pair<std::shared_ptr<void>, uint32_t> getDriverEventForInjection(void* serverDriverHost);
+	// driver events injection (never blocks or allocates, events are dropped and counted when the host's ring is full)
+	bool addDriverEventForInjection(void* serverDriverHost, const void* event, uint32_t size);
+	/** Copies the next injected event into pEvent, returns false when there is none */
+	bool getDriverEventForInjection(void* serverDriverHost, void* pEvent, uint32_t uncbVREvent);
+	DriverEventInjectionStats driverEventInjectionStats() const { return m_eventsToInject.stats(); }
+	/**
+	* PollNextEvent stays hooked while injected events or haptic pulses are pending. Releases the hook once
+	* they have been idle for a second, only called from the ipc thread.
+	*/
+	void releaseIdleEventInjectionHook();
 
 
 private:
@@ -141,6 +191,8 @@ private:
 
 	static std::string installDir;
 
+	static int64_t _steadyMilliseconds();
+
 	//// virtual devices related ////
 	std::recursive_mutex _virtualDevicesMutex;
 	uint32_t m_virtualDeviceCount = 0;
@@ -157,22 +209,35 @@ private:
 	std::map<vr::PropertyContainerHandle_t, DeviceManipulationHandle*> _propertyContainerToDeviceManipulationHandleMap;
 	std::map<void*, DeviceManipulationHandle*> _ptrToDeviceManipulationHandleMap;
 	std::map<uint64_t, DeviceManipulationHandle*> _inputComponentToDeviceManipulationHandleMap;
+	std::mutex _deviceProcessingMaskMutex;
+	std::atomic<uint64_t> _deviceProcessingMask[(vr::k_unMaxTrackedDeviceCount + 63) / 64]; // One bit per OpenVR id, set when the device needs processing
+	InputRoutingTable m_inputRouting;
 
 	//// motion compensation related ////
 	MotionCompensationManager m_motionCompensation;
 
 	//// function hooks related ////
 	std::shared_ptr<InterfaceHooks> _driverContextHooks;
+	HookRecorder m_hookRecorder;
 
 	// driver events injection
-	std::mutex _driverEventInjectionMutex;
-	std::map<void*, std::queue<std::pair<std::shared_ptr<void>, uint32_t>>> m_eventsToInjectQueues;
+	DriverEventInjectionQueue m_eventsToInject;
+	std::mutex _eventInjectionHookMutex;
+	std::atomic<bool> _eventInjectionHookActive { false }; // Holds a HookFeature::EventInjection reference
+	std::atomic<int64_t> _lastEventInjectionTime { 0 }; // steady_clock milliseconds
+
+	// OS side effects (declared after the device manipulation handles, the worker may reference them until it is stopped)
+	OutputInjectionWorker m_outputInjection;
+
+	// Sends virtual device poses at a high rate (references the virtual devices until it is stopped)
+	PosePumpWorker m_posePump;
 
 	// Device Property Overrides
 	std::string _propertiesOverrideHmdManufacturer;
 	std::string _propertiesOverrideHmdModel;
 	std::string _propertiesOverrideHmdTrackingSystem;
-	bool _propertiesOverrideGenericTrackerFakeController;
+	bool _propertiesOverrideGenericTrackerFakeController = false;
+	bool _propertiesOverrideHooksActive = false; // Holds a HookFeature::PropertyBatches reference
 };
 
 
@@ -1,12 +1,20 @@
 #include "VirtualDeviceDriver.h"
 
+#include <chrono>
 #include "../logging.h"
+#include "ServerDriver.h"
 
 
 namespace vrinputemulator {
 namespace driver {
 
 
+// Time base of the pose prediction
+static double _predictionClock() {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
 VirtualDeviceDriver::VirtualDeviceDriver(ServerDriver* parent, VirtualDeviceType type, const std::string& serial, uint32_t virtualId)
 		: m_serverDriver(parent), m_deviceType(type), m_serialNumber(serial), m_virtualDeviceId(virtualId) {
 	memset(&m_pose, 0, sizeof(vr::DriverPose_t));
@@ -35,6 +43,8 @@ vr::EVRInitError VirtualDeviceDriver::Activate(uint32_t unObjectId) {
 
 void VirtualDeviceDriver::Deactivate() {
 	LOG(TRACE) << "VirtualDeviceDriver[" << m_serialNumber << "]::Deactivate()";
+	// Before taking _mutex, the pump holds its entries lock while it waits for _mutex
+	m_serverDriver->posePump().removeDevice(this);
 	std::lock_guard<std::recursive_mutex> lock(_mutex);
 	//m_serverDriver->_trackedDeviceDeactivated(m_openvrId);
 	m_openvrId = vr::k_unTrackedDeviceIndexInvalid;
@@ -63,7 +73,10 @@ void VirtualDeviceDriver::updatePose(const vr::DriverPose_t & newPose, double ti
 	std::lock_guard<std::recursive_mutex> lock(_mutex);
 	m_pose = newPose;
 	m_pose.poseTimeOffset += timeOffset;
-	if (notify && m_openvrId != vr::k_unTrackedDeviceIndexInvalid) {
+	if (m_posePrediction.enabled()) {
+		m_posePrediction.addSample(m_pose, _predictionClock() + m_pose.poseTimeOffset);
+	}
+	if (notify && !m_posePumped.load(std::memory_order_relaxed) && m_openvrId != vr::k_unTrackedDeviceIndexInvalid) {
 		vr::VRServerDriverHost()->TrackedDevicePoseUpdated(m_openvrId, m_pose, sizeof(vr::DriverPose_t));
 	}
 }
@@ -74,11 +87,26 @@ void VirtualDeviceDriver::sendPoseUpdate(double timeOffset, bool onlyWhenConnect
 	if (!onlyWhenConnected || (m_pose.poseIsValid && m_pose.deviceIsConnected)) {
 		m_pose.poseTimeOffset = timeOffset;
 		if (m_openvrId != vr::k_unTrackedDeviceIndexInvalid) {
-			vr::VRServerDriverHost()->TrackedDevicePoseUpdated(m_openvrId, m_pose, sizeof(vr::DriverPose_t));
+			if (m_posePrediction.enabled()) {
+				auto pose = m_pose;
+				m_posePrediction.predict(pose, _predictionClock() + timeOffset);
+				vr::VRServerDriverHost()->TrackedDevicePoseUpdated(m_openvrId, pose, sizeof(vr::DriverPose_t));
+			} else {
+				vr::VRServerDriverHost()->TrackedDevicePoseUpdated(m_openvrId, m_pose, sizeof(vr::DriverPose_t));
+			}
 		}
 	}
 }
 
+void VirtualDeviceDriver::setPosePrediction(const PosePredictionSettings& settings) {
+	LOG(TRACE) << "VirtualDeviceDriver[" << m_serialNumber << "]::setPosePrediction( " << settings.enabled << ", " << settings.maxPredictionTime << ", " << settings.accelerationDamping << " )";
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	m_posePrediction.configure(settings);
+	if (settings.enabled && m_pose.poseIsValid) {
+		m_posePrediction.addSample(m_pose, _predictionClock() + m_pose.poseTimeOffset);
+	}
+}
+
 void VirtualDeviceDriver::publish() {
 	LOG(TRACE) << "VirtualDeviceDriver[" << m_serialNumber << "]::publish()";
 	if (!m_published) {
@@ -2,9 +2,12 @@
 
 #include <map>
 #include <mutex>
+#include <atomic>
 #include <openvr_driver.h>
 #include <vrinputemulator_types.h>
 #include "utils/DevicePropertyValueVisitor.h"
+#include "utils/PosePredictor.h"
+#include "../logging.h"
 
 
 
@@ -33,9 +36,12 @@ protected:
 	uint32_t m_openvrId = vr::k_unTrackedDeviceIndexInvalid;
 	bool m_published = false;
 	bool m_periodicPoseUpdates = true;
+	std::atomic<uint32_t> m_poseRate { 0 }; // Hz, 0 .. rate of the pose pump
+	std::atomic<bool> m_posePumped { false }; // The pose pump sends the pose updates of this device
 	vr::PropertyContainerHandle_t m_propertyContainer = vr::k_ulInvalidPropertyContainer;
 
 	vr::DriverPose_t m_pose;
+	PosePredictor m_posePrediction;
 	typedef boost::variant<int32_t, uint64_t, float, bool, std::string, vr::HmdMatrix34_t, vr::HmdMatrix44_t, vr::HmdVector3_t, vr::HmdVector4_t> _devicePropertyType_t;
 	std::map<int, _devicePropertyType_t> _deviceProperties;
 
@@ -72,11 +78,24 @@ public:
 	vr::DriverPose_t& driverPose() { return m_pose; }
 
 	bool enablePeriodicPoseUpdates(bool enabled) { return m_periodicPoseUpdates; }
+
+	// Rate with which the pose pump sends periodic pose updates of this device
+	uint32_t poseRate() const { return m_poseRate.load(std::memory_order_relaxed); }
+	void setPoseRate(uint32_t rate) { m_poseRate.store(rate, std::memory_order_relaxed); }
+	// Set by the pose pump, updatePose() does not notify SteamVR while the pump sends the poses
+	void setPosePumped(bool pumped) { m_posePumped.store(pumped, std::memory_order_relaxed); }
 	void publish();
 
 	void updatePose(const vr::DriverPose_t& newPose, double timeOffset, bool notify = true);
 	void sendPoseUpdate(double timeOffset = 0.0, bool onlyWhenConnected = true);
 
+	// Periodic pose updates extrapolate the last client pose to the time they are sent
+	void setPosePrediction(const PosePredictionSettings& settings);
+	PosePredictionSettings posePrediction() {
+		std::lock_guard<std::recursive_mutex> lock(_mutex);
+		return m_posePrediction.settings();
+	}
+
 	template<class T>
 	T getTrackedDeviceProperty(vr::ETrackedDeviceProperty prop, vr::ETrackedPropertyError * pError) {
 		std::lock_guard<std::recursive_mutex> lock(_mutex);
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+
+// driver namespace
+namespace vrinputemulator {
+namespace driver {
+
+
+/**
+* Fixed-capacity multi-producer/multi-consumer queue for trivially copyable values.
+*
+* Bounded queue after Dmitry Vyukov: every slot carries a sequence number that tells producers and consumers
+* whether it is free or filled, so push() and pop() never lock or allocate. push() returns false when the
+* queue is full.
+*/
+template<typename T, uint32_t Capacity>
+class BoundedQueue {
+	static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+public:
+	BoundedQueue() {
+		for (uint32_t i = 0; i < Capacity; ++i) {
+			_slots[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	bool push(const T& value) {
+		auto pos = _enqueuePos.load(std::memory_order_relaxed);
+		Slot* slot;
+		while (true) {
+			slot = &_slots[pos & (Capacity - 1)];
+			auto diff = (int64_t)slot->sequence.load(std::memory_order_acquire) - (int64_t)pos;
+			if (diff == 0) {
+				if (_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+					break;
+				}
+			} else if (diff < 0) {
+				return false;
+			} else {
+				pos = _enqueuePos.load(std::memory_order_relaxed);
+			}
+		}
+		slot->value = value;
+		slot->sequence.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool pop(T& value) {
+		auto pos = _dequeuePos.load(std::memory_order_relaxed);
+		Slot* slot;
+		while (true) {
+			slot = &_slots[pos & (Capacity - 1)];
+			auto diff = (int64_t)slot->sequence.load(std::memory_order_acquire) - (int64_t)(pos + 1);
+			if (diff == 0) {
+				if (_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+					break;
+				}
+			} else if (diff < 0) {
+				return false;
+			} else {
+				pos = _dequeuePos.load(std::memory_order_relaxed);
+			}
+		}
+		value = slot->value;
+		slot->sequence.store(pos + Capacity, std::memory_order_release);
+		return true;
+	}
+
+	/** Is already false while a push is still in progress, pop() fails until the push is finished */
+	bool empty() const {
+		return _dequeuePos.load(std::memory_order_relaxed) == _enqueuePos.load(std::memory_order_relaxed);
+	}
+
+private:
+	struct Slot {
+		std::atomic<uint64_t> sequence;
+		T value;
+	};
+
+	Slot _slots[Capacity];
+	alignas(64) std::atomic<uint64_t> _enqueuePos { 0 };
+	alignas(64) std::atomic<uint64_t> _dequeuePos { 0 };
+};
+
+
+} // end namespace driver
+} // end namespace vrinputemulator
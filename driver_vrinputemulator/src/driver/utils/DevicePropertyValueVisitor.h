@@ -20,8 +20,7 @@ public:
 	std::string operator()(T& i) const {
 		return "Unknown value type";
 	}
-	template<>
-	std::string operator()<int32_t>(int32_t& val) const {
+	std::string operator()(int32_t& val) const {
 		auto pError = vr::VRProperties()->SetInt32Property(propertyContainer, deviceProperty, val);
 		if (pError == vr::TrackedProp_Success) {
 			return "";
@@ -29,8 +28,7 @@ public:
 			return std::string("OpenVR returned an error: ") + std::to_string((int)pError);
 		}
 	}
-	template<>
-	std::string operator()<uint64_t>(uint64_t& val) const {
+	std::string operator()(uint64_t& val) const {
 		auto pError = vr::VRProperties()->SetUint64Property(propertyContainer, deviceProperty, val);
 		if (pError == vr::TrackedProp_Success) {
 			return "";
@@ -38,8 +36,7 @@ public:
 			return std::string("OpenVR returned an error: ") + std::to_string((int)pError);
 		}
 	}
-	template<>
-	std::string operator()<float>(float& val) const {
+	std::string operator()(float& val) const {
 		auto pError = vr::VRProperties()->SetFloatProperty(propertyContainer, deviceProperty, val);
 		if (pError == vr::TrackedProp_Success) {
 			return "";
@@ -47,8 +44,7 @@ public:
 			return std::string("OpenVR returned an error: ") + std::to_string((int)pError);
 		}
 	}
-	template<>
-	std::string operator()<bool>(bool& val) const {
+	std::string operator()(bool& val) const {
 		auto pError = vr::VRProperties()->SetBoolProperty(propertyContainer, deviceProperty, val);
 		if (pError == vr::TrackedProp_Success) {
 			return "";
@@ -56,8 +52,7 @@ public:
 			return std::string("OpenVR returned an error: ") + std::to_string((int)pError);
 		}
 	}
-	template<>
-	std::string operator()<std::string>(std::string& val) const {
+	std::string operator()(std::string& val) const {
 		auto pError = vr::VRProperties()->SetStringProperty(propertyContainer, deviceProperty, val.c_str());
 		if (pError == vr::TrackedProp_Success) {
 			return "";
@@ -65,8 +60,7 @@ public:
 			return std::string("OpenVR returned an error: ") + std::to_string((int)pError);
 		}
 	}
-	template<>
-	std::string operator()<vr::HmdMatrix34_t>(vr::HmdMatrix34_t& val) const {
+	std::string operator()(vr::HmdMatrix34_t& val) const {
 		auto pError = vr::VRProperties()->SetProperty(propertyContainer, deviceProperty, &val, sizeof(vr::HmdMatrix34_t), vr::k_unHmdMatrix34PropertyTag);
 		if (pError == vr::TrackedProp_Success) {
 			return "";
@@ -74,8 +68,7 @@ public:
 			return std::string("OpenVR returned an error: ") + std::to_string((int)pError);
 		}
 	}
-	template<>
-	std::string operator()<vr::HmdMatrix44_t>(vr::HmdMatrix44_t& val) const {
+	std::string operator()(vr::HmdMatrix44_t& val) const {
 		auto pError = vr::VRProperties()->SetProperty(propertyContainer, deviceProperty, &val, sizeof(vr::HmdMatrix44_t), vr::k_unHmdMatrix44PropertyTag);
 		if (pError == vr::TrackedProp_Success) {
 			return "";
@@ -83,8 +76,7 @@ public:
 			return std::string("OpenVR returned an error: ") + std::to_string((int)pError);
 		}
 	}
-	template<>
-	std::string operator()<vr::HmdVector3_t>(vr::HmdVector3_t& val) const {
+	std::string operator()(vr::HmdVector3_t& val) const {
 		auto pError = vr::VRProperties()->SetProperty(propertyContainer, deviceProperty, &val, sizeof(vr::HmdVector3_t), vr::k_unHmdVector3PropertyTag);
 		if (pError == vr::TrackedProp_Success) {
 			return "";
@@ -92,8 +84,7 @@ public:
 			return std::string("OpenVR returned an error: ") + std::to_string((int)pError);
 		}
 	}
-	template<>
-	std::string operator()<vr::HmdVector4_t>(vr::HmdVector4_t& val) const {
+	std::string operator()(vr::HmdVector4_t& val) const {
 		auto pError = vr::VRProperties()->SetProperty(propertyContainer, deviceProperty, &val, sizeof(vr::HmdVector4_t), vr::k_unHmdVector4PropertyTag);
 		if (pError == vr::TrackedProp_Success) {
 			return "";
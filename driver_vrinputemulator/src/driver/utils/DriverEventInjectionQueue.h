@@ -0,0 +1,170 @@
+#pragma once
+
+#include <atomic>
+#include <cstring>
+#include <stdint.h>
+#include "BoundedQueue.h"
+
+
+// driver namespace
+namespace vrinputemulator {
+namespace driver {
+
+
+struct DriverEventInjectionStats {
+	uint64_t injectedEvents = 0;
+	uint64_t overflows = 0; // Ring of the server driver host was full
+	uint64_t oversizedEvents = 0; // Event did not fit into a slot
+	uint64_t unknownHosts = 0; // All host rings were already taken
+	uint64_t sizeMismatches = 0; // Event size did not match the size PollNextEvent asked for
+};
+
+
+/**
+* Fixed-capacity ring of driver events waiting to be returned from PollNextEvent.
+*
+* A BoundedQueue of raw event bytes: several threads may inject events concurrently, and since SteamVR may poll
+* from more than one thread consumers are also safe against each other. When the ring is full new events are
+* dropped and counted.
+*/
+class DriverEventRing {
+public:
+	static const uint32_t capacity = 64; // Power of two
+	static const uint32_t maxEventSize = 64; // Driver side VREvent_t is 48 bytes
+
+	/** Returns false when the ring is full or the event is too large */
+	bool push(const void* event, uint32_t size) {
+		if (size > maxEventSize) {
+			oversizedEvents.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		Event e;
+		e.size = size;
+		std::memcpy(e.data, event, size);
+		if (!_events.push(e)) {
+			overflows.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		injectedEvents.fetch_add(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	/**
+	* Dequeues the oldest event and returns false when there is none. The event is only copied into dest
+	* when its size equals destSize, otherwise it is discarded (eventSize tells the caller which case it was).
+	*/
+	bool pop(void* dest, uint32_t destSize, uint32_t& eventSize) {
+		Event e;
+		if (!_events.pop(e)) {
+			return false;
+		}
+		eventSize = e.size;
+		if (eventSize == destSize) {
+			std::memcpy(dest, e.data, eventSize);
+		}
+		return true;
+	}
+
+	bool empty() const {
+		return _events.empty();
+	}
+
+	std::atomic<uint64_t> injectedEvents { 0 };
+	std::atomic<uint64_t> overflows { 0 };
+	std::atomic<uint64_t> oversizedEvents { 0 };
+
+private:
+	struct Event {
+		uint32_t size;
+		alignas(8) char data[maxEventSize];
+	};
+
+	BoundedQueue<Event, capacity> _events;
+};
+
+
+/**
+* One DriverEventRing per server driver host, preallocated.
+*
+* A host claims the lowest free entry on its first event. Entries are never given back, so producers that race
+* for the same host always compete for the same entry and a host can never end up with two rings.
+*/
+class DriverEventInjectionQueue {
+public:
+	static const uint32_t maxHosts = 8;
+
+	bool push(void* serverDriverHost, const void* event, uint32_t size) {
+		auto ring = _findRing(serverDriverHost, true);
+		if (!ring) {
+			_unknownHosts.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		return ring->push(event, size);
+	}
+
+	/** See DriverEventRing::pop(), events with the wrong size are counted as size mismatches */
+	bool pop(void* serverDriverHost, void* dest, uint32_t destSize, uint32_t& eventSize) {
+		auto ring = _findRing(serverDriverHost, false);
+		if (ring && ring->pop(dest, destSize, eventSize)) {
+			if (eventSize != destSize) {
+				_sizeMismatches.fetch_add(1, std::memory_order_relaxed);
+			}
+			return true;
+		}
+		return false;
+	}
+
+	/** No event is waiting for any host */
+	bool empty() const {
+		for (auto& e : _entries) {
+			if (!e.ring.empty()) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	DriverEventInjectionStats stats() const {
+		DriverEventInjectionStats stats;
+		for (auto& e : _entries) {
+			stats.injectedEvents += e.ring.injectedEvents.load(std::memory_order_relaxed);
+			stats.overflows += e.ring.overflows.load(std::memory_order_relaxed);
+			stats.oversizedEvents += e.ring.oversizedEvents.load(std::memory_order_relaxed);
+		}
+		stats.unknownHosts = _unknownHosts.load(std::memory_order_relaxed);
+		stats.sizeMismatches = _sizeMismatches.load(std::memory_order_relaxed);
+		return stats;
+	}
+
+private:
+	struct Entry {
+		std::atomic<void*> host { nullptr };
+		DriverEventRing ring;
+	};
+
+	DriverEventRing* _findRing(void* serverDriverHost, bool claim) {
+		for (auto& e : _entries) {
+			auto host = e.host.load(std::memory_order_acquire);
+			if (host == serverDriverHost) {
+				return &e.ring;
+			} else if (!host) {
+				if (!claim) {
+					return nullptr;
+				}
+				void* expected = nullptr;
+				if (e.host.compare_exchange_strong(expected, serverDriverHost, std::memory_order_acq_rel) || expected == serverDriverHost) {
+					return &e.ring;
+				}
+			}
+		}
+		return nullptr;
+	}
+
+	Entry _entries[maxHosts];
+	std::atomic<uint64_t> _unknownHosts { 0 };
+	std::atomic<uint64_t> _sizeMismatches { 0 };
+};
+
+
+} // end namespace driver
+} // end namespace vrinputemulator
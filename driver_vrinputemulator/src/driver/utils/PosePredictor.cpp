@@ -0,0 +1,102 @@
+#include "PosePredictor.h"
+
+#include <cmath>
+#include <algorithm>
+#include <openvr_math.h>
+
+// driver namespace
+namespace vrinputemulator {
+namespace driver {
+
+
+// Updates further apart than this are not used to estimate derivatives (source paused, tracking lost)
+static const double maxSampleGap = 0.25;
+
+// Updates closer together than this replace the newest sample instead of producing huge derivatives
+static const double minSampleGap = 0.0005;
+
+
+void PosePredictor::configure(const PosePredictionSettings& settings) {
+	_settings = settings;
+	_settings.maxPredictionTime = std::min(std::max(_settings.maxPredictionTime, 0.0), 0.5);
+	_settings.accelerationDamping = std::max(_settings.accelerationDamping, 0.0);
+	_sampleCount = 0;
+}
+
+
+void PosePredictor::addSample(const vr::DriverPose_t& pose, double time) {
+	if (!pose.poseIsValid) {
+		_sampleCount = 0;
+		return;
+	}
+	Sample sample = { time, { pose.vecPosition[0], pose.vecPosition[1], pose.vecPosition[2] }, pose.qRotation };
+	if (_sampleCount > 0) {
+		auto dt = time - _samples[0].time;
+		if (dt > maxSampleGap || dt < 0.0) {
+			_sampleCount = 0;
+		} else if (dt < minSampleGap) {
+			// Keep the derivatives, just move to the newer pose
+			_samples[0] = sample;
+			return;
+		}
+	}
+	_samples[2] = _samples[1];
+	_samples[1] = _samples[0];
+	_samples[0] = sample;
+	_sampleCount = std::min(_sampleCount + 1, 3u);
+
+	_velocity = { 0.0, 0.0, 0.0 };
+	_acceleration = { 0.0, 0.0, 0.0 };
+	_angularVelocity = { 0.0, 0.0, 0.0 };
+	_angularAcceleration = { 0.0, 0.0, 0.0 };
+	if (_sampleCount >= 2) {
+		auto dt0 = _samples[0].time - _samples[1].time;
+		_velocity = (_samples[0].position - _samples[1].position) / dt0;
+		_angularVelocity = vrmath::quaternionToRotationVector(_samples[0].rotation * vrmath::quaternionConjugate(_samples[1].rotation)) / dt0;
+		if (_sampleCount >= 3) {
+			auto dt1 = _samples[1].time - _samples[2].time;
+			auto velocity1 = (_samples[1].position - _samples[2].position) / dt1;
+			auto angularVelocity1 = vrmath::quaternionToRotationVector(_samples[1].rotation * vrmath::quaternionConjugate(_samples[2].rotation)) / dt1;
+			// Both velocities are central to their interval, so they are (dt0 + dt1) / 2 apart
+			auto span = (dt0 + dt1) / 2.0;
+			_acceleration = (_velocity - velocity1) / span;
+			_angularAcceleration = (_angularVelocity - angularVelocity1) / span;
+		}
+	}
+}
+
+
+void PosePredictor::predict(vr::DriverPose_t& pose, double time) const {
+	if (_sampleCount < 2) {
+		return;
+	}
+	auto elapsed = time - _samples[0].time;
+	auto t = std::min(elapsed, _settings.maxPredictionTime);
+	if (t <= 0.0) {
+		return;
+	}
+	// A stale source blends back to its last real pose over another maxPredictionTime instead of freezing ahead of it
+	double weight = 1.0;
+	if (elapsed > _settings.maxPredictionTime) {
+		weight = 1.0 - (elapsed - _settings.maxPredictionTime) / _settings.maxPredictionTime;
+		if (weight <= 0.0) {
+			return;
+		}
+	}
+	// Displacement caused by an acceleration a0 * e^(-t/tau): a0 * (tau * t - tau^2 * (1 - e^(-t/tau)))
+	double k = 0.0;
+	auto tau = _settings.accelerationDamping;
+	if (tau > 0.0) {
+		k = tau * t - tau * tau * (1.0 - std::exp(-t / tau));
+	}
+	auto position = _samples[0].position + (_velocity * t + _acceleration * k) * weight;
+	pose.vecPosition[0] = position.v[0];
+	pose.vecPosition[1] = position.v[1];
+	pose.vecPosition[2] = position.v[2];
+	auto rotation = (_angularVelocity * t + _angularAcceleration * k) * weight;
+	pose.qRotation = vrmath::quaternionFromRotationVector(rotation) * _samples[0].rotation;
+}
+
+
+}
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <openvr_driver.h>
+#include <vrinputemulator_types.h>
+
+// driver namespace
+namespace vrinputemulator {
+namespace driver {
+
+// Forward prediction for poses that arrive at a low rate (virtual devices fed by clients at 30 - 120 Hz).
+// The derivatives are estimated from the last three updates when an update arrives, so predict() only has to
+// evaluate p + v*t + a*k(t), where k(t) integrates the acceleration fading out with the configured time constant.
+// Predictions never reach further than maxPredictionTime past the last update. After that they blend back to the
+// last update within another maxPredictionTime, so a stale source ends up at its last real pose.
+class PosePredictor {
+public:
+	void configure(const PosePredictionSettings& settings);
+	const PosePredictionSettings& settings() const { return _settings; }
+	bool enabled() const { return _settings.enabled; }
+
+	// time is the sample time in seconds (any monotonic base, the same as for predict())
+	void addSample(const vr::DriverPose_t& pose, double time);
+
+	// Moves position and rotation of pose (the last sample) to time
+	void predict(vr::DriverPose_t& pose, double time) const;
+
+	void reset() { _sampleCount = 0; }
+
+private:
+	struct Sample {
+		double time;
+		vr::HmdVector3d_t position;
+		vr::HmdQuaternion_t rotation;
+	};
+
+	PosePredictionSettings _settings;
+	Sample _samples[3]; // 0 .. newest
+	unsigned _sampleCount = 0;
+	vr::HmdVector3d_t _velocity;
+	vr::HmdVector3d_t _acceleration;
+	vr::HmdVector3d_t _angularVelocity; // rotation vector per second, driver space
+	vr::HmdVector3d_t _angularAcceleration;
+};
+
+}
+}
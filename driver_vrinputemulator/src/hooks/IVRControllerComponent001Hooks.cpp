@@ -16,7 +16,7 @@ IVRControllerComponent001Hooks::IVRControllerComponent001Hooks(void* iptr) : con
 	triggerHapicPulseAddress = vtable[1];
 	auto it = _hookedTriggerHapticPulseAdressMap.find(triggerHapicPulseAddress);
 	if (it == _hookedTriggerHapticPulseAdressMap.end()) {
-		CREATE_MH_HOOK(triggerHapicPulseHook, _triggerHapticPulse, "IVRControllerComponent001Hooks::TriggerHapticPulse", iptr, 1);
+		CREATE_MH_FEATURE_HOOK(triggerHapicPulseHook, _triggerHapticPulse, "IVRControllerComponent001Hooks::TriggerHapticPulse", iptr, 1, HookFeature::Haptics);
 		_hookedTriggerHapticPulseAdressMap[triggerHapicPulseAddress].useCount = 1;
 		_hookedTriggerHapticPulseAdressMap[triggerHapicPulseAddress].hookData = triggerHapicPulseHook;
 	} else {
@@ -17,9 +17,9 @@ HookData<IVRDriverInput001Hooks::createHapticComponent_t> IVRDriverInput001Hooks
 IVRDriverInput001Hooks::IVRDriverInput001Hooks(void* iptr) {
 	if (!_isHooked) {
 		CREATE_MH_HOOK(createBooleanComponentHook, _createBooleanComponent, "IVRDriverInput001Hooks::CreateBooleanComponent", iptr, 0);
-		CREATE_MH_HOOK(updateBooleanComponentHook, _updateBooleanComponent, "IVRDriverInput001Hooks::UpdateBooleanComponent", iptr, 1);
+		CREATE_MH_FEATURE_HOOK(updateBooleanComponentHook, _updateBooleanComponent, "IVRDriverInput001Hooks::UpdateBooleanComponent", iptr, 1, HookFeature::DigitalInput);
 		CREATE_MH_HOOK(createScalarComponentHook, _createScalarComponent, "IVRDriverInput001Hooks::CreateScalarComponent", iptr, 2);
-		CREATE_MH_HOOK(updateScalarComponentHook, _updateScalarComponent, "IVRDriverInput001Hooks::UpdateScalarComponent", iptr, 3);
+		CREATE_MH_FEATURE_HOOK(updateScalarComponentHook, _updateScalarComponent, "IVRDriverInput001Hooks::UpdateScalarComponent", iptr, 3, HookFeature::AnalogInput);
 		CREATE_MH_HOOK(createHapticComponentHook, _createHapticComponent, "IVRDriverInput001Hooks::CreateHapticComponent", iptr, 4);
 		_isHooked = true;
 	}
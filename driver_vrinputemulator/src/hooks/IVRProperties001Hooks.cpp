@@ -13,8 +13,8 @@ HookData<IVRProperties001Hooks::writePropertyBatch_t> IVRProperties001Hooks::wri
 
 IVRProperties001Hooks::IVRProperties001Hooks(void* iptr) {
 	if (!_isHooked) {
-		CREATE_MH_HOOK(readPropertyBatchHook, _readPropertyBatch, "IVRproperties001Hooks::ReadPropertyBatch", iptr, 0);
-		CREATE_MH_HOOK(writePropertyBatchHook, _writePropertyBatch, "IVRproperties001Hooks::WritePropertyBatch", iptr, 1);
+		CREATE_MH_FEATURE_HOOK(readPropertyBatchHook, _readPropertyBatch, "IVRproperties001Hooks::ReadPropertyBatch", iptr, 0, HookFeature::PropertyBatches);
+		CREATE_MH_FEATURE_HOOK(writePropertyBatchHook, _writePropertyBatch, "IVRproperties001Hooks::WritePropertyBatch", iptr, 1, HookFeature::PropertyBatches);
 		_isHooked = true;
 	}
 }
@@ -20,11 +20,11 @@ IVRServerDriverHost004Hooks::IVRServerDriverHost004Hooks(void* iptr) {
 	if (!_isHooked) {
 		CREATE_MH_HOOK(trackedDeviceAddedHook, _trackedDeviceAdded, "IVRServerDriverHost004::TrackedDeviceAdded", iptr, 0);
 		CREATE_MH_HOOK(trackedDevicePoseUpdatedHook, _trackedDevicePoseUpdated, "IVRServerDriverHost004::TrackedDevicePoseUpdated", iptr, 1);
-		CREATE_MH_HOOK(trackedDeviceButtonPressedHook, _trackedDeviceButtonPressed, "IVRServerDriverHost004::TrackedDeviceButtonPressed", iptr, 3);
-		CREATE_MH_HOOK(trackedDeviceButtonUnpressedHook, _trackedDeviceButtonUnpressed, "IVRServerDriverHost004::TrackedDeviceButtonUnpressed", iptr, 4);
-		CREATE_MH_HOOK(trackedDeviceButtonTouchedHook, _trackedDeviceButtonTouched, "IVRServerDriverHost004::TrackedDeviceButtonTouched", iptr, 5);
-		CREATE_MH_HOOK(trackedDeviceButtonUntouchedHook, _trackedDeviceButtonUntouched, "IVRServerDriverHost004::TrackedDeviceButtonUntouched", iptr, 6);
-		CREATE_MH_HOOK(trackedDeviceAxisUpdatedHook, _trackedDeviceAxisUpdated, "IVRServerDriverHost004::TrackedDeviceAxisUpdated", iptr, 7);
+		CREATE_MH_FEATURE_HOOK(trackedDeviceButtonPressedHook, _trackedDeviceButtonPressed, "IVRServerDriverHost004::TrackedDeviceButtonPressed", iptr, 3, HookFeature::DigitalInput);
+		CREATE_MH_FEATURE_HOOK(trackedDeviceButtonUnpressedHook, _trackedDeviceButtonUnpressed, "IVRServerDriverHost004::TrackedDeviceButtonUnpressed", iptr, 4, HookFeature::DigitalInput);
+		CREATE_MH_FEATURE_HOOK(trackedDeviceButtonTouchedHook, _trackedDeviceButtonTouched, "IVRServerDriverHost004::TrackedDeviceButtonTouched", iptr, 5, HookFeature::DigitalInput);
+		CREATE_MH_FEATURE_HOOK(trackedDeviceButtonUntouchedHook, _trackedDeviceButtonUntouched, "IVRServerDriverHost004::TrackedDeviceButtonUntouched", iptr, 6, HookFeature::DigitalInput);
+		CREATE_MH_FEATURE_HOOK(trackedDeviceAxisUpdatedHook, _trackedDeviceAxisUpdated, "IVRServerDriverHost004::TrackedDeviceAxisUpdated", iptr, 7, HookFeature::AnalogInput);
 		_isHooked = true;
 	}
 }
@@ -88,6 +88,11 @@ void IVRServerDriverHost004Hooks::_trackedDevicePoseUpdated(void* _this, uint32_
 	// Vive Controller: 369 calls/s each
 	//
 	// Time is key. If we assume 1 HMD and 13 controllers, we have a total of  ~6000 calls/s. That's about 166 microseconds per call at 100% load.
+	if (!serverDriver->poseNeedsProcessing(unWhichDevice)) {
+		serverDriver->passthroughPoseUpdated(unWhichDevice, newPose);
+		trackedDevicePoseUpdatedHook.origFunc(_this, unWhichDevice, newPose, unPoseStructSize);
+		return;
+	}
 	auto poseCopy = newPose;
 	if (serverDriver->hooksTrackedDevicePoseUpdated(_this, 4, unWhichDevice, poseCopy, unPoseStructSize)) {
 		trackedDevicePoseUpdatedHook.origFunc(_this, unWhichDevice, poseCopy, unPoseStructSize);
@@ -95,30 +100,50 @@ void IVRServerDriverHost004Hooks::_trackedDevicePoseUpdated(void* _this, uint32_
 }
 
 void IVRServerDriverHost004Hooks::_trackedDeviceButtonPressed(void* _this, uint32_t unWhichDevice, vr::EVRButtonId eButtonId, double eventTimeOffset) {
+	if (!serverDriver->inputNeedsProcessing(unWhichDevice)) {
+		trackedDeviceButtonPressedHook.origFunc(_this, unWhichDevice, eButtonId, eventTimeOffset);
+		return;
+	}
 	if (serverDriver->hooksTrackedDeviceButtonPressed(_this, 4, unWhichDevice, eButtonId, eventTimeOffset)) {
 		trackedDeviceButtonPressedHook.origFunc(_this, unWhichDevice, eButtonId, eventTimeOffset);
 	}
 }
 
 void IVRServerDriverHost004Hooks::_trackedDeviceButtonUnpressed(void* _this, uint32_t unWhichDevice, vr::EVRButtonId eButtonId, double eventTimeOffset) {
+	if (!serverDriver->inputNeedsProcessing(unWhichDevice)) {
+		trackedDeviceButtonUnpressedHook.origFunc(_this, unWhichDevice, eButtonId, eventTimeOffset);
+		return;
+	}
 	if (serverDriver->hooksTrackedDeviceButtonUnpressed(_this, 4, unWhichDevice, eButtonId, eventTimeOffset)) {
 		trackedDeviceButtonUnpressedHook.origFunc(_this, unWhichDevice, eButtonId, eventTimeOffset);
 	}
 }
 
 void IVRServerDriverHost004Hooks::_trackedDeviceButtonTouched(void* _this, uint32_t unWhichDevice, vr::EVRButtonId eButtonId, double eventTimeOffset) {
+	if (!serverDriver->inputNeedsProcessing(unWhichDevice)) {
+		trackedDeviceButtonTouchedHook.origFunc(_this, unWhichDevice, eButtonId, eventTimeOffset);
+		return;
+	}
 	if (serverDriver->hooksTrackedDeviceButtonTouched(_this, 4, unWhichDevice, eButtonId, eventTimeOffset)) {
 		trackedDeviceButtonTouchedHook.origFunc(_this, unWhichDevice, eButtonId, eventTimeOffset);
 	}
 }
 
 void IVRServerDriverHost004Hooks::_trackedDeviceButtonUntouched(void* _this, uint32_t unWhichDevice, vr::EVRButtonId eButtonId, double eventTimeOffset) {
+	if (!serverDriver->inputNeedsProcessing(unWhichDevice)) {
+		trackedDeviceButtonUntouchedHook.origFunc(_this, unWhichDevice, eButtonId, eventTimeOffset);
+		return;
+	}
 	if (serverDriver->hooksTrackedDeviceButtonUntouched(_this, 4, unWhichDevice, eButtonId, eventTimeOffset)) {
 		trackedDeviceButtonUntouchedHook.origFunc(_this, unWhichDevice, eButtonId, eventTimeOffset);
 	}
 }
 
 void IVRServerDriverHost004Hooks::_trackedDeviceAxisUpdated(void* _this, uint32_t unWhichDevice, uint32_t unWhichAxis, const vr::VRControllerAxis_t & axisState) {
+	if (!serverDriver->inputNeedsProcessing(unWhichDevice)) {
+		trackedDeviceAxisUpdatedHook.origFunc(_this, unWhichDevice, unWhichAxis, axisState);
+		return;
+	}
 	auto stateCopy = axisState;
 	if (serverDriver->hooksTrackedDeviceAxisUpdated(_this, 4, unWhichDevice, unWhichAxis, stateCopy)) {
 		trackedDeviceAxisUpdatedHook.origFunc(_this, unWhichDevice, unWhichAxis, stateCopy);
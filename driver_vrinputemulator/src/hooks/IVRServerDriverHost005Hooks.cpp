@@ -16,7 +16,7 @@ IVRServerDriverHost005Hooks::IVRServerDriverHost005Hooks(void* iptr) {
 	if (!_isHooked) {
 		CREATE_MH_HOOK(trackedDeviceAddedHook, _trackedDeviceAdded, "IVRServerDriverHost005::TrackedDeviceAdded", iptr, 0);
 		CREATE_MH_HOOK(trackedDevicePoseUpdatedHook, _trackedDevicePoseUpdated, "IVRServerDriverHost005::TrackedDevicePoseUpdated", iptr, 1);
-		CREATE_MH_HOOK(pollNextEventHook, _pollNextEvent, "IVRServerDriverHost005::PollNextEvent", iptr, 5);
+		CREATE_MH_FEATURE_HOOK(pollNextEventHook, _pollNextEvent, "IVRServerDriverHost005::PollNextEvent", iptr, 5, HookFeature::EventInjection);
 		_isHooked = true;
 	}
 }
@@ -56,6 +56,11 @@ void IVRServerDriverHost005Hooks::_trackedDevicePoseUpdated(void* _this, uint32_
 	// Vive Controller: 369 calls/s each
 	//
 	// Time is key. If we assume 1 HMD and 13 controllers, we have a total of  ~6000 calls/s. That's about 166 microseconds per call at 100% load.
+	if (!serverDriver->poseNeedsProcessing(unWhichDevice)) {
+		serverDriver->passthroughPoseUpdated(unWhichDevice, newPose);
+		trackedDevicePoseUpdatedHook.origFunc(_this, unWhichDevice, newPose, unPoseStructSize);
+		return;
+	}
 	auto poseCopy = newPose;
 	if (serverDriver->hooksTrackedDevicePoseUpdated(_this, 5, unWhichDevice, poseCopy, unPoseStructSize)) {
 		trackedDevicePoseUpdatedHook.origFunc(_this, unWhichDevice, poseCopy, unPoseStructSize);
@@ -63,18 +68,10 @@ void IVRServerDriverHost005Hooks::_trackedDevicePoseUpdated(void* _this, uint32_
 }
 
 bool IVRServerDriverHost005Hooks::_pollNextEvent(void* _this, void* pEvent, uint32_t uncbVREvent) {
-	auto injectedEvent = serverDriver->getDriverEventForInjection(_this);
-	if (injectedEvent.first) {
-		if (injectedEvent.second == uncbVREvent) {
-			memcpy(pEvent, injectedEvent.first.get(), uncbVREvent);
-			auto event = (vr::VREvent_t*)pEvent;
-			LOG(DEBUG) << "IVRServerDriverHost005Hooks::_pollNextEvent: Injecting event: " << event->eventType << ", " << event->trackedDeviceIndex;
-			return true;
-		} else {
-			auto event = (vr::VREvent_t*)injectedEvent.first.get();
-			LOG(ERROR) << "IVRServerDriverHost005Hooks::_pollNextEvent: Could not inject event (" << event->eventType << ", " << event->trackedDeviceIndex 
-				<< ") because size does not match, expected " << uncbVREvent << " but got " << injectedEvent.second;
-		}
+	if (serverDriver->getDriverEventForInjection(_this, pEvent, uncbVREvent)) {
+		auto event = (vr::VREvent_t*)pEvent;
+		LOG(DEBUG) << "IVRServerDriverHost005Hooks::_pollNextEvent: Injecting event: " << event->eventType << ", " << event->trackedDeviceIndex;
+		return true;
 	}
 	bool retval, hretval;
 	do {
@@ -17,6 +17,79 @@ namespace driver {
 ServerDriver* InterfaceHooks::serverDriver = nullptr;
 
 
+std::mutex HookFeatures::_mutex;
+int HookFeatures::_refCounts[(int)HookFeature::Count] = {};
+std::vector<HookFeatures::HookEntry> HookFeatures::_hooks;
+
+
+void HookFeatures::acquire(HookFeature feature) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (_refCounts[(int)feature]++ == 0) {
+		for (auto& h : _hooks) {
+			if (h.feature == feature) {
+				_setEnabled(h, true);
+			}
+		}
+	}
+}
+
+
+void HookFeatures::release(HookFeature feature) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (_refCounts[(int)feature] <= 0) {
+		LOG(ERROR) << "HookFeatures::release: Feature " << (int)feature << " is not in use.";
+	} else if (--_refCounts[(int)feature] == 0) {
+		for (auto& h : _hooks) {
+			if (h.feature == feature) {
+				_setEnabled(h, false);
+			}
+		}
+	}
+}
+
+
+bool HookFeatures::isActive(HookFeature feature) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _refCounts[(int)feature] > 0;
+}
+
+
+void HookFeatures::addHook(HookFeature feature, void* targetFunc, const char* logName) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	_hooks.push_back({ feature, targetFunc, logName, false });
+	if (_refCounts[(int)feature] > 0) {
+		_setEnabled(_hooks.back(), true);
+	} else {
+		LOG(INFO) << logName << " hook is created but not yet needed (Address: " << std::hex << targetFunc << std::dec << ")";
+	}
+}
+
+
+void HookFeatures::removeHook(void* targetFunc) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	for (auto it = _hooks.begin(); it != _hooks.end(); ++it) {
+		if (it->targetFunc == targetFunc) {
+			_hooks.erase(it);
+			break;
+		}
+	}
+}
+
+
+void HookFeatures::_setEnabled(HookEntry& entry, bool enable) {
+	if (entry.enabled == enable) {
+		return;
+	}
+	auto hookError = enable ? platform::enableHook(entry.targetFunc) : platform::disableHook(entry.targetFunc);
+	if (!hookError) {
+		entry.enabled = enable;
+		LOG(INFO) << entry.logName << " hook is " << (enable ? "enabled" : "disabled") << " (Address: " << std::hex << entry.targetFunc << std::dec << ")";
+	} else {
+		LOG(ERROR) << "Error while " << (enable ? "enabling " : "disabling ") << entry.logName << " hook: " << hookError;
+	}
+}
+
+
 std::shared_ptr<InterfaceHooks> InterfaceHooks::hookInterface(void* interfaceRef, std::string interfaceVersion) {
 	std::shared_ptr<InterfaceHooks> retval;
 	if (interfaceVersion.compare("IVRDriverContext") == 0) {
@@ -2,14 +2,17 @@
 
 #include <string>
 #include <stdint.h>
-#include <MinHook.h>
+#include <memory>
+#include <mutex>
+#include <vector>
 #include "../logging.h"
+#include "../platform/platform.h"
 
 
 namespace vr {
-	enum EVRInputError;
-	enum EVRScalarType;
-	enum EVRScalarUnits;
+	enum EVRInputError : int;
+	enum EVRScalarType : int;
+	enum EVRScalarUnits : int;
 	typedef uint64_t VRInputComponentHandle_t;
 }
 
@@ -20,30 +23,88 @@ namespace driver {
 
 #define CREATE_MH_HOOK(detourInfo, detourFunc, logName, objPtr, vtableOffset) {\
 	detourInfo.targetFunc = (*((void***)objPtr))[vtableOffset]; \
-	MH_STATUS mhError = MH_CreateHook(detourInfo.targetFunc, (void*)&detourFunc, reinterpret_cast<LPVOID*>(&detourInfo.origFunc)); \
-	if (mhError == MH_OK) { \
-		mhError = MH_EnableHook(detourInfo.targetFunc); \
-		if (mhError == MH_OK) { \
-			detourInfo.enabled = true; \
+	const char* hookError = platform::createHook(detourInfo.targetFunc, (void*)&detourFunc, reinterpret_cast<void**>(&detourInfo.origFunc)); \
+	if (!hookError) { \
+		hookError = platform::enableHook(detourInfo.targetFunc); \
+		if (!hookError) { \
+			detourInfo.created = true; \
 			LOG(INFO) << logName << " hook is enabled (Address: " << std::hex << detourInfo.targetFunc << std::dec << ")"; \
 		} else { \
-			MH_RemoveHook(detourInfo.targetFunc); \
-			LOG(ERROR) << "Error while enabling " << logName << " hook: " << MH_StatusToString(mhError); \
+			platform::removeHook(detourInfo.targetFunc); \
+			LOG(ERROR) << "Error while enabling " << logName << " hook: " << hookError; \
 		} \
 	} else { \
-		LOG(ERROR) << "Error while creating " << logName << " hook: " << MH_StatusToString(mhError); \
+		LOG(ERROR) << "Error while creating " << logName << " hook: " << hookError; \
+	}\
+}
+
+
+// Creates the hook disabled, it gets enabled while the given HookFeature is in use
+#define CREATE_MH_FEATURE_HOOK(detourInfo, detourFunc, logName, objPtr, vtableOffset, feature) {\
+	detourInfo.targetFunc = (*((void***)objPtr))[vtableOffset]; \
+	const char* hookError = platform::createHook(detourInfo.targetFunc, (void*)&detourFunc, reinterpret_cast<void**>(&detourInfo.origFunc)); \
+	if (!hookError) { \
+		detourInfo.created = true; \
+		HookFeatures::addHook(feature, detourInfo.targetFunc, logName); \
+	} else { \
+		LOG(ERROR) << "Error while creating " << logName << " hook: " << hookError; \
 	}\
 }
 
 
 #define REMOVE_MH_HOOK(detourInfo) {\
-	if (detourInfo.enabled) { \
-		MH_RemoveHook(detourInfo.targetFunc); \
-		detourInfo.enabled = false; \
+	if (detourInfo.created) { \
+		HookFeatures::removeHook(detourInfo.targetFunc); \
+		platform::removeHook(detourInfo.targetFunc); \
+		detourInfo.created = false; \
 	}\
 }
 
 
+/** Groups of hooks on hot paths that are only needed while certain features are in use */
+enum class HookFeature : int {
+	DigitalInput, // Button events and boolean component updates
+	AnalogInput, // Axis updates and scalar component updates
+	Haptics, // Legacy haptic pulses
+	EventInjection, // PollNextEvent (haptic events of redirected devices, injected driver events)
+	PropertyBatches, // Property reads and writes
+	Count
+};
+
+
+/**
+* Reference counted activation of feature hooks.
+*
+* Feature hooks are created at startup like all other hooks, but stay disabled until someone acquires their
+* feature. When the last reference is released they are disabled again, so SteamVR calls the original functions
+* directly. Disabled hooks keep their trampoline, so detours that are still running can call origFunc safely.
+*/
+class HookFeatures {
+public:
+	static void acquire(HookFeature feature);
+	static void release(HookFeature feature);
+	static bool isActive(HookFeature feature);
+
+	/** Registers a created but not yet enabled hook, enables it right away when its feature is active */
+	static void addHook(HookFeature feature, void* targetFunc, const char* logName);
+	static void removeHook(void* targetFunc);
+
+private:
+	struct HookEntry {
+		HookFeature feature;
+		void* targetFunc;
+		std::string logName;
+		bool enabled;
+	};
+
+	static void _setEnabled(HookEntry& entry, bool enable);
+
+	static std::mutex _mutex;
+	static int _refCounts[(int)HookFeature::Count];
+	static std::vector<HookEntry> _hooks;
+};
+
+
 //forward declarations
 class ServerDriver;
 class IVRDriverContextHooks;
@@ -51,7 +112,7 @@ class IVRServerDriverHost004Hooks;
 
 template<class T>
 struct HookData {
-	bool enabled = false;
+	bool created = false;
 	void* targetFunc = nullptr;
 	T origFunc = nullptr;
 };
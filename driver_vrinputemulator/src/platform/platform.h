@@ -0,0 +1,75 @@
+#pragma once
+
+#include <string>
+#include <stdint.h>
+
+
+// driver namespace
+namespace vrinputemulator {
+namespace driver {
+namespace platform {
+
+
+/**
+* Everything the driver needs from the operating system: function hooking, file handling, sound output and keyboard injection.
+*
+* platform_win32.cpp implements it with MinHook and the Win32 API and is used by the driver dll.
+* When VRINPUTEMULATOR_HEADLESS is defined platform_headless.cpp is compiled instead. It does not patch any code,
+* hooks are kept in a table and must be dispatched explicitly with getHookedFunction() (see driver_testhost),
+* and side effects are only counted. This allows to run the device manipulation pipeline without SteamVR.
+*/
+
+
+/** Path separator used when building paths relative to the install directory */
+extern const char* const pathSeparator;
+
+
+//// function hooks ////
+
+/** All hooking functions return nullptr on success, otherwise an error description */
+const char* initHooking();
+const char* shutdownHooking();
+const char* createHook(void* targetFunc, void* detourFunc, void** origFunc);
+const char* enableHook(void* targetFunc);
+const char* disableHook(void* targetFunc);
+const char* removeHook(void* targetFunc);
+
+/** Returns the function that is executed when targetFunc gets called (the detour when an enabled hook exists) */
+void* getHookedFunction(void* targetFunc);
+
+
+//// files ////
+
+/** Sets the size of an existing file, returns false on error */
+bool resizeFile(const std::string& path, uint64_t size);
+
+/** Creates a directory (not its parents), returns true when it exists afterwards */
+bool createDirectory(const std::string& path);
+
+
+//// side effects ////
+
+void playSound(const std::string& file);
+
+/** Presses/releases keyCode (a Windows virtual key code) together with the given modifiers */
+void sendKeyboardInput(bool keyUp, bool shiftPressed, bool ctrlPressed, bool altPressed, uint16_t keyCode, bool sendScanCode);
+
+
+struct SideEffectCounters {
+	uint64_t playedSounds = 0;
+	uint64_t keyboardInputs = 0;
+};
+
+SideEffectCounters getSideEffectCounters();
+
+
+//// timing ////
+
+/** Requests 1 ms scheduler granularity for sleeps on the calling thread's behalf, calls have to be paired */
+void beginHighResolutionTimer();
+void endHighResolutionTimer();
+
+
+} // end namespace platform
+} // end namespace driver
+} // end namespace vrinputemulator
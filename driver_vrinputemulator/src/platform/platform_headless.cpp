@@ -0,0 +1,194 @@
+#if !defined(_WIN32) || defined(VRINPUTEMULATOR_HEADLESS)
+
+#include "platform.h"
+
+#include <atomic>
+#include <mutex>
+#include <cstdint>
+#include <cerrno>
+#if defined(_WIN32)
+#include <io.h>
+#include <fcntl.h>
+#include <share.h>
+#include <direct.h>
+#else
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+
+
+namespace vrinputemulator {
+namespace driver {
+namespace platform {
+
+
+#if defined(_WIN32)
+const char* const pathSeparator = "\\";
+#else
+const char* const pathSeparator = "/";
+#endif
+
+static std::atomic<uint64_t> _playedSounds(0);
+static std::atomic<uint64_t> _keyboardInputs(0);
+
+
+// Nothing gets patched, the hosting application has to call getHookedFunction() to dispatch into the detours.
+// getHookedFunction() runs on every dispatched call, so the table is a fixed open addressing array it can probe
+// without locking. A slot belongs to its target function forever, removed hooks only clear the detour.
+struct HeadlessHook {
+	std::atomic<void*> targetFunc { nullptr };
+	std::atomic<void*> activeDetour { nullptr }; // The detour while the hook is enabled
+	void* detourFunc = nullptr; // nullptr when no hook exists
+};
+static const size_t _maxHooks = 256; // Power of two
+static std::mutex _hooksMutex; // Serializes all writers
+static HeadlessHook _hooks[_maxHooks];
+
+
+/** Returns nullptr when targetFunc has no slot, with claim set a free slot is taken (needs _hooksMutex) */
+static HeadlessHook* _findHook(void* targetFunc, bool claim) {
+	auto index = (size_t)(((uint64_t)(uintptr_t)targetFunc * 0x9E3779B97F4A7C15ull) >> 32);
+	for (size_t i = 0; i < _maxHooks; ++i) {
+		auto& hook = _hooks[(index + i) & (_maxHooks - 1)];
+		auto func = hook.targetFunc.load(std::memory_order_acquire);
+		if (func == targetFunc) {
+			return &hook;
+		} else if (!func) {
+			if (claim) {
+				hook.targetFunc.store(targetFunc, std::memory_order_release);
+				return &hook;
+			}
+			return nullptr;
+		}
+	}
+	return nullptr;
+}
+
+
+const char* initHooking() {
+	return nullptr;
+}
+
+const char* shutdownHooking() {
+	std::lock_guard<std::mutex> lock(_hooksMutex);
+	for (auto& hook : _hooks) {
+		hook.activeDetour.store(nullptr, std::memory_order_release);
+		hook.detourFunc = nullptr;
+	}
+	return nullptr;
+}
+
+const char* createHook(void* targetFunc, void* detourFunc, void** origFunc) {
+	std::lock_guard<std::mutex> lock(_hooksMutex);
+	if (!targetFunc || !detourFunc) {
+		return "Invalid function pointer";
+	}
+	auto hook = _findHook(targetFunc, true);
+	if (!hook) {
+		return "Too many hooks";
+	} else if (hook->detourFunc) {
+		return "Hook already exists";
+	}
+	hook->detourFunc = detourFunc;
+	*origFunc = targetFunc;
+	return nullptr;
+}
+
+const char* enableHook(void* targetFunc) {
+	std::lock_guard<std::mutex> lock(_hooksMutex);
+	auto hook = _findHook(targetFunc, false);
+	if (!hook || !hook->detourFunc) {
+		return "Hook not found";
+	}
+	hook->activeDetour.store(hook->detourFunc, std::memory_order_release);
+	return nullptr;
+}
+
+const char* disableHook(void* targetFunc) {
+	std::lock_guard<std::mutex> lock(_hooksMutex);
+	auto hook = _findHook(targetFunc, false);
+	if (!hook || !hook->detourFunc) {
+		return "Hook not found";
+	}
+	hook->activeDetour.store(nullptr, std::memory_order_release);
+	return nullptr;
+}
+
+const char* removeHook(void* targetFunc) {
+	std::lock_guard<std::mutex> lock(_hooksMutex);
+	auto hook = _findHook(targetFunc, false);
+	if (!hook || !hook->detourFunc) {
+		return "Hook not found";
+	}
+	hook->activeDetour.store(nullptr, std::memory_order_release);
+	hook->detourFunc = nullptr;
+	return nullptr;
+}
+
+void* getHookedFunction(void* targetFunc) {
+	auto hook = _findHook(targetFunc, false);
+	if (hook) {
+		auto detour = hook->activeDetour.load(std::memory_order_acquire);
+		if (detour) {
+			return detour;
+		}
+	}
+	return targetFunc;
+}
+
+
+bool resizeFile(const std::string& path, uint64_t size) {
+#if defined(_WIN32)
+	int fd;
+	if (_sopen_s(&fd, path.c_str(), _O_RDWR | _O_BINARY, _SH_DENYNO, 0) != 0) {
+		return false;
+	}
+	bool retval = _chsize_s(fd, (long long)size) == 0;
+	_close(fd);
+	return retval;
+#else
+	return ::truncate(path.c_str(), (off_t)size) == 0;
+#endif
+}
+
+
+bool createDirectory(const std::string& path) {
+#if defined(_WIN32)
+	return _mkdir(path.c_str()) == 0 || errno == EEXIST;
+#else
+	return ::mkdir(path.c_str(), 0755) == 0 || errno == EEXIST;
+#endif
+}
+
+
+void playSound(const std::string&) {
+	_playedSounds++;
+}
+
+
+void sendKeyboardInput(bool, bool, bool, bool, uint16_t, bool) {
+	_keyboardInputs++;
+}
+
+
+SideEffectCounters getSideEffectCounters() {
+	SideEffectCounters counters;
+	counters.playedSounds = _playedSounds;
+	counters.keyboardInputs = _keyboardInputs;
+	return counters;
+}
+
+
+void beginHighResolutionTimer() {
+}
+
+
+void endHighResolutionTimer() {
+}
+
+
+} // end namespace platform
+} // end namespace driver
+} // end namespace vrinputemulator
+
+#endif
@@ -0,0 +1,175 @@
+#if defined(_WIN32) && !defined(VRINPUTEMULATOR_HEADLESS)
+
+#include "platform.h"
+
+#include <atomic>
+#include <MinHook.h>
+
+#undef WIN32_LEAN_AND_MEAN
+#undef NOSOUND
+#include <Windows.h>
+// According to windows documentation mmsystem.h should be automatically included with Windows.h when WIN32_LEAN_AND_MEAN and NOSOUND are not defined
+// But it doesn't work so I have to include it manually
+#include <mmsystem.h>
+
+
+namespace vrinputemulator {
+namespace driver {
+namespace platform {
+
+
+const char* const pathSeparator = "\\";
+
+static std::atomic<uint64_t> _playedSounds(0);
+static std::atomic<uint64_t> _keyboardInputs(0);
+
+
+static const char* _mhStatus(MH_STATUS status) {
+	return status == MH_OK ? nullptr : MH_StatusToString(status);
+}
+
+const char* initHooking() {
+	return _mhStatus(MH_Initialize());
+}
+
+const char* shutdownHooking() {
+	return _mhStatus(MH_Uninitialize());
+}
+
+const char* createHook(void* targetFunc, void* detourFunc, void** origFunc) {
+	return _mhStatus(MH_CreateHook(targetFunc, detourFunc, reinterpret_cast<LPVOID*>(origFunc)));
+}
+
+const char* enableHook(void* targetFunc) {
+	return _mhStatus(MH_EnableHook(targetFunc));
+}
+
+const char* disableHook(void* targetFunc) {
+	return _mhStatus(MH_DisableHook(targetFunc));
+}
+
+const char* removeHook(void* targetFunc) {
+	return _mhStatus(MH_RemoveHook(targetFunc));
+}
+
+void* getHookedFunction(void* targetFunc) {
+	// MinHook patches the target function itself
+	return targetFunc;
+}
+
+
+bool resizeFile(const std::string& path, uint64_t size) {
+	auto file = CreateFileA(path.c_str(), GENERIC_WRITE, 0, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	LARGE_INTEGER newSize;
+	newSize.QuadPart = (LONGLONG)size;
+	bool retval = SetFilePointerEx(file, newSize, NULL, FILE_BEGIN) && SetEndOfFile(file);
+	CloseHandle(file);
+	return retval;
+}
+
+
+bool createDirectory(const std::string& path) {
+	return CreateDirectoryA(path.c_str(), NULL) || GetLastError() == ERROR_ALREADY_EXISTS;
+}
+
+
+void playSound(const std::string& file) {
+	PlaySoundA(file.c_str(), NULL, SND_FILENAME | SND_ASYNC | SND_NODEFAULT);
+	_playedSounds++;
+}
+
+
+void sendKeyboardInput(bool keyUp, bool shiftPressed, bool ctrlPressed, bool altPressed, uint16_t keyCode, bool sendScanCode) {
+	INPUT ips[4];
+	memset(ips, 0, sizeof(ips));
+	WORD flags = 0;
+	/* DirectInput games ignore virtual key codes, for those scan codes should be used */
+	if (sendScanCode) {
+		flags |= KEYEVENTF_SCANCODE;
+		keyCode = MapVirtualKey(keyCode, MAPVK_VK_TO_VSC);
+	}
+	if (keyUp) {
+		flags |= KEYEVENTF_KEYUP;
+	}
+	unsigned ipCount = 0;
+	if (keyUp && keyCode) {
+		ips[ipCount].type = INPUT_KEYBOARD;
+		if (sendScanCode) {
+			ips[ipCount].ki.wScan = keyCode;
+		} else {
+			ips[ipCount].ki.wVk = keyCode;
+		}
+		ips[ipCount].ki.dwFlags = flags;
+		ipCount++;
+	}
+	if (shiftPressed) {
+		ips[ipCount].type = INPUT_KEYBOARD;
+		if (sendScanCode) {
+			ips[ipCount].ki.wScan = MapVirtualKey(VK_SHIFT, MAPVK_VK_TO_VSC);
+		} else {
+			ips[ipCount].ki.wVk = VK_SHIFT;
+		}
+		ips[ipCount].ki.dwFlags = flags;
+		ipCount++;
+	}
+	if (ctrlPressed) {
+		ips[ipCount].type = INPUT_KEYBOARD;
+		if (sendScanCode) {
+			ips[ipCount].ki.wScan = MapVirtualKey(VK_CONTROL, MAPVK_VK_TO_VSC);
+		} else {
+			ips[ipCount].ki.wVk = VK_CONTROL;
+		}
+		ips[ipCount].ki.dwFlags = flags;
+		ipCount++;
+	}
+	if (altPressed) {
+		ips[ipCount].type = INPUT_KEYBOARD;
+		if (sendScanCode) {
+			ips[ipCount].ki.wScan = MapVirtualKey(VK_MENU, MAPVK_VK_TO_VSC);
+		} else {
+			ips[ipCount].ki.wVk = VK_MENU;
+		}
+		ips[ipCount].ki.dwFlags = flags;
+		ipCount++;
+	}
+	if (!keyUp && keyCode) {
+		ips[ipCount].type = INPUT_KEYBOARD;
+		if (sendScanCode) {
+			ips[ipCount].ki.wScan = keyCode;
+		} else {
+			ips[ipCount].ki.wVk = keyCode;
+		}
+		ips[ipCount].ki.dwFlags = flags;
+		ipCount++;
+	}
+	SendInput(4, ips, sizeof(INPUT));
+	_keyboardInputs++;
+}
+
+
+SideEffectCounters getSideEffectCounters() {
+	SideEffectCounters counters;
+	counters.playedSounds = _playedSounds;
+	counters.keyboardInputs = _keyboardInputs;
+	return counters;
+}
+
+
+void beginHighResolutionTimer() {
+	timeBeginPeriod(1);
+}
+
+
+void endHighResolutionTimer() {
+	timeEndPeriod(1);
+}
+
+
+} // end namespace platform
+} // end namespace driver
+} // end namespace vrinputemulator
+
+#endif
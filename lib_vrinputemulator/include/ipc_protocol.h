@@ -4,7 +4,7 @@
 #include <utility>
 
 
-#define IPC_PROTOCOL_VERSION 3
+#define IPC_PROTOCOL_VERSION 17
 
 namespace vrinputemulator {
 namespace ipc {
@@ -38,6 +38,8 @@ enum class RequestType : uint32_t {
 	VirtualDevices_RemoveDeviceProperty,
 	VirtualDevices_SetDevicePose,
 	VirtualDevices_SetControllerState,
+	VirtualDevices_SetPosePrediction,
+	VirtualDevices_SetPoseRate,
 
 	DeviceManipulation_GetDeviceInfo,
 	DeviceManipulation_ButtonMapping,
@@ -50,6 +52,13 @@ enum class RequestType : uint32_t {
 	DeviceManipulation_FakeDisconnectedMode,
 	DeviceManipulation_TriggerHapticPulse,
 	DeviceManipulation_SetMotionCompensationProperties,
+	DeviceManipulation_SubscribeDeviceStateChanges,
+	DeviceManipulation_SubscribePoseTelemetry,
+	DeviceManipulation_HookCapture,
+	DeviceManipulation_InputMirror,
+	DeviceManipulation_SetPoseSmoothing,
+	DeviceManipulation_SetMotionCompensationGroup,
+	DeviceManipulation_SubscribeDevicePoses,
 
 	InputRemapping_SetDigitalRemapping,
 	InputRemapping_GetDigitalRemapping,
@@ -75,6 +84,7 @@ enum class ReplyType : uint32_t {
 
 	DeviceManipulation_GetDeviceInfo,
 	DeviceManipulation_GetDeviceOffsets,
+	DeviceManipulation_DeviceStateChanged, // Pushed to subscribed clients, messageId is always 0
 
 	InputRemapping_GetDigitalRemapping,
 	InputRemapping_GetAnalogRemapping
@@ -223,6 +233,20 @@ struct Request_VirtualDevices_SetControllerState {
 	vr::VRControllerState_t controllerState;
 };
 
+struct Request_VirtualDevices_SetPosePrediction {
+	uint32_t clientId;
+	uint32_t messageId; // Used to associate with Reply
+	uint32_t virtualDeviceId;
+	PosePredictionSettings settings;
+};
+
+struct Request_VirtualDevices_SetPoseRate {
+	uint32_t clientId;
+	uint32_t messageId; // Used to associate with Reply
+	uint32_t virtualDeviceId; // k_unTrackedDeviceIndexInvalid .. rate of the pose pump
+	uint32_t rate; // Hz, 0 .. pump rate (device) or RunFrame (pump)
+};
+
 struct Request_DeviceManipulation_ButtonMapping {
 	uint32_t clientId;
 	uint32_t messageId; // Used to associate with Reply
@@ -284,6 +308,8 @@ struct Request_DeviceManipulation_TriggerHapticPulse {
 	uint32_t axisId;
 	uint16_t durationMicroseconds;
 	bool directMode;
+	uint32_t waveformSegmentCount; // When > 0 the waveform is played instead of a single pulse of durationMicroseconds
+	HapticWaveformSegment waveform[maxHapticWaveformSegments];
 };
 
 struct Request_DeviceManipulation_SetMotionCompensationProperties {
@@ -297,6 +323,57 @@ struct Request_DeviceManipulation_SetMotionCompensationProperties {
 	double kalmanFilterObservationNoise;
 	bool movingAverageWindowValid;
 	unsigned movingAverageWindow;
+	uint32_t group; // Motion compensation group the properties apply to
+};
+
+struct Request_DeviceManipulation_SubscribeDeviceStateChanges {
+	uint32_t clientId;
+	uint32_t messageId; // Used to associate with Reply
+	bool subscribe;
+};
+
+struct Request_DeviceManipulation_SubscribeDevicePoses {
+	uint32_t clientId;
+	uint32_t messageId; // Used to associate with Reply
+	bool subscribe; // Poses are only written to the device state table while at least one client is subscribed
+};
+
+struct Request_DeviceManipulation_SubscribePoseTelemetry {
+	uint32_t clientId;
+	uint32_t messageId; // Used to associate with Reply
+	bool subscribe;
+	uint64_t deviceMask; // One bit per OpenVR device id
+	uint32_t capacity; // Ring buffer size in records, rounded up to a power of two
+};
+
+struct Request_DeviceManipulation_HookCapture {
+	uint32_t clientId;
+	uint32_t messageId; // Used to associate with Reply
+	bool start; // false stops a running capture
+	uint32_t maxSizeMB;
+	char fileName[260]; // Plain file name, the driver writes it into the captures folder of its install directory
+};
+
+struct Request_DeviceManipulation_InputMirror {
+	uint32_t clientId;
+	uint32_t messageId; // Used to associate with Reply
+	uint32_t sourceDeviceId;
+	uint32_t targetDeviceId;
+	bool enable; // false removes the mirror
+};
+
+struct Request_DeviceManipulation_SetPoseSmoothing {
+	uint32_t clientId;
+	uint32_t messageId; // Used to associate with Reply
+	uint32_t deviceId;
+	PoseSmoothingSettings settings;
+};
+
+struct Request_DeviceManipulation_SetMotionCompensationGroup {
+	uint32_t clientId;
+	uint32_t messageId; // Used to associate with Reply
+	uint32_t deviceId;
+	uint32_t group; // motionCompensationGroupNone excludes the device from motion compensation
 };
 
 struct Request_InputRemapping_SetDigitalRemapping {
@@ -366,6 +443,8 @@ struct Request {
 		Request_VirtualDevices_RemoveDeviceProperty vd_RemoveDeviceProperty;
 		Request_VirtualDevices_SetDevicePose vd_SetDevicePose;
 		Request_VirtualDevices_SetControllerState vd_SetControllerState;
+		Request_VirtualDevices_SetPosePrediction vd_SetPosePrediction;
+		Request_VirtualDevices_SetPoseRate vd_SetPoseRate;
 		Request_DeviceManipulation_ButtonMapping dm_ButtonMapping;
 		Request_DeviceManipulation_SetDeviceOffsets dm_DeviceOffsets;
 		Request_DeviceManipulation_RedirectMode dm_RedirectMode;
@@ -373,6 +452,13 @@ struct Request {
 		Request_DeviceManipulation_MotionCompensationMode dm_MotionCompensationMode;
 		Request_DeviceManipulation_TriggerHapticPulse dm_triggerHapticPulse;
 		Request_DeviceManipulation_SetMotionCompensationProperties dm_SetMotionCompensationProperties;
+		Request_DeviceManipulation_SubscribeDeviceStateChanges dm_SubscribeDeviceStateChanges;
+		Request_DeviceManipulation_SubscribePoseTelemetry dm_SubscribePoseTelemetry;
+		Request_DeviceManipulation_SubscribeDevicePoses dm_SubscribeDevicePoses;
+		Request_DeviceManipulation_HookCapture dm_HookCapture;
+		Request_DeviceManipulation_InputMirror dm_InputMirror;
+		Request_DeviceManipulation_SetPoseSmoothing dm_SetPoseSmoothing;
+		Request_DeviceManipulation_SetMotionCompensationGroup dm_SetMotionCompensationGroup;
 		Request_InputRemapping_SetDigitalRemapping ir_SetDigitalRemapping;
 		Request_InputRemapping_GetDigitalRemapping ir_GetDigitalRemapping;
 		Request_InputRemapping_SetAnalogRemapping ir_SetAnalogRemapping;
@@ -439,6 +525,10 @@ struct Reply_DeviceManipulation_GetDeviceOffsets {
 	vr::HmdVector3d_t deviceTranslationOffset;
 };
 
+struct Reply_DeviceManipulation_DeviceStateChanged {
+	DeviceState state;
+};
+
 struct Reply_InputRemapping_GetDigitalRemapping {
 	uint32_t deviceId;
 	uint32_t buttonId;
@@ -473,6 +563,7 @@ struct Reply {
 		Reply_VirtualDevices_AddDevice vd_AddDevice;
 		Reply_DeviceManipulation_GetDeviceInfo dm_deviceInfo;
 		Reply_DeviceManipulation_GetDeviceOffsets dm_deviceOffsets;
+		Reply_DeviceManipulation_DeviceStateChanged dm_deviceStateChanged;
 		Reply_InputRemapping_GetDigitalRemapping ir_getDigitalRemapping;
 		Reply_InputRemapping_GetAnalogRemapping ir_getAnalogRemapping;
 		MsgUnion() {}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "vrinputemulator_types.h"
+#include <atomic>
+
+
+#define IPC_SHM_LAYOUT_VERSION 2
+#define IPC_SHM_DEVICESTATE_NAME "driver_vrinputemulator.devicestate_shm"
+#define IPC_SHM_POSETELEMETRY_NAME "driver_vrinputemulator.posetelemetry_shm." // + client id
+#define IPC_SHM_POSETELEMETRY_MAXCAPACITY 65536
+
+namespace vrinputemulator {
+namespace ipc {
+
+
+/**
+* Read-only device state table the driver maintains in shared memory.
+*
+* Every entry is protected by a seqlock: A writer claims the entry by making the sequence odd before it
+* modifies the data and makes it even again afterwards. Readers copy the data and retry when the sequence
+* was odd or has changed in the meantime. Poses are written from several threads (pose hooks, ipc thread,
+* pose pump), so writers claim the odd sequence with a compare-exchange instead of a plain store.
+* Poses are only mirrored while at least one client has asked for them (see SubscribeDevicePoses).
+*/
+struct SharedDeviceStateData {
+	bool valid;
+	DeviceState state;
+	uint64_t digitalRemappingMask; // One bit per button id that has a remapping
+	uint32_t analogRemappingMask; // One bit per axis id that has a remapping
+};
+
+struct SharedDevicePoseData {
+	bool valid;
+	int64_t timestamp; // milliseconds since epoch
+	vr::DriverPose_t pose; // pose as it was forwarded to OpenVR
+};
+
+struct SharedDeviceState {
+	std::atomic<uint32_t> stateSequence;
+	SharedDeviceStateData state;
+	std::atomic<uint32_t> poseSequence;
+	SharedDevicePoseData pose;
+};
+
+struct SharedDeviceStateTable {
+	uint32_t layoutVersion;
+	std::atomic<uint32_t> updateCounter; // Incremented after every state change, can be used to detect changes cheaply
+	std::atomic<uint64_t> droppedInjectedEvents; // Driver events that could not be queued for injection (ring full etc.)
+	SharedDeviceState devices[vr::k_unMaxTrackedDeviceCount];
+};
+
+
+/**
+* Single-producer/single-consumer ring of pose telemetry records (one per subscriber).
+*
+* The driver only advances writeIndex, the client only advances readIndex. When the ring is full the
+* driver drops the new record instead of waiting for the reader. The records follow the header directly.
+*/
+struct PoseTelemetryRing {
+	uint32_t layoutVersion;
+	uint32_t capacity; // Power of two
+	std::atomic<uint64_t> writeIndex;
+	std::atomic<uint64_t> readIndex;
+	std::atomic<uint64_t> droppedRecords;
+
+	static size_t sizeFor(uint32_t capacity) { return sizeof(PoseTelemetryRing) + capacity * sizeof(PoseTelemetryRecord); }
+	PoseTelemetryRecord* records() { return (PoseTelemetryRecord*)(this + 1); }
+	const PoseTelemetryRecord* records() const { return (const PoseTelemetryRecord*)(this + 1); }
+};
+
+
+template<typename T>
+inline void seqlockWrite(std::atomic<uint32_t>& sequence, T& dest, const T& src) {
+	uint32_t seq;
+	do {
+		// Only an even sequence can be claimed, so concurrent writers spin until the current one is done
+		seq = sequence.load(std::memory_order_relaxed) & ~(uint32_t)1;
+	} while (!sequence.compare_exchange_weak(seq, seq + 1, std::memory_order_acquire, std::memory_order_relaxed));
+	std::atomic_thread_fence(std::memory_order_release);
+	dest = src;
+	sequence.store(seq + 2, std::memory_order_release);
+}
+
+/** Returns false when the writer was active during the copy (caller should retry) */
+template<typename T>
+inline bool seqlockTryRead(const std::atomic<uint32_t>& sequence, const T& src, T& dest) {
+	auto seq1 = sequence.load(std::memory_order_acquire);
+	if (seq1 & 1) {
+		return false;
+	}
+	dest = src;
+	std::atomic_thread_fence(std::memory_order_acquire);
+	return sequence.load(std::memory_order_relaxed) == seq1;
+}
+
+
+} // end namespace ipc
+} // end namespace vrinputemulator
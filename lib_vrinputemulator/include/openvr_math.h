@@ -180,6 +180,69 @@ namespace vrmath {
 		};
 	}
 
+	inline double quaternionDot(const vr::HmdQuaternion_t& lhs, const vr::HmdQuaternion_t& rhs) {
+		return lhs.w * rhs.w + lhs.x * rhs.x + lhs.y * rhs.y + lhs.z * rhs.z;
+	}
+
+	// Rotation angle between two orientations in radians (0 .. pi)
+	inline double quaternionAngle(const vr::HmdQuaternion_t& lhs, const vr::HmdQuaternion_t& rhs) {
+		auto d = std::abs(quaternionDot(lhs, rhs));
+		return d >= 1.0 ? 0.0 : 2.0 * std::acos(d);
+	}
+
+	// Spherical interpolation along the shorter arc, t may leave 0 .. 1 to extrapolate
+	inline vr::HmdQuaternion_t quaternionSlerp(const vr::HmdQuaternion_t& from, const vr::HmdQuaternion_t& to, double t) {
+		auto d = quaternionDot(from, to);
+		auto sign = d < 0.0 ? -1.0 : 1.0;
+		d *= sign;
+		double a, b;
+		if (d > 0.9995) {
+			// Nearly parallel, a normalized lerp is accurate enough and avoids dividing by sin(~0)
+			a = 1.0 - t;
+			b = t;
+		} else {
+			auto theta = std::acos(d);
+			auto sinTheta = std::sin(theta);
+			a = std::sin((1.0 - t) * theta) / sinTheta;
+			b = std::sin(t * theta) / sinTheta;
+		}
+		b *= sign;
+		vr::HmdQuaternion_t result = {
+			a * from.w + b * to.w,
+			a * from.x + b * to.x,
+			a * from.y + b * to.y,
+			a * from.z + b * to.z
+		};
+		auto n = std::sqrt(quaternionDot(result, result));
+		if (n > 0.0) {
+			result.w /= n;
+			result.x /= n;
+			result.y /= n;
+			result.z /= n;
+		}
+		return result;
+	}
+
+	// Rotation vector (axis * angle in radians) of a unit quaternion, along the shorter arc
+	inline vr::HmdVector3d_t quaternionToRotationVector(const vr::HmdQuaternion_t& quat) {
+		auto sign = quat.w < 0.0 ? -1.0 : 1.0;
+		auto s = std::sqrt(quat.x * quat.x + quat.y * quat.y + quat.z * quat.z);
+		if (s < 1e-9) {
+			// Small angle, sin(a/2) ~ a/2
+			return { 2.0 * sign * quat.x, 2.0 * sign * quat.y, 2.0 * sign * quat.z };
+		}
+		auto scale = 2.0 * std::atan2(s, sign * quat.w) / s * sign;
+		return { quat.x * scale, quat.y * scale, quat.z * scale };
+	}
+
+	inline vr::HmdQuaternion_t quaternionFromRotationVector(const vr::HmdVector3d_t& vector) {
+		auto angle = std::sqrt(vector.v[0] * vector.v[0] + vector.v[1] * vector.v[1] + vector.v[2] * vector.v[2]);
+		if (angle < 1e-9) {
+			return { 1.0, vector.v[0] / 2.0, vector.v[1] / 2.0, vector.v[2] / 2.0 };
+		}
+		return quaternionFromRotationAxis(angle, vector.v[0] / angle, vector.v[1] / angle, vector.v[2] / angle);
+	}
+
 	inline vr::HmdVector3d_t quaternionRotateVector(const vr::HmdQuaternion_t& quat, const vr::HmdVector3d_t& vector, bool reverse = false) {
 		if (reverse) {
 			vr::HmdQuaternion_t pin = { 0.0, vector.v[0], vector.v[1] , vector.v[2] };
@@ -3,6 +3,7 @@
 #include <stdint.h>
 #include <string>
 #include <future>
+#include <functional>
 #include <mutex>
 #include <thread>
 #include <map>
@@ -11,6 +12,8 @@
 #include <string>
 #include <openvr.h>
 #include <boost/interprocess/ipc/message_queue.hpp>
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <boost/interprocess/mapped_region.hpp>
 
 
 namespace vr {
@@ -83,6 +86,7 @@ namespace vr {
 
 
 #include <ipc_protocol.h>
+#include <ipc_shm_layout.h>
 
 
 namespace vrinputemulator {
@@ -123,6 +127,23 @@ class vrinputemulator_toomanydevices : public vrinputemulator_exception {
 };
 
 
+/** Defines what happens when a request is sent while the driver's message queue is full */
+enum class IpcSendPolicy {
+	Block,			// Wait until there is room in the queue (default)
+	TimedBlock,		// Wait at most the configured send timeout, then drop the request
+	DropNewest,		// Never wait, drop the request that is about to be sent
+	DropOldest		// Never wait, keep the newest pose update per device pending and drop older ones (pose updates only, others behave like DropNewest)
+};
+
+
+struct IpcSendStatistics {
+	uint64_t sentMessages = 0;
+	uint64_t droppedMessages = 0;
+	uint64_t blockedMessages = 0; // Messages that had to wait for room in the queue
+	uint64_t blockedTimeMicroseconds = 0;
+};
+
+
 struct VirtualDeviceInfo {
 	uint32_t virtualDeviceId;
 	uint32_t openvrDeviceId;
@@ -142,6 +163,14 @@ public:
 
 	void ping(bool modal = true, bool enableReply = false);
 
+	// Only applies to requests where no reply is awaited, modal requests always block
+	void setIpcSendPolicy(ipc::RequestType type, IpcSendPolicy policy);
+	IpcSendPolicy getIpcSendPolicy(ipc::RequestType type);
+	void setIpcSendTimeout(unsigned milliseconds);
+	unsigned getIpcSendTimeout();
+	IpcSendStatistics getIpcSendStatistics();
+	void resetIpcSendStatistics();
+
 	void openvrUpdatePose(uint32_t deviceId, const vr::DriverPose_t& pose);
 	void openvrButtonEvent(ButtonEventType eventType, uint32_t deviceId, vr::EVRButtonId buttonId, double timeOffset = 0.0);
 	void openvrAxisEvent(uint32_t deviceId, uint32_t axisId, const vr::VRControllerAxis_t& axisState);
@@ -164,6 +193,11 @@ public:
 	void removeVirtualDeviceProperty(uint32_t virtualDeviceId, vr::ETrackedDeviceProperty deviceProperty, bool modal = true);
 	void setVirtualDevicePose(uint32_t virtualDeviceId, const vr::DriverPose_t& pose, bool modal = true);
 	void setVirtualControllerState(uint32_t virtualDeviceId, const vr::VRControllerState_t& state, bool modal = true);
+	void setVirtualDevicePosePrediction(uint32_t virtualDeviceId, const PosePredictionSettings& settings, bool modal = true);
+	// Rate (Hz) with which the pose pump sends the pose of a virtual device, 0 .. the pump's rate
+	void setVirtualDevicePoseRate(uint32_t virtualDeviceId, uint32_t rate, bool modal = true);
+	// Rate (Hz) of the driver's pose pump thread, 0 .. virtual device poses are only sent once per frame
+	void setPosePumpRate(uint32_t rate, bool modal = true);
 
 	void enableDeviceButtonMapping(uint32_t deviceId, bool enable, bool modal = true);
 	void addDeviceButtonMapping(uint32_t deviceId, vr::EVRButtonId button, vr::EVRButtonId mapped, bool modal = true);
@@ -186,12 +220,24 @@ public:
 	void setDeviceSwapMode(uint32_t deviceId, uint32_t target, bool modal = true);
 	void setDeviceMotionCompensationMode(uint32_t deviceId, MotionCompensationVelAccMode velAccMode = MotionCompensationVelAccMode::Disabled, bool modal = true);
 
-	void setMotionVelAccCompensationMode(MotionCompensationVelAccMode velAccMode, bool modal = true);
-	void setMotionCompensationKalmanProcessNoise(double variance, bool modal = true);
-	void setMotionCompensationKalmanObservationNoise(double variance, bool modal = true);
-	void setMotionCompensationMovingAverageWindow(unsigned window, bool modal = true);
+	void setMotionVelAccCompensationMode(MotionCompensationVelAccMode velAccMode, bool modal = true, uint32_t group = 0);
+	void setMotionCompensationKalmanProcessNoise(double variance, bool modal = true, uint32_t group = 0);
+	void setMotionCompensationKalmanObservationNoise(double variance, bool modal = true, uint32_t group = 0);
+	void setMotionCompensationMovingAverageWindow(unsigned window, bool modal = true, uint32_t group = 0);
+	// The device is compensated by (or, in motion compensation mode, the reference of) the given group.
+	// motionCompensationGroupNone excludes it from motion compensation
+	void setDeviceMotionCompensationGroup(uint32_t deviceId, uint32_t group, bool modal = true);
+
+	// Adaptive pose smoothing of a single device, applied before offsets and motion compensation
+	void setPoseSmoothing(uint32_t deviceId, const PoseSmoothingSettings& settings, bool modal = true);
+
+	// The callback is called from the ipc thread, once for every device right after subscribing and then whenever a device's state changes
+	void subscribeDeviceStateChanges(std::function<void(const DeviceState&)> callback, bool modal = true);
+	void unsubscribeDeviceStateChanges(bool modal = true);
 
 	void triggerHapticPulse(uint32_t deviceId, uint32_t axisId, uint16_t durationMicroseconds, bool directMode, bool modal = true);
+	// Plays a whole rumble pattern with one message, waveforms for the same device are queued by the driver
+	void triggerHapticWaveform(uint32_t deviceId, const HapticWaveformSegment* segments, uint32_t segmentCount, bool directMode, bool modal = true);
 
 	void setDigitalInputRemapping(uint32_t deviceId, uint32_t buttonId, const DigitalInputRemapping& remapping, bool modal = true);
 	DigitalInputRemapping getDigitalInputRemapping(uint32_t deviceId, uint32_t buttonId);
@@ -199,6 +245,30 @@ public:
 	void setAnalogInputRemapping(uint32_t deviceId, uint32_t axisId, const AnalogInputRemapping& remapping, bool modal = true);
 	AnalogInputRemapping getAnalogInputRemapping(uint32_t deviceId, uint32_t axisId);
 
+	// These read the driver's device state table in shared memory and never send anything to the driver.
+	// They return false when there is no state for the given device.
+	// The first readDevicePose() call asks the driver to start mirroring poses, so it usually returns false.
+	bool readDeviceState(uint32_t deviceId, DeviceState& state, uint64_t* digitalRemappingMask = nullptr, uint32_t* analogRemappingMask = nullptr);
+	bool readDevicePose(uint32_t deviceId, vr::DriverPose_t& pose, int64_t* timestamp = nullptr);
+	uint32_t readDeviceStateUpdateCounter();
+	uint64_t readDroppedInjectedEventCount();
+
+	// Pose telemetry: The driver writes the raw and the manipulated pose of every pose update into a shared memory ring.
+	// readPoseTelemetry() copies up to maxCount records and returns the number of copied records, it must only be called from one thread at a time.
+	void enablePoseTelemetry(uint64_t deviceMask = ~(uint64_t)0, uint32_t capacity = 4096);
+	void disablePoseTelemetry();
+	uint32_t readPoseTelemetry(PoseTelemetryRecord* records, uint32_t maxCount);
+	uint64_t getPoseTelemetryDroppedRecords();
+
+	// Hook capture: The driver records all hooked calls into a file in the captures folder of its install directory.
+	// fileName must not contain a path. Captures can be replayed with driver_testhost.
+	void startHookCapture(const std::string& fileName, uint32_t maxSizeMB = 256);
+	void stopHookCapture();
+
+	// Input mirrors: Input of the source device is additionally sent to the target device (up to 3 mirrors per source).
+	void addInputMirror(uint32_t sourceDeviceId, uint32_t targetDeviceId);
+	void removeInputMirror(uint32_t sourceDeviceId, uint32_t targetDeviceId);
+
 private:
 	std::recursive_mutex _mutex;
 	uint32_t m_clientId = 0;
@@ -218,11 +288,37 @@ private:
 		std::promise<ipc::Reply> promise;
 	};
 	std::map<uint32_t, _ipcPromiseMapEntry> _ipcPromiseMap;
+	std::function<void(const DeviceState&)> _deviceStateCallback;
 	std::string _ipcServerQueueName;
 	std::string _ipcClientQueueName;
 	boost::interprocess::message_queue* _ipcServerQueue = nullptr;
 	boost::interprocess::message_queue* _ipcClientQueue = nullptr;
 
+	std::recursive_mutex _ipcSendMutex;
+	std::map<ipc::RequestType, IpcSendPolicy> _ipcSendPolicies;
+	unsigned _ipcSendTimeout = 10; // milliseconds
+	IpcSendStatistics _ipcSendStatistics;
+	std::map<std::pair<ipc::RequestType, uint32_t>, ipc::Request> _ipcPendingPoseUpdates;
+	bool _sendRequest(const ipc::Request& message, bool replyExpected = false);
+	void _flushPendingPoseUpdates();
+
+	std::unique_ptr<boost::interprocess::shared_memory_object> _deviceStateShm;
+	std::unique_ptr<boost::interprocess::mapped_region> _deviceStateRegion;
+	const ipc::SharedDeviceStateTable* _deviceStateTable = nullptr;
+	bool _devicePosesSubscribed = false;
+	const ipc::SharedDeviceStateTable* _getDeviceStateTable();
+
+	std::unique_ptr<boost::interprocess::shared_memory_object> _poseTelemetryShm;
+	std::unique_ptr<boost::interprocess::mapped_region> _poseTelemetryRegion;
+	ipc::PoseTelemetryRing* _poseTelemetryRing = nullptr;
+	void _sendPoseTelemetryRequest(bool subscribe, uint64_t deviceMask, uint32_t capacity);
+
+	void _sendHookCaptureRequest(bool start, const std::string& fileName, uint32_t maxSizeMB);
+
+	void _sendInputMirrorRequest(uint32_t sourceDeviceId, uint32_t targetDeviceId, bool enable);
+
+	void _sendTriggerHapticPulseRequest(ipc::Request& message, bool modal);
+
 	void _setVirtualDeviceProperty(uint32_t emulatorDeviceId, vr::ETrackedDeviceProperty deviceProperty, std::function<void(ipc::Request&)>, bool modal);
 };
 
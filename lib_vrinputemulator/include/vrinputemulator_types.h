@@ -10,6 +10,7 @@ namespace vrinputemulator {
 	static const char* const vrsettings_overrideHmdModel_string = "overrideHmdModel";
 	static const char* const vrsettings_overrideHmdTrackingSystem_string = "overrideHmdTrackingSystem";
 	static const char* const vrsettings_genericTrackerFakeController_bool = "genericTrackerFakeController";
+	static const char* const vrsettings_posePumpRate_int32 = "posePumpRate";
 
 	enum class VirtualDeviceType : uint32_t {
 		None = 0,
@@ -62,6 +63,49 @@ namespace vrinputemulator {
 	};
 
 
+	/** Adaptive pose low-pass (One Euro filter): The cutoff frequency rises with the speed, so jitter at rest is
+	* smoothed away while fast movements are not delayed */
+	struct PoseSmoothingSettings {
+		bool enabled = false;
+		double minCutoff = 1.0; // Hz, cutoff at rest (lower .. less jitter, more lag when moving slowly)
+		double beta = 0.5; // Cutoff increase per m/s (position) or rad/s (orientation)
+		double derivativeCutoff = 1.0; // Hz, cutoff of the speed estimate
+	};
+
+
+	/** Forward prediction of virtual device poses: Between two client updates the driver extrapolates the last
+	* pose to the time it is sent, from the velocities and the damped acceleration of the recent updates */
+	struct PosePredictionSettings {
+		bool enabled = false;
+		double maxPredictionTime = 0.05; // s, when no update arrived for this long the pose returns to the last update
+		double accelerationDamping = 0.05; // s, time constant with which the estimated acceleration fades out (0 .. velocity only)
+	};
+
+
+	/** Compact device state record that is pushed to subscribed clients */
+	struct DeviceState {
+		DeviceInfo info;
+		DeviceOffsets offsets;
+		uint32_t motionCompensationStatus; // 0 .. Waiting for zero ref, 1 .. Running, 2 .. Motion ref not tracking (only valid in motion compensation mode)
+		uint32_t motionCompensationGroup; // Group that compensates the device (motionCompensationGroupNone .. not compensated)
+	};
+
+
+	/** Pose telemetry record: The pose we got from the device driver and what we made out of it */
+	struct PoseTelemetryRecord {
+		int64_t timestamp; // microseconds since epoch
+		uint32_t deviceId;
+		bool forwarded; // false when the pose was not forwarded to OpenVR (e.g. fake disconnected or redirect target)
+		vr::DriverPose_t rawPose;
+		vr::DriverPose_t outputPose;
+	};
+
+
+	// Motion compensation groups are independent (own reference device, zero pose and settings), e.g. for several motion seats
+	const uint32_t maxMotionCompensationGroups = 4;
+	const uint32_t motionCompensationGroupNone = 0xFFFFFFFF;
+
+
 	enum class MotionCompensationVelAccMode : uint32_t {
 		Disabled = 0,
 		SetZero = 1,
@@ -71,13 +115,42 @@ namespace vrinputemulator {
 	};
 
 
+	const uint32_t maxHapticWaveformSegments = 16;
+	const float maxHapticWaveformSegmentSeconds = 5.0f; // Longer durations and delays are clamped by the driver
+
+	// A waveform is a sequence of haptic pulses, the segments together form the duration/frequency/amplitude envelope
+	struct HapticWaveformSegment {
+		uint32_t delayMicroseconds; // Start relative to the start of the previous segment
+		float durationSeconds;
+		float frequency;
+		float amplitude; // 0.0 - 1.0
+	};
+
+
 	enum class DigitalBindingType : uint32_t {
 		NoRemapping = 0,
 		Disabled = 1,
 		OpenVR = 2,
 		Keyboard = 3,
 		SuspendRedirectMode = 4,
-		ToggleTouchpadEmulationFix = 5
+		ToggleTouchpadEmulationFix = 5,
+		KeyboardMacro = 6
+	};
+
+
+	const uint32_t maxKeyboardMacroSteps = 16;
+
+	struct KeyboardMacroStep {
+		uint16_t keyCode; // Windows virtual key code
+		bool keyUp;
+		uint32_t delayMicroseconds; // Delay relative to the previous step
+	};
+
+	// Played once per press, modifiers are ordinary steps (e.g. VK_SHIFT down, key down, key up, VK_SHIFT up)
+	struct KeyboardMacro {
+		uint32_t stepCount;
+		bool sendScanCode;
+		KeyboardMacroStep steps[maxKeyboardMacroSteps];
 	};
 
 
@@ -98,6 +171,8 @@ namespace vrinputemulator {
 				bool sendScanCode = true;
 			} keyboard;
 
+			KeyboardMacro keyboardMacro;
+
 			BindingUnion() {}
 		} data;
 		
@@ -137,6 +212,36 @@ namespace vrinputemulator {
 		OpenVR
 	};
 
+	enum class AnalogResponseCurveType : uint32_t {
+		Linear = 0,
+		Exponential = 1, // out = in^exponent
+		SCurve = 2, // Smoothstep blended with linear, exponent 0 .. linear, 1 .. full smoothstep
+		PiecewiseLinear = 3 // Through points, (0, 0) and (1, 1) are implicit
+	};
+
+	enum class AnalogDeadzoneMode : uint32_t {
+		Axial = 0, // Each axis on its own
+		Radial = 1 // On the length of the (x, y) vector, keeps the direction
+	};
+
+	const uint32_t maxAnalogResponseCurvePoints = 8;
+
+	struct AnalogResponseCurve {
+		AnalogResponseCurveType type = AnalogResponseCurveType::Linear;
+		float exponent = 2.0f;
+		uint32_t pointCount = 0;
+		float points[maxAnalogResponseCurvePoints][2]; // (in, out) in 0.0 - 1.0, sorted by in
+	};
+
+	enum class AnalogFilterStageType : uint32_t {
+		Deadzone = 0,
+		ResponseCurve = 1,
+		Smoothing = 2,
+		TouchpadEmulation = 3 // Always runs last, on the axis the value is sent to
+	};
+
+	const uint32_t maxAnalogFilterStages = 4;
+
 	struct AnalogBinding {
 		AnalogBindingType type;
 		union BindingUnion {
@@ -151,8 +256,14 @@ namespace vrinputemulator {
 		bool swapAxes = false;
 		float lowerDeadzone = 0.0;
 		float upperDeadzone = 1.0;
+		AnalogDeadzoneMode deadzoneMode = AnalogDeadzoneMode::Axial;
+		AnalogResponseCurve responseCurve; // Applied after the deadzones
 		unsigned touchpadEmulationMode = 0; // 0 .. Disabled, 1 .. Position Based, 2 .. Position Based (Deferred Zero Updates)
 		bool buttonPressDeadzoneFix = false;
+		uint32_t filterStageCount = 0; // 0 .. Deadzone, ResponseCurve, TouchpadEmulation
+		AnalogFilterStageType filterStages[maxAnalogFilterStages];
+		float smoothingFactor = 0.5f; // Smoothing stage: weight of the previous value, 0.0 - 0.99
+		bool pairScalarComponents = false; // Remap x and y of scalar components (same time offset) as one 2D sample
 
 		AnalogBinding(AnalogBindingType type = AnalogBindingType::NoRemapping) : type(type) {}
 	};
@@ -1,6 +1,8 @@
 #include <vrinputemulator.h>
 #include <boost/date_time/posix_time/posix_time_types.hpp>
 #include <cstdlib>
+#include <cmath>
+#include <algorithm>
 #include <functional>
 #include <iostream>
 #include <config.h>
@@ -27,7 +29,17 @@ void VRInputEmulator::_ipcThreadFunc(VRInputEmulator * _this) {
 			unsigned priority;
 			boost::posix_time::ptime timeout = boost::posix_time::microsec_clock::universal_time() + boost::posix_time::milliseconds(50);
 			if (_this->_ipcClientQueue->timed_receive(&message, sizeof(ipc::Reply), recv_size, priority, timeout)) {
-				if (recv_size == sizeof(ipc::Reply)) {
+				if (recv_size == sizeof(ipc::Reply) && message.type == ipc::ReplyType::DeviceManipulation_DeviceStateChanged) {
+					// Pushed by the driver, nobody is waiting for it
+					std::function<void(const DeviceState&)> callback;
+					{
+						std::lock_guard<std::recursive_mutex> lock(_this->_mutex);
+						callback = _this->_deviceStateCallback;
+					}
+					if (callback) {
+						callback(message.msg.dm_deviceStateChanged.state);
+					}
+				} else if (recv_size == sizeof(ipc::Reply)) {
 					std::lock_guard<std::recursive_mutex> lock(_this->_mutex);
 					auto i = _this->_ipcPromiseMap.find(message.messageId);
 					if (i != _this->_ipcPromiseMap.end()) {
@@ -41,6 +53,11 @@ void VRInputEmulator::_ipcThreadFunc(VRInputEmulator * _this) {
 			} else {
 				std::this_thread::sleep_for(std::chrono::milliseconds(1));
 			}
+			// Pose updates kept back by the DropOldest policy must not get stuck when the producer stops sending
+			{
+				std::lock_guard<std::recursive_mutex> lock(_this->_ipcSendMutex);
+				_this->_flushPendingPoseUpdates();
+			}
 		} catch (std::exception& ex) {
 			WRITELOG(ERROR, "Exception in ipc receive loop: " << ex.what() << std::endl);
 		}
@@ -105,7 +122,7 @@ void VRInputEmulator::connect() {
 			std::lock_guard<std::recursive_mutex> lock(_mutex);
 			_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
 		}
-		_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+		_sendRequest(message, true);
 		// Wait for response
 		auto resp = respFuture.get();
 		m_clientId = resp.msg.ipc_ClientConnect.clientId;
@@ -144,7 +161,7 @@ void VRInputEmulator::disconnect() {
 			std::lock_guard<std::recursive_mutex> lock(_mutex);
 			_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
 		}
-		_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+		_sendRequest(message, true);
 		auto resp = respFuture.get();
 		m_clientId = resp.msg.ipc_ClientConnect.clientId;
 		{
@@ -156,7 +173,19 @@ void VRInputEmulator::disconnect() {
 			_ipcThreadStop = true;
 			_ipcThread.join();
 		}
+		// unmap shared memory
+		_poseTelemetryRing = nullptr;
+		_poseTelemetryRegion.reset();
+		_poseTelemetryShm.reset();
+		_deviceStateTable = nullptr;
+		_devicePosesSubscribed = false;
+		_deviceStateRegion.reset();
+		_deviceStateShm.reset();
 		// delete message queues
+		{
+			std::lock_guard<std::recursive_mutex> lock(_ipcSendMutex);
+			_ipcPendingPoseUpdates.clear();
+		}
 		if (_ipcServerQueue) {
 			delete _ipcServerQueue;
 			_ipcServerQueue = nullptr;
@@ -183,7 +212,7 @@ void VRInputEmulator::ping(bool modal, bool enableReply) {
 				std::lock_guard<std::recursive_mutex> lock(_mutex);
 				_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
 			}
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			_sendRequest(message, true);
 			auto resp = respFuture.get();
 			{
 				std::lock_guard<std::recursive_mutex> lock(_mutex);
@@ -202,7 +231,7 @@ void VRInputEmulator::ping(bool modal, bool enableReply) {
 			} else {
 				message.msg.ipc_Ping.messageId = 0;
 			}
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			_sendRequest(message);
 		}
 	} else {
 		throw vrinputemulator_connectionerror("No active connection.");
@@ -210,11 +239,129 @@ void VRInputEmulator::ping(bool modal, bool enableReply) {
 }
 
 
+void VRInputEmulator::setIpcSendPolicy(ipc::RequestType type, IpcSendPolicy policy) {
+	std::lock_guard<std::recursive_mutex> lock(_ipcSendMutex);
+	_ipcSendPolicies[type] = policy;
+	if (policy != IpcSendPolicy::DropOldest) {
+		// Don't leave pose updates of this type pending forever
+		_flushPendingPoseUpdates();
+	}
+}
+
+IpcSendPolicy VRInputEmulator::getIpcSendPolicy(ipc::RequestType type) {
+	std::lock_guard<std::recursive_mutex> lock(_ipcSendMutex);
+	auto i = _ipcSendPolicies.find(type);
+	if (i != _ipcSendPolicies.end()) {
+		return i->second;
+	}
+	return IpcSendPolicy::Block;
+}
+
+void VRInputEmulator::setIpcSendTimeout(unsigned milliseconds) {
+	std::lock_guard<std::recursive_mutex> lock(_ipcSendMutex);
+	_ipcSendTimeout = milliseconds;
+}
+
+unsigned VRInputEmulator::getIpcSendTimeout() {
+	std::lock_guard<std::recursive_mutex> lock(_ipcSendMutex);
+	return _ipcSendTimeout;
+}
+
+IpcSendStatistics VRInputEmulator::getIpcSendStatistics() {
+	std::lock_guard<std::recursive_mutex> lock(_ipcSendMutex);
+	return _ipcSendStatistics;
+}
+
+void VRInputEmulator::resetIpcSendStatistics() {
+	std::lock_guard<std::recursive_mutex> lock(_ipcSendMutex);
+	_ipcSendStatistics = IpcSendStatistics();
+}
+
+
+// Sends a request according to the configured send policy. Returns false when the request has been dropped or is still pending.
+bool VRInputEmulator::_sendRequest(const ipc::Request& message, bool replyExpected) {
+	auto policy = IpcSendPolicy::Block;
+	unsigned timeout;
+	{
+		std::lock_guard<std::recursive_mutex> lock(_ipcSendMutex);
+		// Pending pose updates are older than anything we send now
+		_flushPendingPoseUpdates();
+		if (!replyExpected) {
+			auto i = _ipcSendPolicies.find(message.type);
+			if (i != _ipcSendPolicies.end()) {
+				policy = i->second;
+			}
+		}
+		timeout = _ipcSendTimeout;
+		if (_ipcServerQueue->try_send(&message, sizeof(ipc::Request), 0)) {
+			_ipcSendStatistics.sentMessages++;
+			return true;
+		}
+		if (policy == IpcSendPolicy::DropOldest) {
+			uint32_t deviceId = 0;
+			if (message.type == ipc::RequestType::OpenVR_PoseUpdate) {
+				deviceId = message.msg.ipc_PoseUpdate.deviceId;
+			} else if (message.type == ipc::RequestType::VirtualDevices_SetDevicePose) {
+				deviceId = message.msg.vd_SetDevicePose.virtualDeviceId;
+			} else {
+				policy = IpcSendPolicy::DropNewest;
+			}
+			if (policy == IpcSendPolicy::DropOldest) {
+				auto r = _ipcPendingPoseUpdates.insert({ { message.type, deviceId }, message });
+				if (!r.second) {
+					r.first->second = message;
+					_ipcSendStatistics.droppedMessages++;
+				}
+				return false;
+			}
+		}
+		if (policy == IpcSendPolicy::DropNewest) {
+			_ipcSendStatistics.droppedMessages++;
+			return false;
+		}
+	}
+	// Queue is full and we need to wait, so don't hold the lock while blocking
+	bool retval = true;
+	auto start = std::chrono::steady_clock::now();
+	if (policy == IpcSendPolicy::TimedBlock) {
+		boost::posix_time::ptime sendTimeout = boost::posix_time::microsec_clock::universal_time() + boost::posix_time::milliseconds(timeout);
+		retval = _ipcServerQueue->timed_send(&message, sizeof(ipc::Request), 0, sendTimeout);
+	} else {
+		_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+	}
+	auto blockedTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+	std::lock_guard<std::recursive_mutex> lock(_ipcSendMutex);
+	_ipcSendStatistics.blockedMessages++;
+	_ipcSendStatistics.blockedTimeMicroseconds += blockedTime;
+	if (retval) {
+		_ipcSendStatistics.sentMessages++;
+	} else {
+		_ipcSendStatistics.droppedMessages++;
+	}
+	return retval;
+}
+
+
+// Needs to be called with _ipcSendMutex locked
+void VRInputEmulator::_flushPendingPoseUpdates() {
+	auto i = _ipcPendingPoseUpdates.begin();
+	while (i != _ipcPendingPoseUpdates.end()) {
+		if (!_ipcServerQueue || !_ipcServerQueue->try_send(&i->second, sizeof(ipc::Request), 0)) {
+			break;
+		}
+		_ipcSendStatistics.sentMessages++;
+		i = _ipcPendingPoseUpdates.erase(i);
+	}
+}
+
+
+
 void VRInputEmulator::openvrUpdatePose(uint32_t deviceId, const vr::DriverPose_t & pose) {
 	if (_ipcServerQueue) {
 		ipc::Request message(ipc::RequestType::OpenVR_PoseUpdate);
 		message.msg.ipc_PoseUpdate.deviceId = deviceId;
 		message.msg.ipc_PoseUpdate.pose = pose;
+		_sendRequest(message);
 	} else {
 		throw vrinputemulator_connectionerror("No active connection.");
 	}
@@ -229,7 +376,7 @@ void VRInputEmulator::openvrButtonEvent(ButtonEventType eventType, uint32_t devi
 		message.msg.ipc_ButtonEvent.events[0].deviceId = deviceId;
 		message.msg.ipc_ButtonEvent.events[0].buttonId = buttonId;
 		message.msg.ipc_ButtonEvent.events[0].timeOffset = timeOffset;
-		_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+		_sendRequest(message);
 	} else {
 		throw vrinputemulator_connectionerror("No active connection.");
 	}
@@ -243,7 +390,7 @@ void VRInputEmulator::openvrAxisEvent(uint32_t deviceId, uint32_t axisId, const
 		message.msg.ipc_AxisEvent.events[0].deviceId = deviceId;
 		message.msg.ipc_AxisEvent.events[0].axisId = axisId;
 		message.msg.ipc_AxisEvent.events[0].axisState = axisState;
-		_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+		_sendRequest(message);
 	} else {
 		throw vrinputemulator_connectionerror("No active connection.");
 	}
@@ -255,7 +402,7 @@ void VRInputEmulator::openvrProximitySensorEvent(uint32_t deviceId, bool sensorT
 		ipc::Request message(ipc::RequestType::OpenVR_ProximitySensorEvent);
 		message.msg.ovr_ProximitySensorEvent.deviceId = deviceId;
 		message.msg.ovr_ProximitySensorEvent.sensorTriggered = sensorTriggered;
-		_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+		_sendRequest(message);
 	} else {
 		throw vrinputemulator_connectionerror("No active connection.");
 	}
@@ -269,7 +416,7 @@ void VRInputEmulator::openvrVendorSpecificEvent(uint32_t deviceId, vr::EVREventT
 		message.msg.ovr_VendorSpecificEvent.eventType = eventType;
 		message.msg.ovr_VendorSpecificEvent.eventData = eventData;
 		message.msg.ovr_VendorSpecificEvent.timeOffset = timeOffset;
-		_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+		_sendRequest(message);
 	} else {
 		throw vrinputemulator_connectionerror("No active connection.");
 	}
@@ -288,7 +435,7 @@ uint32_t VRInputEmulator::getVirtualDeviceCount() {
 			std::lock_guard<std::recursive_mutex> lock(_mutex);
 			_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
 		}
-		_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+		_sendRequest(message, true);
 		auto resp = respFuture.get();
 		{
 			std::lock_guard<std::recursive_mutex> lock(_mutex);
@@ -319,7 +466,7 @@ VirtualDeviceInfo VRInputEmulator::getVirtualDeviceInfo(uint32_t virtualDeviceId
 			std::lock_guard<std::recursive_mutex> lock(_mutex);
 			_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
 		}
-		_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+		_sendRequest(message, true);
 		auto resp = respFuture.get();
 		{
 			std::lock_guard<std::recursive_mutex> lock(_mutex);
@@ -362,7 +509,7 @@ vr::DriverPose_t VRInputEmulator::getVirtualDevicePose(uint32_t virtualDeviceId)
 			std::lock_guard<std::recursive_mutex> lock(_mutex);
 			_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
 		}
-		_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+		_sendRequest(message, true);
 		auto resp = respFuture.get();
 		{
 			std::lock_guard<std::recursive_mutex> lock(_mutex);
@@ -400,7 +547,7 @@ vr::VRControllerState_t VRInputEmulator::getVirtualControllerState(uint32_t virt
 			std::lock_guard<std::recursive_mutex> lock(_mutex);
 			_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
 		}
-		_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+		_sendRequest(message, true);
 		auto resp = respFuture.get();
 		{
 			std::lock_guard<std::recursive_mutex> lock(_mutex);
@@ -443,7 +590,7 @@ uint32_t VRInputEmulator::addVirtualDevice(VirtualDeviceType deviceType, const s
 			std::lock_guard<std::recursive_mutex> lock(_mutex);
 			_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
 		}
-		_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+		_sendRequest(message, true);
 		auto resp = respFuture.get();
 		{
 			std::lock_guard<std::recursive_mutex> lock(_mutex);
@@ -486,7 +633,7 @@ void VRInputEmulator::publishVirtualDevice(uint32_t virtualDeviceId, bool modal)
 			std::lock_guard<std::recursive_mutex> lock(_mutex);
 			_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
 		}
-		_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+		_sendRequest(message, true);
 		auto resp = respFuture.get();
 		{
 			std::lock_guard<std::recursive_mutex> lock(_mutex);
@@ -525,7 +672,7 @@ void VRInputEmulator::_setVirtualDeviceProperty(uint32_t virtualDeviceId, vr::ET
 				std::lock_guard<std::recursive_mutex> lock(_mutex);
 				_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
 			}
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			_sendRequest(message, true);
 			auto resp = respFuture.get();
 			{
 				std::lock_guard<std::recursive_mutex> lock(_mutex);
@@ -548,7 +695,7 @@ void VRInputEmulator::_setVirtualDeviceProperty(uint32_t virtualDeviceId, vr::ET
 			}
 		} else {
 			message.msg.vd_SetDeviceProperty.messageId = 0;
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			_sendRequest(message);
 		}
 	} else {
 		throw vrinputemulator_connectionerror("No active connection.");
@@ -621,7 +768,7 @@ void VRInputEmulator::removeVirtualDeviceProperty(uint32_t virtualDeviceId, vr::
 				std::lock_guard<std::recursive_mutex> lock(_mutex);
 				_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
 			}
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			_sendRequest(message, true);
 			auto resp = respFuture.get();
 			{
 				std::lock_guard<std::recursive_mutex> lock(_mutex);
@@ -641,7 +788,7 @@ void VRInputEmulator::removeVirtualDeviceProperty(uint32_t virtualDeviceId, vr::
 			}
 		} else {
 			message.msg.vd_RemoveDeviceProperty.messageId = 0;
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			_sendRequest(message);
 		}
 	} else {
 		throw vrinputemulator_connectionerror("No active connection.");
@@ -663,7 +810,7 @@ void VRInputEmulator::setVirtualDevicePose(uint32_t virtualDeviceId, const vr::D
 				std::lock_guard<std::recursive_mutex> lock(_mutex);
 				_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
 			}
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			_sendRequest(message, true);
 			auto resp = respFuture.get();
 			{
 				std::lock_guard<std::recursive_mutex> lock(_mutex);
@@ -683,7 +830,7 @@ void VRInputEmulator::setVirtualDevicePose(uint32_t virtualDeviceId, const vr::D
 			}
 		} else {
 			message.msg.vd_SetDevicePose.messageId = 0;
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			_sendRequest(message);
 		}
 	} else {
 		throw vrinputemulator_connectionerror("No active connection.");
@@ -705,7 +852,7 @@ void VRInputEmulator::setVirtualControllerState(uint32_t virtualDeviceId, const
 				std::lock_guard<std::recursive_mutex> lock(_mutex);
 				_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
 			}
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			_sendRequest(message, true);
 			auto resp = respFuture.get();
 			{
 				std::lock_guard<std::recursive_mutex> lock(_mutex);
@@ -728,13 +875,103 @@ void VRInputEmulator::setVirtualControllerState(uint32_t virtualDeviceId, const
 			}
 		} else {
 			message.msg.vd_SetControllerState.messageId = 0;
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			_sendRequest(message);
+		}
+	} else {
+		throw vrinputemulator_connectionerror("No active connection.");
+	}
+}
+
+void VRInputEmulator::setVirtualDevicePosePrediction(uint32_t virtualDeviceId, const PosePredictionSettings& settings, bool modal) {
+	if (_ipcServerQueue) {
+		ipc::Request message(ipc::RequestType::VirtualDevices_SetPosePrediction);
+		memset(&message.msg, 0, sizeof(message.msg));
+		message.msg.vd_SetPosePrediction.clientId = m_clientId;
+		message.msg.vd_SetPosePrediction.virtualDeviceId = virtualDeviceId;
+		message.msg.vd_SetPosePrediction.settings = settings;
+		if (modal) {
+			uint32_t messageId = _ipcRandomDist(_ipcRandomDevice);
+			message.msg.vd_SetPosePrediction.messageId = messageId;
+			std::promise<ipc::Reply> respPromise;
+			auto respFuture = respPromise.get_future();
+			{
+				std::lock_guard<std::recursive_mutex> lock(_mutex);
+				_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
+			}
+			_sendRequest(message, true);
+			auto resp = respFuture.get();
+			{
+				std::lock_guard<std::recursive_mutex> lock(_mutex);
+				_ipcPromiseMap.erase(messageId);
+			}
+			std::stringstream ss;
+			ss << "Error while setting pose prediction: ";
+			if (resp.status == ipc::ReplyStatus::InvalidId) {
+				ss << "Invalid device id";
+				throw vrinputemulator_invalidid(ss.str());
+			} else if (resp.status == ipc::ReplyStatus::NotFound) {
+				ss << "Device not found";
+				throw vrinputemulator_notfound(ss.str());
+			} else if (resp.status != ipc::ReplyStatus::Ok) {
+				ss << "Error code " << (int)resp.status;
+				throw vrinputemulator_exception(ss.str());
+			}
+		} else {
+			message.msg.vd_SetPosePrediction.messageId = 0;
+			_sendRequest(message);
+		}
+	} else {
+		throw vrinputemulator_connectionerror("No active connection.");
+	}
+}
+
+void VRInputEmulator::setVirtualDevicePoseRate(uint32_t virtualDeviceId, uint32_t rate, bool modal) {
+	if (_ipcServerQueue) {
+		ipc::Request message(ipc::RequestType::VirtualDevices_SetPoseRate);
+		memset(&message.msg, 0, sizeof(message.msg));
+		message.msg.vd_SetPoseRate.clientId = m_clientId;
+		message.msg.vd_SetPoseRate.virtualDeviceId = virtualDeviceId;
+		message.msg.vd_SetPoseRate.rate = rate;
+		if (modal) {
+			uint32_t messageId = _ipcRandomDist(_ipcRandomDevice);
+			message.msg.vd_SetPoseRate.messageId = messageId;
+			std::promise<ipc::Reply> respPromise;
+			auto respFuture = respPromise.get_future();
+			{
+				std::lock_guard<std::recursive_mutex> lock(_mutex);
+				_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
+			}
+			_sendRequest(message, true);
+			auto resp = respFuture.get();
+			{
+				std::lock_guard<std::recursive_mutex> lock(_mutex);
+				_ipcPromiseMap.erase(messageId);
+			}
+			std::stringstream ss;
+			ss << "Error while setting pose rate: ";
+			if (resp.status == ipc::ReplyStatus::InvalidId) {
+				ss << "Invalid device id";
+				throw vrinputemulator_invalidid(ss.str());
+			} else if (resp.status == ipc::ReplyStatus::NotFound) {
+				ss << "Device not found";
+				throw vrinputemulator_notfound(ss.str());
+			} else if (resp.status != ipc::ReplyStatus::Ok) {
+				ss << "Error code " << (int)resp.status;
+				throw vrinputemulator_exception(ss.str());
+			}
+		} else {
+			message.msg.vd_SetPoseRate.messageId = 0;
+			_sendRequest(message);
 		}
 	} else {
 		throw vrinputemulator_connectionerror("No active connection.");
 	}
 }
 
+void VRInputEmulator::setPosePumpRate(uint32_t rate, bool modal) {
+	setVirtualDevicePoseRate(vr::k_unTrackedDeviceIndexInvalid, rate, modal);
+}
+
 void VRInputEmulator::enableDeviceButtonMapping(uint32_t deviceId, bool enable, bool modal) {
 	if (_ipcServerQueue) {
 		ipc::Request message(ipc::RequestType::DeviceManipulation_ButtonMapping);
@@ -753,7 +990,7 @@ void VRInputEmulator::enableDeviceButtonMapping(uint32_t deviceId, bool enable,
 				std::lock_guard<std::recursive_mutex> lock(_mutex);
 				_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
 			}
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			_sendRequest(message, true);
 			auto resp = respFuture.get();
 			{
 				std::lock_guard<std::recursive_mutex> lock(_mutex);
@@ -772,7 +1009,7 @@ void VRInputEmulator::enableDeviceButtonMapping(uint32_t deviceId, bool enable,
 				throw vrinputemulator_exception(ss.str());
 			}
 		} else {
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			_sendRequest(message);
 		}
 	} else {
 		throw vrinputemulator_connectionerror("No active connection.");
@@ -799,7 +1036,7 @@ void VRInputEmulator::addDeviceButtonMapping(uint32_t deviceId, vr::EVRButtonId
 				std::lock_guard<std::recursive_mutex> lock(_mutex);
 				_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
 			}
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			_sendRequest(message, true);
 			auto resp = respFuture.get();
 			{
 				std::lock_guard<std::recursive_mutex> lock(_mutex);
@@ -818,7 +1055,7 @@ void VRInputEmulator::addDeviceButtonMapping(uint32_t deviceId, vr::EVRButtonId
 				throw vrinputemulator_exception(ss.str());
 			}
 		} else {
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			_sendRequest(message);
 		}
 	} else {
 		throw vrinputemulator_connectionerror("No active connection.");
@@ -844,7 +1081,7 @@ void VRInputEmulator::removeDeviceButtonMapping(uint32_t deviceId, vr::EVRButton
 				std::lock_guard<std::recursive_mutex> lock(_mutex);
 				_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
 			}
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			_sendRequest(message, true);
 			auto resp = respFuture.get();
 			{
 				std::lock_guard<std::recursive_mutex> lock(_mutex);
@@ -863,7 +1100,7 @@ void VRInputEmulator::removeDeviceButtonMapping(uint32_t deviceId, vr::EVRButton
 				throw vrinputemulator_exception(ss.str());
 			}
 		} else {
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			_sendRequest(message);
 		}
 	} else {
 		throw vrinputemulator_connectionerror("No active connection.");
@@ -888,7 +1125,7 @@ void VRInputEmulator::removeAllDeviceButtonMappings(uint32_t deviceId, bool moda
 				std::lock_guard<std::recursive_mutex> lock(_mutex);
 				_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
 			}
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			_sendRequest(message, true);
 			auto resp = respFuture.get();
 			{
 				std::lock_guard<std::recursive_mutex> lock(_mutex);
@@ -907,7 +1144,7 @@ void VRInputEmulator::removeAllDeviceButtonMappings(uint32_t deviceId, bool moda
 				throw vrinputemulator_exception(ss.str());
 			}
 		} else {
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			_sendRequest(message);
 		}
 	} else {
 		throw vrinputemulator_connectionerror("No active connection.");
@@ -928,7 +1165,7 @@ void VRInputEmulator::getDeviceOffsets(uint32_t deviceId, DeviceOffsets & data)
 			std::lock_guard<std::recursive_mutex> lock(_mutex);
 			_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
 		}
-		_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+		_sendRequest(message, true);
 		auto resp = respFuture.get();
 		{
 			std::lock_guard<std::recursive_mutex> lock(_mutex);
@@ -971,7 +1208,7 @@ void VRInputEmulator::enableDeviceOffsets(uint32_t deviceId, bool enable, bool m
 				std::lock_guard<std::recursive_mutex> lock(_mutex);
 				_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
 			}
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			_sendRequest(message, true);
 			auto resp = respFuture.get();
 			{
 				std::lock_guard<std::recursive_mutex> lock(_mutex);
@@ -991,7 +1228,7 @@ void VRInputEmulator::enableDeviceOffsets(uint32_t deviceId, bool enable, bool m
 			}
 		} else {
 			message.msg.dm_DeviceOffsets.messageId = 0;
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			_sendRequest(message);
 		}
 	} else {
 		throw vrinputemulator_connectionerror("No active connection.");
@@ -1016,7 +1253,7 @@ void VRInputEmulator::setWorldFromDriverRotationOffset(uint32_t deviceId, const
 				std::lock_guard<std::recursive_mutex> lock(_mutex);
 				_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
 			}
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			_sendRequest(message, true);
 			auto resp = respFuture.get();
 			{
 				std::lock_guard<std::recursive_mutex> lock(_mutex);
@@ -1035,7 +1272,7 @@ void VRInputEmulator::setWorldFromDriverRotationOffset(uint32_t deviceId, const
 				throw vrinputemulator_exception(ss.str());
 			}
 		} else {
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			_sendRequest(message);
 		}
 	} else {
 		throw vrinputemulator_connectionerror("No active connection.");
@@ -1060,7 +1297,7 @@ void VRInputEmulator::setWorldFromDriverTranslationOffset(uint32_t deviceId, con
 				std::lock_guard<std::recursive_mutex> lock(_mutex);
 				_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
 			}
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			_sendRequest(message, true);
 			auto resp = respFuture.get();
 			{
 				std::lock_guard<std::recursive_mutex> lock(_mutex);
@@ -1079,7 +1316,7 @@ void VRInputEmulator::setWorldFromDriverTranslationOffset(uint32_t deviceId, con
 				throw vrinputemulator_exception(ss.str());
 			}
 		} else {
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			_sendRequest(message);
 		}
 	} else {
 		throw vrinputemulator_connectionerror("No active connection.");
@@ -1104,7 +1341,7 @@ void VRInputEmulator::setDriverFromHeadRotationOffset(uint32_t deviceId, const v
 				std::lock_guard<std::recursive_mutex> lock(_mutex);
 				_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
 			}
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			_sendRequest(message, true);
 			auto resp = respFuture.get();
 			{
 				std::lock_guard<std::recursive_mutex> lock(_mutex);
@@ -1123,7 +1360,7 @@ void VRInputEmulator::setDriverFromHeadRotationOffset(uint32_t deviceId, const v
 				throw vrinputemulator_exception(ss.str());
 			}
 		} else {
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			_sendRequest(message);
 		}
 	} else {
 		throw vrinputemulator_connectionerror("No active connection.");
@@ -1148,7 +1385,7 @@ void VRInputEmulator::setDriverFromHeadTranslationOffset(uint32_t deviceId, cons
 				std::lock_guard<std::recursive_mutex> lock(_mutex);
 				_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
 			}
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			_sendRequest(message, true);
 			auto resp = respFuture.get();
 			{
 				std::lock_guard<std::recursive_mutex> lock(_mutex);
@@ -1167,7 +1404,7 @@ void VRInputEmulator::setDriverFromHeadTranslationOffset(uint32_t deviceId, cons
 				throw vrinputemulator_exception(ss.str());
 			}
 		} else {
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			_sendRequest(message);
 		}
 	} else {
 		throw vrinputemulator_connectionerror("No active connection.");
@@ -1192,7 +1429,7 @@ void VRInputEmulator::setDriverRotationOffset(uint32_t deviceId, const vr::HmdQu
 				std::lock_guard<std::recursive_mutex> lock(_mutex);
 				_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
 			}
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			_sendRequest(message, true);
 			auto resp = respFuture.get();
 			{
 				std::lock_guard<std::recursive_mutex> lock(_mutex);
@@ -1211,7 +1448,7 @@ void VRInputEmulator::setDriverRotationOffset(uint32_t deviceId, const vr::HmdQu
 				throw vrinputemulator_exception(ss.str());
 			}
 		} else {
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			_sendRequest(message);
 		}
 	} else {
 		throw vrinputemulator_connectionerror("No active connection.");
@@ -1236,7 +1473,7 @@ void VRInputEmulator::setDriverTranslationOffset(uint32_t deviceId, const vr::Hm
 				std::lock_guard<std::recursive_mutex> lock(_mutex);
 				_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
 			}
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			_sendRequest(message, true);
 			auto resp = respFuture.get();
 			{
 				std::lock_guard<std::recursive_mutex> lock(_mutex);
@@ -1255,7 +1492,7 @@ void VRInputEmulator::setDriverTranslationOffset(uint32_t deviceId, const vr::Hm
 				throw vrinputemulator_exception(ss.str());
 			}
 		} else {
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			_sendRequest(message);
 		}
 	} else {
 		throw vrinputemulator_connectionerror("No active connection.");
@@ -1276,7 +1513,7 @@ void VRInputEmulator::getDeviceInfo(uint32_t deviceId, DeviceInfo & info) {
 			std::lock_guard<std::recursive_mutex> lock(_mutex);
 			_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
 		}
-		_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+		_sendRequest(message, true);
 		auto resp = respFuture.get();
 		{
 			std::lock_guard<std::recursive_mutex> lock(_mutex);
@@ -1322,7 +1559,7 @@ void VRInputEmulator::setDeviceNormalMode(uint32_t deviceId, bool modal) {
 				std::lock_guard<std::recursive_mutex> lock(_mutex);
 				_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
 			}
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			_sendRequest(message, true);
 			auto resp = respFuture.get();
 			{
 				std::lock_guard<std::recursive_mutex> lock(_mutex);
@@ -1341,7 +1578,7 @@ void VRInputEmulator::setDeviceNormalMode(uint32_t deviceId, bool modal) {
 				throw vrinputemulator_exception(ss.str());
 			}
 		} else {
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			_sendRequest(message);
 		}
 	} else {
 		throw vrinputemulator_connectionerror("No active connection.");
@@ -1364,7 +1601,7 @@ void VRInputEmulator::setDeviceFakeDisconnectedMode(uint32_t deviceId, bool moda
 				std::lock_guard<std::recursive_mutex> lock(_mutex);
 				_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
 			}
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			_sendRequest(message, true);
 			auto resp = respFuture.get();
 			{
 				std::lock_guard<std::recursive_mutex> lock(_mutex);
@@ -1383,7 +1620,7 @@ void VRInputEmulator::setDeviceFakeDisconnectedMode(uint32_t deviceId, bool moda
 				throw vrinputemulator_exception(ss.str());
 			}
 		} else {
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			_sendRequest(message);
 		}
 	} else {
 		throw vrinputemulator_connectionerror("No active connection.");
@@ -1407,7 +1644,7 @@ void VRInputEmulator::setDeviceRedictMode(uint32_t deviceId, uint32_t target, bo
 				std::lock_guard<std::recursive_mutex> lock(_mutex);
 				_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
 			}
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			_sendRequest(message, true);
 			auto resp = respFuture.get();
 			{
 				std::lock_guard<std::recursive_mutex> lock(_mutex);
@@ -1426,7 +1663,7 @@ void VRInputEmulator::setDeviceRedictMode(uint32_t deviceId, uint32_t target, bo
 				throw vrinputemulator_exception(ss.str());
 			}
 		} else {
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			_sendRequest(message);
 		}
 	} else {
 		throw vrinputemulator_connectionerror("No active connection.");
@@ -1450,7 +1687,7 @@ void VRInputEmulator::setDeviceSwapMode(uint32_t deviceId, uint32_t target, bool
 				std::lock_guard<std::recursive_mutex> lock(_mutex);
 				_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
 			}
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			_sendRequest(message, true);
 			auto resp = respFuture.get();
 			{
 				std::lock_guard<std::recursive_mutex> lock(_mutex);
@@ -1469,7 +1706,7 @@ void VRInputEmulator::setDeviceSwapMode(uint32_t deviceId, uint32_t target, bool
 				throw vrinputemulator_exception(ss.str(), (int)resp.status);
 			}
 		} else {
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			_sendRequest(message);
 		}
 	} else {
 		throw vrinputemulator_connectionerror("No active connection.");
@@ -1495,7 +1732,7 @@ void VRInputEmulator::setDeviceMotionCompensationMode(uint32_t deviceId, MotionC
 				std::lock_guard<std::recursive_mutex> lock(_mutex);
 				_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
 			}
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			_sendRequest(message, true);
 			auto resp = respFuture.get();
 			{
 				std::lock_guard<std::recursive_mutex> lock(_mutex);
@@ -1514,7 +1751,7 @@ void VRInputEmulator::setDeviceMotionCompensationMode(uint32_t deviceId, MotionC
 				throw vrinputemulator_exception(ss.str(), (int)resp.status);
 			}
 		} else {
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			_sendRequest(message);
 		}
 	} else {
 		throw vrinputemulator_connectionerror("No active connection.");
@@ -1522,12 +1759,13 @@ void VRInputEmulator::setDeviceMotionCompensationMode(uint32_t deviceId, MotionC
 }
 
 
-void VRInputEmulator::setMotionVelAccCompensationMode(MotionCompensationVelAccMode velAccMode, bool modal) {
+void VRInputEmulator::setMotionVelAccCompensationMode(MotionCompensationVelAccMode velAccMode, bool modal, uint32_t group) {
 	if (_ipcServerQueue) {
 		ipc::Request message(ipc::RequestType::DeviceManipulation_SetMotionCompensationProperties);
 		memset(&message.msg, 0, sizeof(message.msg));
 		message.msg.dm_SetMotionCompensationProperties.clientId = m_clientId;
 		message.msg.dm_SetMotionCompensationProperties.messageId = 0;
+		message.msg.dm_SetMotionCompensationProperties.group = group;
 		message.msg.dm_SetMotionCompensationProperties.velAccCompensationModeValid = true;
 		message.msg.dm_SetMotionCompensationProperties.velAccCompensationMode = velAccMode;
 		message.msg.dm_SetMotionCompensationProperties.kalmanFilterProcessNoiseValid = false;
@@ -1541,7 +1779,7 @@ void VRInputEmulator::setMotionVelAccCompensationMode(MotionCompensationVelAccMo
 				std::lock_guard<std::recursive_mutex> lock(_mutex);
 				_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
 			}
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			_sendRequest(message, true);
 			auto resp = respFuture.get();
 			{
 				std::lock_guard<std::recursive_mutex> lock(_mutex);
@@ -1550,7 +1788,7 @@ void VRInputEmulator::setMotionVelAccCompensationMode(MotionCompensationVelAccMo
 			std::stringstream ss;
 			ss << "Error while setting motion compensation properties: ";
 			if (resp.status == ipc::ReplyStatus::InvalidId) {
-				ss << "Invalid device id";
+				ss << "Invalid group id";
 				throw vrinputemulator_invalidid(ss.str(), (int)resp.status);
 			} else if (resp.status == ipc::ReplyStatus::NotFound) {
 				ss << "Device not found";
@@ -1560,19 +1798,20 @@ void VRInputEmulator::setMotionVelAccCompensationMode(MotionCompensationVelAccMo
 				throw vrinputemulator_exception(ss.str(), (int)resp.status);
 			}
 		} else {
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			_sendRequest(message);
 		}
 	} else {
 		throw vrinputemulator_connectionerror("No active connection.");
 	}
 }
 
-void VRInputEmulator::setMotionCompensationKalmanProcessNoise(double variance, bool modal) {
+void VRInputEmulator::setMotionCompensationKalmanProcessNoise(double variance, bool modal, uint32_t group) {
 	if (_ipcServerQueue) {
 		ipc::Request message(ipc::RequestType::DeviceManipulation_SetMotionCompensationProperties);
 		memset(&message.msg, 0, sizeof(message.msg));
 		message.msg.dm_SetMotionCompensationProperties.clientId = m_clientId;
 		message.msg.dm_SetMotionCompensationProperties.messageId = 0;
+		message.msg.dm_SetMotionCompensationProperties.group = group;
 		message.msg.dm_SetMotionCompensationProperties.velAccCompensationModeValid = false;
 		message.msg.dm_SetMotionCompensationProperties.kalmanFilterProcessNoiseValid = true;
 		message.msg.dm_SetMotionCompensationProperties.kalmanFilterProcessNoise = variance;
@@ -1586,7 +1825,7 @@ void VRInputEmulator::setMotionCompensationKalmanProcessNoise(double variance, b
 				std::lock_guard<std::recursive_mutex> lock(_mutex);
 				_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
 			}
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			_sendRequest(message, true);
 			auto resp = respFuture.get();
 			{
 				std::lock_guard<std::recursive_mutex> lock(_mutex);
@@ -1595,7 +1834,7 @@ void VRInputEmulator::setMotionCompensationKalmanProcessNoise(double variance, b
 			std::stringstream ss;
 			ss << "Error while setting motion compensation properties: ";
 			if (resp.status == ipc::ReplyStatus::InvalidId) {
-				ss << "Invalid device id";
+				ss << "Invalid group id";
 				throw vrinputemulator_invalidid(ss.str(), (int)resp.status);
 			} else if (resp.status == ipc::ReplyStatus::NotFound) {
 				ss << "Device not found";
@@ -1605,19 +1844,20 @@ void VRInputEmulator::setMotionCompensationKalmanProcessNoise(double variance, b
 				throw vrinputemulator_exception(ss.str(), (int)resp.status);
 			}
 		} else {
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			_sendRequest(message);
 		}
 	} else {
 		throw vrinputemulator_connectionerror("No active connection.");
 	}
 }
 
-void VRInputEmulator::setMotionCompensationKalmanObservationNoise(double variance, bool modal) {
+void VRInputEmulator::setMotionCompensationKalmanObservationNoise(double variance, bool modal, uint32_t group) {
 	if (_ipcServerQueue) {
 		ipc::Request message(ipc::RequestType::DeviceManipulation_SetMotionCompensationProperties);
 		memset(&message.msg, 0, sizeof(message.msg));
 		message.msg.dm_SetMotionCompensationProperties.clientId = m_clientId;
 		message.msg.dm_SetMotionCompensationProperties.messageId = 0;
+		message.msg.dm_SetMotionCompensationProperties.group = group;
 		message.msg.dm_SetMotionCompensationProperties.velAccCompensationModeValid = false;
 		message.msg.dm_SetMotionCompensationProperties.kalmanFilterProcessNoiseValid = false;
 		message.msg.dm_SetMotionCompensationProperties.kalmanFilterObservationNoiseValid = true;
@@ -1631,7 +1871,7 @@ void VRInputEmulator::setMotionCompensationKalmanObservationNoise(double varianc
 				std::lock_guard<std::recursive_mutex> lock(_mutex);
 				_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
 			}
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			_sendRequest(message, true);
 			auto resp = respFuture.get();
 			{
 				std::lock_guard<std::recursive_mutex> lock(_mutex);
@@ -1640,7 +1880,7 @@ void VRInputEmulator::setMotionCompensationKalmanObservationNoise(double varianc
 			std::stringstream ss;
 			ss << "Error while setting motion compensation properties: ";
 			if (resp.status == ipc::ReplyStatus::InvalidId) {
-				ss << "Invalid device id";
+				ss << "Invalid group id";
 				throw vrinputemulator_invalidid(ss.str(), (int)resp.status);
 			} else if (resp.status == ipc::ReplyStatus::NotFound) {
 				ss << "Device not found";
@@ -1650,19 +1890,20 @@ void VRInputEmulator::setMotionCompensationKalmanObservationNoise(double varianc
 				throw vrinputemulator_exception(ss.str(), (int)resp.status);
 			}
 		} else {
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			_sendRequest(message);
 		}
 	} else {
 		throw vrinputemulator_connectionerror("No active connection.");
 	}
 }
 
-void VRInputEmulator::setMotionCompensationMovingAverageWindow(unsigned window, bool modal) {
+void VRInputEmulator::setMotionCompensationMovingAverageWindow(unsigned window, bool modal, uint32_t group) {
 	if (_ipcServerQueue) {
 		ipc::Request message(ipc::RequestType::DeviceManipulation_SetMotionCompensationProperties);
 		memset(&message.msg, 0, sizeof(message.msg));
 		message.msg.dm_SetMotionCompensationProperties.clientId = m_clientId;
 		message.msg.dm_SetMotionCompensationProperties.messageId = 0;
+		message.msg.dm_SetMotionCompensationProperties.group = group;
 		message.msg.dm_SetMotionCompensationProperties.velAccCompensationModeValid = false;
 		message.msg.dm_SetMotionCompensationProperties.kalmanFilterProcessNoiseValid = false;
 		message.msg.dm_SetMotionCompensationProperties.kalmanFilterObservationNoiseValid = false;
@@ -1677,7 +1918,7 @@ void VRInputEmulator::setMotionCompensationMovingAverageWindow(unsigned window,
 				std::lock_guard<std::recursive_mutex> lock(_mutex);
 				_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
 			}
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			_sendRequest(message, true);
 			auto resp = respFuture.get();
 			{
 				std::lock_guard<std::recursive_mutex> lock(_mutex);
@@ -1685,6 +1926,50 @@ void VRInputEmulator::setMotionCompensationMovingAverageWindow(unsigned window,
 			}
 			std::stringstream ss;
 			ss << "Error while setting motion compensation properties: ";
+			if (resp.status == ipc::ReplyStatus::InvalidId) {
+				ss << "Invalid group id";
+				throw vrinputemulator_invalidid(ss.str(), (int)resp.status);
+			} else if (resp.status == ipc::ReplyStatus::NotFound) {
+				ss << "Device not found";
+				throw vrinputemulator_notfound(ss.str(), (int)resp.status);
+			} else if (resp.status != ipc::ReplyStatus::Ok) {
+				ss << "Error code " << (int)resp.status;
+				throw vrinputemulator_exception(ss.str(), (int)resp.status);
+			}
+		} else {
+			_sendRequest(message);
+		}
+	} else {
+		throw vrinputemulator_connectionerror("No active connection.");
+	}
+}
+
+
+void VRInputEmulator::setPoseSmoothing(uint32_t deviceId, const PoseSmoothingSettings& settings, bool modal) {
+	if (_ipcServerQueue) {
+		ipc::Request message(ipc::RequestType::DeviceManipulation_SetPoseSmoothing);
+		memset(&message.msg, 0, sizeof(message.msg));
+		message.msg.dm_SetPoseSmoothing.clientId = m_clientId;
+		message.msg.dm_SetPoseSmoothing.messageId = 0;
+		message.msg.dm_SetPoseSmoothing.deviceId = deviceId;
+		message.msg.dm_SetPoseSmoothing.settings = settings;
+		if (modal) {
+			uint32_t messageId = _ipcRandomDist(_ipcRandomDevice);
+			message.msg.dm_SetPoseSmoothing.messageId = messageId;
+			std::promise<ipc::Reply> respPromise;
+			auto respFuture = respPromise.get_future();
+			{
+				std::lock_guard<std::recursive_mutex> lock(_mutex);
+				_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
+			}
+			_sendRequest(message, true);
+			auto resp = respFuture.get();
+			{
+				std::lock_guard<std::recursive_mutex> lock(_mutex);
+				_ipcPromiseMap.erase(messageId);
+			}
+			std::stringstream ss;
+			ss << "Error while setting pose smoothing: ";
 			if (resp.status == ipc::ReplyStatus::InvalidId) {
 				ss << "Invalid device id";
 				throw vrinputemulator_invalidid(ss.str(), (int)resp.status);
@@ -1696,7 +1981,7 @@ void VRInputEmulator::setMotionCompensationMovingAverageWindow(unsigned window,
 				throw vrinputemulator_exception(ss.str(), (int)resp.status);
 			}
 		} else {
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			_sendRequest(message);
 		}
 	} else {
 		throw vrinputemulator_connectionerror("No active connection.");
@@ -1704,16 +1989,164 @@ void VRInputEmulator::setMotionCompensationMovingAverageWindow(unsigned window,
 }
 
 
-void VRInputEmulator::triggerHapticPulse(uint32_t deviceId, uint32_t axisId, uint16_t durationMicroseconds, bool directMode, bool modal) {
+void VRInputEmulator::setDeviceMotionCompensationGroup(uint32_t deviceId, uint32_t group, bool modal) {
 	if (_ipcServerQueue) {
-		ipc::Request message(ipc::RequestType::DeviceManipulation_TriggerHapticPulse);
+		ipc::Request message(ipc::RequestType::DeviceManipulation_SetMotionCompensationGroup);
 		memset(&message.msg, 0, sizeof(message.msg));
+		message.msg.dm_SetMotionCompensationGroup.clientId = m_clientId;
+		message.msg.dm_SetMotionCompensationGroup.messageId = 0;
+		message.msg.dm_SetMotionCompensationGroup.deviceId = deviceId;
+		message.msg.dm_SetMotionCompensationGroup.group = group;
+		if (modal) {
+			uint32_t messageId = _ipcRandomDist(_ipcRandomDevice);
+			message.msg.dm_SetMotionCompensationGroup.messageId = messageId;
+			std::promise<ipc::Reply> respPromise;
+			auto respFuture = respPromise.get_future();
+			{
+				std::lock_guard<std::recursive_mutex> lock(_mutex);
+				_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
+			}
+			_sendRequest(message, true);
+			auto resp = respFuture.get();
+			{
+				std::lock_guard<std::recursive_mutex> lock(_mutex);
+				_ipcPromiseMap.erase(messageId);
+			}
+			std::stringstream ss;
+			ss << "Error while setting motion compensation group: ";
+			if (resp.status == ipc::ReplyStatus::InvalidId) {
+				ss << "Invalid device or group id";
+				throw vrinputemulator_invalidid(ss.str(), (int)resp.status);
+			} else if (resp.status == ipc::ReplyStatus::NotFound) {
+				ss << "Device not found";
+				throw vrinputemulator_notfound(ss.str(), (int)resp.status);
+			} else if (resp.status == ipc::ReplyStatus::InvalidOperation) {
+				ss << "Device is the reference of its group";
+				throw vrinputemulator_exception(ss.str(), (int)resp.status);
+			} else if (resp.status != ipc::ReplyStatus::Ok) {
+				ss << "Error code " << (int)resp.status;
+				throw vrinputemulator_exception(ss.str(), (int)resp.status);
+			}
+		} else {
+			_sendRequest(message);
+		}
+	} else {
+		throw vrinputemulator_connectionerror("No active connection.");
+	}
+}
+
+
+void VRInputEmulator::subscribeDeviceStateChanges(std::function<void(const DeviceState&)> callback, bool modal) {
+	if (_ipcServerQueue) {
+		{
+			std::lock_guard<std::recursive_mutex> lock(_mutex);
+			_deviceStateCallback = callback;
+		}
+		ipc::Request message(ipc::RequestType::DeviceManipulation_SubscribeDeviceStateChanges);
+		message.msg.dm_SubscribeDeviceStateChanges.clientId = m_clientId;
+		message.msg.dm_SubscribeDeviceStateChanges.messageId = 0;
+		message.msg.dm_SubscribeDeviceStateChanges.subscribe = true;
+		if (modal) {
+			uint32_t messageId = _ipcRandomDist(_ipcRandomDevice);
+			message.msg.dm_SubscribeDeviceStateChanges.messageId = messageId;
+			std::promise<ipc::Reply> respPromise;
+			auto respFuture = respPromise.get_future();
+			{
+				std::lock_guard<std::recursive_mutex> lock(_mutex);
+				_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
+			}
+			_sendRequest(message, true);
+			auto resp = respFuture.get();
+			{
+				std::lock_guard<std::recursive_mutex> lock(_mutex);
+				_ipcPromiseMap.erase(messageId);
+			}
+			if (resp.status != ipc::ReplyStatus::Ok) {
+				std::stringstream ss;
+				ss << "Error while subscribing to device state changes: Error code " << (int)resp.status;
+				throw vrinputemulator_exception(ss.str(), (int)resp.status);
+			}
+		} else {
+			_sendRequest(message);
+		}
+	} else {
+		throw vrinputemulator_connectionerror("No active connection.");
+	}
+}
+
+
+void VRInputEmulator::unsubscribeDeviceStateChanges(bool modal) {
+	if (_ipcServerQueue) {
+		ipc::Request message(ipc::RequestType::DeviceManipulation_SubscribeDeviceStateChanges);
+		message.msg.dm_SubscribeDeviceStateChanges.clientId = m_clientId;
+		message.msg.dm_SubscribeDeviceStateChanges.messageId = 0;
+		message.msg.dm_SubscribeDeviceStateChanges.subscribe = false;
+		if (modal) {
+			uint32_t messageId = _ipcRandomDist(_ipcRandomDevice);
+			message.msg.dm_SubscribeDeviceStateChanges.messageId = messageId;
+			std::promise<ipc::Reply> respPromise;
+			auto respFuture = respPromise.get_future();
+			{
+				std::lock_guard<std::recursive_mutex> lock(_mutex);
+				_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
+			}
+			_sendRequest(message, true);
+			auto resp = respFuture.get();
+			{
+				std::lock_guard<std::recursive_mutex> lock(_mutex);
+				_ipcPromiseMap.erase(messageId);
+				_deviceStateCallback = nullptr;
+			}
+			if (resp.status != ipc::ReplyStatus::Ok) {
+				std::stringstream ss;
+				ss << "Error while unsubscribing from device state changes: Error code " << (int)resp.status;
+				throw vrinputemulator_exception(ss.str(), (int)resp.status);
+			}
+		} else {
+			_sendRequest(message);
+			std::lock_guard<std::recursive_mutex> lock(_mutex);
+			_deviceStateCallback = nullptr;
+		}
+	} else {
+		throw vrinputemulator_connectionerror("No active connection.");
+	}
+}
+
+
+void VRInputEmulator::triggerHapticPulse(uint32_t deviceId, uint32_t axisId, uint16_t durationMicroseconds, bool directMode, bool modal) {
+	ipc::Request message(ipc::RequestType::DeviceManipulation_TriggerHapticPulse);
+	memset(&message.msg, 0, sizeof(message.msg));
+	message.msg.dm_triggerHapticPulse.deviceId = deviceId;
+	message.msg.dm_triggerHapticPulse.axisId = axisId;
+	message.msg.dm_triggerHapticPulse.durationMicroseconds = durationMicroseconds;
+	message.msg.dm_triggerHapticPulse.directMode = directMode;
+	_sendTriggerHapticPulseRequest(message, modal);
+}
+
+
+void VRInputEmulator::triggerHapticWaveform(uint32_t deviceId, const HapticWaveformSegment* segments, uint32_t segmentCount, bool directMode, bool modal) {
+	if (segmentCount == 0 || segmentCount > maxHapticWaveformSegments) {
+		throw vrinputemulator_exception("Invalid number of waveform segments.");
+	}
+	for (uint32_t i = 0; i < segmentCount; ++i) {
+		if (!std::isfinite(segments[i].durationSeconds) || !std::isfinite(segments[i].frequency) || !std::isfinite(segments[i].amplitude)) {
+			throw vrinputemulator_exception("Invalid waveform segment.");
+		}
+	}
+	ipc::Request message(ipc::RequestType::DeviceManipulation_TriggerHapticPulse);
+	memset(&message.msg, 0, sizeof(message.msg));
+	message.msg.dm_triggerHapticPulse.deviceId = deviceId;
+	message.msg.dm_triggerHapticPulse.directMode = directMode;
+	message.msg.dm_triggerHapticPulse.waveformSegmentCount = segmentCount;
+	std::copy(segments, segments + segmentCount, message.msg.dm_triggerHapticPulse.waveform);
+	_sendTriggerHapticPulseRequest(message, modal);
+}
+
+
+void VRInputEmulator::_sendTriggerHapticPulseRequest(ipc::Request& message, bool modal) {
+	if (_ipcServerQueue) {
 		message.msg.dm_triggerHapticPulse.clientId = m_clientId;
 		message.msg.dm_triggerHapticPulse.messageId = 0;
-		message.msg.dm_triggerHapticPulse.deviceId = deviceId;
-		message.msg.dm_triggerHapticPulse.axisId = axisId;
-		message.msg.dm_triggerHapticPulse.durationMicroseconds = durationMicroseconds;
-		message.msg.dm_triggerHapticPulse.directMode = directMode;
 		if (modal) {
 			uint32_t messageId = _ipcRandomDist(_ipcRandomDevice);
 			message.msg.dm_triggerHapticPulse.messageId = messageId;
@@ -1723,26 +2156,29 @@ void VRInputEmulator::triggerHapticPulse(uint32_t deviceId, uint32_t axisId, uin
 				std::lock_guard<std::recursive_mutex> lock(_mutex);
 				_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
 			}
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			_sendRequest(message, true);
 			auto resp = respFuture.get();
 			{
 				std::lock_guard<std::recursive_mutex> lock(_mutex);
 				_ipcPromiseMap.erase(messageId);
 			}
 			std::stringstream ss;
-			ss << "Error while enabling device offsets: ";
+			ss << "Error while triggering haptic pulse: ";
 			if (resp.status == ipc::ReplyStatus::InvalidId) {
 				ss << "Invalid device id";
 				throw vrinputemulator_invalidid(ss.str(), (int)resp.status);
 			} else if (resp.status == ipc::ReplyStatus::NotFound) {
 				ss << "Device not found";
 				throw vrinputemulator_notfound(ss.str(), (int)resp.status);
+			} else if (resp.status == ipc::ReplyStatus::InvalidOperation) {
+				ss << "Invalid waveform segment";
+				throw vrinputemulator_exception(ss.str(), (int)resp.status);
 			} else if (resp.status != ipc::ReplyStatus::Ok) {
 				ss << "Error code " << (int)resp.status;
 				throw vrinputemulator_exception(ss.str(), (int)resp.status);
 			}
 		} else {
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			_sendRequest(message);
 		}
 	} else {
 		throw vrinputemulator_connectionerror("No active connection.");
@@ -1767,7 +2203,7 @@ void VRInputEmulator::setDigitalInputRemapping(uint32_t deviceId, uint32_t butto
 				std::lock_guard<std::recursive_mutex> lock(_mutex);
 				_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
 			}
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			_sendRequest(message, true);
 			auto resp = respFuture.get();
 			{
 				std::lock_guard<std::recursive_mutex> lock(_mutex);
@@ -1786,7 +2222,7 @@ void VRInputEmulator::setDigitalInputRemapping(uint32_t deviceId, uint32_t butto
 				throw vrinputemulator_exception(ss.str(), (int)resp.status);
 			}
 		} else {
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			_sendRequest(message);
 		}
 	} else {
 		throw vrinputemulator_connectionerror("No active connection.");
@@ -1807,7 +2243,7 @@ DigitalInputRemapping VRInputEmulator::getDigitalInputRemapping(uint32_t deviceI
 			std::lock_guard<std::recursive_mutex> lock(_mutex);
 			_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
 		}
-		_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+		_sendRequest(message, true);
 		auto resp = respFuture.get();
 		{
 			std::lock_guard<std::recursive_mutex> lock(_mutex);
@@ -1842,7 +2278,7 @@ void VRInputEmulator::setAnalogInputRemapping(uint32_t deviceId, uint32_t axisId
 				std::lock_guard<std::recursive_mutex> lock(_mutex);
 				_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
 			}
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			_sendRequest(message, true);
 			auto resp = respFuture.get();
 			{
 				std::lock_guard<std::recursive_mutex> lock(_mutex);
@@ -1861,7 +2297,7 @@ void VRInputEmulator::setAnalogInputRemapping(uint32_t deviceId, uint32_t axisId
 				throw vrinputemulator_exception(ss.str(), (int)resp.status);
 			}
 		} else {
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			_sendRequest(message);
 		}
 	} else {
 		throw vrinputemulator_connectionerror("No active connection.");
@@ -1882,7 +2318,7 @@ AnalogInputRemapping VRInputEmulator::getAnalogInputRemapping(uint32_t deviceId,
 			std::lock_guard<std::recursive_mutex> lock(_mutex);
 			_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
 		}
-		_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+		_sendRequest(message, true);
 		auto resp = respFuture.get();
 		{
 			std::lock_guard<std::recursive_mutex> lock(_mutex);
@@ -1900,6 +2336,287 @@ AnalogInputRemapping VRInputEmulator::getAnalogInputRemapping(uint32_t deviceId,
 }
 
 
+const ipc::SharedDeviceStateTable* VRInputEmulator::_getDeviceStateTable() {
+	if (!_ipcServerQueue) {
+		throw vrinputemulator_connectionerror("No active connection.");
+	}
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	if (!_deviceStateTable) {
+		try {
+			_deviceStateShm.reset(new boost::interprocess::shared_memory_object(boost::interprocess::open_only, IPC_SHM_DEVICESTATE_NAME, boost::interprocess::read_only));
+			_deviceStateRegion.reset(new boost::interprocess::mapped_region(*_deviceStateShm, boost::interprocess::read_only));
+		} catch (std::exception& e) {
+			_deviceStateRegion.reset();
+			_deviceStateShm.reset();
+			std::stringstream ss;
+			ss << "Could not open device state shared memory: " << e.what();
+			throw vrinputemulator_connectionerror(ss.str());
+		}
+		auto table = (const ipc::SharedDeviceStateTable*)_deviceStateRegion->get_address();
+		if (_deviceStateRegion->get_size() < sizeof(ipc::SharedDeviceStateTable) || table->layoutVersion != IPC_SHM_LAYOUT_VERSION) {
+			_deviceStateRegion.reset();
+			_deviceStateShm.reset();
+			throw vrinputemulator_invalidversion("Incompatible device state shared memory layout.");
+		}
+		_deviceStateTable = table;
+	}
+	return _deviceStateTable;
+}
+
+
+bool VRInputEmulator::readDeviceState(uint32_t deviceId, DeviceState& state, uint64_t* digitalRemappingMask, uint32_t* analogRemappingMask) {
+	if (deviceId >= vr::k_unMaxTrackedDeviceCount) {
+		throw vrinputemulator_invalidid("Invalid device id");
+	}
+	auto& entry = _getDeviceStateTable()->devices[deviceId];
+	ipc::SharedDeviceStateData data;
+	while (!ipc::seqlockTryRead(entry.stateSequence, entry.state, data)) {
+		std::this_thread::yield();
+	}
+	if (data.valid) {
+		state = data.state;
+		if (digitalRemappingMask) {
+			*digitalRemappingMask = data.digitalRemappingMask;
+		}
+		if (analogRemappingMask) {
+			*analogRemappingMask = data.analogRemappingMask;
+		}
+	}
+	return data.valid;
+}
+
+
+bool VRInputEmulator::readDevicePose(uint32_t deviceId, vr::DriverPose_t& pose, int64_t* timestamp) {
+	if (deviceId >= vr::k_unMaxTrackedDeviceCount) {
+		throw vrinputemulator_invalidid("Invalid device id");
+	}
+	auto& entry = _getDeviceStateTable()->devices[deviceId];
+	{
+		// The driver only mirrors poses into the table while someone reads them
+		std::lock_guard<std::recursive_mutex> lock(_mutex);
+		if (!_devicePosesSubscribed) {
+			ipc::Request message(ipc::RequestType::DeviceManipulation_SubscribeDevicePoses);
+			message.msg.dm_SubscribeDevicePoses.clientId = m_clientId;
+			message.msg.dm_SubscribeDevicePoses.messageId = 0;
+			message.msg.dm_SubscribeDevicePoses.subscribe = true;
+			_sendRequest(message);
+			_devicePosesSubscribed = true;
+		}
+	}
+	ipc::SharedDevicePoseData data;
+	while (!ipc::seqlockTryRead(entry.poseSequence, entry.pose, data)) {
+		std::this_thread::yield();
+	}
+	if (data.valid) {
+		pose = data.pose;
+		if (timestamp) {
+			*timestamp = data.timestamp;
+		}
+	}
+	return data.valid;
+}
+
+
+uint32_t VRInputEmulator::readDeviceStateUpdateCounter() {
+	return _getDeviceStateTable()->updateCounter.load(std::memory_order_acquire);
+}
+
+
+uint64_t VRInputEmulator::readDroppedInjectedEventCount() {
+	return _getDeviceStateTable()->droppedInjectedEvents.load(std::memory_order_relaxed);
+}
+
+
+void VRInputEmulator::_sendPoseTelemetryRequest(bool subscribe, uint64_t deviceMask, uint32_t capacity) {
+	if (_ipcServerQueue) {
+		uint32_t messageId = _ipcRandomDist(_ipcRandomDevice);
+		ipc::Request message(ipc::RequestType::DeviceManipulation_SubscribePoseTelemetry);
+		message.msg.dm_SubscribePoseTelemetry.clientId = m_clientId;
+		message.msg.dm_SubscribePoseTelemetry.messageId = messageId;
+		message.msg.dm_SubscribePoseTelemetry.subscribe = subscribe;
+		message.msg.dm_SubscribePoseTelemetry.deviceMask = deviceMask;
+		message.msg.dm_SubscribePoseTelemetry.capacity = capacity;
+		std::promise<ipc::Reply> respPromise;
+		auto respFuture = respPromise.get_future();
+		{
+			std::lock_guard<std::recursive_mutex> lock(_mutex);
+			_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
+		}
+		_sendRequest(message, true);
+		auto resp = respFuture.get();
+		{
+			std::lock_guard<std::recursive_mutex> lock(_mutex);
+			_ipcPromiseMap.erase(messageId);
+		}
+		if (resp.status != ipc::ReplyStatus::Ok) {
+			std::stringstream ss;
+			ss << "Error while " << (subscribe ? "enabling" : "disabling") << " pose telemetry: Error code " << (int)resp.status;
+			throw vrinputemulator_exception(ss.str(), (int)resp.status);
+		}
+	} else {
+		throw vrinputemulator_connectionerror("No active connection.");
+	}
+}
+
+
+void VRInputEmulator::enablePoseTelemetry(uint64_t deviceMask, uint32_t capacity) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	// The driver creates a new ring on every subscribe, so drop the old mapping first
+	_poseTelemetryRing = nullptr;
+	_poseTelemetryRegion.reset();
+	_poseTelemetryShm.reset();
+	_sendPoseTelemetryRequest(true, deviceMask, capacity);
+	auto shmName = std::string(IPC_SHM_POSETELEMETRY_NAME) + std::to_string(m_clientId);
+	try {
+		_poseTelemetryShm.reset(new boost::interprocess::shared_memory_object(boost::interprocess::open_only, shmName.c_str(), boost::interprocess::read_write));
+		_poseTelemetryRegion.reset(new boost::interprocess::mapped_region(*_poseTelemetryShm, boost::interprocess::read_write));
+	} catch (std::exception& e) {
+		_poseTelemetryRegion.reset();
+		_poseTelemetryShm.reset();
+		std::stringstream ss;
+		ss << "Could not open pose telemetry shared memory: " << e.what();
+		throw vrinputemulator_connectionerror(ss.str());
+	}
+	auto ring = (ipc::PoseTelemetryRing*)_poseTelemetryRegion->get_address();
+	if (ring->layoutVersion != IPC_SHM_LAYOUT_VERSION || _poseTelemetryRegion->get_size() < ipc::PoseTelemetryRing::sizeFor(ring->capacity)) {
+		_poseTelemetryRegion.reset();
+		_poseTelemetryShm.reset();
+		throw vrinputemulator_invalidversion("Incompatible pose telemetry shared memory layout.");
+	}
+	_poseTelemetryRing = ring;
+}
+
+
+void VRInputEmulator::disablePoseTelemetry() {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	_poseTelemetryRing = nullptr;
+	_poseTelemetryRegion.reset();
+	_poseTelemetryShm.reset();
+	_sendPoseTelemetryRequest(false, 0, 0);
+}
+
+
+uint32_t VRInputEmulator::readPoseTelemetry(PoseTelemetryRecord* records, uint32_t maxCount) {
+	auto ring = _poseTelemetryRing;
+	if (!ring) {
+		throw vrinputemulator_exception("Pose telemetry is not enabled.");
+	}
+	auto readIndex = ring->readIndex.load(std::memory_order_relaxed);
+	auto available = ring->writeIndex.load(std::memory_order_acquire) - readIndex;
+	uint32_t count = (uint32_t)std::min<uint64_t>(available, maxCount);
+	for (uint32_t i = 0; i < count; ++i) {
+		records[i] = ring->records()[(readIndex + i) & (ring->capacity - 1)];
+	}
+	ring->readIndex.store(readIndex + count, std::memory_order_release);
+	return count;
+}
+
+
+uint64_t VRInputEmulator::getPoseTelemetryDroppedRecords() {
+	auto ring = _poseTelemetryRing;
+	if (!ring) {
+		throw vrinputemulator_exception("Pose telemetry is not enabled.");
+	}
+	return ring->droppedRecords.load(std::memory_order_relaxed);
+}
+
+
+
+void VRInputEmulator::_sendHookCaptureRequest(bool start, const std::string& fileName, uint32_t maxSizeMB) {
+	if (_ipcServerQueue) {
+		uint32_t messageId = _ipcRandomDist(_ipcRandomDevice);
+		ipc::Request message(ipc::RequestType::DeviceManipulation_HookCapture);
+		memset(&message.msg, 0, sizeof(message.msg));
+		message.msg.dm_HookCapture.clientId = m_clientId;
+		message.msg.dm_HookCapture.messageId = messageId;
+		message.msg.dm_HookCapture.start = start;
+		message.msg.dm_HookCapture.maxSizeMB = maxSizeMB;
+		strncpy_s(message.msg.dm_HookCapture.fileName, fileName.c_str(), sizeof(message.msg.dm_HookCapture.fileName) - 1);
+		std::promise<ipc::Reply> respPromise;
+		auto respFuture = respPromise.get_future();
+		{
+			std::lock_guard<std::recursive_mutex> lock(_mutex);
+			_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
+		}
+		_sendRequest(message, true);
+		auto resp = respFuture.get();
+		{
+			std::lock_guard<std::recursive_mutex> lock(_mutex);
+			_ipcPromiseMap.erase(messageId);
+		}
+		if (resp.status != ipc::ReplyStatus::Ok) {
+			std::stringstream ss;
+			ss << "Error while " << (start ? "starting" : "stopping") << " hook capture: Error code " << (int)resp.status;
+			throw vrinputemulator_exception(ss.str(), (int)resp.status);
+		}
+	} else {
+		throw vrinputemulator_connectionerror("No active connection.");
+	}
+}
+
+
+void VRInputEmulator::startHookCapture(const std::string& fileName, uint32_t maxSizeMB) {
+	if (fileName.empty() || fileName.size() >= sizeof(ipc::Request_DeviceManipulation_HookCapture::fileName)
+			|| fileName == ".." || fileName.find_first_of("/\\:") != std::string::npos) {
+		throw vrinputemulator_exception("Invalid capture file name.");
+	}
+	_sendHookCaptureRequest(true, fileName, maxSizeMB);
+}
+
+
+void VRInputEmulator::stopHookCapture() {
+	_sendHookCaptureRequest(false, std::string(), 0);
+}
+
+
+void VRInputEmulator::_sendInputMirrorRequest(uint32_t sourceDeviceId, uint32_t targetDeviceId, bool enable) {
+	if (_ipcServerQueue) {
+		uint32_t messageId = _ipcRandomDist(_ipcRandomDevice);
+		ipc::Request message(ipc::RequestType::DeviceManipulation_InputMirror);
+		memset(&message.msg, 0, sizeof(message.msg));
+		message.msg.dm_InputMirror.clientId = m_clientId;
+		message.msg.dm_InputMirror.messageId = messageId;
+		message.msg.dm_InputMirror.sourceDeviceId = sourceDeviceId;
+		message.msg.dm_InputMirror.targetDeviceId = targetDeviceId;
+		message.msg.dm_InputMirror.enable = enable;
+		std::promise<ipc::Reply> respPromise;
+		auto respFuture = respPromise.get_future();
+		{
+			std::lock_guard<std::recursive_mutex> lock(_mutex);
+			_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
+		}
+		_sendRequest(message, true);
+		auto resp = respFuture.get();
+		{
+			std::lock_guard<std::recursive_mutex> lock(_mutex);
+			_ipcPromiseMap.erase(messageId);
+		}
+		std::stringstream ss;
+		ss << "Error while " << (enable ? "adding" : "removing") << " input mirror: ";
+		if (resp.status == ipc::ReplyStatus::InvalidId) {
+			ss << "Invalid device id";
+			throw vrinputemulator_invalidid(ss.str(), (int)resp.status);
+		} else if (resp.status == ipc::ReplyStatus::InvalidOperation) {
+			ss << "Too many mirrors";
+			throw vrinputemulator_toomanydevices(ss.str(), (int)resp.status);
+		} else if (resp.status != ipc::ReplyStatus::Ok) {
+			ss << "Error code " << (int)resp.status;
+			throw vrinputemulator_exception(ss.str(), (int)resp.status);
+		}
+	} else {
+		throw vrinputemulator_connectionerror("No active connection.");
+	}
+}
+
+
+void VRInputEmulator::addInputMirror(uint32_t sourceDeviceId, uint32_t targetDeviceId) {
+	_sendInputMirrorRequest(sourceDeviceId, targetDeviceId, true);
+}
+
+
+void VRInputEmulator::removeInputMirror(uint32_t sourceDeviceId, uint32_t targetDeviceId) {
+	_sendInputMirrorRequest(sourceDeviceId, targetDeviceId, false);
+}
 
 
 } // end namespace vrinputemulator